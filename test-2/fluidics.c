@@ -12,11 +12,21 @@
 
 #include "fluidics.h"
 
+#ifdef FLUIDIC_HOST_SIM
+#include "fluidicsSim.h"
+#endif
+
 /**
 * @addtogroup Fluidics
 *  @{
 */
 
+
+// The queue indices are free running, so the slot of an index must not jump
+// when the index wraps.
+_Static_assert((FLUIDIC_CMD_QUEUE_LEN & (FLUIDIC_CMD_QUEUE_LEN - 1u)) == 0u,
+               "FLUIDIC_CMD_QUEUE_LEN must be a power of two");
+
 STATIC XState FluidicState_Init(Fluidic_t* me, XEvent_t* pEv);
 STATIC XState FluidicState_Idle(Fluidic_t* me, XEvent_t* pEv);
 STATIC XState FluidicState_CheckForStrip(Fluidic_t* me, XEvent_t* pEv);
@@ -38,7 +48,25 @@ STATIC eErrorCode OnLiftUpBladders_Entry(Fluidic_t* me);
 STATIC eErrorCode FluidicMixContactControlled_OnEntry(Fluidic_t* me);
 STATIC eErrorCode FluidicMixPiezoControlled_OnEntry(Fluidic_t* me);
 STATIC XState FluidicMoveContact_OnTick (Fluidic_t* me);
-STATIC XState FluidicMixContactControlled_OnTick(Fluidic_t* me);
+STATIC XState FluidicMoveContact_CheckFluidFront(Fluidic_t* me, eErrorCode* pError);
+STATIC void FluidicMoveContact_ArmTimer(Fluidic_t* me);
+STATIC void FluidicFrontReset(Fluidic_t* me);
+STATIC void FluidicFrontOnStatusChange(Fluidic_t* me);
+STATIC bool FluidicFrontPredictVolts(Fluidic_t* me, eFluidicPositions_t eTarget, float* pVolts);
+STATIC void FluidicRecordBegin(Fluidic_t* me, eFluidicTelemetryKind_t eKind);
+STATIC void FluidicRecordFrontChange(Fluidic_t* me);
+STATIC void FluidicRecordRetry(Fluidic_t* me);
+STATIC void FluidicRecordEnd(Fluidic_t* me, eFluidicTelemetryOutcome_t eOutcome, eErrorCode error);
+STATIC void FluidicStatsOnRecord(Fluidic_t* me, const FluidicTelemetryRecord_t *pRec);
+STATIC void FluidicStatsOnFrontStop(Fluidic_t* me);
+STATIC void FluidicStatsOnPiezoStopped(Fluidic_t* me);
+STATIC void FluidicOnStatsDumpMsg(Fluidic_t* me, const XEvent_t *pEv);
+STATIC XState FluidicMixContactControlled_CheckFluidFront(Fluidic_t* me);
+STATIC XState FluidicMix_OnTimeout(Fluidic_t* me);
+STATIC void FluidicTimerArmSettle(Fluidic_t* me, uint32_t settle_ms);
+STATIC void FluidicTimerArmDeadline(Fluidic_t* me, uint32_t elapsed_ms, uint32_t timeout_ms);
+STATIC bool FluidicTimerIsDeadline(Fluidic_t* me);
+STATIC uint32_t FluidicMoveElapsedMs(Fluidic_t* me);
 STATIC eErrorCode FluidOnPiezoMoveComplete(Fluidic_t* me, XEvent_t* pEv);
 STATIC eErrorCode FluidOnPiezoStop(Fluidic_t* me, XEvent_t* pEv);
 STATIC eErrorCode FluidOnEchemStatusChange(Fluidic_t* me, XEvent_t* pEv);
@@ -53,7 +81,7 @@ STATIC XState FluidicState_MixWaitContinue(Fluidic_t *me,
 STATIC void Fluidic_OnErrorStateEntry(Fluidic_t *me);
 
 STATIC bool bladderControlCheckMoveValid(
-                                         Fluidic_t *me,
+                                         eFluidicPositions_t eFromPos,
                                          eFluidicPositions_t eTargetPos);
 
 
@@ -62,10 +90,17 @@ STATIC bool bladderControlCheckValidPosChange(
                                               eFluidicPositions_t eTargetPos);
 
 STATIC bool isFrequencyOk(Fluidic_t* me, 
+                          eFluidicPositions_t eFromPos,
                           eFluidicPositions_t eTargetPos,
-                          float mixFrequency_Hz);
-STATIC bool isMixPositionOk(Fluidic_t* me, eFluidicPositions_t eTargetPos);
+                          float mixFrequency_Hz,
+                          eFluidMixingType_t eMixType);
+STATIC bool isMixPositionOk(eFluidicPositions_t eFromPos, eFluidicPositions_t eTargetPos);
+STATIC float FluidicMixAutoFrequency(const Fluidic_t *me,
+                                     eFluidicPositions_t eFromPos,
+                                     eFluidicPositions_t eTargetPos,
+                                     eFluidMixingType_t eMixType);
 STATIC bool isMixTimeoutOk(Fluidic_t* me, uint32_t mixTimeout_ms);
+STATIC bool FluidicParamsAreValid(const FluidicParams_t *pParams);
 
 
 STATIC XState OnMsgBladderControlMoveToPos(Fluidic_t  *me, 
@@ -74,6 +109,8 @@ STATIC XState OnMsgBladderControlMoveToPos(Fluidic_t  *me,
 STATIC XState OnMsgBladderControlMix(Fluidic_t  *me, 
                                      const XEvent_t *pEv);
 STATIC eErrorCode FluidicBeginPiezoMoveToTarget(Fluidic_t* me);
+STATIC eErrorCode FluidicBeginPiezoMoveToContact(Fluidic_t* me);
+STATIC eErrorCode FluidicMoveContact_OnPiezoStop(Fluidic_t* me, const XEvent_t *pEv);
 
 STATIC eErrorCode FluidicBeginPiezoMoveToLift(Fluidic_t* me);
 
@@ -83,6 +120,7 @@ STATIC void OnMsgUpdateParams(Fluidic_t *me, XEvent_t* pEv);
 STATIC XState FluidicsErrorSet(Fluidic_t *me, eErrorCode err, XState retCode);
 
 STATIC eErrorCode FluidCheckMoveParams(Fluidic_t *me,
+                                       eFluidicPositions_t eFromPos,
                                        eFluidicPositions_t eTarget,
                                        float rampSpeedVoltsPerSec,
                                        uint32_t timeout_ms,
@@ -90,6 +128,7 @@ STATIC eErrorCode FluidCheckMoveParams(Fluidic_t *me,
                                        float compensationProportion);
 
 STATIC eErrorCode FluidCheckMixParams(Fluidic_t *me,
+                                      eFluidicPositions_t eFromPos,
                                       eFluidicPositions_t eTarget,
                                       float mixFrequency_Hz,
                                       uint32_t mixTimeout_ms,
@@ -104,28 +143,104 @@ STATIC eEcFluidDetectPosition_t fluidGetEchemRequirement(Fluidic_t* me,
 
 STATIC eErrorCode FluidicStopMove(Fluidic_t* me);
 STATIC eErrorCode FluidicHomeMoveBegin(Fluidic_t* me);
+STATIC void FluidicRunParamsInit(Fluidic_t* me);
+STATIC void FluidicRunParamsNewTest(Fluidic_t* me);
 
 
 STATIC void FluidicOnMoveCompleteMsg(Fluidic_t* me);
 STATIC void FluidicOnMixComplete(Fluidic_t* me);
 STATIC void FluidicOnMoveFailMsg(Fluidic_t *me, eFluidicPositions_t pos, eErrorCode eError);
+STATIC void FluidicReport(Fluidic_t *me, const XEvent_t *pEv);
 STATIC void FluidicSetCurrentAndTargetPositions(Fluidic_t* me, 
                                                 eFluidicPositions_t eCurrent,
                                                 eFluidicPositions_t eTarget);
 STATIC void AdjustHysterisisVoltage(Fluidic_t* me, 
                                     eFluidicHysterisisChangeType_t multiplierType);
+STATIC float FluidicHysterisisLimit(float hystVoltage);
+STATIC void FluidicMixControllerReset(Fluidic_t *me);
+STATIC void FluidicMixControllerUpdate(Fluidic_t *me, bool contactMade, float observedVolts);
+STATIC void FluidicMixControllerPi(Fluidic_t *me, bool contactMade, float observedVolts);
+STATIC void FluidicContactResponseUpdate(Fluidic_t *me, float observedVolts);
 
-STATIC void fluidicMixingCalculaterampSpeedVoltsPerSec(Fluidic_t* me,
-                                                       float startVolts,
-                                                       float endVolts);
 STATIC XState FluidMixOnStageComplete(Fluidic_t *me);
-STATIC float FluidicMixCalculateDownStrokeMixProportion(Fluidic_t *me);
-STATIC bool  FluidicStateCanAcceptCommand(Fluidic_t * me);
+STATIC void FluidicMixSwapDirection(Fluidic_t *me);
+STATIC void FluidicMixStrokeSet(const Fluidic_t *me,
+                                FluidicMixStroke_t *pStroke,
+                                eFluidicMoveDirection_t eDirection,
+                                float startVolts,
+                                float endVolts);
+STATIC float FluidicMixDownstrokeVolts(const Fluidic_t *me,
+                                       eFluidicPositions_t eLowerPos,
+                                       float upperVolts);
+STATIC void FluidicMixPlanBuild(Fluidic_t *me);
+STATIC const FluidicMixStroke_t* FluidicMixPlanStroke(const Fluidic_t *me, uint32_t stage);
+STATIC eErrorCode FluidicMixPlayStroke(Fluidic_t *me, const FluidicMixStroke_t *pStroke);
+#ifdef FLUIDIC_PIEZO_WAVEFORM
+STATIC eErrorCode FluidicMixPlayWaveform(Fluidic_t *me);
+#endif
+STATIC eFluidicWaveformShape_t FluidicMixWaveformShape(const Fluidic_t *me);
 STATIC eErrorCode FluidicMonitorBladderDetection(Fluidic_t * me, eXEventId eventId);
+STATIC bool FluidicIsBladderEvent(const Fluidic_t * me, eXEventId eventId);
 STATIC XState OnMsgLiftUpBladders(Fluidic_t  *me, const XEvent_t *pEv);
 
 STATIC eElectrochemicalChannelPos ConvertFluidPosToEchemPos(eFluidicPositions_t eFluidPos);
+STATIC void FluidicSetScanFocus(Fluidic_t *me, eElectrochemicalChannelPos ePos);
+STATIC void FluidicSetScanWatch(Fluidic_t *me, bool isWatched);
 STATIC XState OnMsgWaitForFluidAtContact(Fluidic_t * me, const XEvent_t *pEv);
+STATIC XState FluidicOnCommandMsg(Fluidic_t *me, const XEvent_t *pEv);
+
+STATIC bool FluidicCmdQueueIsEmpty(Fluidic_t *me);
+STATIC bool FluidicCmdQueueHasSpace(Fluidic_t *me);
+STATIC eFluidicPositions_t FluidicCmdQueueEndPosition(Fluidic_t *me);
+STATIC void FluidicRestPosPublish(Fluidic_t *me);
+STATIC eErrorCode FluidicCmdQueuePush(Fluidic_t *me, const FluidicQueuedCmd_t *pCmd);
+STATIC void FluidicCmdQueueDispatch(Fluidic_t *me);
+STATIC void FluidicCmdQueueFlush(Fluidic_t *me);
+
+STATIC void FluidicTraceOnEvent(Fluidic_t *me, const XEvent_t *pEv);
+STATIC void FluidicTraceRecord(Fluidic_t *me, const XEvent_t *pEv, eFluidicTraceSource_t eSource);
+STATIC void FluidicTraceEncode(const Fluidic_t *me, const XEvent_t *pEv, FluidicTraceRecord_t *pRecord);
+STATIC void FluidicTraceRecordBegin(const Fluidic_t *me,
+                                    FluidicTraceRecord_t *pRecord,
+                                    uint32_t id,
+                                    eFluidicTraceSource_t eSource);
+STATIC void FluidicTraceOutput(Fluidic_t *me,
+                               eFluidicTraceOutput_t eOutput,
+                               const peizoMoveParams_t *pMoveParams);
+#ifdef FLUIDIC_PIEZO_WAVEFORM
+STATIC void FluidicTraceWaveform(Fluidic_t *me, const FluidicWaveform_t *pWaveform);
+#endif
+STATIC eErrorCode FluidicPiezoVoltageSet(Fluidic_t *me, peizoMoveParams_t *pMoveParams);
+
+
+/// Bladder detection events published by the electrochemistry, for each
+/// channel. Add a row for each channel added to eElectrochemicalChannel.
+static const eXEventId s_bladderEvents[EC_STRIP_CHAN_COUNT][FLUIDIC_BLADDER_STATE_COUNT] =
+{
+  [EC_STRIP_CHAN_1] = { [FLUIDIC_BLADDER_UP] = XMSG_EC_A1_BLDR_UP, [FLUIDIC_BLADDER_DOWN] = XMSG_EC_A1_BLDR_DOWN },
+  [EC_STRIP_CHAN_2] = { [FLUIDIC_BLADDER_UP] = XMSG_EC_B2_BLDR_UP, [FLUIDIC_BLADDER_DOWN] = XMSG_EC_B2_BLDR_DOWN },
+  [EC_STRIP_CHAN_3] = { [FLUIDIC_BLADDER_UP] = XMSG_EC_A3_BLDR_UP, [FLUIDIC_BLADDER_DOWN] = XMSG_EC_A3_BLDR_DOWN },
+  [EC_STRIP_CHAN_4] = { [FLUIDIC_BLADDER_UP] = XMSG_EC_B4_BLDR_UP, [FLUIDIC_BLADDER_DOWN] = XMSG_EC_B4_BLDR_DOWN },
+};
+
+/// State handlers, by their index in a trace snapshot. Only ever append, as
+/// traces taken with older firmware hold the index.
+static const XStateHandler s_traceStates[] =
+{
+  (XStateHandler) &FluidicState_Init,
+  (XStateHandler) &FluidicState_Idle,
+  (XStateHandler) &FluidicState_CheckForStrip,
+  (XStateHandler) &FluidicState_MoveContact,
+  (XStateHandler) &FluidicState_MoveOther,
+  (XStateHandler) &FluidicState_LiftUpBladder,
+  (XStateHandler) &FluidicState_WaitForContact,
+  (XStateHandler) &FluidicState_WaitForPiezoStop,
+  (XStateHandler) &FluidicState_MixContactControlled,
+  (XStateHandler) &FluidicState_MixPiezoControlled,
+  (XStateHandler) &FluidicState_MixWaitContinue,
+  (XStateHandler) &FluidicState_MonitorFluidBreach,
+  (XStateHandler) &FluidicState_Err,
+};
 
 /**
 * @defgroup fAPI Fluidic APIs
@@ -155,6 +270,12 @@ void FluidicInit(Fluidic_t* me,
   ASSERT_NOT_NULL(pInitParams);  
   ASSERT_NOT_NULL(pInitParams->pPiezo);
   ASSERT_NOT_NULL(pInitParams->pEchem);
+  ASSERT_NOT_NULL(pInitParams->pParams);
+  ASSERT(FluidicParamsAreValid(pInitParams->pParams));
+  ASSERT(pInitParams->eChannel < EC_STRIP_CHAN_COUNT);
+  ASSERT_NOT_NULL(pInitParams->pTimerWheel);
+  ASSERT_NOT_NULL(pInitParams->pEventPool);
+  ASSERT(pInitParams->pEventPool->eventSize >= FLUIDIC_POOL_EVENT_SIZE);
  // ASSERT_NOT_NULL(XFwk);
   
   (void)memset(me, 0, sizeof(Fluidic_t));
@@ -164,6 +285,29 @@ void FluidicInit(Fluidic_t* me,
   me->pPiezo  = pInitParams->pPiezo;
   me->pEchem  = pInitParams->pEchem;
   me->pParams = pInitParams ->pParams;
+  me->eChannel = pInitParams->eChannel;
+  me->pCal    = pInitParams->pCal;
+  me->pStats  = pInitParams->pStats;
+  me->pTrace  = pInitParams->pTrace;
+  me->pTimerWheel = pInitParams->pTimerWheel;
+  me->pEventPool = pInitParams->pEventPool;
+  
+  // Until a contact has been seen, assume it can take a whole echem sweep.
+  me->contactResponseMs = (float)ECHEM_UPDATE_PERIOD_MS;
+  
+  FluidicRunParamsInit(me);
+  FluidicTelemetryInit(&(me->telemetry));
+  
+  if(NULL != me->pStats)
+  {
+    FluidicStatsReset(me->pStats);
+  }
+  
+  // Started before the framework, so the trace covers every event delivered.
+  if(NULL != me->pTrace)
+  {
+    FluidicTraceStart(me->pTrace, (uint8_t)me->eChannel, FLUIDIC_TIME_NOW_MS());
+  }
   
   me->super.enableDebugging = false; 
   
@@ -171,38 +315,31 @@ void FluidicInit(Fluidic_t* me,
   
   XActive_ctor(&me->super, (XStateHandler) &FluidicState_Init);
   
-  XTimerCreate(&(me->timer), 
-               &(me->super), 
-               X_EV_TIMER, 
-               FLUIDIC_TIMER_COUNT_MS,
-               false);
+  XTimerWheelTimerInit(&(me->timer), &(me->super), X_EV_TIMER);
   
   //Construct the published events.
   X_EV_INIT((&me->moveSuccessMsg), (XMSG_FMOVE_CMPLT), me);
   X_EV_INIT((&me->moveFailMsg), XMSG_FLUID_CHANNEL_MOVE_FAIL, me);
   X_EV_INIT(&me->mixCmpltMsg, XMSG_FLUID_MIX_COMPLETE, me);
   X_EV_INIT(&me->moveFailMsg, XMSG_FLUID_ERR, me);
+  X_EV_INIT(&me->flushFailMsg, XMSG_FLUID_CHANNEL_MOVE_FAIL, me);
+  me->flushFailMsg.eChannel = me->eChannel;
+  me->flushFailMsg.eTargetPosition = BC_NONE;
   X_EV_INIT(&me->fcStartBladderDetectMsg, XMSG_FLUID_START_BLDDR_DETECT, me);
   X_EV_INIT(&me->fcStopBladderDetectMsg, XMSG_FLUID_STOP_BLDDR_DETECT, me);
   
   //Constructors for events to self.
   X_EV_INIT(&(me->errClearMsg), XMSG_FLUID_ERR_CLEAR, me);
   X_EV_INIT(&(me->stopMsg), XMSG_FLUID_CHANNEL_CANCEL, me);
-  X_EV_INIT(&(me->paramsMsg), XMSG_FLUID_CHANNEL_NEW_PARAMS, me);
   X_EV_INIT(&(me->moveMsg), XMSG_FLUID_CHANNEL_MOVE_TO, me);
-  X_EV_INIT(&(me->mixMsg), XMSG_FLUID_MIX, me);
   X_EV_INIT(&(me->cmdFail), XMSG_COMMAND_FAILED, me);
-  X_EV_INIT(&(me->liftUpBlddrMsg), XMSG_FLUID_LIFT_UP_BLADDER, me);
-  X_EV_INIT(&(me->waitForFluidContactMsg), XMSG_FLUID_WAIT_FOR_CONTACT, me);
-  
-  X_EV_INIT(&(me->monitorPositionMsg), XMSG_FLUID_ENABLE_BREACH_DETECT, me);
   
   X_EV_INIT(&(me->stageCompelteMsg), XMSG_FLUID_MIX_STAGE_COMPLETE, me);
   X_EV_INIT(&(me->breachDetectedMsg),
             XMSG_BREACH_DETECTED,
             me);
   
-  me->stageCompelteMsg.eChannel = me->pParams->eChannel;
+  me->stageCompelteMsg.eChannel = me->eChannel;
   
   XActiveStart(pXActiveFramework,
                (XActive_t*)&(me->super),
@@ -212,6 +349,10 @@ void FluidicInit(Fluidic_t* me,
                sizeof(me->evQueueBytes),
                NULL);
   
+  // Only this channel's bladder detection events are subscribed to.
+  me->bladderEvents[FLUIDIC_BLADDER_UP]   = s_bladderEvents[me->eChannel][FLUIDIC_BLADDER_UP];
+  me->bladderEvents[FLUIDIC_BLADDER_DOWN] = s_bladderEvents[me->eChannel][FLUIDIC_BLADDER_DOWN];
+  
   X_SUBSCRIBE_TO_FLUIDIC_EVENTS(me);
 }
 
@@ -251,25 +392,45 @@ eErrorCode FluidicStop(Fluidic_t *me)
 *     @param[in]      pParams - The new parameters.
 *     @retval OK_COMMAND_ACCEPTED The parameters are okay, and can be used.
 *     @retval ERROR_FLUID_INVALID_PARAMS The requested parameters cannot be used.
+*     @retval ERROR_OBJECT_NOT_READY The event pool is empty.
 **/
-eErrorCode FluidicParamsSet(Fluidic_t* me, FluidicParams_t *pParams)
+eErrorCode FluidicParamsSet(Fluidic_t* me, const FluidicParams_t *pParams)
 { 
   eErrorCode error;
+  FluidicUpdateParamsMsg_t *pParamsMsg;
+  float flAVal;
+  float flBVal;
+  float flCVal;
   
   ASSERT_NOT_NULL(me);
   ASSERT_NOT_NULL(pParams);
   
-  me->paramsMsg.flAVal = pParams->positionLimits[BC_POS_FLUID_A].targetVolts;
-  me->paramsMsg.flBVal = pParams->positionLimits[BC_POS_FLUID_B].targetVolts;
-  me->paramsMsg.flCVal = pParams->positionLimits[BC_POS_FLUID_C].targetVolts;
+  flAVal = pParams->positionLimits[BC_POS_FLUID_A].targetVolts;
+  flBVal = pParams->positionLimits[BC_POS_FLUID_B].targetVolts;
+  flCVal = pParams->positionLimits[BC_POS_FLUID_C].targetVolts;
   
   // Check that targets for Fluid A < Fluid B (as contact A cannot be further up
   // the channel than contact B), and that B < C (same reason)
-  if((me->paramsMsg.flAVal < me->paramsMsg.flBVal) &&
-     (me->paramsMsg.flBVal < me->paramsMsg.flCVal))
+  if((flAVal < flBVal) && (flBVal < flCVal))
   {
-    XActivePost(&me->super, (XEvent_t const*) &(me->paramsMsg)); 
-    error = OK_COMMAND_ACCEPTED;
+    pParamsMsg = (FluidicUpdateParamsMsg_t*) XEventPoolNew(me->pEventPool,
+                                                            sizeof(FluidicUpdateParamsMsg_t),
+                                                            XMSG_FLUID_CHANNEL_NEW_PARAMS,
+                                                            me);
+    
+    if(NULL != pParamsMsg)
+    {
+      pParamsMsg->flAVal = flAVal;
+      pParamsMsg->flBVal = flBVal;
+      pParamsMsg->flCVal = flCVal;
+      
+      XActivePost(&me->super, &(pParamsMsg->super)); 
+      error = OK_COMMAND_ACCEPTED;
+    }
+    else
+    {
+      error = ERROR_OBJECT_NOT_READY;
+    }
   }
   else
   {
@@ -289,9 +450,12 @@ eErrorCode FluidicParamsSet(Fluidic_t* me, FluidicParams_t *pParams)
 *     @param[in]      me - The fluidic controller instance.
 *     @param[in]      eTarget - The target position.
 *     @param[in]      erampSpeedVoltsPerSec - The step speed to move at.
+*     @details The move is queued behind any executing or queued commands, and
+*              validated against the position those commands end at.
 *     @retval OK_COMMAND_ACCEPTED - The mixing can be performed.
 *     @retval ERROR_FLUID_CHANNEL_INVALID_MOVE - The mixing parameters are invalid, 
 *             or the move cannot be completed
+*     @retval ERROR_OBJECT_NOT_READY - The command queue is full.
 **/
 eErrorCode FluidicMove(Fluidic_t* me, 
                        eFluidicPositions_t eTarget, 
@@ -299,59 +463,88 @@ eErrorCode FluidicMove(Fluidic_t* me,
                        uint32_t timeout_ms,
                        eFluidOvershootCompensation_t   eOvershootComp,
                        float overshootCompProportion)
+{  
+  return FluidicMoveReportTo(me,
+                             NULL,
+                             eTarget,
+                             rampSpeedVoltsPerSec,
+                             timeout_ms,
+                             eOvershootComp,
+                             overshootCompProportion,
+                             FLUID_MOVE_PROFILE_SINGLE_SPEED);
+}
+
+
+/**
+*     @brief API to move the fluid control instance to a given position, and
+*            post the result to an object rather than publishing it.
+*     @param[in]      me - The fluidic controller instance.
+*     @param[in]      pReportTo - Receives the move complete or move fail
+*                                 event. NULL to publish the result.
+*     @param[in]      eTarget - The target position.
+*     @param[in]      erampSpeedVoltsPerSec - The step speed to move at.
+*     @param[in]      eProfile - Speed profile. With FLUID_MOVE_PROFILE_FAST_APPROACH
+*                                a forward move to a contact whose voltage is known
+*                                runs at FLUID_SPEED_HIGH_DEFAULT_V_PER_S up to the
+*                                approach window, then at rampSpeedVoltsPerSec.
+*     @note pReportTo and eProfile are not used for homing moves, which are never queued.
+*     @returns As FluidicMove().
+**/
+eErrorCode FluidicMoveReportTo(Fluidic_t* me, 
+                               XActive_t* pReportTo,
+                               eFluidicPositions_t eTarget, 
+                               float rampSpeedVoltsPerSec,
+                               uint32_t timeout_ms,
+                               eFluidOvershootCompensation_t   eOvershootComp,
+                               float overshootCompProportion,
+                               eFluidMoveProfile_t eProfile)
 {  
   eErrorCode error = ERROR_NULL_PTR;
-  
-  // Cannot accept a movement command when the parameters are invalid, or
-  // if not in idle state.
-  
-  bool isReady;
+  FluidicQueuedCmd_t cmd;
   
   if (NULL != me)
   {
     // Can always accept a homing move.
-    // don't need to check parameters.
+    // don't need to check parameters. Homing is never queued, it
+    // flushes the queue instead.
     if(eTarget == BC_POS_HOME)
     {
       me->moveMsg.eTargetPos = BC_POS_HOME;
+      me->moveMsg.eProfile = FLUID_MOVE_PROFILE_SINGLE_SPEED;
       
       XActivePost(&me->super, (XEvent_t const*) &(me->moveMsg)); 
       error = OK_COMMAND_ACCEPTED;
     }
     else
     {
-      // Otherwise, do a parameter and status check before accepting command.
+      // Otherwise, do a parameter check before accepting command. The move
+      // starts from wherever the queued commands leave the channel.
       error = FluidCheckMoveParams(me,
+                                   FluidicCmdQueueEndPosition(me),
                                    eTarget,
                                    rampSpeedVoltsPerSec,
                                    timeout_ms,
                                    eOvershootComp,
                                    overshootCompProportion);
       
-      isReady = FluidicStateCanAcceptCommand(me);
-        
-      // Have to check if move is permitted first.  
-      if (isReady)
+      if ((OK_STATUS == error) && (eProfile >= FLUID_MOVE_PROFILE_COUNT))
       {
-        //  error = OK_STATUS, the only thing which might hold us back is
-        // being busy!
-        if (OK_STATUS == error)
-        {
-          me->moveMsg.eTargetPos = eTarget;
-          me->moveMsg.rampSpeedVoltsPerSec = rampSpeedVoltsPerSec;
-          me->moveMsg.timeout_ms = timeout_ms;
-          me->moveMsg.eOvershootComp = eOvershootComp;
-          me->moveMsg.overshootCompProportion = overshootCompProportion;
-          
-          
-          XActivePost(&me->super, (XEvent_t const*) &(me->moveMsg)); 
-          
-          error = OK_COMMAND_ACCEPTED;    // Asynch command. Return command_accepted.
-        }
+        error = ERROR_FLUID_CHANNEL_INVALID_MOVE;
       }
-      else
+      
+      if (OK_STATUS == error)
       {
-        error = ERROR_OBJECT_NOT_READY; // Busy. return appropriate code.
+        X_EV_INIT(&(cmd.msg.move), XMSG_FLUID_CHANNEL_MOVE_TO, me);
+        cmd.msg.move.eTargetPos = eTarget;
+        cmd.msg.move.rampSpeedVoltsPerSec = rampSpeedVoltsPerSec;
+        cmd.msg.move.timeout_ms = timeout_ms;
+        cmd.msg.move.eOvershootComp = eOvershootComp;
+        cmd.msg.move.overshootCompProportion = overshootCompProportion;
+        cmd.msg.move.eProfile = eProfile;
+        cmd.eEndPos = eTarget;
+        cmd.pReportTo = pReportTo;
+        
+        error = FluidicCmdQueuePush(me, &cmd);    // Asynch command. Returns command_accepted.
       }
     }
   }
@@ -360,6 +553,45 @@ eErrorCode FluidicMove(Fluidic_t* me,
 }
 
 
+/**
+*     @brief Checks whether FluidicMove() would accept a move, without queuing it.
+*     @param[in]      me - The fluidic controller instance.
+*     @param[in]      eTarget - The target position.
+*     @param[in]      erampSpeedVoltsPerSec - The step speed to move at.
+*     @retval OK_STATUS - The move would be accepted.
+*     @retval ERROR_FLUID_CHANNEL_INVALID_MOVE - The move parameters are invalid, 
+*             or the move cannot be completed
+*     @retval ERROR_OBJECT_NOT_READY - The command queue is full.
+**/
+eErrorCode FluidicMoveCheck(Fluidic_t* me, 
+                            eFluidicPositions_t eTarget, 
+                            float rampSpeedVoltsPerSec,
+                            uint32_t timeout_ms,
+                            eFluidOvershootCompensation_t   eOvershootComp,
+                            float overshootCompProportion)
+{
+  eErrorCode error = ERROR_NULL_PTR;
+  
+  if (NULL != me)
+  {
+    error = FluidCheckMoveParams(me,
+                                 FluidicCmdQueueEndPosition(me),
+                                 eTarget,
+                                 rampSpeedVoltsPerSec,
+                                 timeout_ms,
+                                 eOvershootComp,
+                                 overshootCompProportion);
+    
+    if ((OK_STATUS == error) && (false == FluidicCmdQueueHasSpace(me)))
+    {
+      error = ERROR_OBJECT_NOT_READY;
+    }
+  }
+  
+  return error;
+}
+
+
 /**
   * @brief API to lift bladders until bladder down contacts no longer made.
   * @param[in] me - The fluid controller
@@ -368,44 +600,43 @@ eErrorCode FluidicMove(Fluidic_t* me,
   * @param[in] timeout_ms - The move timeout
   * @param[in] eOvershootComp - Overshoot compensation mode
   * @param[in] overshootCompProportion - % of Piezo voltage difference between start and end points.
-  * @returns OK_COMMAND_ACCEPTED if the command is valid and can be performed.
+  * @details The lift is queued behind any executing or queued commands.
+  * @returns OK_COMMAND_ACCEPTED if the command is valid and can be performed, or
+  *          has been queued. ERROR_OBJECT_NOT_READY if the command queue is full.
   **/
 eErrorCode FluidicLiftUpBladder(Fluidic_t* me,
                                 float rampSpeedVoltsPerSec,
                                 uint32_t timeout_ms)
 {
   eErrorCode error;
+  FluidicQueuedCmd_t cmd;
 
   ASSERT_NOT_NULL(me);
   ASSERT_NOT_NULL(me->pParams);
 
-  me->eTargetPos = BC_POS_HOME;           // Has to be home to check against UP, rather than down.
-  me->liftUpBlddrMsg.rampSpeedVoltsPerSec = rampSpeedVoltsPerSec;
-  me->liftUpBlddrMsg.timeout_ms = timeout_ms;
-
-  // Cannot accept a movement command when the parameters are invalid, or
-  // if not in idle state.
+  // Cannot accept a movement command when the parameters are invalid.
   
   error = FluidCheckMoveParams(me,
+                               FluidicCmdQueueEndPosition(me),
                                BC_POS_DOWN,
                                rampSpeedVoltsPerSec,
                                timeout_ms,
                                FLUID_OVERSHOOT_COMP_NONE,
                                0.f);
   
-  bool isReady = FluidicStateCanAcceptCommand(me);
-  
   if((OK_STATUS == error))
   {
-    if (isReady)
-    {
-      XActivePost(&me->super, (XEvent_t const*) &(me->liftUpBlddrMsg));
-      error = OK_COMMAND_ACCEPTED;
-    }
-    else
-    {
-      error = ERROR_OBJECT_NOT_READY;
-    }
+    // Has to target home to check against UP, rather than down.
+    X_EV_INIT(&(cmd.msg.lift), XMSG_FLUID_LIFT_UP_BLADDER, me);
+    cmd.msg.lift.eTargetPos = BC_POS_HOME;
+    cmd.msg.lift.rampSpeedVoltsPerSec = rampSpeedVoltsPerSec;
+    cmd.msg.lift.timeout_ms = timeout_ms;
+    cmd.msg.lift.eOvershootComp = FLUID_OVERSHOOT_COMP_NONE;
+    cmd.msg.lift.overshootCompProportion = 0.f;
+    cmd.eEndPos = BC_POS_DOWN;
+    cmd.pReportTo = NULL;
+    
+    error = FluidicCmdQueuePush(me, &cmd);
   }
 
   return error;
@@ -421,9 +652,12 @@ eErrorCode FluidicLiftUpBladder(Fluidic_t* me,
 *     @param[in]      eTarget - The target position.
 *     @param[in]      mixFreq - The frequency of the fluid front movement.
 *     @param[in]      mixTimeout - The mixing period in ms.
+*     @details The mix is queued behind any executing or queued commands, and
+*              mixes from the position those commands end at.
 *     @retval OK_COMMAND_ACCEPTED - The mixing can be performed (command has been received)
 *     @retval ERROR_FLUID_CHANNEL_INVALID_MOVE - The mixing parameters are invalid, 
 *             or the move cannot be completed
+*     @retval ERROR_OBJECT_NOT_READY - The command queue is full.
 **/
 eErrorCode FluidicMix(Fluidic_t* me, 
                       eFluidicPositions_t eTarget, 
@@ -433,12 +667,50 @@ eErrorCode FluidicMix(Fluidic_t* me,
                       eFluidMixingType_t  eMixType,
                       float openLoopCompensationFactor,
                       float mixDownstrokeProportion)
+{
+  return FluidicMixReportTo(me,
+                            NULL,
+                            eTarget,
+                            mixFreq,
+                            mixTimeout,
+                            cycles,
+                            eMixType,
+                            openLoopCompensationFactor,
+                            mixDownstrokeProportion);
+}
+
+
+/**
+*     @brief API to mix the fluid control instance, and post the result to an
+*            object rather than publishing it.
+*     @param[in]      me - The fluidic controller instance.
+*     @param[in]      pReportTo - Receives the mix complete or move fail
+*                                 event. NULL to publish the result.
+*     @param[in]      eTarget - The target position.
+*     @param[in]      mixFreq - The frequency of the fluid front movement.
+*     @param[in]      mixTimeout - The mixing period in ms.
+*     @returns As FluidicMix().
+**/
+eErrorCode FluidicMixReportTo(Fluidic_t* me, 
+                              XActive_t* pReportTo,
+                              eFluidicPositions_t eTarget, 
+                              float mixFreq, 
+                              uint32_t mixTimeout, 
+                              uint32_t cycles,
+                              eFluidMixingType_t  eMixType,
+                              float openLoopCompensationFactor,
+                              float mixDownstrokeProportion)
 {
   eErrorCode error = ERROR_NULL_PTR;
+  FluidicQueuedCmd_t cmd;
+  eFluidicPositions_t eFromPos;
   
   if (NULL != me)
   {
+    eFromPos = FluidicCmdQueueEndPosition(me);
+    
     error =  FluidCheckMixParams(me,
+                                 eFromPos,
                                  eTarget,
                                  mixFreq,
                                  mixTimeout,
@@ -447,31 +719,67 @@ eErrorCode FluidicMix(Fluidic_t* me,
                                  openLoopCompensationFactor,
                                  mixDownstrokeProportion);
       
-    if (FluidicStateCanAcceptCommand(me))
+    if(OK_STATUS == error)
     {
-      if(OK_STATUS == error)
-      {
-        
-        me->mixMsg.eTargetPos                 = eTarget;
-        me->mixMsg.mixFrequency               = mixFreq;
-        me->mixMsg.mixTime                    = mixTimeout;
-        me->mixMsg.mixCycles                  = cycles;
-        me->mixMsg.eMixType                   = eMixType;
-        me->mixMsg.openLoopCompensationFactor = openLoopCompensationFactor;
-        me->mixMsg.mixDownstrokeProportion    = mixDownstrokeProportion;
-        XActivePost(&me->super, (XEvent_t const*) &(me->mixMsg)); 
-        error = OK_COMMAND_ACCEPTED;
-      }
+      X_EV_INIT(&(cmd.msg.mix), XMSG_FLUID_MIX, me);
+      cmd.msg.mix.eTargetPos                 = eTarget;
+      cmd.msg.mix.mixFrequency               = mixFreq;
+      cmd.msg.mix.mixTime                    = mixTimeout;
+      cmd.msg.mix.mixCycles                  = cycles;
+      cmd.msg.mix.eMixType                   = eMixType;
+      cmd.msg.mix.openLoopCompensationFactor = openLoopCompensationFactor;
+      cmd.msg.mix.mixDownstrokeProportion    = mixDownstrokeProportion;
+      cmd.eEndPos = eFromPos;                  // A mix returns to where it started.
+      cmd.pReportTo = pReportTo;
       
+      error = FluidicCmdQueuePush(me, &cmd);
     }
-    else
+  }
+  
+  return error;
+}
+
+
+/**
+*     @brief Checks whether FluidicMix() would accept a mix, without queuing it.
+*     @param[in]      me - The fluidic controller instance.
+*     @param[in]      eTarget - The target position.
+*     @param[in]      mixFreq - The frequency of the fluid front movement.
+*     @param[in]      mixTimeout - The mixing period in ms.
+*     @retval OK_STATUS - The mix would be accepted.
+*     @retval ERROR_FLUID_CHANNEL_INVALID_MOVE - The mixing parameters are invalid, 
+*             or the move cannot be completed
+*     @retval ERROR_OBJECT_NOT_READY - The command queue is full.
+**/
+eErrorCode FluidicMixCheck(Fluidic_t* me, 
+                           eFluidicPositions_t eTarget, 
+                           float mixFreq, 
+                           uint32_t mixTimeout, 
+                           uint32_t cycles,
+                           eFluidMixingType_t  eMixType,
+                           float openLoopCompensationFactor,
+                           float mixDownstrokeProportion)
+{
+  eErrorCode error = ERROR_NULL_PTR;
+  
+  if (NULL != me)
+  {
+    error =  FluidCheckMixParams(me,
+                                 FluidicCmdQueueEndPosition(me),
+                                 eTarget,
+                                 mixFreq,
+                                 mixTimeout,
+                                 cycles,
+                                 eMixType,
+                                 openLoopCompensationFactor,
+                                 mixDownstrokeProportion);
+    
+    if ((OK_STATUS == error) && (false == FluidicCmdQueueHasSpace(me)))
     {
       error = ERROR_OBJECT_NOT_READY;
     }
   }
   
-  
-  
   return error;
 }
 
@@ -482,60 +790,67 @@ eErrorCode FluidicMix(Fluidic_t* me,
   * @details Posts message to the fluid controller.
   * @param[in] me - The fluid controller
   * @param[in] enable - Boolean flag to enable contact monitoring after the movement compeltes.
+  * @retval OK_STATUS
+  * @retval ERROR_OBJECT_NOT_READY The event pool is empty.
   **/
 eErrorCode FluidicEnableBreachMonitoring(Fluidic_t* me,
                                    bool enable)
 {
-  me->monitorPositionMsg.monitorFluidPosition = enable;
+  eErrorCode eError = ERROR_OBJECT_NOT_READY;
+  FluidicMonitorBreachMsg_t *pBreachMsg;
   
-  XActivePost(&me->super, (XEvent_t const*) &(me->monitorPositionMsg)); 
+  pBreachMsg = (FluidicMonitorBreachMsg_t*) XEventPoolNew(me->pEventPool,
+                                                          sizeof(FluidicMonitorBreachMsg_t),
+                                                          XMSG_FLUID_ENABLE_BREACH_DETECT,
+                                                          me);
   
-  return OK_STATUS;
+  if (NULL != pBreachMsg)
+  {
+    pBreachMsg->monitorFluidPosition = enable;
+    
+    XActivePost(&me->super, &(pBreachMsg->super)); 
+    
+    eError = OK_STATUS;
+  }
+  
+  return eError;
 }
 
                        
 /**
   *     @brief Object API to instruct fluid controller to wait for fluid detection at
   *            the specified location.
+  *     @details The wait is queued behind any executing or queued commands, and
+  *              checked against the position those commands end at.
   *     @param[in] me - The fluid controller
   *     @param[in] eTarget - The position we expect fluid to be detected at
   *     @param[in] timeoutMs - The timeout limit, in ms.
   *     @returns OK_COMMAND_ACCEPTED if the parameters are OK.
+  *     @retval ERROR_BAD_ARGS The target is not a fluid contact the channel can reach.
+  *     @retval ERROR_OBJECT_NOT_READY The command queue is full.
   **/
 eErrorCode FluidicWaitForFluidAtContact(Fluidic_t * me,
                                         eFluidicPositions_t eTarget,
                                         uint32_t timeoutMs)
 {
-  ASSERT_NOT_NULL(me);
-  
   eErrorCode eError = ERROR_NULL_PTR;
-  bool canAcceptCommand = FluidicStateCanAcceptCommand(me);
-  bool moveValid = bladderControlCheckMoveValid(me, eTarget);
-  
+  FluidicQueuedCmd_t cmd;
   
   // Default error is NULL_PTR, so already handled.
   if (NULL != me)
   {
-    
     // Can't wait for contact at bladder down, othereise use moveValid state
     // to check against "bad-args"
-    if ((eTarget >= BC_POS_FLUID_A) && (moveValid))
+    if ((eTarget >= BC_POS_FLUID_A) &&
+        bladderControlCheckMoveValid(FluidicCmdQueueEndPosition(me), eTarget))
     {
+      X_EV_INIT(&(cmd.msg.wait), XMSG_FLUID_WAIT_FOR_CONTACT, me);
+      cmd.msg.wait.eTargetPos = eTarget;
+      cmd.msg.wait.timeoutMs = timeoutMs;
+      cmd.eEndPos = eTarget;
+      cmd.pReportTo = NULL;
       
-      // Before sending the command, check that we can actually accept it!
-      if (canAcceptCommand)
-      {
-        me->waitForFluidContactMsg.eTargetPos = eTarget;
-        me->waitForFluidContactMsg.timeoutMs = timeoutMs;
-        
-        X_POST(me, me->waitForFluidContactMsg);
-        
-        eError = OK_COMMAND_ACCEPTED;
-      }
-      else
-      {
-        eError = ERROR_OBJECT_NOT_READY;
-      }
+      eError = FluidicCmdQueuePush(me, &cmd);
     }
     else
     {
@@ -546,6 +861,54 @@ eErrorCode FluidicWaitForFluidAtContact(Fluidic_t * me,
   return eError;
 }
 
+
+/**
+  *     @brief Object API to dump the latency histograms, one line per histogram.
+  *     @details For a console command. The dump is made by the fluid
+  *              controller, between events, so the histograms are not read
+  *              or reset whilst they are being added to.
+  *     @param[in] me - The fluid controller
+  *     @param[in] pfnPrint - Writes each line. Called from the fluid controller's thread.
+  *     @param[in] pCtx - Passed to pfnPrint.
+  *     @param[in] reset - Empty the histograms once dumped.
+  *     @retval OK_COMMAND_ACCEPTED
+  *     @retval ERROR_OBJECT_NOT_READY The channel was not given histograms, or the event pool is empty.
+  *     @note The console's dump command is EventSenderFluidicStatsDump(),
+  *           which publishes each line to the console.
+  **/
+eErrorCode FluidicStatsDumpRequest(Fluidic_t * me,
+                                   FluidicStatsPrintFn_t pfnPrint,
+                                   void *pCtx,
+                                   bool reset)
+{
+  eErrorCode eError = ERROR_OBJECT_NOT_READY;
+  FluidicStatsMsg_t *pStatsMsg = NULL;
+  
+  ASSERT_NOT_NULL(me);
+  ASSERT_NOT_NULL(pfnPrint);
+  
+  if (NULL != me->pStats)
+  {
+    pStatsMsg = (FluidicStatsMsg_t*) XEventPoolNew(me->pEventPool,
+                                                   sizeof(FluidicStatsMsg_t),
+                                                   XMSG_FLUID_STATS_DUMP,
+                                                   me);
+  }
+  
+  if (NULL != pStatsMsg)
+  {
+    pStatsMsg->pfnPrint = pfnPrint;
+    pStatsMsg->pCtx = pCtx;
+    pStatsMsg->reset = reset;
+    
+    XActivePost(&me->super, &(pStatsMsg->super));
+    
+    eError = OK_COMMAND_ACCEPTED;
+  }
+  
+  return eError;
+}
+
 /** @} **/
 
 
@@ -574,6 +937,7 @@ STATIC XState FluidicState_Init(Fluidic_t* me, XEvent_t* pEv)
   
   me->status.eFluidFrontPosition    = FD_DATA_INVALID;
   
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -592,8 +956,11 @@ XMSG_FLUID_CHANNEL_MOVE_TO| Begins a fluid channel move.
 ------------------------- |----------------------------------
 XMSG_FLUID_MIX            | Starts fluid channel mixing.
 ------------------------- |----------------------------------
+XMSG_FLUID_WAIT_FOR_CONTACT | Waits for fluid at a contact.
+------------------------- |----------------------------------
 default                   | Calls the default event handler.  
 
+* @note Queued commands are started on entry.
 * @returns The state response.
 **/  
 STATIC XState FluidicState_Idle(Fluidic_t* me, XEvent_t* pEv)
@@ -603,27 +970,20 @@ STATIC XState FluidicState_Idle(Fluidic_t* me, XEvent_t* pEv)
   
   eXEventId eventId = pEv->id;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch(eventId)
   {
   case X_EV_ENTRY:
-    me->timeoutTimer = 0u;
     error = Fluidic_OnIdleEntry(me);
+    FluidicCmdQueueDispatch(me);
     break;
     
   case XMSG_FLUID_CHANNEL_MOVE_TO:
-    retCode = OnMsgBladderControlMoveToPos(me, pEv);
-    break;
-    
   case XMSG_FLUID_LIFT_UP_BLADDER:
-    retCode = OnMsgLiftUpBladders(me, pEv);
-    break;
-    
   case XMSG_FLUID_MIX:
-    retCode = OnMsgBladderControlMix(me, pEv);
-    break;
-    
   case XMSG_FLUID_WAIT_FOR_CONTACT:
-    retCode = OnMsgWaitForFluidAtContact(me, pEv);
+    retCode = FluidicOnCommandMsg(me, pEv);
     break;
     
   default:
@@ -632,6 +992,8 @@ STATIC XState FluidicState_Idle(Fluidic_t* me, XEvent_t* pEv)
   }
   
   retCode = FluidicsErrorSet(me, error, retCode);
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -649,9 +1011,9 @@ STATIC XState FluidicState_Idle(Fluidic_t* me, XEvent_t* pEv)
   **/
 STATIC eErrorCode Fluidic_OnIdleEntry(Fluidic_t* me)
 {
-  eErrorCode error = ecDisable(me->pEchem, me->pParams->eChannel);
+  eErrorCode error = ecDisable(me->pEchem, me->eChannel);
   
-  XTimerStop(&(me->timer)); //Don't need timer in idle
+  XTimerWheelCancel(me->pTimerWheel, &(me->timer)); //Don't need timer in idle
   
   //@todo Check potential errors in ecDisable.
   if(OK_STATUS == error)
@@ -659,6 +1021,8 @@ STATIC eErrorCode Fluidic_OnIdleEntry(Fluidic_t* me)
     error = FluidicStopMove(me);  //Stop where we are. Just in case the piezo was still moving.
   }
   
+  FluidicRecordEnd(me, FLUIDIC_TELEMETRY_CANCELLED, OK_STATUS);   // Nothing open should reach idle, but keep the ring honest.
+  
   // If an error has occurred then these values are reset in the error state.
   me->status.eFluidFrontPosition = FD_DATA_INVALID;
   me->status.eMoveDirection = FLUID_MOVE_FWD;
@@ -680,9 +1044,11 @@ Event                     | Actions
 ------------------------- | ---------------------------------
 X_EV_ENTRY                | Initialises the fluid channel movement.
 ------------------------- |----------------------------------
-X_EV_TIMER                | Processing for the fluidic channel, on the 20ms timer.
+X_EV_TIMER                | Settling check of the fluid front, predictive stop, then the move timeout.
+------------------------- |----------------------------------
+XMSG_EC_FLUID_STATUS_CHANGED | Updates the fluid front position and estimator. Stops the move as soon as the requirement is met.
 ------------------------- |----------------------------------
-XMSG_PIEZO_MOVE_COMPLTE   | Publish movement failure event, go to idle state.
+XMSG_PIEZO_MOVE_COMPLTE   | Ends the fast part of a fast approach. Otherwise ignored, the timer declares a failure.
 ------------------------- |----------------------------------
 default                   | Calls the default event handler.  
 
@@ -694,32 +1060,50 @@ STATIC XState FluidicState_MoveContact(Fluidic_t* me, XEvent_t* pEv)
   eErrorCode error = OK_STATUS;
   eXEventId eventId = pEv->id;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch(eventId)
   {
   case X_EV_ENTRY:
-    me->timeoutTimer = 0u;
     error = OnFluidMoveContact_Entry(me);
     break;
     
-   // Check the  echem status, successful move will be detected in this
-   // time based check.
   case X_EV_TIMER:
     retCode = FluidicMoveContact_OnTick (me);
     break;
     
+    // Successful move is detected on the status change itself, so the Piezo
+    // is stopped with minimum overshoot.
+  case XMSG_EC_FLUID_STATUS_CHANGED:
+    error = FluidOnEchemStatusChange(me, pEv);
+    FluidicFrontOnStatusChange(me);
+    retCode = FluidicMoveContact_CheckFluidFront(me, &error);
+    break;
+    
   case XMSG_PIEZO_MOVE_COMPLTE:
-    // A PIEZO complete maybe received, don't want to handle
-    // it as a default case (below). Want to allow the timer
+    // The fast part of a fast approach has finished, finish the move at the
+    // requested speed. Otherwise a PIEZO complete maybe received, don't want
+    // to handle it as a default case (below). Want to allow the timer
     // to complete before declaring a fail
+    error = FluidicMoveContact_OnPiezoStop(me, pEv);
     retCode = X_RET_HANDLED;
     break;
     
+  case X_EV_EXIT:
+    me->isApproaching = false;
+    me->front.isStopPending = false;
+    me->front.isFrontAwaited = false;
+    retCode = Fluidic_defaultEvents(me, pEv);
+    break;
+    
   default:
     retCode = Fluidic_defaultEvents(me, pEv);
     break;
   }
   
   retCode = FluidicsErrorSet(me, error, retCode);
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -736,13 +1120,11 @@ Event                     | Actions
 ------------------------- |----------------------------------
 X_EV_ENTRY                | Initialises the fluid channel movement.
 ------------------------- |----------------------------------
-X_EV_TIMER                | Increment timeout timer. If it has exceeded the timeout value publish failure event and go to idle state.
-------------------------- |----------------------------------
-XMSG_EC_xx_BLDR_xxxx      | Bladder detection feedback msgs
+X_EV_TIMER                | Settling time elapsed: start bladder detection. Deadline: publish failure event and go to idle state.
 ------------------------- |----------------------------------
 XMSG_PIEZO_MOVE_COMPLTE   | Publish movement complete event, go to idle state.
 ------------------------- |----------------------------------
-default                   | Calls the default event handler.  
+default                   | The channel's bladder detection events stop the Piezo. Otherwise calls the default event handler.
 
 * @returns The state response.
 **/
@@ -755,6 +1137,8 @@ STATIC XState FluidicState_MoveOther(Fluidic_t* me, XEvent_t* pEv)
   
   PiezoMoveCompltEv_t* pMoveCmplt = (PiezoMoveCompltEv_t*) pEv;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch (eventId)
   {
   case X_EV_ENTRY:
@@ -763,9 +1147,7 @@ STATIC XState FluidicState_MoveOther(Fluidic_t* me, XEvent_t* pEv)
     break;
     
   case X_EV_TIMER:
-    me->timeoutTimer += FLUIDIC_TIMER_COUNT_MS;
-    
-    if (me->timeoutTimer >= me->pParams->timeout_ms)
+    if (FluidicTimerIsDeadline(me))
     {
       /* Let the script runner know that this is down to timeout
        * (instrument inactivity). */
@@ -777,25 +1159,15 @@ STATIC XState FluidicState_MoveOther(Fluidic_t* me, XEvent_t* pEv)
       retCode = X_TRAN(me, &FluidicState_Idle);
     }
     /* Give enough time for states of channels to settle
-     * before we kick off EC (bladder detection state) and make sure target
-     * position is down/pressed. */
-    if ((20u == me->timeoutTimer) && (BC_POS_DOWN == me->eTargetPos))
+     * before we kick off EC (bladder detection state). The settling
+     * timer is only armed when the target position is down/pressed. */
+    else
     {
       X_PUBLISH(X_FRAMEWORK_OF(me), me->fcStartBladderDetectMsg);
+      FluidicTimerArmDeadline(me, FluidicMoveElapsedMs(me), me->run.timeout_ms);
     }
     break;
 
-  case XMSG_EC_A1_BLDR_UP:
-  case XMSG_EC_B2_BLDR_UP:
-  case XMSG_EC_A3_BLDR_UP:
-  case XMSG_EC_B4_BLDR_UP:
-  case XMSG_EC_A1_BLDR_DOWN:
-  case XMSG_EC_B2_BLDR_DOWN:
-  case XMSG_EC_A3_BLDR_DOWN:
-  case XMSG_EC_B4_BLDR_DOWN:
-	  error = FluidicMonitorBladderDetection(me, eventId);
-	break;
-
   case XMSG_PIEZO_STOPPED:
   case XMSG_PIEZO_MOVE_COMPLTE:
     if(pMoveCmplt->chan == me->pPiezo->pParams->chan)
@@ -805,7 +1177,7 @@ STATIC XState FluidicState_MoveOther(Fluidic_t* me, XEvent_t* pEv)
       
       if (BC_POS_DOWN == me->eTargetPos)
       {
-        me->pParams->positionLimits[me->eTargetPos].targetVolts =
+        me->run.positions[me->eTargetPos].targetVolts =
           piezoVoltageGet(me->pPiezo);
       }
 
@@ -814,11 +1186,21 @@ STATIC XState FluidicState_MoveOther(Fluidic_t* me, XEvent_t* pEv)
     break; 
     
   default:
-    retCode = Fluidic_defaultEvents(me, pEv);
+    // Bladder detection event ids are per channel, so are not case labels.
+    if(FluidicIsBladderEvent(me, eventId))
+    {
+      error = FluidicMonitorBladderDetection(me, eventId);
+    }
+    else
+    {
+      retCode = Fluidic_defaultEvents(me, pEv);
+    }
     break;
   }
   
   retCode = FluidicsErrorSet(me, error, retCode);
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -832,18 +1214,9 @@ Event                     | Actions
 ------------------------- |----------------------------------
 X_EV_ENTRY                | Initialises the fluid channel movement.
 ------------------------- |----------------------------------
-XMSG_EC_A1_BLDR_UP        |
-XMSG_EC_B2_BLDR_UP        |
-XMSG_EC_A3_BLDR_UP        |
-XMSG_EC_B4_BLDR_UP        |
-XMSG_EC_A1_BLDR_DOWN      | Events indicating bladder status
-XMSG_EC_B2_BLDR_DOWN      |
-XMSG_EC_A3_BLDR_DOWN      |
-XMSG_EC_B4_BLDR_DOWN      |
-------------------------- |----------------------------------
 XMSG_PIEZO_MOVE_COMPLTE   | Publish movement complete event, go to idle state.
 ------------------------- |----------------------------------
-default                   | Calls the default event handler.
+default                   | The channel's bladder detection events stop the Piezo. Otherwise calls the default event handler.
 
 * @returns The state response.
 **/
@@ -856,6 +1229,8 @@ STATIC XState FluidicState_LiftUpBladder(Fluidic_t* me, XEvent_t* pEv)
 
   PiezoMoveCompltEv_t* pMoveCmplt = (PiezoMoveCompltEv_t*) pEv;
 
+  FluidicTraceOnEvent(me, pEv);
+
   switch (eventId)
   {
   case X_EV_ENTRY:
@@ -864,9 +1239,7 @@ STATIC XState FluidicState_LiftUpBladder(Fluidic_t* me, XEvent_t* pEv)
     break;
 
   case X_EV_TIMER:
-    me->timeoutTimer += FLUIDIC_TIMER_COUNT_MS;
-
-    if (me->timeoutTimer >= me->pParams->timeout_ms)
+    if (FluidicTimerIsDeadline(me))
     {
       FluidicOnMoveFailMsg(me, me->eTargetPos, ERROR_COMMAND_TIMEOUT);
 
@@ -874,25 +1247,15 @@ STATIC XState FluidicState_LiftUpBladder(Fluidic_t* me, XEvent_t* pEv)
       retCode = X_TRAN(me, &FluidicState_Idle);
     }
     /* Give enough time for states of channels to settle
-     * before we kick off EC (bladder detection state) and make sure target
-     * position is HOME/open */
-    if ((20u == me->timeoutTimer) && (BC_POS_HOME == me->eTargetPos))
+     * before we kick off EC (bladder detection state). The settling
+     * timer is only armed when the target position is HOME/open */
+    else
     {
       X_PUBLISH(X_FRAMEWORK_OF(me), me->fcStartBladderDetectMsg);
+      FluidicTimerArmDeadline(me, FluidicMoveElapsedMs(me), me->run.timeout_ms);
     }
     break;
 
-  case XMSG_EC_A1_BLDR_UP:
-  case XMSG_EC_B2_BLDR_UP:
-  case XMSG_EC_A3_BLDR_UP:
-  case XMSG_EC_B4_BLDR_UP:
-  case XMSG_EC_A1_BLDR_DOWN:
-  case XMSG_EC_B2_BLDR_DOWN:
-  case XMSG_EC_A3_BLDR_DOWN:
-  case XMSG_EC_B4_BLDR_DOWN:
-    error = FluidicMonitorBladderDetection(me, eventId);
-  break;
-
   case XMSG_PIEZO_STOPPED:
   case XMSG_PIEZO_MOVE_COMPLTE:
     if(pMoveCmplt->chan == me->pPiezo->pParams->chan)
@@ -906,11 +1269,20 @@ STATIC XState FluidicState_LiftUpBladder(Fluidic_t* me, XEvent_t* pEv)
     break;
 
   default:
-    retCode = Fluidic_defaultEvents(me, pEv);
+    if(FluidicIsBladderEvent(me, eventId))
+    {
+      error = FluidicMonitorBladderDetection(me, eventId);
+    }
+    else
+    {
+      retCode = Fluidic_defaultEvents(me, pEv);
+    }
     break;
   }
 
   retCode = FluidicsErrorSet(me, error, retCode);
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -938,21 +1310,33 @@ STATIC XState FluidicState_WaitForContact(Fluidic_t* me, XEvent_t* pEv)
   
   PiezoMoveCompltEv_t* pMoveCmplt = (PiezoMoveCompltEv_t*) pEv;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch (eventId)
   {
   case X_EV_ENTRY:
-     ecChan = me->pParams->eChannel;
-    
+     ecChan = me->eChannel;
     
-    XTimerStart(&(me->timer));    // Need timer if moving. 
-    me->timeoutTimer = 0u;      // Reset timeout timer.
+    me->moveStartMs = FLUIDIC_TIME_NOW_MS();
+    FluidicTimerArmSettle(me, FLUIDIC_TIMER_COUNT_MS);    // Check once the current position, then wait for the deadline.
     
     error = ecSetModeFillDetect(me->pEchem, ecChan, EC_CHAN_POS_A);    // We're waiting for a contact. monitor all of them!             
+    FluidicSetScanFocus(me, ConvertFluidPosToEchemPos(me->eTargetPos));
     break;
 
-  case X_EV_TIMER:
-    me->timeoutTimer += FLUIDIC_TIMER_COUNT_MS;
+  case XMSG_EC_FLUID_STATUS_CHANGED:
+    error = FluidOnEchemStatusChange(me, pEv);
+    
+    eRequirement = fluidGetEchemRequirement(me, true);
     
+    if (eRequirement == me->status.eFluidFrontPosition)
+    {
+      FluidicOnMoveCompleteMsg(me);
+      retCode = X_TRAN(me, &FluidicState_Idle);
+    }
+    break;
+
+  case X_EV_TIMER:
     eRequirement = fluidGetEchemRequirement(me, true);
     eFluidFrontPos = me->status.eFluidFrontPosition;
     
@@ -962,7 +1346,7 @@ STATIC XState FluidicState_WaitForContact(Fluidic_t* me, XEvent_t* pEv)
       retCode = X_TRAN(me, &FluidicState_Idle);
     }
 
-    else if (me->timeoutTimer >= me->pParams->timeout_ms)
+    else if (FluidicTimerIsDeadline(me))
     {
       FluidicOnMoveFailMsg(me, me->eTargetPos, ERROR_COMMAND_TIMEOUT);
 
@@ -971,6 +1355,7 @@ STATIC XState FluidicState_WaitForContact(Fluidic_t* me, XEvent_t* pEv)
     }
     else
     {
+      FluidicTimerArmDeadline(me, FluidicMoveElapsedMs(me), me->run.timeout_ms);
       retCode = X_RET_HANDLED;
     }
     break;
@@ -991,6 +1376,8 @@ STATIC XState FluidicState_WaitForContact(Fluidic_t* me, XEvent_t* pEv)
 
   retCode = FluidicsErrorSet(me, error, retCode);
   
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -1010,12 +1397,17 @@ STATIC XState FluidicState_CheckForStrip(Fluidic_t* me, XEvent_t* pEv)
   eErrorCode error = OK_STATUS;
   eXEventId eventId = pEv->id;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch(eventId)
   {
   case X_EV_ENTRY:
-    me->timeoutTimer = 0u;
-    XTimerStart(&(me->timer));
-    error = ecSetModeFillDetect(me->pEchem, me->pParams->eChannel, EC_CHAN_POS_A); 
+    // Wait at least ECHEM_UPDATE_PERIOD_MS before checking the status
+    // (This allows the echem long enough to sample the pins.)
+    me->moveStartMs = FLUIDIC_TIME_NOW_MS();
+    FluidicRecordBegin(me, FLUIDIC_TELEMETRY_MOVE);
+    FluidicTimerArmSettle(me, ECHEM_UPDATE_PERIOD_MS + FLUIDIC_TIMER_COUNT_MS);
+    error = ecSetModeFillDetect(me->pEchem, me->eChannel, EC_CHAN_POS_A); 
     break;
     
   case X_EV_TIMER:
@@ -1028,6 +1420,8 @@ STATIC XState FluidicState_CheckForStrip(Fluidic_t* me, XEvent_t* pEv)
     }
   
   retCode = FluidicsErrorSet(me, error, retCode);
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -1039,26 +1433,23 @@ STATIC XState FluidicState_CheckForStrip(Fluidic_t* me, XEvent_t* pEv)
   *   - A strip is inserted before starting a move
   *   - If moving up the fluid channel, that there is fluid applied to the strip.
   *   Movements to Bladder down position have a few additional checks.
+  *   The first check is made once the echem has had time to sample the pins.
+  *   While the data is invalid the echem is re-checked every ECHEM_UPDATE_PERIOD_MS.
   **/
 STATIC XState FluidicState_CheckForStrip_OnTick(Fluidic_t *me)
 {
   XState retCode = X_RET_HANDLED;
   eErrorCode error = OK_STATUS;
   
-  // Increment timeout.
-  me->timeoutTimer += FLUIDIC_TIMER_COUNT_MS;
-  
   me->status.eFluidFrontPosition = ecGetFluidPosition(me->pEchem,
-                                                      me->pParams->eChannel);
+                                                      me->eChannel);
   
-  // Wait at least ECHEM_UPDATE_PERIOD_MS before checking the status
-  // (This allows the echem long enough to sample the pins.)
   // Check to see if data is not invalid (Echem may not have been serviced yet)
-  if((me->timeoutTimer > ECHEM_UPDATE_PERIOD_MS) && (me->status.eFluidFrontPosition != FD_DATA_INVALID))
+  if(me->status.eFluidFrontPosition != FD_DATA_INVALID)
   {
     // Check the status of the fluid front. Do this on a timer update so that even if the status hasn't
     // been published in event we are still getting an update.
-    me->status.eFluidFrontPosition = ecGetFluidPosition(me->pEchem, me->pParams->eChannel);
+    me->status.eFluidFrontPosition = ecGetFluidPosition(me->pEchem, me->eChannel);
     
     // If moving to down position then doesn't need to be fluid. But does need a strip.
     if((me->eTargetPos == BC_POS_DOWN) && (me->status.eFluidFrontPosition >= NO_FLUID_DETECTED))
@@ -1069,7 +1460,6 @@ STATIC XState FluidicState_CheckForStrip_OnTick(Fluidic_t *me)
     else if((me->status.eFluidFrontPosition >= FLUID_DETECTED) &&  me->eTargetPos > BC_POS_DOWN)
     {
       retCode = X_TRAN(me, &FluidicState_MoveContact);
-      me->timeoutTimer = 0u;  // Reset the timeout timer
     }
     // Not a critical error if no strip (someone may have requested the movement
     // before putting strip in instrument)
@@ -1090,11 +1480,16 @@ STATIC XState FluidicState_CheckForStrip_OnTick(Fluidic_t *me)
   
   // We should have received a response from the echem before timeout,
   // if no response is received there is an error.
-  if(me->timeoutTimer >= me->pParams->timeout_ms)
+  if(FluidicMoveElapsedMs(me) >= me->run.timeout_ms)
   {
     error = ERROR_COMMAND_TIMEOUT;
     retCode = X_TRAN(me, &FluidicState_Idle);
   }
+  // Echem data not yet valid, check again after the next update.
+  else if(X_RET_HANDLED == retCode)
+  {
+    FluidicTimerArmSettle(me, ECHEM_UPDATE_PERIOD_MS);
+  }
   
   
   if(OK_STATUS != error)
@@ -1131,6 +1526,8 @@ STATIC XState FluidicState_WaitForPiezoStop(Fluidic_t* me, XEvent_t* pEv)
   PiezoMoveCompltEv_t* pMoveCmplt = (PiezoMoveCompltEv_t*) pEv;
   PiezoStoppedEv_t * pStoppedEv = (PiezoStoppedEv_t*) pEv;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch(eventId)
   {    
   case XMSG_PIEZO_STOPPED:
@@ -1154,7 +1551,7 @@ STATIC XState FluidicState_WaitForPiezoStop(Fluidic_t* me, XEvent_t* pEv)
       
       // Select state dependant on whether need to detect for breach or not.
       // We can detect breach here as we're holding fluid at a given contact.
-      if(me->pParams->monitorBreachAfterMove)
+      if(me->run.monitorBreachAfterMove)
       {
         retCode = X_TRAN(me, FluidicState_MonitorFluidBreach);
       }
@@ -1175,6 +1572,8 @@ STATIC XState FluidicState_WaitForPiezoStop(Fluidic_t* me, XEvent_t* pEv)
   }
   
   retCode = FluidicsErrorSet(me, error, retCode);
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -1203,24 +1602,35 @@ STATIC XState FluidicStateWaitForPiezoStop_OnPiezoStop(Fluidic_t *me,
   
   /// Check the pushback mechanism; this is required when moving forwards.
   
-  eFluidOvershootCompensation_t eCompType = me->pParams->eOvershootCompensationType;
+  eFluidOvershootCompensation_t eCompType = me->run.eOvershootCompensationType;
   
   // We kknow that we're at the target position. However, we might be performing
   // some additional movements in order to avoid overshoot.
   me->eLastKnownPos = me->eTargetPos;
   
   /// Store the updated piezo voltage.
-  me->pParams->positionLimits[me->eTargetPos].targetVolts = 
+  me->run.positions[me->eTargetPos].targetVolts = 
     piezoVoltageGet(me->pPiezo);
   
   if(me->status.eMoveDirection == FLUID_MOVE_FWD)
   {   
+    me->isContactVoltsKnown[me->eTargetPos] = true;
+    
+    // Learn the contact voltage for the next test on this strip lot.
+    if(NULL != me->pCal)
+    {
+      FluidicCalRecord(me->pCal,
+                       me->eChannel,
+                       me->eTargetPos,
+                       me->run.positions[me->eTargetPos].targetVolts);
+    }
+    
     // Compensation only applied if moving forwards initially.
     if(FLUID_OVERSHOOT_COMP_NONE == eCompType)
     {
       // No compensation, therefore publish completion.
       FluidicOnMoveCompleteMsg(me);
-      me->pParams->positionLimits[me->eTargetPos].targetVolts =
+      me->run.positions[me->eTargetPos].targetVolts =
         me->status.piezoVoltage;
       movementIsComplete = true;
     }
@@ -1233,20 +1643,20 @@ STATIC XState FluidicStateWaitForPiezoStop_OnPiezoStop(Fluidic_t *me,
       
       /// Set Piezo voltage to V[pos] - ((V[pos] - V[pos - 1]) * compensationFactor);
       
-      overshootPiezoVoltage = me->pParams->positionLimits[me->eTargetPos].targetVolts;
-      overshootPiezoVoltage -= me->pParams->positionLimits[lowerPos].targetVolts;
-      overshootPiezoVoltage *= me->pParams->compensationProportion;
+      overshootPiezoVoltage = me->run.positions[me->eTargetPos].targetVolts;
+      overshootPiezoVoltage -= me->run.positions[lowerPos].targetVolts;
+      overshootPiezoVoltage *= me->run.compensationProportion;
       
-      overshootParams.targetVoltage = me->pParams->positionLimits[me->eTargetPos].targetVolts - overshootPiezoVoltage;
+      overshootParams.targetVoltage = me->run.positions[me->eTargetPos].targetVolts - overshootPiezoVoltage;
       
       /// This high speed "push-back" has to be at the fastest possible rate.
       overshootParams.rampSpeed = PIEZO_RAMP_MAX;
       overshootParams.publishCompletion = false;
       
       // Save this slightly lower voltage.
-      me->pParams->positionLimits[me->eTargetPos].targetVolts = overshootParams.targetVoltage;
+      me->run.positions[me->eTargetPos].targetVolts = overshootParams.targetVoltage;
       
-      error = piezoVoltageSet(me->pPiezo, &overshootParams);
+      error = FluidicPiezoVoltageSet(me, &overshootParams);
     }
     
     // Only remaining compensation method is to break and remake contact.
@@ -1254,6 +1664,7 @@ STATIC XState FluidicStateWaitForPiezoStop_OnPiezoStop(Fluidic_t *me,
     {
       // Move back down to the previous contact.
       me->status.eMoveDirection = FLUID_MOVE_REV;
+      FluidicRecordRetry(me);
       // Need to transition to movement state.
       retCode = X_TRAN(me, &FluidicState_MoveContact);
     }
@@ -1263,7 +1674,7 @@ STATIC XState FluidicStateWaitForPiezoStop_OnPiezoStop(Fluidic_t *me,
     // Bug observed in units
     // Therefore just stop if performing fluid move.
     FluidicOnMoveCompleteMsg(me);
-    me->pParams->positionLimits[me->eTargetPos].targetVolts =
+    me->run.positions[me->eTargetPos].targetVolts =
       me->status.piezoVoltage;
     
     movementIsComplete = true;
@@ -1283,7 +1694,7 @@ STATIC XState FluidicStateWaitForPiezoStop_OnPiezoStop(Fluidic_t *me,
 //    
 //    if(me->pParams->returnSpeedRedcutionFactor > 0.f)
 //    {
-//      me->pParams->rampSpeedVoltsPerSec /= me->pParams->returnSpeedRedcutionFactor;  
+//      me->run.rampSpeedVoltsPerSec /= me->pParams->returnSpeedRedcutionFactor;  
 //    }
 //
 //    me->status.eMoveDirection = FLUID_MOVE_RETURN;
@@ -1295,7 +1706,7 @@ STATIC XState FluidicStateWaitForPiezoStop_OnPiezoStop(Fluidic_t *me,
   else
   {
     FluidicOnMoveCompleteMsg(me);
-    me->pParams->positionLimits[me->eTargetPos].targetVolts =
+    me->run.positions[me->eTargetPos].targetVolts =
       me->status.piezoVoltage;
     
     movementIsComplete = true;
@@ -1309,7 +1720,7 @@ STATIC XState FluidicStateWaitForPiezoStop_OnPiezoStop(Fluidic_t *me,
   // 
   if(movementIsComplete)
   {
-    if(me->pParams->monitorBreachAfterMove)
+    if(me->run.monitorBreachAfterMove)
     {
       retCode = X_TRAN(me, FluidicState_MonitorFluidBreach);
     }
@@ -1334,7 +1745,11 @@ Event                     | Actions
 ------------------------- | ---------------------------------
 X_EV_ENTRY                | Starts the movement (for this stage of mixing)
 ------------------------- |----------------------------------
-X_EV_TIMER                | Processing for the fluidic channel, on the 20ms timer. Detects the end of the mixing stage.
+X_EV_TIMER                | Mix timeout. Moves back to the mix end position.
+------------------------- |----------------------------------
+XMSG_EC_FLUID_STATUS_CHANGED | Updates the fluid front position. Detects the end of the mixing stage.
+------------------------- |----------------------------------
+X_EV_EXIT                 | Adds the stage duration to the mix time.
 ------------------------- |----------------------------------
 XMSG_FLUID_CHANNEL_CANCEL | Stops the fluid channel mixing, and begins a move back to the rest position.
 --------------------------|----------------------------------
@@ -1351,6 +1766,8 @@ STATIC XState FluidicState_MixContactControlled(Fluidic_t* me, XEvent_t* pEv)
     PiezoMoveCompltEv_t* pMoveCmplt = (PiezoMoveCompltEv_t*) pEv;
   eXEventId eventId = pEv->id;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch(eventId)
   {
   case X_EV_ENTRY:
@@ -1358,16 +1775,28 @@ STATIC XState FluidicState_MixContactControlled(Fluidic_t* me, XEvent_t* pEv)
     break;
     
   case X_EV_TIMER:
-    retCode = FluidicMixContactControlled_OnTick(me);
+    retCode = FluidicMix_OnTimeout(me);
+    break;
+    
+  case XMSG_EC_FLUID_STATUS_CHANGED:
+    error = FluidOnEchemStatusChange(me, pEv);
+    retCode = FluidicMixContactControlled_CheckFluidFront(me);
+    break;
+    
+  case X_EV_EXIT:
+    me->mixTimer += FLUIDIC_TIME_NOW_MS() - me->mixStageStartMs;
+    FluidicRecordEnd(me, FLUIDIC_TELEMETRY_CANCELLED, OK_STATUS);    // Stroke cut short.
+    retCode = Fluidic_defaultEvents(me, pEv);
     break;
     
   case XMSG_PIEZO_MOVE_COMPLTE:
     if(pMoveCmplt->chan == me->pPiezo->pParams->chan)
     {
       // Move completed, without reaching the contact.
-      // Therefore increase the hysterisis on the target contact.
-      AdjustHysterisisVoltage(me, FLUID_HYST_INC);
+      // Therefore move the stroke end point further out.
+      FluidicMixControllerUpdate(me, false, pMoveCmplt->piezoVoltage);
       me->status.piezoVoltage = pMoveCmplt->piezoVoltage;  
+      FluidicRecordEnd(me, FLUIDIC_TELEMETRY_MISSED, OK_STATUS);
       // Stage is complete. Do the next stage!
       retCode = FluidMixOnStageComplete(me);
     }
@@ -1380,7 +1809,7 @@ STATIC XState FluidicState_MixContactControlled(Fluidic_t* me, XEvent_t* pEv)
   case XMSG_FLUID_CHANNEL_CANCEL:
     //A cancel fluid mix causes it to create a move command to the last known position.
     //No parameters are involved.
-    me->eTargetPos = me->pParams->eMixEndPosition;
+    me->eTargetPos = me->run.eMixEndPosition;
     me->status.mixComplete = true;
     
     // Movement is cancelled automatically when new move message is sent to Piezo.
@@ -1394,6 +1823,8 @@ STATIC XState FluidicState_MixContactControlled(Fluidic_t* me, XEvent_t* pEv)
   }
   
   retCode = FluidicsErrorSet(me, error, retCode);
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -1414,11 +1845,13 @@ STATIC XState FluidicState_MixContactControlled(Fluidic_t* me, XEvent_t* pEv)
     ------------------------- | ---------------------------------
     X_EV_ENTRY                | Initialises the fluid channel mixing process.
     ------------------------- |----------------------------------
-    X_EV_TIMER                | Processing for the fluidic channel, on the 20ms timer.
+    X_EV_TIMER                | Mix timeout. Moves back to the mix end position.
+    ------------------------- |----------------------------------
+    X_EV_EXIT                 | Adds the stage duration to the mix time.
     ------------------------- |----------------------------------
     XMSG_FLUID_CHANNEL_CANCEL | Stops the fluid channel mixing, and begins a move back to the rest position.
     --------------------------|----------------------------------
-    XMSG_PIEZO_MOVE_COMPLTE   | Used to indicate that the mixing stage movement has compelted.
+    XMSG_PIEZO_MOVE_COMPLTE   | Used to indicate that the mixing stage movement has compelted, or the whole mix if streamed as a waveform.
     ------------------------- |----------------------------------
     default                   | Calls the default event handler. 
   **/
@@ -1430,6 +1863,8 @@ STATIC XState FluidicState_MixPiezoControlled(Fluidic_t* me, XEvent_t* pEv)
   
   eErrorCode error = OK_STATUS;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch(eventId)
   {
   case X_EV_ENTRY:
@@ -1437,17 +1872,13 @@ STATIC XState FluidicState_MixPiezoControlled(Fluidic_t* me, XEvent_t* pEv)
     break;
     
   case X_EV_TIMER:
-    me->mixTimer += FLUIDIC_TIMER_COUNT_MS;
+    retCode = FluidicMix_OnTimeout(me);
+    break;
     
-    if(me->mixTimer >= me->pParams->mixTimeout_ms)
-    {
-      /* Let the script runner know that this is down to timeout
-       * (instrument inactivity). */
-      FluidicOnMoveFailMsg(me, me->eTargetPos, ERROR_DXRUNNER_FMIX_TIMEOUT);
-      me->eTargetPos = me->pParams->eMixEndPosition;
-      
-      retCode = X_TRAN(me, &FluidicState_MoveContact);
-    }
+  case X_EV_EXIT:
+    me->mixTimer += FLUIDIC_TIME_NOW_MS() - me->mixStageStartMs;
+    FluidicRecordEnd(me, FLUIDIC_TELEMETRY_CANCELLED, OK_STATUS);    // Stroke cut short.
+    retCode = Fluidic_defaultEvents(me, pEv);
     break;
     
   case XMSG_PIEZO_MOVE_COMPLTE:  
@@ -1467,7 +1898,7 @@ STATIC XState FluidicState_MixPiezoControlled(Fluidic_t* me, XEvent_t* pEv)
   case XMSG_FLUID_CHANNEL_CANCEL:
     //A cancel fluid mix causes it to create a move command to the last known position.
     //No parameters are involved.
-    me->eTargetPos = me->pParams->eMixEndPosition;
+    me->eTargetPos = me->run.eMixEndPosition;
     me->status.mixComplete = true;
     
     // Movement is cancelled automatically when new move message is sent to Piezo.
@@ -1482,6 +1913,8 @@ STATIC XState FluidicState_MixPiezoControlled(Fluidic_t* me, XEvent_t* pEv)
   
   retCode = FluidicsErrorSet(me, error, retCode);
   
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -1500,26 +1933,20 @@ STATIC XState FluidicState_MixWaitContinue(Fluidic_t *me,
   
   eErrorCode error = OK_STATUS;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch(eventId)
   {
   case X_EV_ENTRY:
     // Stop any Piezo movement!
     // Waiting for our next command.
-    (void)piezoStop(me->pPiezo);
+    (void)FluidicStopMove(me);
     
     X_PUBLISH(X_FRAMEWORK_OF(me), me->stageCompelteMsg);
     break;
     
   case X_EV_TIMER:
-    me->mixTimer += FLUIDIC_TIMER_COUNT_MS;
-    
-    if(me->mixTimer >= me->pParams->mixTimeout_ms)
-    {
-      FluidicOnMoveFailMsg(me, me->eTargetPos, ERROR_DXRUNNER_FMIX_TIMEOUT);
-      me->eTargetPos = me->pParams->eMixEndPosition;
-      
-      retCode = X_TRAN(me, &FluidicState_MoveContact);
-    }
+    retCode = FluidicMix_OnTimeout(me);
     break;
     
   case XMSG_FLUID_MIX_CONTINUE:
@@ -1533,7 +1960,7 @@ STATIC XState FluidicState_MixWaitContinue(Fluidic_t *me,
   case XMSG_FLUID_CHANNEL_CANCEL:
     //A cancel fluid mix causes it to create a move command to the last known position.
     //No parameters are involved.
-    me->eTargetPos = me->pParams->eMixEndPosition;
+    me->eTargetPos = me->run.eMixEndPosition;
     me->status.mixComplete = true;
     
     // Movement is cancelled automatically when new move message is sent to Piezo.
@@ -1547,6 +1974,8 @@ STATIC XState FluidicState_MixWaitContinue(Fluidic_t *me,
   }
   
   retCode = FluidicsErrorSet(me, error, retCode);
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -1557,7 +1986,8 @@ STATIC XState FluidicState_MixWaitContinue(Fluidic_t *me,
   * @details Fluid position is held static (first implementation), the fluid 
   *          position from the electrochem object is monitored to check for breach.
   *          If a breach is detected then publish the event (handled by event sender)
-  *          Accepts new move and hold commands.
+  *          Accepts new move, mix, lift up and wait for contact commands.
+  *          Queued commands are started on entry.
   * @param me The fluidic object. 
   * @param pEv Input events to be handled.
   * @returns State response code.
@@ -1568,7 +1998,9 @@ STATIC XState FluidicState_MonitorFluidBreach(Fluidic_t* me, XEvent_t* pEv)
   
   eXEventId eventId = pEv->id;
   
-  eElectrochemicalChannel ecChan = me->pParams->eChannel;
+  eElectrochemicalChannel ecChan = me->eChannel;
+  
+  FluidicTraceOnEvent(me, pEv);
   
   switch(eventId)
   {
@@ -1577,6 +2009,13 @@ STATIC XState FluidicState_MonitorFluidBreach(Fluidic_t* me, XEvent_t* pEv)
     // This state is only entererd after movement completion
     // Just turn on the echem channel.
     (void)ecSetModeFillDetect(me->pEchem, ecChan, ConvertFluidPosToEchemPos(me->eLastKnownPos));                      
+    FluidicSetScanFocus(me, EC_CHAN_POS_NONE);   // Nothing to wait on,
+    FluidicSetScanWatch(me, true);               // but a breach must be seen at the plain sweep rate.
+    FluidicCmdQueueDispatch(me);
+    break;
+    
+  case X_EV_EXIT:
+    FluidicSetScanWatch(me, false);
     break;
     
   case XMSG_EC_FLUID_STATUS_CHANGED:
@@ -1598,11 +2037,10 @@ STATIC XState FluidicState_MonitorFluidBreach(Fluidic_t* me, XEvent_t* pEv)
     break;
     
   case XMSG_FLUID_CHANNEL_MOVE_TO:
-    retCode = OnMsgBladderControlMoveToPos(me, pEv);
-    break;
-    
+  case XMSG_FLUID_LIFT_UP_BLADDER:
   case XMSG_FLUID_MIX:
-    retCode = OnMsgBladderControlMix(me, pEv);
+  case XMSG_FLUID_WAIT_FOR_CONTACT:
+    retCode = FluidicOnCommandMsg(me, pEv);
     break;
     
   default:
@@ -1610,6 +2048,8 @@ STATIC XState FluidicState_MonitorFluidBreach(Fluidic_t* me, XEvent_t* pEv)
     break;
   }
   
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -1637,6 +2077,8 @@ STATIC XState FluidicState_Err(Fluidic_t* me, XEvent_t* pEv)
   XState retCode = X_RET_HANDLED;
   eXEventId eventId = pEv->id;
   
+  FluidicTraceOnEvent(me, pEv);
+  
   switch(eventId)
   {
   case X_EV_ENTRY:
@@ -1652,6 +2094,8 @@ STATIC XState FluidicState_Err(Fluidic_t* me, XEvent_t* pEv)
     break;
   }
   
+  XEventPoolRelease(me->pEventPool, pEv);
+  FluidicRestPosPublish(me);
   return retCode;
 }
 
@@ -1670,7 +2114,7 @@ STATIC void Fluidic_OnErrorStateEntry(Fluidic_t *me)
 {
   eErrorCode error;
   // Disable echem, and stop piezo movement. Report error (on debug port)
-  error = ecDisable(me->pEchem, me->pParams->eChannel);
+  error = ecDisable(me->pEchem, me->eChannel);
   ERROR_CHECK(error);
   error = FluidicStopMove(me);
   ERROR_CHECK(error);
@@ -1679,6 +2123,8 @@ STATIC void Fluidic_OnErrorStateEntry(Fluidic_t *me)
   
   //Forces a homing move after exiting the error state.
   FluidicSetCurrentAndTargetPositions(me, BC_POS_UNKNOWN, BC_NONE);
+  FluidicCmdQueueFlush(me);
+  FluidicRecordEnd(me, FLUIDIC_TELEMETRY_FAILED, me->super.super.errorCode);
   
   // Now publish error message.
   me->errorMsg.errorCode =  me->super.super.errorCode;
@@ -1717,6 +2163,8 @@ XMSG_PEIZO_MOVE_FAIL      | Updates the fluidic channel parameters
 ------------------------- |----------------------------------
 XMSG_FLUID_CHANNEL_NEW_PARAMS | Updates the fluidic channel parameters
 ------------------------- |----------------------------------
+XMSG_FLUID_STATS_DUMP     | Dumps (and optionally resets) the latency histograms.
+------------------------- |----------------------------------
 XMSG_EC_ERROR             | Updates the echem status in the fluidic object, and checks for critical errors.
 ------------------------- |----------------------------------
 default                   | Ignored.
@@ -1735,10 +2183,20 @@ STATIC XState Fluidic_defaultEvents(Fluidic_t* me, XEvent_t* pEv)
   
   FluidicMovePositionMsg_t *pFMoveEv;
   
+  // Queued commands are only dispatched to a state which can start them, so
+  // this one started something else after cmdInFlight was posted. Answer it,
+  // and what was queued behind it, rather than leave the queue waiting on it.
+  if ((pEv == &(me->cmdInFlight.msg.super)) && me->cmdDispatchPending)
+  {
+    FluidicCmdQueueFlush(me);
+  }
+  
   switch(pEv->id)
   {    
   case XMSG_FLUID_CHANNEL_CANCEL:      
   case XMSG_GLOBAL_HALT:                
+    FluidicRecordEnd(me, FLUIDIC_TELEMETRY_CANCELLED, OK_STATUS);
+    
     if(me->eTargetPos != BC_NONE)
     {
       FluidicOnMoveCompleteMsg(me);                                             //Publish a move complete message so that other objects know we've stopped moving.
@@ -1747,6 +2205,7 @@ STATIC XState Fluidic_defaultEvents(Fluidic_t* me, XEvent_t* pEv)
     
     // Stopping movement and disabling echem handled in idle state.
     me->status.eFluidFrontPosition = FD_DATA_INVALID;
+    FluidicCmdQueueFlush(me);
     retCode = X_TRAN(me, &FluidicState_Idle);
     break;
     
@@ -1754,9 +2213,11 @@ STATIC XState Fluidic_defaultEvents(Fluidic_t* me, XEvent_t* pEv)
     // No error codes generated, just perform a homing move.
     // Do not need to use OnMsgBladderControlMoveToPos as 
     // target position is known.
+    FluidicRecordEnd(me, FLUIDIC_TELEMETRY_CANCELLED, OK_STATUS);
     me->eTargetPos = BC_POS_HOME;
     
     me->publishCompletionEvent = false; /// Only case where command complete should not be published.
+    FluidicCmdQueueFlush(me);
     
     retCode = X_TRAN(me, &FluidicState_MoveOther);
     break;
@@ -1802,6 +2263,10 @@ STATIC XState Fluidic_defaultEvents(Fluidic_t* me, XEvent_t* pEv)
     retCode = X_RET_HANDLED;
     break;
     
+  case XMSG_FLUID_STATS_DUMP:
+    FluidicOnStatsDumpMsg(me, pEv);
+    break;
+    
     
   case XMSG_PEIZO_MOVE_FAIL:
     pMoveFailMsg = (PiezoMoveFailEv_t *) pEv;
@@ -1824,13 +2289,13 @@ STATIC XState Fluidic_defaultEvents(Fluidic_t* me, XEvent_t* pEv)
     // Timer should be re-enabled as required.
   case X_EV_EXIT:
     error = OK_STATUS;
-    XTimerStop(&(me->timer));
+    XTimerWheelCancel(me->pTimerWheel, &(me->timer));
     break;
     
     // Set the breach detect status to new value in message.
   case XMSG_FLUID_ENABLE_BREACH_DETECT:
     pMonitorFluidBreachMsg = (FluidicMonitorBreachMsg_t*)pEv;
-    me->pParams->monitorBreachAfterMove = pMonitorFluidBreachMsg->monitorFluidPosition;
+    me->run.monitorBreachAfterMove = pMonitorFluidBreachMsg->monitorFluidPosition;
     break; 
     
   default:
@@ -1859,9 +2324,7 @@ STATIC XState Fluidic_defaultEvents(Fluidic_t* me, XEvent_t* pEv)
 STATIC eErrorCode OnFluidMoveContact_Entry(Fluidic_t* me)
 {
   eErrorCode error;
-  eElectrochemicalChannel ecChan = me->pParams->eChannel;
-  
-  XTimerStart(&(me->timer));    // Need timer if moving.
+  eElectrochemicalChannel ecChan = me->eChannel;
   
   //First - Check whether eChem is needed.
   eFluidicPositions_t eTarget = me->eTargetPos;
@@ -1869,15 +2332,18 @@ STATIC eErrorCode OnFluidMoveContact_Entry(Fluidic_t* me)
   ASSERT((me->eTargetPos <= BC_VALID_POS_COUNT) && 
          (me->eTargetPos > BC_POS_DOWN));
   
-  me->timeoutTimer = 0u;      // Reset timeout timer.
+  me->moveStartMs = FLUIDIC_TIME_NOW_MS();
+  FluidicRecordBegin(me, FLUIDIC_TELEMETRY_MOVE);       // Already open if the strip check, or a first contact, started the move.
+  FluidicTimerArmSettle(me, FLUIDIC_TIMER_COUNT_MS);    // Check the starting fluid front, then wait for the deadline.
   
   error = ecSetModeFillDetect(me->pEchem, ecChan, EC_CHAN_POS_A);    // We're moving to a contact, therefore we need to monitor all contacts.                  
+  FluidicSetScanFocus(me, ConvertFluidPosToEchemPos(eTarget));   // But sample the target's contact the most.
   
   
   // If no errors when setting up echem, start piezo movements.
   if(OK_STATUS == error)
   {
-    error = FluidicBeginPiezoMoveToTarget(me);
+    error = FluidicBeginPiezoMoveToContact(me);
   }
   // If there was an error setting up echem then we have failed moving.
   // publish movement fail event.
@@ -1905,8 +2371,18 @@ STATIC eErrorCode OnFluidMoveOther_Entry(Fluidic_t* me)
   
   eErrorCode err ;
   
-  me->timeoutTimer = 0u;
-  XTimerStart(&(me->timer));    // Need timer if moving.
+  me->moveStartMs = FLUIDIC_TIME_NOW_MS();
+  FluidicRecordBegin(me, FLUIDIC_TELEMETRY_MOVE);
+  
+  // Bladder detection is started once the channels have settled.
+  if(me->eTargetPos == BC_POS_DOWN)
+  {
+    FluidicTimerArmSettle(me, FLUIDIC_TIMER_COUNT_MS);
+  }
+  else
+  {
+    FluidicTimerArmDeadline(me, 0u, me->run.timeout_ms);
+  }
   
   if(me->eTargetPos == BC_POS_HOME)
   {
@@ -1916,7 +2392,7 @@ STATIC eErrorCode OnFluidMoveOther_Entry(Fluidic_t* me)
   { 
     // If we're moving to home / down, then we don't want our contacts to be 
     // enabled.
-    err = ecDisable(me->pEchem, me->pParams->eChannel);
+    err = ecDisable(me->pEchem, me->eChannel);
     
     if (OK_STATUS == err)
     {
@@ -1957,8 +2433,18 @@ STATIC eErrorCode OnLiftUpBladders_Entry(Fluidic_t* me)
 
   eErrorCode err;
 
-  me->timeoutTimer = 0u;
-  XTimerStart(&(me->timer));    // Need timer if moving.
+  me->moveStartMs = FLUIDIC_TIME_NOW_MS();
+  FluidicRecordBegin(me, FLUIDIC_TELEMETRY_MOVE);
+
+  // Bladder detection is started once the channels have settled.
+  if(me->eTargetPos == BC_POS_HOME)
+  {
+    FluidicTimerArmSettle(me, FLUIDIC_TIMER_COUNT_MS);
+  }
+  else
+  {
+    FluidicTimerArmDeadline(me, 0u, me->run.timeout_ms);
+  }
 
   err = FluidicBeginPiezoMoveToLift(me);
 
@@ -1972,14 +2458,112 @@ STATIC eErrorCode OnLiftUpBladders_Entry(Fluidic_t* me)
 
 
 /**
-*     @brief Processes the timer tick for the Move state.
+*     @brief Processes the timer events for the Move state.
 *     @param[in] me - The fluidic controller instance.
 *     @details Checks the status of the Piezo and Fluid detect system to
 *              determine if a move has been completed, or has failed.
-*              As we're moving to a channel contact we always 
+*              The first event is the settling check, which catches a fluid
+*              front that already meets the requirement. The timer is then
+*              armed for the predictive stop, if any, and the move timeout.
+*              A predictively stopped Piezo waits one echem sweep for the
+*              front. If it has not arrived the move is finished as normal.
 *     @returns State transition code.
 **/
 STATIC XState FluidicMoveContact_OnTick (Fluidic_t* me)
+{
+  eErrorCode error = OK_STATUS;
+  XState retCode = FluidicMoveContact_CheckFluidFront(me, &error);
+  
+  if(FluidicTimerIsDeadline(me))
+  {    
+    FluidicOnMoveFailMsg(me, me->eTargetPos, ERROR_DXRUNNER_FMOV_TIMEOUT);
+    retCode = X_TRAN(me, &FluidicState_Idle);
+  }
+  else if(X_RET_HANDLED != retCode)
+  {
+    // Move completed or failed.
+  }
+  else if(me->front.isStopPending)
+  {
+    me->front.isStopPending = false;
+    me->front.isFrontAwaited = true;
+    error = FluidicStopMove(me);
+    FluidicTimerArmSettle(me, ECHEM_UPDATE_PERIOD_MS + FLUIDIC_TIMER_COUNT_MS);
+  }
+  else if(me->front.isFrontAwaited)
+  {
+    // Stopped short of the contact.
+    me->front.isFrontAwaited = false;
+    FluidicRecordRetry(me);
+    error = FluidicBeginPiezoMoveToTarget(me);
+    FluidicMoveContact_ArmTimer(me);
+  }
+  else
+  {
+    FluidicMoveContact_ArmTimer(me);
+  }
+  
+  return FluidicsErrorSet(me, error, retCode);
+}
+
+
+/**
+*     @brief Arms the timer of a move to a contact.
+*     @param[in] me - The fluidic controller instance.
+*     @details Arms the timer for a predictive stop if the fluid front
+*              estimator predicts the target contact, and the stop is due
+*              before the move timeout. Otherwise arms it for the timeout.
+*              Predictive stops are only made on forward moves at the
+*              requested ramp speed.
+**/
+STATIC void FluidicMoveContact_ArmTimer(Fluidic_t* me)
+{
+  uint32_t elapsed_ms = FluidicMoveElapsedMs(me);
+  uint32_t stop_ms = 0u;
+  float predictedVolts;
+  float stopVolts;
+  float nowVolts;
+  
+  me->front.isStopPending = false;
+  
+  if((FLUID_MOVE_FWD == me->status.eMoveDirection) &&
+     (false == me->isApproaching) &&
+     (me->pParams->predictiveStopLeadMs > 0u) &&
+     (me->run.rampSpeedVoltsPerSec > 0.f) &&
+     FluidicFrontPredictVolts(me, me->eTargetPos, &predictedVolts))
+  {
+    stopVolts = predictedVolts - ((me->run.rampSpeedVoltsPerSec *
+                                   (float)me->pParams->predictiveStopLeadMs) / 1000.f);
+    nowVolts = piezoVoltageGet(me->pPiezo);
+    
+    if(stopVolts > nowVolts)
+    {
+      stop_ms = (uint32_t)(((stopVolts - nowVolts) * 1000.f) / me->run.rampSpeedVoltsPerSec) + 1u;
+      me->front.isStopPending = ((elapsed_ms + stop_ms) < me->run.timeout_ms);
+    }
+  }
+  
+  if(me->front.isStopPending)
+  {
+    FluidicTimerArmSettle(me, stop_ms);
+  }
+  else
+  {
+    FluidicTimerArmDeadline(me, elapsed_ms, me->run.timeout_ms);
+  }
+}
+
+
+
+/**
+*     @brief Checks the fluid front position against the move's echem requirement.
+*     @param[in] me - The fluidic controller instance.
+*     @param[out] pError - Set to the error from stopping the Piezo, if it was stopped.
+*     @details Called on the settling check, and on each echem status change.
+*              Stops the Piezo as soon as the fluid front reaches the requirement.
+*     @returns State transition code.
+**/
+STATIC XState FluidicMoveContact_CheckFluidFront(Fluidic_t* me, eErrorCode* pError)
 {
   XState retCode = X_RET_HANDLED;
   
@@ -1989,8 +2573,6 @@ STATIC XState FluidicMoveContact_OnTick (Fluidic_t* me)
   
   eEcFluidDetectPosition_t eRequirement = fluidGetEchemRequirement(me,
                                                                    true);
-
-  eErrorCode error = OK_STATUS;
   
   eEcFluidDetectPosition_t eFluidFrontPos = me->status.eFluidFrontPosition;
   
@@ -2007,22 +2589,14 @@ STATIC XState FluidicMoveContact_OnTick (Fluidic_t* me)
     // If the fluid front is where we expect it to be then movement complete.
     if(eRequirement == eFluidFrontPos)
     {
-      error = FluidicStopMove(me);                            //Need to stop the Piezo moving, before going idle/ performing next move.
+      FluidicStatsOnFrontStop(me);
+      *pError = FluidicStopMove(me);                          //Need to stop the Piezo moving, before going idle/ performing next move.
       retCode = X_TRAN(me, &FluidicState_WaitForPiezoStop);   // Go to wait state. (This should only take 1 ThreadX tick,
                                                               // but could take more.
     }
   }
   
-  // Increment timer, and check for timer overflow.
-  me->timeoutTimer += FLUIDIC_TIMER_COUNT_MS;
-  
-  if(me->timeoutTimer >= me->pParams->timeout_ms)
-  {    
-    FluidicOnMoveFailMsg(me, me->eTargetPos, ERROR_DXRUNNER_FMOV_TIMEOUT);
-    retCode = X_TRAN(me, &FluidicState_Idle);
-  }
-  
-  return FluidicsErrorSet(me, error, retCode);
+  return retCode;
 }
 
 
@@ -2040,50 +2614,54 @@ STATIC eErrorCode FluidicMixContactControlled_OnEntry(Fluidic_t* me)
   float startVolts;
   
   float endVolts;
+  FluidicMixStroke_t stroke;
   
-  if(me->pParams->eMixType == FLUID_MIX_DUAL_POINT_LOOP)
+  if(me->run.eMixType == FLUID_MIX_DUAL_POINT_LOOP)
   {
-    startVolts = me->pParams->positionLimits[me->eLastKnownPos].targetVolts;
-    endVolts = me->pParams->positionLimits[me->eTargetPos].targetVolts;
+    startVolts = me->run.positions[me->eLastKnownPos].targetVolts;
+    endVolts = me->run.positions[me->eTargetPos].targetVolts;
     
     if(me->status.eMoveDirection == FLUID_MOVE_REV)
     {
-      endVolts -= me->pParams->positionLimits[me->eTargetPos].posHysterisis;
+      endVolts -= me->run.positions[me->eTargetPos].posHysterisis;
     }
     else
     {
-      endVolts += me->pParams->positionLimits[me->eTargetPos].posHysterisis;
+      endVolts += me->run.positions[me->eTargetPos].posHysterisis;
     }
   }
   else
   {
     if(me->status.eMoveDirection == FLUID_MOVE_REV)
     {
-      startVolts =  me->pParams->positionLimits[me->eLastKnownPos].targetVolts;
-      endVolts    = FluidicMixCalculateDownStrokeMixProportion(me);
+      startVolts =  me->run.positions[me->eLastKnownPos].targetVolts;
+      endVolts    = FluidicMixDownstrokeVolts(me, me->eTargetPos, me->status.piezoVoltage);
     }
     else
     {
       startVolts = piezoVoltageGet(me->pPiezo);
-      endVolts = me->pParams->positionLimits[me->eTargetPos].targetVolts;
-      endVolts += me->pParams->positionLimits[me->eTargetPos].posHysterisis;
+      endVolts = me->run.positions[me->eTargetPos].targetVolts;
+      endVolts += me->run.positions[me->eTargetPos].posHysterisis;
     }
   }
   
   
-  eElectrochemicalChannel ecChan = me->pParams->eChannel;
+  eElectrochemicalChannel ecChan = me->eChannel;
   
-  // Start timer, reset number of mix cycles, timer, and movement failure count.
-  XTimerStart(&(me->timer));
+  // Arm the timer for whatever is left of the mix timeout.
+  me->mixStageStartMs = FLUIDIC_TIME_NOW_MS();
+  FluidicRecordBegin(me, FLUIDIC_TELEMETRY_MIX_STROKE);
+  FluidicTimerArmDeadline(me, me->mixTimer, me->run.mixTimeout_ms);
 
-  // Calculate Piezo ramp speed from the mixing frequency.
-  fluidicMixingCalculaterampSpeedVoltsPerSec(me,
-                                             startVolts,
-                                             endVolts);
+  // The end point moves with the contact feedback, so the ramp speed is
+  // worked out per stroke to keep each stroke to half the mix period.
+  FluidicMixStrokeSet(me, &stroke, me->status.eMoveDirection, startVolts, endVolts);
+  me->run.rampSpeedVoltsPerSec = stroke.rampSpeedVoltsPerSec;
   
   // Enable the fill detect for our channel.
   // As we're moving to a contact, we set the minimum contact to our postion A.
   error = ecSetModeFillDetect(me->pEchem, ecChan, EC_CHAN_POS_A);                      
+  FluidicSetScanFocus(me, ConvertFluidPosToEchemPos(me->eTargetPos));
   
   //No homing move is allowed in mixing.
   if(OK_STATUS == error)
@@ -2100,83 +2678,65 @@ STATIC eErrorCode FluidicMixContactControlled_OnEntry(Fluidic_t* me)
 
 /**
 * @brief      Handles the entry event for the mixing state.
-* @details    Starts the movement to the next stage of the mixing; no echem used for this move,
+* @details    Starts the movement to the next stage of the mixing; no echem used for this move.
+*             An open loop mix plays the stroke from its plan, or the whole
+*             plan if it is streamed as a waveform.
 * @param[in] me - The fluidic controller
 * @returns The state handler code.
 **/
 STATIC eErrorCode FluidicMixPiezoControlled_OnEntry(Fluidic_t* me)
 {
+  const FluidicMixStroke_t *pStroke;
+  FluidicMixStroke_t stroke;
   eErrorCode error;
   
-  float startVolts;
-  float endVolts;
+  if(me->mixPlan.isStreamed)
+  {
+    pStroke = FluidicMixPlanStroke(me, me->status.mixingStagesCompleted);
+  }
   
-  // If reversing, then we will be at the top position
-  // So can sue the explicit position.
-  if(me->status.eMoveDirection == FLUID_MOVE_REV)
+  // Single point mixing: the downstroke starts wherever the contact was made.
+  else if(me->status.eMoveDirection == FLUID_MOVE_REV)
   {
-    startVolts  = me->status.piezoVoltage;
-    
-    endVolts    = FluidicMixCalculateDownStrokeMixProportion(me);
-    
-    // If it's the first step back to the top, we need to compensate for additional movement.
-    if((me->status.mixingStagesCompleted == 1u) && (me->pParams->eMixType == FLUID_MIX_OPEN_LOOP))
-    {
-      endVolts -= endVolts * me->pParams->openLoopCompensationFactor;
-    }
+    FluidicMixStrokeSet(me,
+                        &stroke,
+                        FLUID_MOVE_REV,
+                        me->status.piezoVoltage,
+                        FluidicMixDownstrokeVolts(me, me->eTargetPos, me->status.piezoVoltage));
+    pStroke = &stroke;
   }
   else
   {
-    endVolts    = me->pParams->positionLimits[me->eTargetPos].targetVolts;
-    startVolts  = me->status.piezoVoltage;
+    FluidicMixStrokeSet(me,
+                        &stroke,
+                        FLUID_MOVE_FWD,
+                        me->status.piezoVoltage,
+                        me->run.positions[me->eTargetPos].targetVolts);
+    pStroke = &stroke;
   }
   
+  // Arm the timer for whatever is left of the mix timeout.
+  me->mixStageStartMs = FLUIDIC_TIME_NOW_MS();
+  FluidicRecordBegin(me, FLUIDIC_TELEMETRY_MIX_STROKE);
+  FluidicTimerArmDeadline(me, me->mixTimer, me->run.mixTimeout_ms);
   
-  // Start timer, reset number of mix cycles, timer, and movement failure count.
-  XTimerStart(&(me->timer));
-  
-  // Calculate ramp speed based on movement amount.
-  fluidicMixingCalculaterampSpeedVoltsPerSec(me,
-                                             startVolts,
-                                             endVolts);
-  
-  // Manually set the Piezo movement.
-  peizoMoveParams_t piezoParams;
-  
-  piezoParams.rampSpeed = me->pParams->rampSpeedVoltsPerSec;
-  piezoParams.targetVoltage = endVolts;
-  piezoParams.publishCompletion = false;
-  
-  error = piezoVoltageSet(me->pPiezo, &piezoParams);
+#ifdef FLUIDIC_PIEZO_WAVEFORM
+  if(me->mixPlan.isWaveform)
+  {
+    error = FluidicMixPlayWaveform(me);
+  }
+  else
+#endif
+  {
+    error = FluidicMixPlayStroke(me, pStroke);
+  }
   
   return error;
 }
 
 
 /**
-  * @brief Helper function to calculate the lower movement position, when performing
-  *        and open loop movement (no echem contact change)
-  * @param[in] me - The fluidic control object
-  * @returns The lower position voltage.
-  **/
-STATIC float FluidicMixCalculateDownStrokeMixProportion(Fluidic_t *me)
-{
-  float endVolts = me->pParams->positionLimits[me->eTargetPos].targetVolts;
-  float startVolts = me->status.piezoVoltage;
-  
-  // Direction is always reverse.  
-  endVolts = startVolts - endVolts;
-  endVolts *= me->pParams->mixDownstrokeProportion;
-  
-  endVolts = startVolts - endVolts;
-  
-
-  return endVolts;
-}
-
-
-/**
-* @brief Processing of tick events in the mix state.
+* @brief Processing of fluid status changes in the mix state.
 * @details    Mixing control is performed using the electrochemical contacts.
 *             The Piezo moves to targetVoltage +/- hysterisis, as necessary.
 *             If the Piezo movement completes, but the fluid front is not in
@@ -2185,13 +2745,12 @@ STATIC float FluidicMixCalculateDownStrokeMixProportion(Fluidic_t *me)
 *             is still moving, the Piezo is stopped and the hystserisis level
 *             decreased.
 *             After each swing is completed we invert the movement direction.
-*             When the timer expires the target is set to the rest position.
 *             We have to wait for "stopped" events to be recieved before
 *             generating new moves.
 * @param[in] me - The fluidic controller
 * @returns The state handler code.
 **/
-STATIC XState FluidicMixContactControlled_OnTick(Fluidic_t* me)
+STATIC XState FluidicMixContactControlled_CheckFluidFront(Fluidic_t* me)
 {
   XState retCode = X_RET_HANDLED;
   
@@ -2208,49 +2767,29 @@ STATIC XState FluidicMixContactControlled_OnTick(Fluidic_t* me)
   eEcFluidDetectPosition_t eTargetFrontPosition = fluidGetEchemRequirement(me,
                                                                            true);
   
-  me->mixTimer +=  FLUIDIC_TIMER_COUNT_MS;
-  
-  // If we've exceeded mixing timeout then we've failed.
-  // Publish error
-  if(me->mixTimer >= me->pParams->mixTimeout_ms)
+  // If the fluid front is in the targeted position, then we know we've completed
+  // the movement stage.
+  // Check >= target 
+  if((eTargetFrontPosition <= me->status.eFluidFrontPosition)
+     && (me->status.eMoveDirection == FLUID_MOVE_FWD))
   {
-    /* Let the script runner know that this is down to timeout
-     * (instrument inactivity). */
-    FluidicOnMoveFailMsg(me, me->eTargetPos, ERROR_DXRUNNER_FMIX_TIMEOUT);
-    me->eTargetPos = me->pParams->eMixEndPosition;
-    
-    retCode = X_TRAN(me, &FluidicState_MoveContact);
-    fluidInCorrectPos = false;
+    fluidInCorrectPos = true;
+  }
+  else if((eTargetFrontPosition >= me->status.eFluidFrontPosition)
+     && (me->status.eMoveDirection == FLUID_MOVE_REV))
+  {
+    fluidInCorrectPos = true;
   }
-  
   else
   {
-    // If the fluid front is in the targeted position, then we know we've completed
-    // the movement stage.
-    // Check >= target 
-    if((eTargetFrontPosition <= me->status.eFluidFrontPosition)
-       && (me->status.eMoveDirection == FLUID_MOVE_FWD))
-    {
-      fluidInCorrectPos = true;
-    }
-    else if((eTargetFrontPosition >= me->status.eFluidFrontPosition)
-       && (me->status.eMoveDirection == FLUID_MOVE_REV))
-    {
-      fluidInCorrectPos = true;
-    }
-    else
-    {
-      fluidInCorrectPos = false;
-    }
+    fluidInCorrectPos = false;
   }
   
   
   if(fluidInCorrectPos)
   {
-    me->pParams->positionLimits[me->eTargetPos].targetVolts = 
-      piezoVoltageGet(me->pPiezo);
-    
-    AdjustHysterisisVoltage(me, FLUID_HYST_DEC);
+    FluidicStatsOnFrontStop(me);      // Timed if the Piezo is then stopped, rather than sent back.
+    FluidicMixControllerUpdate(me, true, piezoVoltageGet(me->pPiezo));
     
     retCode = FluidMixOnStageComplete(me);
   }
@@ -2267,25 +2806,49 @@ STATIC XState FluidicMixContactControlled_OnTick(Fluidic_t* me)
   *        fluid mixing stage.
   * @param[in] me - The fluidic controller
   * @details Increments the number of mixing stages complete, checks to see if
-  *          mixing has compelted; otherwise the mixing is continued.
+  *          mixing has compelted; otherwise the mixing is continued. A streamed
+  *          (open loop) mix starts its next planned stroke straight away, other
+  *          mixes wait for XMSG_FLUID_MIX_CONTINUE.
   *          If complete, the fluid controller moves back to the mixing end point.
   * @returns State transition code.
   **/
 STATIC XState FluidMixOnStageComplete(Fluidic_t *me)
 {
   XState retCode;
+  eErrorCode error;
   
-  me->status.mixingStagesCompleted ++;
+  FluidicRecordEnd(me, FLUIDIC_TELEMETRY_REACHED, OK_STATUS);       // Unless already recorded as missed.
+  
+  // A waveform only completes once the Piezo has played every stage.
+  if(me->mixPlan.isWaveform)
+  {
+    me->status.mixingStagesCompleted = me->mixPlan.totalStages;
+  }
+  else
+  {
+    me->status.mixingStagesCompleted ++;
+  }
   
   // Check to see if we've compelted the move.
-  if((me->status.mixingStagesCompleted / FLUID_NUM_MIXING_STAGES_PER_CYCLE) 
-     >= me->pParams->targetMixCycles)
+  if(me->status.mixingStagesCompleted >= me->mixPlan.totalStages)
   {
     FluidicOnMixComplete(me); 
     
     retCode = X_TRAN(me, &FluidicState_Idle);  
   }
   
+  // Planned strokes follow on directly, there is nothing to synchronise with.
+  else if(me->mixPlan.isStreamed)
+  {
+    FluidicMixSwapDirection(me);
+    FluidicRecordBegin(me, FLUIDIC_TELEMETRY_MIX_STROKE);
+    
+    error = FluidicMixPlayStroke(me, 
+                                 FluidicMixPlanStroke(me, me->status.mixingStagesCompleted));
+    
+    retCode = FluidicsErrorSet(me, error, X_RET_HANDLED);
+  }
+  
   // Publish the stage complete command.
   // Go to wait state.
   else
@@ -2299,11 +2862,30 @@ STATIC XState FluidMixOnStageComplete(Fluidic_t *me)
 
 
 
+/**
+  * @brief Helper for the mix timeout.
+  * @param[in] me - The fluidic controller
+  * @details The mix has not completed within the mix timeout. Publishes the
+  *          failure and moves back to the mix end position.
+  * @returns State transition code.
+  **/
+STATIC XState FluidicMix_OnTimeout(Fluidic_t* me)
+{
+  /* Let the script runner know that this is down to timeout
+   * (instrument inactivity). */
+  FluidicOnMoveFailMsg(me, me->eTargetPos, ERROR_DXRUNNER_FMIX_TIMEOUT);
+  me->eTargetPos = me->run.eMixEndPosition;
+  
+  return X_TRAN(me, &FluidicState_MoveContact);
+}
+
+
+
+
 /**
   *   @brief Helper to re-set movement of Piezo for mixing.
-  *   @details Need to invert the target and known positions, re-calculate the
-  *            mixing speed (to maintain consistent frequency)
-  *            and start moving.
+  *   @details Need to invert the target and known positions, then re-enter
+  *            the mixing state for the next stroke.
   *            At this point increment mixing cycles, and reset failure count.
   *   @returns Error code from Piezo move begin.
   **/
@@ -2311,6 +2893,45 @@ STATIC XState FluidMixMovementContinue(Fluidic_t* me)
 {
   XState retCode;
   
+  FluidicMixSwapDirection(me);
+  
+  // Now select the appropriate transition for the mixing type.
+  if(me->run.eMixType == FLUID_MIX_DUAL_POINT_LOOP)
+  {
+    retCode = X_TRAN(me, &FluidicState_MixContactControlled);
+  }
+  
+  else if(me->run.eMixType == FLUID_MIX_SINGLE_POINT_LOOP)
+  {
+    // If direction now forwards then we need to remain in this state.
+    // Otherwise, transition to Piezo controlled.
+    if(me->status.eMoveDirection == FLUID_MOVE_FWD)
+    {
+      retCode = X_TRAN(me, &FluidicState_MixContactControlled);
+    }
+    else
+    {
+      retCode = X_TRAN(me, &FluidicState_MixPiezoControlled);
+    }
+  }
+  
+  else
+  {
+    retCode = X_TRAN(me, &FluidicState_MixPiezoControlled);
+  }
+  
+  return retCode;
+}
+
+
+
+/**
+  *   @brief Helper to reverse the mix for the next stroke.
+  *   @details Swaps the target and known positions, and inverts the direction.
+  *   @param[in] me - The fluidic controller
+  **/
+STATIC void FluidicMixSwapDirection(Fluidic_t *me)
+{
   // Swap the current and target positions.
   FluidicSetCurrentAndTargetPositions(me,
                                       me->eTargetPos,
@@ -2325,33 +2946,191 @@ STATIC XState FluidMixMovementContinue(Fluidic_t* me)
   {
     me->status.eMoveDirection = FLUID_MOVE_REV;
   }
+}
+
+
+/**
+  *   @brief Helper to fill in a mix stroke.
+  *   @details The ramp speed is set so that the stroke takes half of the mix
+  *            period, whatever its length.
+  *   @param[in] me - The fluidic controller
+  *   @param[out] pStroke - The stroke to fill in.
+  *   @param[in] eDirection - Direction of the fluid movement.
+  *   @param[in] startVolts - Piezo voltage at the start of the stroke.
+  *   @param[in] endVolts - Piezo voltage at the end of the stroke.
+  **/
+STATIC void FluidicMixStrokeSet(const Fluidic_t *me,
+                                FluidicMixStroke_t *pStroke,
+                                eFluidicMoveDirection_t eDirection,
+                                float startVolts,
+                                float endVolts)
+{
+  pStroke->eDirection = eDirection;
+  pStroke->startVolts = startVolts;
+  pStroke->endVolts   = endVolts;
   
-  // Now select the appropriate transition for the mixing type.
-  if(me->pParams->eMixType == FLUID_MIX_DUAL_POINT_LOOP)
+  // Need to multiply frequency by 2 so that each movement is equal to half the
+  // mixing period.
+  pStroke->rampSpeedVoltsPerSec = (float)fabsf(startVolts - endVolts) 
+                                  * 2.f * 
+                                  me->run.mixFrequency_Hz;
+}
+
+
+/**
+  *   @brief Helper to calculate the lower point of an open loop downstroke.
+  *   @details The downstroke covers mixDownstrokeProportion of the voltage
+  *            between the upper point and the lower mix position.
+  *   @param[in] me - The fluidic controller
+  *   @param[in] eLowerPos - The lower mix position.
+  *   @param[in] upperVolts - Piezo voltage at the start of the downstroke.
+  *   @returns The lower position voltage.
+  **/
+STATIC float FluidicMixDownstrokeVolts(const Fluidic_t *me,
+                                       eFluidicPositions_t eLowerPos,
+                                       float upperVolts)
+{
+  float strokeVolts = upperVolts - me->run.positions[eLowerPos].targetVolts;
+  
+  strokeVolts *= me->run.mixDownstrokeProportion;
+  
+  return upperVolts - strokeVolts;
+}
+
+
+/**
+  *   @brief Builds the stroke schedule of the mix.
+  *   @details Called once the mix parameters have been stored, with the channel
+  *            at the mix end position and eTargetPos at the lower mix position.
+  *            An open loop mix is fully known up front:
+  *            - stroke 0, down from the current voltage, with the open loop
+  *              compensation for the first stroke,
+  *            - stroke 1, back up to the end position,
+  *            - strokes 2 and 3, the down and up strokes which then repeat.
+  *            If the configuration has an eMixWaveform, and the Piezo driver
+  *            can play it, these strokes are also sampled into the waveform
+  *            the Piezo plays.
+  *            Closed loop mixes move their end points with the contact
+  *            feedback, so only the stage count is planned and each stroke
+  *            is worked out as it starts.
+  *   @param[in] me - The fluidic controller
+  **/
+STATIC void FluidicMixPlanBuild(Fluidic_t *me)
+{
+  FluidicMixPlan_t *pPlan = &me->mixPlan;
+  float upperVolts = me->run.positions[me->run.eMixEndPosition].targetVolts;
+  float firstLowerVolts;
+  float lowerVolts;
+  bool isAdded;
+  
+  (void)memset(pPlan, 0, sizeof(FluidicMixPlan_t));
+  
+  pPlan->totalStages = me->run.targetMixCycles * FLUID_NUM_MIXING_STAGES_PER_CYCLE;
+  pPlan->isStreamed  = (me->run.eMixType == FLUID_MIX_OPEN_LOOP);
+  
+  if(pPlan->isStreamed)
   {
-    retCode = X_TRAN(me, &FluidicState_MixContactControlled);
+    firstLowerVolts  = FluidicMixDownstrokeVolts(me, me->eTargetPos, me->status.piezoVoltage);
+    firstLowerVolts -= firstLowerVolts * me->run.openLoopCompensationFactor;
+    
+    lowerVolts = FluidicMixDownstrokeVolts(me, me->eTargetPos, upperVolts);
+    
+    FluidicMixStrokeSet(me, &pPlan->strokes[0u], FLUID_MOVE_REV, me->status.piezoVoltage, firstLowerVolts);
+    FluidicMixStrokeSet(me, &pPlan->strokes[1u], FLUID_MOVE_FWD, firstLowerVolts, upperVolts);
+    FluidicMixStrokeSet(me, &pPlan->strokes[2u], FLUID_MOVE_REV, upperVolts, lowerVolts);
+    FluidicMixStrokeSet(me, &pPlan->strokes[3u], FLUID_MOVE_FWD, lowerVolts, upperVolts);
+    
+    pPlan->isWaveform = (FLUIDIC_WAVEFORM_NONE != FluidicMixWaveformShape(me));
   }
   
-  else if(me->pParams->eMixType == FLUID_MIX_SINGLE_POINT_LOOP)
+  if(pPlan->isWaveform)
   {
-    // If direction now forwards then we need to remain in this state.
-    // Otherwise, transition to Piezo controlled.
-    if(me->status.eMoveDirection == FLUID_MOVE_FWD)
-    {
-      retCode = X_TRAN(me, &FluidicState_MixContactControlled);
-    }
-    else
+    FluidicWaveformInit(&pPlan->waveform, FluidicMixWaveformShape(me), me->run.mixFrequency_Hz);
+    
+    for(uint32_t i = 0u; i < FLUIDIC_MIX_PLAN_MAX_STROKES; i++)
     {
-      retCode = X_TRAN(me, &FluidicState_MixPiezoControlled);
+      isAdded = FluidicWaveformAddStroke(&pPlan->waveform,
+                                         pPlan->strokes[i].startVolts,
+                                         pPlan->strokes[i].endVolts);
+      ASSERT(isAdded);
     }
+    
+    FluidicWaveformRepeat(&pPlan->waveform, FLUIDIC_MIX_PLAN_LEAD_IN_STROKES, pPlan->totalStages);
   }
+}
+
+
+/**
+  *   @brief Gets the planned stroke for a mix stage.
+  *   @param[in] me - The fluidic controller
+  *   @param[in] stage - Zero based mix stage.
+  *   @returns The stroke to play.
+  **/
+STATIC const FluidicMixStroke_t* FluidicMixPlanStroke(const Fluidic_t *me, uint32_t stage)
+{
+  uint32_t index = stage;
   
-  else
+  if(index >= FLUIDIC_MIX_PLAN_LEAD_IN_STROKES)
   {
-    retCode = X_TRAN(me, &FluidicState_MixPiezoControlled);
+    index = FLUIDIC_MIX_PLAN_LEAD_IN_STROKES + 
+      ((index - FLUIDIC_MIX_PLAN_LEAD_IN_STROKES) % 
+       (FLUIDIC_MIX_PLAN_MAX_STROKES - FLUIDIC_MIX_PLAN_LEAD_IN_STROKES));
   }
   
-  return retCode;
+  return &me->mixPlan.strokes[index];
+}
+
+
+/**
+  *   @brief Starts the Piezo on a mix stroke.
+  *   @details No echem checks are made against the stroke.
+  *   @param[in] me - The fluidic controller
+  *   @param[in] pStroke - The stroke to play.
+  *   @returns Error code from the piezoVoltageSet API.
+  **/
+STATIC eErrorCode FluidicMixPlayStroke(Fluidic_t *me, const FluidicMixStroke_t *pStroke)
+{
+  peizoMoveParams_t piezoParams;
+  
+  piezoParams.rampSpeed         = pStroke->rampSpeedVoltsPerSec;
+  piezoParams.targetVoltage     = pStroke->endVolts;
+  piezoParams.publishCompletion = false;
+  
+  return FluidicPiezoVoltageSet(me, &piezoParams);
+}
+
+
+/**
+  *   @brief Starts the Piezo on the mix waveform.
+  *   @details The Piezo driver plays every remaining stage, and the controller
+  *            next hears from it with XMSG_PIEZO_MOVE_COMPLTE at the end of
+  *            the mix. No echem checks are made against the waveform.
+  *   @param[in] me - The fluidic controller
+  *   @returns Error code from the piezoWaveformPlay API.
+  **/
+#ifdef FLUIDIC_PIEZO_WAVEFORM
+STATIC eErrorCode FluidicMixPlayWaveform(Fluidic_t *me)
+{
+  FluidicTraceWaveform(me, &me->mixPlan.waveform);
+  return piezoWaveformPlay(me->pPiezo, &me->mixPlan.waveform);
+}
+#endif
+
+
+/**
+  *   @brief Gets the waveform open loop mixes are played as.
+  *   @param[in] me - The fluidic controller
+  *   @returns The configured eMixWaveform, or FLUIDIC_WAVEFORM_NONE if the
+  *            Piezo driver cannot play waveforms.
+  **/
+STATIC eFluidicWaveformShape_t FluidicMixWaveformShape(const Fluidic_t *me)
+{
+#ifdef FLUIDIC_PIEZO_WAVEFORM
+  return me->pParams->eMixWaveform;
+#else
+  (void)me;
+  return FLUIDIC_WAVEFORM_NONE;
+#endif
 }
 
 
@@ -2427,6 +3206,7 @@ STATIC eErrorCode FluidOnPiezoStop(Fluidic_t* me, XEvent_t* pEv)
   if(pMoveCmplt ->chan == me->pPiezo->pParams->chan)
   {
     me->status.piezoVoltage = pMoveCmplt->piezoVoltage;
+    FluidicStatsOnPiezoStopped(me);
   }
   
   return OK_STATUS;
@@ -2466,14 +3246,310 @@ STATIC eErrorCode FluidOnPiezoMoveComplete(Fluidic_t* me, XEvent_t* pEv)
 STATIC eErrorCode FluidOnEchemStatusChange(Fluidic_t* me, XEvent_t* pEv)
 {   
   FillDetectStatusChange_t* pFdChange = (FillDetectStatusChange_t*)pEv;
+  eEcFluidDetectPosition_t eFrontPos = pFdChange->results.fluidPositions[me->eChannel];
+  
+  // Published for a change on any channel.
+  if(eFrontPos != me->status.eFluidFrontPosition)
+  {
+    me->frontChangeMs = pFdChange->sweepMs;
+    FluidicRecordFrontChange(me);
+  }
   
-  me->status.eFluidFrontPosition =  pFdChange->results.fluidPositions[me->pParams->eChannel];
+  me->status.eFluidFrontPosition = eFrontPos;
   
   return OK_STATUS;
 }
 
 
 
+/**
+*     @brief Clears the fluid front velocity estimator.
+*     @param[in]      me - The fluid controller instance.
+*     @details Contacts move with the strip, so detections are only kept
+*              until the channel is homed.
+**/
+STATIC void FluidicFrontReset(Fluidic_t* me)
+{
+  (void)memset(&(me->front), 0, sizeof(FluidicFrontEstimator_t));
+}
+
+
+/**
+*     @brief Records a contact detected by a forward move, and refits the
+*            voltage between contacts.
+*     @param[in]      me - The fluid controller instance.
+*     @details Called on each echem status change of a move to a contact.
+*              Only detections made whilst ramping at the requested speed are
+*              recorded, so every detection has the same expected delay.
+*              The voltage between contacts is the least squares slope of
+*              detection voltage against position.
+**/
+STATIC void FluidicFrontOnStatusChange(Fluidic_t* me)
+{
+  eFluidicPositions_t eTarget = me->eTargetPos;
+  float numPoints = 0.f;
+  float sumPos = 0.f;
+  float sumVolts = 0.f;
+  float sumPosPos = 0.f;
+  float sumPosVolts = 0.f;
+  float denominator;
+  
+  if((FLUID_MOVE_FWD == me->status.eMoveDirection) &&
+     (false == me->isApproaching) &&
+     (false == me->front.isFrontAwaited) &&
+     (eTarget >= BC_POS_FLUID_A) && (eTarget <= BC_POS_FLUID_C) &&
+     (fluidGetEchemRequirement(me, true) == me->status.eFluidFrontPosition))
+  {
+    me->front.detectVolts[eTarget] = piezoVoltageGet(me->pPiezo);
+    me->front.isDetected[eTarget] = true;
+    
+    for(uint32_t pos = (uint32_t)BC_POS_FLUID_A; pos <= (uint32_t)BC_POS_FLUID_C; pos++)
+    {
+      if(me->front.isDetected[pos])
+      {
+        numPoints   += 1.f;
+        sumPos      += (float)pos;
+        sumVolts    += me->front.detectVolts[pos];
+        sumPosPos   += (float)pos * (float)pos;
+        sumPosVolts += (float)pos * me->front.detectVolts[pos];
+      }
+    }
+    
+    denominator = (numPoints * sumPosPos) - (sumPos * sumPos);
+    
+    // Needs two contacts. Contacts further up the channel are at higher voltages.
+    if(denominator > 0.f)
+    {
+      me->front.voltsPerContact = ((numPoints * sumPosVolts) - (sumPos * sumVolts)) / denominator;
+      
+      if(me->front.voltsPerContact < 0.f)
+      {
+        me->front.voltsPerContact = 0.f;
+      }
+    }
+  }
+}
+
+
+/**
+*     @brief Predicts the Piezo voltage at which a forward move will detect a contact.
+*     @param[in]      me - The fluid controller instance.
+*     @param[in]      eTarget - The contact.
+*     @param[out]     pVolts - The predicted voltage.
+*     @details The voltage of the last detection of the contact, if there was
+*              one. Otherwise extrapolated from the nearest detected contact
+*              below it, at the fitted voltage between contacts.
+*     @returns True if a prediction was made.
+**/
+STATIC bool FluidicFrontPredictVolts(Fluidic_t* me, eFluidicPositions_t eTarget, float* pVolts)
+{
+  bool isPredicted = false;
+  
+  if((eTarget >= BC_POS_FLUID_A) && (eTarget <= BC_POS_FLUID_C))
+  {
+    if(me->front.isDetected[eTarget])
+    {
+      *pVolts = me->front.detectVolts[eTarget];
+      isPredicted = true;
+    }
+    else if(me->front.voltsPerContact > 0.f)
+    {
+      for(uint32_t pos = (uint32_t)eTarget - 1u; (pos >= (uint32_t)BC_POS_FLUID_A) && (false == isPredicted); pos--)
+      {
+        if(me->front.isDetected[pos])
+        {
+          *pVolts = me->front.detectVolts[pos] +
+                    (me->front.voltsPerContact * (float)((uint32_t)eTarget - pos));
+          isPredicted = true;
+        }
+      }
+    }
+    else
+    {
+      // Not enough detections.
+    }
+  }
+  
+  return isPredicted;
+}
+
+
+/**
+*     @brief Opens the telemetry record of a move or mix stroke.
+*     @param[in]      me - The fluid controller instance.
+*     @param[in]      eKind - Move or mix stroke.
+*     @details        A move may pass through several states. The first to
+*                     start it opens the record, later states keep it open.
+**/
+STATIC void FluidicRecordBegin(Fluidic_t* me, eFluidicTelemetryKind_t eKind)
+{
+  FluidicTelemetryRecord_t *pRec = &(me->record);
+  
+  if(false == me->isRecording)
+  {
+    (void)memset(pRec, 0, sizeof(FluidicTelemetryRecord_t));
+    
+    pRec->eKind = eKind;
+    pRec->eTargetPos = me->eTargetPos;
+    pRec->startMs = FLUIDIC_TIME_NOW_MS();
+    pRec->startVolts = piezoVoltageGet(me->pPiezo);
+    
+    if(me->eTargetPos < BC_VALID_POS_COUNT)
+    {
+      pRec->hysterisisVolts = me->run.positions[me->eTargetPos].posHysterisis;
+    }
+    
+    me->isRecording = true;
+  }
+}
+
+
+/**
+*     @brief Times a fluid front change against the open record.
+*     @param[in]      me - The fluid controller instance.
+**/
+STATIC void FluidicRecordFrontChange(Fluidic_t* me)
+{
+  FluidicTelemetryRecord_t *pRec = &(me->record);
+  uint32_t elapsed_ms;
+  
+  if(me->isRecording)
+  {
+    if(pRec->numFrontChanges < FLUIDIC_TELEMETRY_MAX_FRONT_CHANGES)
+    {
+      elapsed_ms = FLUIDIC_TIME_NOW_MS() - pRec->startMs;
+      pRec->frontChangeMs[pRec->numFrontChanges] = (elapsed_ms < UINT16_MAX) ? (uint16_t)elapsed_ms : UINT16_MAX;
+    }
+    
+    if(pRec->numFrontChanges < UINT8_MAX)
+    {
+      pRec->numFrontChanges++;
+    }
+  }
+}
+
+
+/**
+*     @brief Counts a restart of the Piezo move against the open record.
+*     @param[in]      me - The fluid controller instance.
+**/
+STATIC void FluidicRecordRetry(Fluidic_t* me)
+{
+  if((me->isRecording) && (me->record.retries < UINT8_MAX))
+  {
+    me->record.retries++;
+  }
+}
+
+
+/**
+*     @brief Closes the open record, and writes it to the telemetry ring.
+*     @param[in]      me - The fluid controller instance.
+*     @param[in]      eOutcome - How the move or stroke finished.
+*     @param[in]      error - Error of a failed move, otherwise OK_STATUS.
+*     @details        Does nothing if no record is open, so every path which
+*                     finishes a move can call it, and the first one wins.
+**/
+STATIC void FluidicRecordEnd(Fluidic_t* me, eFluidicTelemetryOutcome_t eOutcome, eErrorCode error)
+{
+  FluidicTelemetryRecord_t *pRec = &(me->record);
+  
+  if(me->isRecording)
+  {
+    me->isRecording = false;
+    
+    pRec->eOutcome = eOutcome;
+    pRec->error = error;
+    pRec->eRestPos = (FLUIDIC_TELEMETRY_REACHED == eOutcome) ? me->eTargetPos : me->eLastKnownPos;    // Mix strokes swap positions after recording.
+    pRec->eFrontPos = me->status.eFluidFrontPosition;
+    pRec->stopMs = FLUIDIC_TIME_NOW_MS();
+    pRec->endVolts = piezoVoltageGet(me->pPiezo);
+    
+    (void)FluidicTelemetryPush(&(me->telemetry), pRec);
+    FluidicStatsOnRecord(me, pRec);
+  }
+}
+
+
+/**
+*     @brief Adds a finished move or mix stroke to the latency histograms.
+*     @param[in]      me - The fluid controller instance.
+*     @param[in]      pRec - The finished record.
+*     @details        Moves are only added if they reached their target, so
+*                     timeouts do not hide the normal spread. Mix strokes are
+*                     added as a percentage of the stroke time set by the mix
+*                     frequency, whether or not they made their contact.
+**/
+STATIC void FluidicStatsOnRecord(Fluidic_t* me, const FluidicTelemetryRecord_t *pRec)
+{
+  FluidicStats_t *pStats = me->pStats;
+  uint32_t duration_ms = pRec->stopMs - pRec->startMs;
+  float strokeMs;
+  
+  if(NULL == pStats)
+  {
+    // Not profiling.
+  }
+  else if(FLUIDIC_TELEMETRY_MOVE == pRec->eKind)
+  {
+    if((FLUIDIC_TELEMETRY_REACHED == pRec->eOutcome) && (pRec->eTargetPos < BC_VALID_POS_COUNT))
+    {
+      FluidicHistogramAdd(&(pStats->moveMs[pRec->eTargetPos]), duration_ms);
+    }
+  }
+  else if(((FLUIDIC_TELEMETRY_REACHED == pRec->eOutcome) || (FLUIDIC_TELEMETRY_MISSED == pRec->eOutcome)) &&
+          (me->run.mixFrequency_Hz > 0.f))
+  {
+    strokeMs = 1000.f / (me->run.mixFrequency_Hz * (float)FLUID_NUM_MIXING_STAGES_PER_CYCLE);
+    FluidicHistogramAdd(&(pStats->strokePct), (uint32_t)(((float)duration_ms * 100.f / strokeMs) + 0.5f));
+  }
+  else
+  {
+    // Cancelled or failed stroke.
+  }
+}
+
+
+/**
+*     @brief Starts timing the reaction to a fluid front change.
+*     @param[in]      me - The fluid controller instance.
+*     @details        Called where the Piezo is stopped because the fluid front
+*                     met the requirement. Only timed if the change was swept
+*                     during the open record; a front which was already there
+*                     when the move started is not a reaction. The time is
+*                     taken once the Piezo confirms the stop.
+**/
+STATIC void FluidicStatsOnFrontStop(Fluidic_t* me)
+{
+  uint32_t now_ms = FLUIDIC_TIME_NOW_MS();
+  
+  me->isFrontStopTimed = (NULL != me->pStats) &&
+                         (me->isRecording) &&
+                         ((now_ms - me->frontChangeMs) <= (now_ms - me->record.startMs));
+}
+
+
+/**
+*     @brief Adds the reaction to a fluid front change to the latency histograms.
+*     @param[in]      me - The fluid controller instance.
+*     @details        Called as the Piezo confirms a stop. The reaction runs from
+*                     the sweep which found the change, so it covers the echem
+*                     publishing it, this object handling it and the Piezo
+*                     stopping. A stroke which reverses the Piezo without
+*                     stopping it is not timed.
+**/
+STATIC void FluidicStatsOnPiezoStopped(Fluidic_t* me)
+{
+  if(me->isFrontStopTimed)
+  {
+    me->isFrontStopTimed = false;
+    FluidicHistogramAdd(&(me->pStats->frontStopMs), FLUIDIC_TIME_NOW_MS() - me->frontChangeMs);
+  }
+}
+
+
+
+
 /**
 *     @brief Starts moving the Piezo to the target.
 *     @param[in]      me - The fluid controller instance.
@@ -2491,8 +3567,8 @@ STATIC eErrorCode FluidicBeginPiezoMoveToTarget(Fluidic_t* me)
   
   ASSERT((eTarget != BC_POS_UNKNOWN) && (eTarget != BC_NONE) && (eTarget != BC_VALID_POS_COUNT));
   
-  piezoParams.targetVoltage = me->pParams->positionLimits[eTarget].targetVolts;
-  piezoParams.rampSpeed     = me->pParams->rampSpeedVoltsPerSec;
+  piezoParams.targetVoltage = me->run.positions[eTarget].targetVolts;
+  piezoParams.rampSpeed     = me->run.rampSpeedVoltsPerSec;
   piezoParams.publishCompletion = false;
   
   
@@ -2502,14 +3578,81 @@ STATIC eErrorCode FluidicBeginPiezoMoveToTarget(Fluidic_t* me)
   }
   else        //Moving the fluid towards bladders.
   {
-    piezoParams.targetVoltage += me->pParams->positionLimits[eTarget].posHysterisis;
+    piezoParams.targetVoltage += me->run.positions[eTarget].posHysterisis;
+  }
+  
+  error = FluidicPiezoVoltageSet(me, &piezoParams);
+  
+  return error;
+}
+
+/**
+*     @brief          Starts the Piezo move of a move to a contact.
+*     @param[in]      me - The fluid controller instance.
+*     @details        A fast approach ramps at FLUID_SPEED_HIGH_DEFAULT_V_PER_S to
+*                     approachWindowVolts short of the contact, and the rest of
+*                     the move is started when that ramp completes. Only used
+*                     for forward moves to a contact whose voltage has been
+*                     learned or configured, and which is further than the
+*                     approach window away. Otherwise the whole move is made at
+*                     the requested speed.
+*     @returns        Error code from the piezoVoltageSet API.
+**/
+STATIC eErrorCode FluidicBeginPiezoMoveToContact(Fluidic_t* me)
+{
+  eErrorCode error;
+  peizoMoveParams_t piezoParams;
+  eFluidicPositions_t eTarget = me->eTargetPos;
+  float approachVolts = me->run.positions[eTarget].targetVolts -
+                        me->pParams->approachWindowVolts;
+  
+  me->isApproaching = (FLUID_MOVE_PROFILE_FAST_APPROACH == me->eMoveProfile) &&
+                      (FLUID_MOVE_FWD == me->status.eMoveDirection) &&
+                      (me->pParams->approachWindowVolts > 0.f) &&
+                      me->isContactVoltsKnown[eTarget] &&
+                      (approachVolts > piezoVoltageGet(me->pPiezo));
+  
+  if(me->isApproaching)
+  {
+    piezoParams.targetVoltage     = approachVolts;
+    piezoParams.rampSpeed         = FLUID_SPEED_HIGH_DEFAULT_V_PER_S;
+    piezoParams.publishCompletion = false;
+    
+    error = FluidicPiezoVoltageSet(me, &piezoParams);
+  }
+  else
+  {
+    error = FluidicBeginPiezoMoveToTarget(me);
   }
   
-  error = piezoVoltageSet(me->pPiezo, &piezoParams);
+  return error;
+}
+
+
+/**
+*     @brief          Processes a Piezo move complete whilst moving to a contact.
+*     @param[in]      me - The fluid controller instance.
+*     @param[in]      pEv - The move complete message.
+*     @details        Completion of this channel's fast approach starts the
+*                     slow finish. Any other completion is ignored.
+*     @returns        Error code from the piezoVoltageSet API.
+**/
+STATIC eErrorCode FluidicMoveContact_OnPiezoStop(Fluidic_t* me, const XEvent_t *pEv)
+{
+  eErrorCode error = OK_STATUS;
+  const PiezoMoveCompltEv_t* pMoveCmplt = (const PiezoMoveCompltEv_t*) pEv;
+  
+  if(me->isApproaching && (pMoveCmplt->chan == me->pPiezo->pParams->chan))
+  {
+    me->isApproaching = false;
+    error = FluidicBeginPiezoMoveToTarget(me);
+    FluidicMoveContact_ArmTimer(me);    // The slow finish may be stopped by prediction.
+  }
   
   return error;
 }
 
+
 /**
 *     @brief          Starts moving the Piezo to HOME/open.
 *     @param[in]      me - The fluid controller instance.
@@ -2526,37 +3669,18 @@ STATIC eErrorCode FluidicBeginPiezoMoveToLift(Fluidic_t* me)
 
   ASSERT((eTarget != BC_POS_UNKNOWN) && (eTarget != BC_NONE) && (eTarget != BC_VALID_POS_COUNT));
 
-  piezoParams.targetVoltage     = me->pParams->positionLimits[eTarget].targetVolts;
-  piezoParams.rampSpeed         = me->pParams->rampSpeedVoltsPerSec;
+  piezoParams.targetVoltage     = me->run.positions[eTarget].targetVolts;
+  piezoParams.rampSpeed         = me->run.rampSpeedVoltsPerSec;
   piezoParams.publishCompletion = false;
   piezoParams.targetVoltage = PIEZO_RAMP_MAX +
-                              me->pParams->positionLimits[eTarget].posHysterisis;
+                              me->run.positions[eTarget].posHysterisis;
 
-  error = piezoVoltageSet(me->pPiezo, &piezoParams);
+  error = FluidicPiezoVoltageSet(me, &piezoParams);
 
   return error;
 }
 
 
-/**
-*     @brief Calculates the ramp rate required to achieve the desired frequency,
-*             based on the target voltages and hysterisis.
-*     @param[in]      me - The fluid controller instance.
-**/
-STATIC void fluidicMixingCalculaterampSpeedVoltsPerSec(Fluidic_t* me,
-                                                       float startVolts,
-                                                       float endVolts)
-{
-  
-  // Need to multiply frequency by 2 so that each movement is equal to half the
-  // mixing period.
-  me->pParams->rampSpeedVoltsPerSec = (float)fabsf(startVolts - endVolts) 
-                                                 * 2.f * 
-                                                  me->pParams->mixFrequency_Hz;
-}
-
-
-
 /**
 *     @brief Processes the XMSG_FLUID_CHANNEL_MOVE_TO event.
 *     @param[in]      me - The fluid controller instance.
@@ -2575,16 +3699,19 @@ STATIC XState OnMsgBladderControlMoveToPos(Fluidic_t  *me,
   
   if (BC_POS_HOME == pBCMsg->eTargetPos)
   {
+    FluidicCmdQueueFlush(me);                   // Homing abandons anything queued.
     me->eTargetPos = pBCMsg->eTargetPos;
-    me->pParams->rampSpeedVoltsPerSec = FLUID_SPEED_HIGH_DEFAULT_V_PER_S;
-    me->pParams->timeout_ms = 1000u;  //1s
-    me->pParams->compensationProportion = 0.f;
-    me->pParams->eOvershootCompensationType = FLUID_OVERSHOOT_COMP_NONE;
+    me->run.rampSpeedVoltsPerSec = FLUID_SPEED_HIGH_DEFAULT_V_PER_S;
+    me->run.timeout_ms = 1000u;  //1s
+    me->run.compensationProportion = 0.f;
+    me->run.eOvershootCompensationType = FLUID_OVERSHOOT_COMP_NONE;
+    me->eMoveProfile = FLUID_MOVE_PROFILE_SINGLE_SPEED;
     
     retCode = X_TRAN(me, &FluidicState_MoveOther);
   }
   
   else if(OK_STATUS ==  FluidCheckMoveParams(me,
+                                        me->eLastKnownPos,
                                         pBCMsg->eTargetPos,
                                         pBCMsg->rampSpeedVoltsPerSec,
                                         pBCMsg->timeout_ms,
@@ -2593,10 +3720,11 @@ STATIC XState OnMsgBladderControlMoveToPos(Fluidic_t  *me,
   {
     
     me->eTargetPos = pBCMsg->eTargetPos;
-    me->pParams->rampSpeedVoltsPerSec = pBCMsg->rampSpeedVoltsPerSec;
-    me->pParams->timeout_ms = pBCMsg->timeout_ms;
-    me->pParams->compensationProportion = pBCMsg->overshootCompProportion;
-    me->pParams->eOvershootCompensationType = pBCMsg->eOvershootComp;
+    me->run.rampSpeedVoltsPerSec = pBCMsg->rampSpeedVoltsPerSec;
+    me->run.timeout_ms = pBCMsg->timeout_ms;
+    me->run.compensationProportion = pBCMsg->overshootCompProportion;
+    me->run.eOvershootCompensationType = pBCMsg->eOvershootComp;
+    me->eMoveProfile = pBCMsg->eProfile;
     
     /// When we're processing the movement command, work out whether this is a forward or reverse move.
     if(me->eLastKnownPos >= me->eTargetPos)
@@ -2629,6 +3757,7 @@ STATIC XState OnMsgLiftUpBladders(Fluidic_t  *me,
   const FluidicMovePositionMsg_t *pBCMsg = (const FluidicMovePositionMsg_t *) pEv;
 
   if(OK_STATUS ==  FluidCheckMoveParams(me,
+                                        me->eLastKnownPos,
                                         pBCMsg->eTargetPos,
                                         pBCMsg->rampSpeedVoltsPerSec,
                                         pBCMsg->timeout_ms,
@@ -2637,10 +3766,11 @@ STATIC XState OnMsgLiftUpBladders(Fluidic_t  *me,
   {
 
     me->eTargetPos = pBCMsg->eTargetPos;
-    me->pParams->rampSpeedVoltsPerSec = pBCMsg->rampSpeedVoltsPerSec;
-    me->pParams->timeout_ms = pBCMsg->timeout_ms;
-    me->pParams->compensationProportion = pBCMsg->overshootCompProportion;
-    me->pParams->eOvershootCompensationType = pBCMsg->eOvershootComp;
+    me->run.rampSpeedVoltsPerSec = pBCMsg->rampSpeedVoltsPerSec;
+    me->run.timeout_ms = pBCMsg->timeout_ms;
+    me->run.compensationProportion = pBCMsg->overshootCompProportion;
+    me->run.eOvershootCompensationType = pBCMsg->eOvershootComp;
+    me->eMoveProfile = FLUID_MOVE_PROFILE_SINGLE_SPEED;
 
     /// When we're processing the movement command, work out whether this is a forward or reverse move.
     if(me->eLastKnownPos >= me->eTargetPos)
@@ -2668,7 +3798,7 @@ STATIC XState OnMsgBladderControlMix(Fluidic_t  *me,
   
   XState retCode = X_RET_IGNORED;
   
-  if(OK_STATUS ==  FluidCheckMixParams(me, pBCMsg->eTargetPos, 
+  if(OK_STATUS ==  FluidCheckMixParams(me, me->eLastKnownPos, pBCMsg->eTargetPos, 
                                        pBCMsg->mixFrequency,
                                        pBCMsg->mixTime,
                                        pBCMsg->mixCycles,
@@ -2678,24 +3808,37 @@ STATIC XState OnMsgBladderControlMix(Fluidic_t  *me,
   {
     
     //All params are okay. Store them.
-    me->pParams->mixFrequency_Hz = pBCMsg->mixFrequency;
+    me->run.mixFrequency_Hz = pBCMsg->mixFrequency;
+    
+    if(FLUIDIC_MIX_FREQ_AUTO == pBCMsg->mixFrequency)
+    {
+      me->run.mixFrequency_Hz = FluidicMixAutoFrequency(me, 
+                                                        me->eLastKnownPos, 
+                                                        pBCMsg->eTargetPos, 
+                                                        pBCMsg->eMixType);
+    }
+    
     me->eTargetPos = pBCMsg->eTargetPos;
-    me->pParams->mixTimeout_ms = pBCMsg->mixTime;
-    me->pParams->targetMixCycles = pBCMsg->mixCycles;
-    me->pParams->eMixType = pBCMsg->eMixType;
-    me->pParams->mixDownstrokeProportion = pBCMsg->mixDownstrokeProportion;
-    me->pParams->openLoopCompensationFactor = pBCMsg->openLoopCompensationFactor;
+    me->run.mixTimeout_ms = pBCMsg->mixTime;
+    me->run.targetMixCycles = pBCMsg->mixCycles;
+    me->run.eMixType = pBCMsg->eMixType;
+    me->run.mixDownstrokeProportion = pBCMsg->mixDownstrokeProportion;
+    me->run.openLoopCompensationFactor = pBCMsg->openLoopCompensationFactor;
     
     // Always start by moving updards.
     me->status.eMoveDirection = FLUID_MOVE_REV;
     
-    me->pParams->eMixEndPosition = me->eLastKnownPos;
+    me->run.eMixEndPosition = me->eLastKnownPos;
     
     me->status.mixingStagesCompleted = 0;
     
     me->mixTimer = 0;
+    me->eMoveProfile = FLUID_MOVE_PROFILE_SINGLE_SPEED;    // Mix strokes, and the move back to the end position on failure.
     
-    if(me->pParams->eMixType == FLUID_MIX_DUAL_POINT_LOOP)
+    FluidicMixPlanBuild(me);
+    FluidicMixControllerReset(me);
+    
+    if(me->run.eMixType == FLUID_MIX_DUAL_POINT_LOOP)
     {
       retCode =  X_TRAN(me, &FluidicState_MixContactControlled);
     }
@@ -2721,9 +3864,33 @@ STATIC void OnMsgUpdateParams(Fluidic_t *me, XEvent_t* pEv)
 {
   FluidicUpdateParamsMsg_t* pUpdateEv = (FluidicUpdateParamsMsg_t*)pEv;
   
-  me->pParams->positionLimits[BC_POS_FLUID_A].targetVolts = pUpdateEv->flAVal;
-  me->pParams->positionLimits[BC_POS_FLUID_B].targetVolts = pUpdateEv->flBVal;
-  me->pParams->positionLimits[BC_POS_FLUID_C].targetVolts = pUpdateEv->flCVal;
+  me->run.positions[BC_POS_FLUID_A].targetVolts = pUpdateEv->flAVal;
+  me->run.positions[BC_POS_FLUID_B].targetVolts = pUpdateEv->flBVal;
+  me->run.positions[BC_POS_FLUID_C].targetVolts = pUpdateEv->flCVal;
+  
+  me->isContactVoltsKnown[BC_POS_FLUID_A] = true;
+  me->isContactVoltsKnown[BC_POS_FLUID_B] = true;
+  me->isContactVoltsKnown[BC_POS_FLUID_C] = true;
+}
+
+
+
+/**
+*     @brief Processes the XMSG_FLUID_STATS_DUMP message.
+*     @param[in]      me - The fluid controller instance.
+*     @param[in]      pEv - The message contents.
+**/
+STATIC void FluidicOnStatsDumpMsg(Fluidic_t* me, const XEvent_t *pEv)
+{
+#pragma cstat_suppress="MISRAC2012-Rule-11.3"
+  const FluidicStatsMsg_t *pStatsMsg = (const FluidicStatsMsg_t *) pEv;
+  
+  FluidicStatsDump(me->pStats, me->eChannel, pStatsMsg->pfnPrint, pStatsMsg->pCtx);
+  
+  if(pStatsMsg->reset)
+  {
+    FluidicStatsReset(me->pStats);
+  }
 }
 
 
@@ -2737,11 +3904,12 @@ STATIC void FluidicOnMoveCompleteMsg(Fluidic_t *me)
 {
   FluidicSetCurrentAndTargetPositions(me, me->eTargetPos, BC_NONE);
   
-  me->moveSuccessMsg.eChannel = me->pParams->eChannel;
+  me->moveSuccessMsg.eChannel = me->eChannel;
   me->moveSuccessMsg.eRestPosition = me->eLastKnownPos;
-  me->moveSuccessMsg.completionTimeMs = me->timeoutTimer; 
+  me->moveSuccessMsg.completionTimeMs = FluidicMoveElapsedMs(me); 
   me->moveSuccessMsg.piezoVolts = piezoVoltageGet(me->pPiezo);
-  X_PUBLISH(X_FRAMEWORK_OF(me), me->moveSuccessMsg);        // Always publish move success message.
+  FluidicReport(me, &(me->moveSuccessMsg.super));          // Always publish move success message.
+  FluidicRecordEnd(me, FLUIDIC_TELEMETRY_REACHED, OK_STATUS);
   
   ///
   /// Logging for debugging purposes
@@ -2763,10 +3931,11 @@ STATIC void FluidicOnMoveCompleteMsg(Fluidic_t *me)
 **/
 STATIC void FluidicOnMoveFailMsg(Fluidic_t *me, eFluidicPositions_t pos, eErrorCode eError)
 {
-  me->moveFailMsg.eChannel = me->pParams->eChannel;
+  me->moveFailMsg.eChannel = me->eChannel;
   me->moveFailMsg.eTargetPosition = pos;
 
-  X_PUBLISH(X_FRAMEWORK_OF(me), me->moveFailMsg);
+  FluidicReport(me, &(me->moveFailMsg.super));
+  FluidicRecordEnd(me, FLUIDIC_TELEMETRY_FAILED, eError);
 
   
   ///
@@ -2778,6 +3947,35 @@ STATIC void FluidicOnMoveFailMsg(Fluidic_t *me, eFluidicPositions_t pos, eErrorC
   
   me->cmdFail.eError = eError;       // Append the error to the fail message.
   X_PUBLISH(X_FRAMEWORK_OF(me), me->cmdFail);
+  
+  FluidicCmdQueueFlush(me);          // Queued commands assumed this one would succeed.
+}
+
+
+/**
+*     @brief Sends the result of a command. Posted to the object which issued
+*            the command if it asked for it, otherwise published.
+*     @param[in] me - The fluidic controller object.
+*     @param[in] pEv - Move complete, move fail or mix complete event.
+**/
+STATIC void FluidicReport(Fluidic_t *me, const XEvent_t *pEv)
+{
+  XActive_t *pReportTo = me->pReportTo;
+  
+  if (NULL != me->pTrace)
+  {
+    FluidicTraceRecord(me, pEv, FLUIDIC_TRACE_RESULT);
+  }
+  
+  if (NULL != pReportTo)
+  {
+    me->pReportTo = NULL;             // Only the first result belongs to the command.
+    XActivePost(pReportTo, pEv);
+  }
+  else
+  {
+    X_PUBLISH(X_FRAMEWORK_OF(me), *pEv);
+  }
 }
 
 
@@ -2791,12 +3989,13 @@ STATIC void FluidicOnMixComplete(Fluidic_t* me)
   me->status.mixComplete = true;
   
   //Save our current position (the target), and begin a move to the end position.
-  FluidicSetCurrentAndTargetPositions(me,  me->eTargetPos, me->pParams->eMixEndPosition);
+  FluidicSetCurrentAndTargetPositions(me,  me->eTargetPos, me->run.eMixEndPosition);
   
   //Prepare and send the event.
-  me->mixCmpltMsg.eChannel = me->pParams->eChannel;
-  me->mixCmpltMsg.eRestPosition = me->pParams->eMixEndPosition;
-  X_PUBLISH(X_FRAMEWORK_OF(me), me->mixCmpltMsg);
+  me->mixCmpltMsg.eChannel = me->eChannel;
+  me->mixCmpltMsg.eRestPosition = me->run.eMixEndPosition;
+  me->mixCmpltMsg.mixFrequency_Hz = me->run.mixFrequency_Hz;
+  FluidicReport(me, &(me->mixCmpltMsg.super));
 }
 
 /**
@@ -2807,6 +4006,7 @@ STATIC void FluidicOnMixComplete(Fluidic_t* me)
 /**
 *     @brief Initiates a move to any other fluid position.
 *     @param[in]      me - The fluid controller instance.
+*     @param[in]      eFromPos - The position the move starts from.
 *     @param[in]      eTarget - The target position
 *     @param[in]      erampSpeedVoltsPerSec - The abstract ramp speed which should be 
 *                                  used during the movement.
@@ -2818,13 +4018,14 @@ STATIC void FluidicOnMixComplete(Fluidic_t* me)
 *     @note           The movement parameters are not stored at this point!                
 **/
 STATIC eErrorCode FluidCheckMoveParams(Fluidic_t *me,
+                                       eFluidicPositions_t eFromPos,
                                        eFluidicPositions_t eTarget,
                                        float rampSpeedVoltsPerSec,
                                        uint32_t timeout_ms,
                                        eFluidOvershootCompensation_t   eOvershootCompMode,
                                        float compensationProportion)
 {
-  bool moveValid =  bladderControlCheckMoveValid(me, eTarget);
+  bool moveValid =  bladderControlCheckMoveValid(eFromPos, eTarget);
   eErrorCode error = OK_STATUS;
   
   
@@ -2858,6 +4059,7 @@ STATIC eErrorCode FluidCheckMoveParams(Fluidic_t *me,
 /**
 *     @brief Initiates a move to any other fluid position.
 *     @param[in]      me - The fluid controller instance.
+*     @param[in]      eFromPos - The position the mix starts from.
 *     @param[in]      eTarget - The target position
 *     @param[in]      mixFrequency_Hz - The frequency the mix should occur at.
 *     @param[in]      mixTimeout_ms - The mixing period, in ms.
@@ -2866,6 +4068,7 @@ STATIC eErrorCode FluidCheckMoveParams(Fluidic_t *me,
 *                     mixing are invalid, mixing should be aborted.
 **/
 STATIC eErrorCode FluidCheckMixParams(Fluidic_t *me,
+                                      eFluidicPositions_t eFromPos,
                                       eFluidicPositions_t eTarget,
                                       float mixFrequency_Hz,
                                       uint32_t mixTimeout_ms,
@@ -2876,9 +4079,9 @@ STATIC eErrorCode FluidCheckMixParams(Fluidic_t *me,
 {
   eErrorCode error = ERROR_BAD_ARGS;
   
-  bool freqOk = isFrequencyOk(me, eTarget, mixFrequency_Hz);
+  bool freqOk = isFrequencyOk(me, eFromPos, eTarget, mixFrequency_Hz, eMixType);
   
-  bool posOk = isMixPositionOk(me, eTarget);
+  bool posOk = isMixPositionOk(eFromPos, eTarget);
   
   bool timeoutOk = isMixTimeoutOk(me, mixTimeout_ms);
   
@@ -2913,30 +4116,39 @@ STATIC eErrorCode FluidCheckMixParams(Fluidic_t *me,
 *     @details        The ramp rate is determined from the frequency and the
 *                     mixing end stops. If the ramp rate exceeds the maximum ramp
 *                     rate of the piezo's maximum ramp rate.
+*                     FLUIDIC_MIX_FREQ_AUTO is always okay.
 *     @param[in]      me - The fluid controller instance.
+*     @param[in]      eFromPos - The position the mix starts from.
 *     @param[in]      eTargetPos - The desired movement positionl.
 *     @param[in]      mixFrequency_Hz - Mixing frequency in Hz.
+*     @param[in]      eMixType - Type of the mix. Open loop mixes may be streamed as a waveform.
 *     @retval         true - The timeout value is okay to use.
 *     @retval         false - Movement should not be completed.
 **/
 STATIC bool isFrequencyOk(Fluidic_t* me, 
+                          eFluidicPositions_t eFromPos,
                           eFluidicPositions_t eTargetPos,
-                          float mixFrequency_Hz)
+                          float mixFrequency_Hz,
+                          eFluidMixingType_t eMixType)
 {
   bool isOk;
-  eFluidicPositions_t eLastPos = me->eLastKnownPos;
+  eFluidicPositions_t eLastPos = eFromPos;
   float maxRampRate = me->pPiezo->pParams->maxRampRate;
   
-  float targetPosVoltage = me->pParams->positionLimits[eTargetPos].targetVolts;
-  float currentPosVoltage = me->pParams->positionLimits[eLastPos].targetVolts;
+  float targetPosVoltage = me->run.positions[eTargetPos].targetVolts;
+  float currentPosVoltage = me->run.positions[eLastPos].targetVolts;
   
   float rampRateForMix = fabsf(currentPosVoltage - targetPosVoltage)*mixFrequency_Hz;
   
-  if(rampRateForMix >= maxRampRate)
+  // A sine waveform ramps faster than its mean through the middle of each stroke.
+  if(eMixType == FLUID_MIX_OPEN_LOOP)
   {
-    isOk = false;
+    rampRateForMix *= FluidicWaveformPeakRateFactor(FluidicMixWaveformShape(me));
   }
-  else if(mixFrequency_Hz == 0.f)
+  
+  // FLUIDIC_MIX_FREQ_AUTO asks for no ramp rate, so always passes. The
+  // controller picks a frequency it can mix at.
+  if(rampRateForMix >= maxRampRate)
   {
     isOk = false;
   }
@@ -2949,6 +4161,71 @@ STATIC bool isFrequencyOk(Fluidic_t* me,
 }
 
 
+/**
+*     @brief  Works out the fastest frequency a mix can run at.
+*     @details        Two limits apply, each used to FLUIDIC_MIX_AUTO_MARGIN:
+*                     - the Piezo's maxRampRate, as each stroke covers the
+*                       voltage between the mix positions in half a period,
+*                     - for mixes which stop on contacts, contactResponseMs.
+*                       The stroke overshoots the contact by the ramp rate
+*                       times the response, which must stay within the
+*                       position hysterisis or the contact is missed.
+*                     Capped at FLUIDIC_MIX_AUTO_MAX_FREQ. The configured
+*                     mixFrequency_Hz is used if the limits leave no
+*                     frequency, e.g. with no hysterisis.
+*     @param[in]      me - The fluid controller instance.
+*     @param[in]      eFromPos - The position the mix starts from.
+*     @param[in]      eTargetPos - The other mix position.
+*     @param[in]      eMixType - Type of the mix.
+*     @returns        The frequency, in Hz.
+**/
+STATIC float FluidicMixAutoFrequency(const Fluidic_t *me,
+                                     eFluidicPositions_t eFromPos,
+                                     eFluidicPositions_t eTargetPos,
+                                     eFluidMixingType_t eMixType)
+{
+  float mixFrequency_Hz = FLUIDIC_MIX_AUTO_MAX_FREQ;
+  float strokeVolts = fabsf(me->run.positions[eFromPos].targetVolts - 
+                            me->run.positions[eTargetPos].targetVolts);
+  float maxRampRate = me->pPiezo->pParams->maxRampRate;
+  float limit_Hz;
+  float hystVolts;
+  
+  if(strokeVolts > 0.f)
+  {
+    if(eMixType == FLUID_MIX_OPEN_LOOP)
+    {
+      maxRampRate /= FluidicWaveformPeakRateFactor(FluidicMixWaveformShape(me));
+    }
+    
+    limit_Hz = FLUIDIC_MIX_AUTO_MARGIN * maxRampRate / (2.f * strokeVolts);
+    mixFrequency_Hz = (limit_Hz < mixFrequency_Hz) ? limit_Hz : mixFrequency_Hz;
+    
+    if((eMixType != FLUID_MIX_OPEN_LOOP) && (me->contactResponseMs > 0.f))
+    {
+      hystVolts = me->run.positions[eTargetPos].posHysterisis;
+      
+      if(eMixType == FLUID_MIX_DUAL_POINT_LOOP)
+      {
+        hystVolts = (me->run.positions[eFromPos].posHysterisis < hystVolts) ? 
+                    me->run.positions[eFromPos].posHysterisis : hystVolts;
+      }
+      
+      limit_Hz = FLUIDIC_MIX_AUTO_MARGIN * hystVolts * 1000.f / 
+                 (2.f * strokeVolts * me->contactResponseMs);
+      mixFrequency_Hz = (limit_Hz < mixFrequency_Hz) ? limit_Hz : mixFrequency_Hz;
+    }
+  }
+  
+  if(mixFrequency_Hz <= 0.f)
+  {
+    mixFrequency_Hz = me->pParams->mixFrequency_Hz;
+  }
+  
+  return mixFrequency_Hz;
+}
+
+
 /**
 *     @brief  Checks whether the timeout specified in the mix command is suitable.
 *     @param[in]      me - The fluid controller instance.
@@ -2979,18 +4256,47 @@ STATIC bool isMixTimeoutOk(Fluidic_t* me, uint32_t mixTimeout_ms)
 
 
 /**
-*     @brief  Checks whether the fluidic channel can mix between the ranges specified
-*     @details A mix must be performed between the current position and a position
+*     @brief  Checks a configuration's positions.
+*     @details The contacts lie in order between the bladder down and home
+*              voltages, and each contact's hysterisis is one the mixing
+*              controllers could have set.
+*     @param[in]      pParams - The configuration.
+*     @returns        true if the positions can be used.
+**/
+STATIC bool FluidicParamsAreValid(const FluidicParams_t *pParams)
+{
+  const FluidicPositionLimits_t *pLimits = pParams->positionLimits;
+  bool isOk;
+  
+  isOk = (PIEZO_MIN_VOLTAGE < pLimits[BC_POS_FLUID_A].targetVolts) &&
+         (pLimits[BC_POS_FLUID_A].targetVolts <= pLimits[BC_POS_FLUID_B].targetVolts) &&
+         (pLimits[BC_POS_FLUID_B].targetVolts <= pLimits[BC_POS_FLUID_C].targetVolts) &&
+         (pLimits[BC_POS_FLUID_C].targetVolts < PIEZO_VOLT_MAX);
+  
+  for(uint32_t ePos = BC_POS_FLUID_A; ePos <= BC_POS_FLUID_C; ePos++)
+  {
+    isOk = isOk &&
+           (pLimits[ePos].posHysterisis >= FLUIDIC_HYSETRISIS_MIN) &&
+           (pLimits[ePos].posHysterisis <= FLUIDIC_HYSETRISIS_MAX);
+  }
+  
+  return isOk;
+}
+
+
+/**
+*     @brief  Checks whether the fluidic channel can mix between the ranges specified
+*     @details A mix must be performed between the current position and a position
 *              earlier in the strip. And must not be performed between HOME.
-*     @param[in]      me - The fluid controller instance.
+*     @param[in]      eFromPos - The position the mix starts from.
 *     @param[in]      eTargetPos - The desired movement positionl.
 *     @retval         true - The mix position is okay to use, mixing can be performed.
 *     @retval         false - Movement should not be completed.
 **/
-STATIC bool isMixPositionOk(Fluidic_t* me, eFluidicPositions_t eTargetPos)
+STATIC bool isMixPositionOk(eFluidicPositions_t eFromPos, eFluidicPositions_t eTargetPos)
 {
   bool isOk;
-  eFluidicPositions_t eLastPosition = me->eLastKnownPos;
+  eFluidicPositions_t eLastPosition = eFromPos;
   
   //Can only mix with a position which is lower.
   if((eTargetPos >= eLastPosition) || (BC_POS_HOME == eTargetPos))
@@ -3016,18 +4322,18 @@ STATIC bool isMixPositionOk(Fluidic_t* me, eFluidicPositions_t eTargetPos)
 *     @details Movements can only be completed if the controller is in idle, or
 *             the intended movement is to return to home. Then check whether
 *             it is possible to move to the desired position.
-*     @param[in]      me - The fluid controller instance.
+*     @param[in]      eFromPos - The position the move starts from.
 *     @param[in]      eTargetPos - The desired movement positionl.
 *     @retval         true - Movement can be performed.
 *     @retval         false - Movement cannot be completed.
 **/
 STATIC bool bladderControlCheckMoveValid(
-                                         Fluidic_t *me,
+                                         eFluidicPositions_t eFromPos,
                                          eFluidicPositions_t eTargetPos)
 {
   bool retState;
   
-  eFluidicPositions_t eCurrentPos   =  me->eLastKnownPos;
+  eFluidicPositions_t eCurrentPos   =  eFromPos;
   
   if(BC_POS_HOME == eTargetPos)
   {
@@ -3118,23 +4424,106 @@ STATIC bool bladderControlCheckValidPosChange(eFluidicPositions_t eCurrentPos ,
 **/
 STATIC eErrorCode FluidicStopMove(Fluidic_t* me)
 {  
+  FluidicTraceOutput(me, FLUIDIC_TRACE_PIEZO_STOP, NULL);
   return piezoStop(me->pPiezo);  //Stop where we are. Just in case the piezo was still moving.
 }
 
 
+/**
+*     @brief  Starts a Piezo ramp.
+*     @param[in]  me - The fluid controller instance.
+*     @param[in]  pMoveParams - The ramp.
+*     @returns The error code from piezoVoltageSet.
+**/
+STATIC eErrorCode FluidicPiezoVoltageSet(Fluidic_t* me, peizoMoveParams_t *pMoveParams)
+{
+  me->isFrontStopTimed = false;     // Sent on, rather than stopped.
+  FluidicTraceOutput(me, FLUIDIC_TRACE_PIEZO_SET, pMoveParams);
+  return piezoVoltageSet(me->pPiezo, pMoveParams);
+}
+
+
+
+/**
+*     @brief  Sets the whole run time overlay from the configuration.
+*     @param[in]  me - The fluid controller instance.
+**/
+STATIC void FluidicRunParamsInit(Fluidic_t* me)
+{
+  const FluidicParams_t *pConfig = me->pParams;
+  
+  me->run.timeout_ms                  = pConfig->timeout_ms;
+  me->run.rampSpeedVoltsPerSec        = pConfig->rampSpeedVoltsPerSec;
+  me->run.eOvershootCompensationType  = pConfig->eOvershootCompensationType;
+  me->run.compensationProportion      = pConfig->compensationProportion;
+  
+  me->run.mixFrequency_Hz             = pConfig->mixFrequency_Hz;
+  me->run.mixTimeout_ms               = pConfig->mixTimeout_ms;
+  me->run.targetMixCycles             = pConfig->targetMixCycles;
+  me->run.eMixEndPosition             = pConfig->eMixEndPosition;
+  me->run.eMixType                    = pConfig->eMixType;
+  me->run.openLoopCompensationFactor  = pConfig->openLoopCompensationFactor;
+  me->run.mixDownstrokeProportion     = pConfig->mixDownstrokeProportion;
+  
+  FluidicRunParamsNewTest(me);
+}
+
+
+/**
+*     @brief  Resets the run time state which carries from move to move.
+*     @param[in]  me - The fluid controller instance.
+*     @details The learned position voltages, the hysterisis adjusted by
+*              mixing, and breach monitoring return to the configuration.
+**/
+STATIC void FluidicRunParamsNewTest(Fluidic_t* me)
+{
+  for(uint32_t pos = 0u; pos < (uint32_t)BC_VALID_POS_COUNT; pos++)
+  {
+    me->run.positions[pos].targetVolts   = me->pParams->positionLimits[pos].targetVolts;
+    me->run.positions[pos].posHysterisis = me->pParams->positionLimits[pos].posHysterisis;
+  }
+  
+  me->run.monitorBreachAfterMove = me->pParams->monitorBreachAfterMove;
+}
+
+
 
 /**
 *     @brief  Starts a Piezo homing move, and updates the Fluidic object's status.
+*     @details Homing starts a new test, so the run time state is reset to
+*              the configuration. The target positions for Fluid A -> C are
+*              then set to the voltages learned for the strip lot, if known,
+*              otherwise to the maximum voltage before lift. Fast approach
+*              moves are only made to learned voltages.
 *     @param[in]  me - The fluid controller instance.
 *     @returns The error code from piezoHome.
 **/
 STATIC eErrorCode FluidicHomeMoveBegin(Fluidic_t* me)
 {
-	/// When homing, reset the target positions for Fluid A -> C.
-  me->pParams->positionLimits[BC_POS_FLUID_A].targetVolts = FLUIDIC_MAX_VOLTS_BEFORE_LIFT;
-  me->pParams->positionLimits[BC_POS_FLUID_B].targetVolts = FLUIDIC_MAX_VOLTS_BEFORE_LIFT;
-  me->pParams->positionLimits[BC_POS_FLUID_C].targetVolts = FLUIDIC_MAX_VOLTS_BEFORE_LIFT;
+  float learnedVolts[FLUIDIC_CAL_POS_COUNT];
+  bool isLearned = FluidicCalLookup(me->pCal, me->eChannel, learnedVolts);
   
+  FluidicRunParamsNewTest(me);
+  FluidicFrontReset(me);
+  
+  me->isContactVoltsKnown[BC_POS_FLUID_A] = isLearned;
+  me->isContactVoltsKnown[BC_POS_FLUID_B] = isLearned;
+  me->isContactVoltsKnown[BC_POS_FLUID_C] = isLearned;
+  
+  if(isLearned)
+  {
+    me->run.positions[BC_POS_FLUID_A].targetVolts = learnedVolts[0u];
+    me->run.positions[BC_POS_FLUID_B].targetVolts = learnedVolts[1u];
+    me->run.positions[BC_POS_FLUID_C].targetVolts = learnedVolts[2u];
+  }
+  else
+  {
+    me->run.positions[BC_POS_FLUID_A].targetVolts = FLUIDIC_MAX_VOLTS_BEFORE_LIFT;
+    me->run.positions[BC_POS_FLUID_B].targetVolts = FLUIDIC_MAX_VOLTS_BEFORE_LIFT;
+    me->run.positions[BC_POS_FLUID_C].targetVolts = FLUIDIC_MAX_VOLTS_BEFORE_LIFT;
+  }
+  
+  FluidicTraceOutput(me, FLUIDIC_TRACE_PIEZO_HOME, NULL);
   return piezoHome(me->pPiezo);
 }
 
@@ -3168,9 +4557,21 @@ STATIC void AdjustHysterisisVoltage(Fluidic_t* me,
   ASSERT_NOT_NULL(me);
   ASSERT(multiplierType != FLUID_HYST_COUNT);
   
-  float hystVoltage = me->pParams->positionLimits[me->eTargetPos].posHysterisis;
+  float hystVoltage = me->run.positions[me->eTargetPos].posHysterisis;
   hystVoltage *= me->pParams->hysterisisMultipliersVolts[multiplierType];
   
+  me->run.positions[me->eTargetPos].posHysterisis = FluidicHysterisisLimit(hystVoltage);
+}
+
+
+/**
+*     @brief  Limits a hysterisis voltage to its allowed range.
+*     @note Hysteris is limited to 1V <= Hysetrisis <= 10V
+*     @param[in] hystVoltage - The requested hysterisis voltage.
+*     @returns The limited hysterisis voltage.
+**/ 
+STATIC float FluidicHysterisisLimit(float hystVoltage)
+{
   if(FLUIDIC_HYSETRISIS_MAX < hystVoltage)
   {
     hystVoltage = FLUIDIC_HYSETRISIS_MAX;
@@ -3184,7 +4585,152 @@ STATIC void AdjustHysterisisVoltage(Fluidic_t* me,
     //Do nothing.
   }
   
-  me->pParams->positionLimits[me->eTargetPos].posHysterisis = hystVoltage;
+  return hystVoltage;
+}
+
+
+/**
+*     @brief  Resets the mix end point controller at the start of a mix.
+*     @details The PI controller starts with no drift, and with a tracking error
+*              which gives the configured hysterisis of each position.
+*     @param[in]  me - The fluid controller instance.
+**/ 
+STATIC void FluidicMixControllerReset(Fluidic_t *me)
+{
+  uint32_t pos;
+  float spreadGain = me->pParams->mixPiGains.spreadGain;
+  
+  for(pos = 0u; pos < (uint32_t)BC_VALID_POS_COUNT; pos++)
+  {
+    me->mixCtrl[pos].driftVolts = 0.f;
+    
+    if(spreadGain > 0.f)
+    {
+      me->mixCtrl[pos].spreadVolts = me->run.positions[pos].posHysterisis / spreadGain;
+    }
+    else
+    {
+      me->mixCtrl[pos].spreadVolts = 0.f;
+    }
+  }
+}
+
+
+/**
+*     @brief  Updates the end point of the target position after a contact
+*             controlled mix stroke.
+*     @details Sets targetVolts and posHysterisis of the target position, which
+*              give the end point of the next stroke to it.
+*     @param[in]  me - The fluid controller instance.
+*     @param[in]  contactMade - The stroke reached the contact.
+*     @param[in]  observedVolts - Piezo voltage when the contact was reached, or
+*                                 at the end of the stroke if it was not.
+**/ 
+STATIC void FluidicMixControllerUpdate(Fluidic_t *me, bool contactMade, float observedVolts)
+{
+  if(contactMade)
+  {
+    FluidicContactResponseUpdate(me, observedVolts);   // Against the expected contact, before it is updated.
+  }
+  
+  switch(me->pParams->eMixController)
+  {
+  case FLUID_MIX_CTRL_PI:
+    FluidicMixControllerPi(me, contactMade, observedVolts);
+    break;
+    
+  case FLUID_MIX_CTRL_MULTIPLIER:
+  default:
+    if(contactMade)
+    {
+      me->run.positions[me->eTargetPos].targetVolts = observedVolts;
+      AdjustHysterisisVoltage(me, FLUID_HYST_DEC);
+    }
+    else
+    {
+      AdjustHysterisisVoltage(me, FLUID_HYST_INC);
+    }
+    break;
+  }
+}
+
+
+/**
+*     @brief  PI mix end point controller.
+*     @details The tracking error is the contact voltage less the expected
+*              contact voltage (targetVolts).
+*              - The error is integrated into the drift of the contact.
+*              - targetVolts moves by kp of the error, plus the drift.
+*              - posHysterisis is spreadGain times the filtered error magnitude,
+*                so the stroke overshoots the contact by only as much as the
+*                contact has been seen to move.
+*              A missed contact only shows that it lies beyond the end of the
+*              stroke, so the error is taken as the hysterisis plus the minimum
+*              hysterisis and only widens the hysterisis. targetVolts and the
+*              drift are held, so a contact which never reports cannot wind
+*              them up.
+*     @param[in]  me - The fluid controller instance.
+*     @param[in]  contactMade - The stroke reached the contact.
+*     @param[in]  observedVolts - Piezo voltage when the contact was reached, or
+*                                 at the end of the stroke if it was not.
+**/ 
+STATIC void FluidicMixControllerPi(Fluidic_t *me, bool contactMade, float observedVolts)
+{
+  const FluidicMixPiGains_t *pGains = &me->pParams->mixPiGains;
+  FluidicPositionState_t *pLimits   = &me->run.positions[me->eTargetPos];
+  FluidicMixCtrlState_t *pCtrl      = &me->mixCtrl[me->eTargetPos];
+  float errorVolts;
+  
+  if(contactMade)
+  {
+    errorVolts = observedVolts - pLimits->targetVolts;
+    
+    pCtrl->driftVolts    += pGains->ki * errorVolts;
+    pLimits->targetVolts += (pGains->kp * errorVolts) + pCtrl->driftVolts;
+  }
+  else
+  {
+    errorVolts = pLimits->posHysterisis + FLUIDIC_HYSETRISIS_MIN;
+  }
+  
+  pCtrl->spreadVolts += pGains->spreadFilter * (fabsf(errorVolts) - pCtrl->spreadVolts);
+  pLimits->posHysterisis = FluidicHysterisisLimit(pGains->spreadGain * pCtrl->spreadVolts);
+}
+
+
+/**
+*     @brief  Updates the observed contact response time.
+*     @details A contact reported past the voltage the stroke expected it at
+*              was reported late by the overshoot over the stroke's ramp rate.
+*              A slower response is taken straight away, a faster one only
+*              moves contactResponseMs by FLUIDIC_CONTACT_RESPONSE_FILTER, so
+*              the time follows the slowest recent responses.
+*     @param[in]  me - The fluid controller instance.
+*     @param[in]  observedVolts - Piezo voltage when the contact was reached.
+**/ 
+STATIC void FluidicContactResponseUpdate(Fluidic_t *me, float observedVolts)
+{
+  float overshootVolts = observedVolts - me->run.positions[me->eTargetPos].targetVolts;
+  float responseMs = 0.f;
+  
+  if(me->status.eMoveDirection == FLUID_MOVE_REV)
+  {
+    overshootVolts = -overshootVolts;
+  }
+  
+  if((overshootVolts > 0.f) && (me->run.rampSpeedVoltsPerSec > 0.f))
+  {
+    responseMs = overshootVolts * 1000.f / me->run.rampSpeedVoltsPerSec;
+  }
+  
+  if(responseMs > me->contactResponseMs)
+  {
+    me->contactResponseMs = responseMs;
+  }
+  else
+  {
+    me->contactResponseMs += FLUIDIC_CONTACT_RESPONSE_FILTER * (responseMs - me->contactResponseMs);
+  }
 }
 
 
@@ -3220,139 +4766,103 @@ STATIC XState FluidicsErrorSet(Fluidic_t *me, eErrorCode err, XState retCode)
 
 
 /**
-  * @brief Helper to check if the Fluid controller is in an appropriate state to
-  *        accept a movement command
+  * @brief Arms the timer for a settling check.
+  * @param[in] me - The fluid controller
+  * @param[in] settle_ms - Delay before the check.
+  * @details The timer fires once. The state handling the check re-arms the
+  *          timer, either for another check or for the deadline.
+  **/
+STATIC void FluidicTimerArmSettle(Fluidic_t* me, uint32_t settle_ms)
+{
+  me->deadlineArmed = false;
+  
+  XTimerWheelArm(me->pTimerWheel, &(me->timer), settle_ms, 0u);
+}
+
+
+/**
+  * @brief Arms the timer for the deadline of the current move, or mix.
   * @param[in] me - The fluid controller
-  * @returns True if a command can be accepted.
+  * @param[in] elapsed_ms - Time already used.
+  * @param[in] timeout_ms - The timeout.
+  * @details Fluidic objects are only woken by the timer when the deadline
+  *          expires; progress is tracked from the Piezo and echem events.
+  *          An expired deadline fires on the next tick.
   **/
-STATIC bool  FluidicStateCanAcceptCommand(Fluidic_t * me)
+STATIC void FluidicTimerArmDeadline(Fluidic_t* me, uint32_t elapsed_ms, uint32_t timeout_ms)
 {
-  bool canAcceptCommand = false;
+  uint32_t remaining_ms = 1u;
   
-  if(XFSM_IS_STATE(me, &FluidicState_Idle)
-         ||
-            XFSM_IS_STATE(me, &FluidicState_MonitorFluidBreach))
+  if(timeout_ms > elapsed_ms)
   {
-    canAcceptCommand = true;
+    remaining_ms = timeout_ms - elapsed_ms;
   }
   
-  return canAcceptCommand;
+  me->deadlineArmed = true;
+  
+  XTimerWheelArm(me->pTimerWheel, &(me->timer), remaining_ms, 0u);
+}
+
+
+/**
+  * @brief Helper to check which timer has fired.
+  * @param[in] me - The fluid controller
+  * @returns True if the deadline has expired, false for a settling check.
+  **/
+STATIC bool FluidicTimerIsDeadline(Fluidic_t* me)
+{
+  return me->deadlineArmed;
 }
 
+
+/**
+  * @brief Time since the current move started.
+  * @param[in] me - The fluid controller
+  * @returns Elapsed time, in ms.
+  **/
+STATIC uint32_t FluidicMoveElapsedMs(Fluidic_t* me)
+{
+  return FLUIDIC_TIME_NOW_MS() - me->moveStartMs;
+}
+
+
+
 /**
   * @brief Helper call which monitors the status of bladders
   *        based on feedback messages coming from bladder
   *        detection engine in electrochemistry object.
-  *
+  * @details Stops the Piezo when the bladder reaches the state of the move:
+  *          down for a move to BC_POS_DOWN, otherwise up.
   * @param[in] me - The fluid controller
-  * @param[in] eventId - message per channel.
+  * @param[in] eventId - One of this channel's bladder detection events.
   * @returns   eErrorCode.
   **/
 STATIC eErrorCode FluidicMonitorBladderDetection(Fluidic_t * me, eXEventId eventId)
 {
-	eErrorCode error = OK_STATUS;
-
-	if (!me->chTargetPosReached)
-	{
-		if (BC_POS_DOWN == me->eTargetPos)
-		{
-			switch(eventId)
-			{
-			case XMSG_EC_A1_BLDR_DOWN:
-				if (EC_STRIP_CHAN_1 == me->pParams->eChannel)
-				{
-					error = piezoStop(me->pPiezo);
-					me->chTargetPosReached = true;
-				}
-        break;
-        
-			case XMSG_EC_B2_BLDR_DOWN:
-				if (EC_STRIP_CHAN_2 == me->pParams->eChannel)
-				{
-					error = piezoStop(me->pPiezo);
-					me->chTargetPosReached = true;
-				}
-        break;
-        
-      case XMSG_EC_A3_BLDR_DOWN:
-				if (EC_STRIP_CHAN_3 == me->pParams->eChannel)
-				{
-					error = piezoStop(me->pPiezo);
-					me->chTargetPosReached = true;
-				}
-        break;
-        
-			case XMSG_EC_B4_BLDR_DOWN:
-				if (EC_STRIP_CHAN_4 == me->pParams->eChannel)
-				{
-					error = piezoStop(me->pPiezo);
-					me->chTargetPosReached = true;
-				}
-        break;
-        
-			case XMSG_EC_A1_BLDR_UP:
-			case XMSG_EC_B2_BLDR_UP:
-			case XMSG_EC_A3_BLDR_UP:
-			case XMSG_EC_B4_BLDR_UP:
-				/* Not handled here. */
-        break;
-        
-			default:
-				error = ERROR_FLUIDIC_UNKNOWN_MSG_FROM_EC;
-        break;
-			}
-		}
-		else
-		{
-      switch(eventId)
-      {
-      case XMSG_EC_A1_BLDR_UP:
-        if (EC_STRIP_CHAN_1 == me->pParams->eChannel)
-        {
-          error = piezoStop(me->pPiezo);
-          me->chTargetPosReached = true;
-        }
-        break;
-        
-      case XMSG_EC_B2_BLDR_UP:
-        if (EC_STRIP_CHAN_2 == me->pParams->eChannel)
-        {
-          error = piezoStop(me->pPiezo);
-          me->chTargetPosReached = true;
-        }
-        break;
-        
-      case XMSG_EC_A3_BLDR_UP:
-        if (EC_STRIP_CHAN_3 == me->pParams->eChannel)
-        {
-          error = piezoStop(me->pPiezo);
-          me->chTargetPosReached = true;
-        }
-        break;
-        
-      case XMSG_EC_B4_BLDR_UP:
-        if (EC_STRIP_CHAN_4 == me->pParams->eChannel)
-        {
-          error = piezoStop(me->pPiezo);
-          me->chTargetPosReached = true;
-        }
-        break;
-        
-      case XMSG_EC_A1_BLDR_DOWN:
-      case XMSG_EC_B2_BLDR_DOWN:
-      case XMSG_EC_A3_BLDR_DOWN:
-      case XMSG_EC_B4_BLDR_DOWN:
-        /* Not handled here. */
-        break;
-        
-      default:
-        error = ERROR_FLUIDIC_UNKNOWN_MSG_FROM_EC;
-        break;
-      }
-		}
-	}
+  eErrorCode error = OK_STATUS;
+  eFluidicBladderState_t eWanted = (BC_POS_DOWN == me->eTargetPos) ?
+                                   FLUIDIC_BLADDER_DOWN : FLUIDIC_BLADDER_UP;
+  
+  if((false == me->chTargetPosReached) && (eventId == me->bladderEvents[eWanted]))
+  {
+    error = FluidicStopMove(me);
+    me->chTargetPosReached = true;
+  }
+  
+  return error;
+}
+
 
-	return error;
+/**
+  * @brief Checks whether an event is one of this channel's bladder detection events.
+  * @param[in] me - The fluid controller
+  * @param[in] eventId - The event.
+  * @returns   True if it is.
+  **/
+STATIC bool FluidicIsBladderEvent(const Fluidic_t * me, eXEventId eventId)
+{
+  return (eventId == me->bladderEvents[FLUIDIC_BLADDER_UP]) ||
+         (eventId == me->bladderEvents[FLUIDIC_BLADDER_DOWN]);
 }
 
 
@@ -3392,6 +4902,44 @@ STATIC eElectrochemicalChannelPos ConvertFluidPosToEchemPos(eFluidicPositions_t
 }
 
 
+/**
+  * @brief Points the echem electrode scan at the contact the channel waits on.
+  * @details Only builds with EC_SCAN_SCHEDULE schedule the scan. Otherwise
+  *          every contact is swept alike, and this does nothing.
+  * @param[in] me - The fluid controller
+  * @param[in] ePos - Position whose contact to sample the most, or
+  *                   EC_CHAN_POS_NONE for the plain sweep.
+  **/
+STATIC void FluidicSetScanFocus(Fluidic_t *me, eElectrochemicalChannelPos ePos)
+{
+#ifdef EC_SCAN_SCHEDULE
+  (void)ecSetScanFocus(me->pEchem, me->eChannel, ePos);
+#else
+  (void)me;
+  (void)ePos;
+#endif
+}
+
+
+/**
+  * @brief Holds the channel's contacts at the plain sweep rate, whatever the
+  *        other channels focus the scan on.
+  * @details Only builds with EC_SCAN_SCHEDULE schedule the scan. Otherwise
+  *          every contact is swept alike, and this does nothing.
+  * @param[in] me - The fluid controller
+  * @param[in] isWatched - True whilst the channel monitors for a breach.
+  **/
+STATIC void FluidicSetScanWatch(Fluidic_t *me, bool isWatched)
+{
+#ifdef EC_SCAN_SCHEDULE
+  (void)ecSetScanWatch(me->pEchem, me->eChannel, isWatched);
+#else
+  (void)me;
+  (void)isWatched;
+#endif
+}
+
+
 
 /**
   * @brief Helper function to handle a wait for fluid at contact message.
@@ -3404,12 +4952,562 @@ STATIC XState OnMsgWaitForFluidAtContact(Fluidic_t * me, const XEvent_t *pEv)
   const FluidicWaitForFluidAtContactMsg_t * pWaitMsg = (const FluidicWaitForFluidAtContactMsg_t *)pEv;
   
   me->eTargetPos = pWaitMsg->eTargetPos;
-  me->pParams->timeout_ms = pWaitMsg->timeoutMs;
+  me->run.timeout_ms = pWaitMsg->timeoutMs;
   
   return X_TRAN(me, &FluidicState_WaitForContact);
 }
 
 
+
+/**
+  * @brief Processes a move, lift up, mix or wait for contact command in a state
+  *        which can accept commands.
+  * @details The command is one of:
+  *          -# Posted directly, e.g. a homing move.
+  *          -# A queue slot, posted by the API to wake the controller. Starts
+  *             the oldest queued command, if one is not already on its way.
+  *          -# cmdInFlight, the oldest queued command. It is removed from the
+  *             queue and started. If it cannot be started, a move fail is
+  *             published and the rest of the queue is dropped.
+  * @param[in] me - The fluid controller
+  * @param[in] pEv - The command.
+  * @returns The state response of the command handler.
+  **/
+STATIC XState FluidicOnCommandMsg(Fluidic_t *me, const XEvent_t *pEv)
+{
+  XState retCode = X_RET_HANDLED;
+  bool isInFlight = (pEv == &(me->cmdInFlight.msg.super));
+  bool isWakeUp = false;
+  
+  for (uint32_t i = 0u; i < FLUIDIC_CMD_QUEUE_LEN; i++)
+  {
+    if (pEv == &(me->cmdQueue.cmds[i].msg.super))
+    {
+      isWakeUp = true;
+    }
+  }
+  
+  if (isWakeUp)
+  {
+    FluidicCmdQueueDispatch(me);
+  }
+  else if (isInFlight && (false == me->cmdDispatchPending))
+  {
+    // The queue was flushed after the command was posted. Drop it.
+  }
+  else
+  {
+    if (isInFlight)
+    {
+      me->cmdDispatchPending = false;
+      me->eRestPos = me->cmdInFlight.eEndPos;     // Before the API can see an empty queue.
+      XPortMemoryBarrier();                       // Slot was copied out, hand it back.
+      me->cmdQueue.tail = me->cmdQueue.tail + 1u;
+      me->pReportTo = me->cmdInFlight.pReportTo;
+    }
+    
+    switch (pEv->id)
+    {
+    case XMSG_FLUID_CHANNEL_MOVE_TO:
+      retCode = OnMsgBladderControlMoveToPos(me, pEv);  // Publishes its own move fail.
+      break;
+      
+    case XMSG_FLUID_LIFT_UP_BLADDER:
+      retCode = OnMsgLiftUpBladders(me, pEv);
+      if (isInFlight && (X_RET_IGNORED == retCode))
+      {
+        FluidicOnMoveFailMsg(me, BC_POS_DOWN, ERROR_FLUID_CHANNEL_INVALID_MOVE);
+      }
+      break;
+      
+    case XMSG_FLUID_WAIT_FOR_CONTACT:
+      retCode = OnMsgWaitForFluidAtContact(me, pEv);
+      break;
+      
+    case XMSG_FLUID_MIX:
+    default:
+      retCode = OnMsgBladderControlMix(me, pEv);
+      if (isInFlight && (X_RET_IGNORED == retCode))
+      {
+        FluidicOnMoveFailMsg(me, me->cmdInFlight.msg.mix.eTargetPos, ERROR_FLUID_CHANNEL_INVALID_MOVE);
+      }
+      break;
+    }
+  }
+  
+  return retCode;
+}
+
+
+/**
+  * @brief Checks whether any commands are queued.
+  * @param[in] me - The fluid controller
+  * @returns true if nothing is queued (or waiting to be started).
+  **/
+STATIC bool FluidicCmdQueueIsEmpty(Fluidic_t *me)
+{
+  return (me->cmdQueue.head == me->cmdQueue.tail);
+}
+
+
+/**
+  * @brief Checks whether another command can be queued.
+  * @param[in] me - The fluid controller
+  * @returns true if the queue is not full.
+  **/
+STATIC bool FluidicCmdQueueHasSpace(Fluidic_t *me)
+{
+  return ((me->cmdQueue.head - me->cmdQueue.tail) < FLUIDIC_CMD_QUEUE_LEN);
+}
+
+
+/**
+  * @brief Predicts the position the channel rests at once the executing
+  *        command, and everything queued behind it, has completed.
+  * @details Called from the API. Only reads the queue slots, which the API
+  *          wrote, and eRestPos, which the controller publishes.
+  *          The controller publishes the end of a queued command before it
+  *          hands the slot back, so an empty queue is never seen with an
+  *          older eRestPos.
+  * @param[in] me - The fluid controller
+  * @returns The position a newly queued command starts from.
+  **/
+STATIC eFluidicPositions_t FluidicCmdQueueEndPosition(Fluidic_t *me)
+{
+  const FluidicCmdQueue_t *pQueue = &(me->cmdQueue);
+  uint32_t head = pQueue->head;
+  eFluidicPositions_t eEndPos;
+  
+  if (head != pQueue->tail)
+  {
+    eEndPos = pQueue->cmds[(head - 1u) % FLUIDIC_CMD_QUEUE_LEN].eEndPos;
+  }
+  else
+  {
+    XPortMemoryBarrier();                         // See eRestPos as the controller left it.
+    eEndPos = me->eRestPos;
+  }
+  
+  return eEndPos;
+}
+
+
+/**
+  * @brief Publishes where the channel rests once the executing command completes.
+  * @details Called by the controller at the end of every state handler,
+  *          including the entry of a new state, so eRestPos follows the
+  *          state machine. The API reads it in FluidicCmdQueueEndPosition().
+  * @param[in] me - The fluid controller
+  **/
+STATIC void FluidicRestPosPublish(Fluidic_t *me)
+{
+  eFluidicPositions_t eRestPos;
+  
+  if (XFSM_IS_STATE(me, &FluidicState_MixContactControlled) ||
+      XFSM_IS_STATE(me, &FluidicState_MixPiezoControlled) ||
+      XFSM_IS_STATE(me, &FluidicState_MixWaitContinue))
+  {
+    eRestPos = me->run.eMixEndPosition;
+  }
+  else if (XFSM_IS_STATE(me, &FluidicState_LiftUpBladder))
+  {
+    eRestPos = BC_POS_DOWN;                       // Targets home, but stops once the bladders are up.
+  }
+  else if (XFSM_IS_STATE(me, &FluidicState_Err))
+  {
+    eRestPos = BC_POS_UNKNOWN;                    // Only a homing move is valid.
+  }
+  else if (me->eTargetPos < BC_VALID_POS_COUNT)
+  {
+    eRestPos = me->eTargetPos;
+  }
+  else
+  {
+    eRestPos = me->eLastKnownPos;
+  }
+  
+  XPortMemoryBarrier();                           // Finish the state first, then publish.
+  me->eRestPos = eRestPos;
+}
+
+
+/**
+  * @brief Adds a command to the back of the queue. Called from the API.
+  * @details Also posts the queue slot to the controller. If the controller
+  *          is ready it starts the command, busy states ignore the slot and
+  *          start the queue when they finish.
+  * @param[in] me - The fluid controller
+  * @param[in] pCmd - The validated command.
+  * @returns OK_COMMAND_ACCEPTED, or ERROR_OBJECT_NOT_READY if the queue is full.
+  **/
+STATIC eErrorCode FluidicCmdQueuePush(Fluidic_t *me, const FluidicQueuedCmd_t *pCmd)
+{
+  eErrorCode error = ERROR_OBJECT_NOT_READY;
+  FluidicCmdQueue_t *pQueue = &(me->cmdQueue);
+  uint32_t head = pQueue->head;
+  FluidicQueuedCmd_t *pSlot;
+  
+  if (FluidicCmdQueueHasSpace(me))
+  {
+    pSlot = &(pQueue->cmds[head % FLUIDIC_CMD_QUEUE_LEN]);
+    *pSlot = *pCmd;
+    XPortMemoryBarrier();                         // Slot is complete, hand it over.
+    pQueue->head = head + 1u;
+    
+    XActivePost(&me->super, (XEvent_t const*) &(pSlot->msg.super));
+    error = OK_COMMAND_ACCEPTED;
+  }
+  
+  return error;
+}
+
+
+/**
+  * @brief Posts the oldest queued command to self, when the channel is ready.
+  * @details The command is copied, so the API can reuse its slot once it
+  *          has been started. It stays in the queue until processed, so
+  *          nothing can overtake it.
+  * @param[in] me - The fluid controller
+  **/
+STATIC void FluidicCmdQueueDispatch(Fluidic_t *me)
+{
+  FluidicCmdQueue_t *pQueue = &(me->cmdQueue);
+  
+  if ((false == me->cmdDispatchPending) && (pQueue->head != pQueue->tail))
+  {
+    XPortMemoryBarrier();                         // See the slot as the producer left it.
+    me->cmdInFlight = pQueue->cmds[pQueue->tail % FLUIDIC_CMD_QUEUE_LEN];
+    me->cmdDispatchPending = true;
+    
+    XActivePost(&me->super, (XEvent_t const*) &(me->cmdInFlight.msg.super));
+  }
+}
+
+
+/**
+  * @brief Drops every queued command, including one posted but not yet started.
+  * @details Called on failures, cancel, homing and the error state. The
+  *          queued commands were validated assuming the channel would reach
+  *          the end of the executing command. Each dropped command is answered
+  *          with a move fail, posted to the object waiting on it or published.
+  * @param[in] me - The fluid controller
+  **/
+STATIC void FluidicCmdQueueFlush(Fluidic_t *me)
+{
+  FluidicCmdQueue_t *pQueue = &(me->cmdQueue);
+  uint32_t head = pQueue->head;
+  XActive_t *pReportTo;
+  
+  XPortMemoryBarrier();                           // See the slots as the producer left them.
+  
+  for (uint32_t i = pQueue->tail; i != head; i++)
+  {
+    pReportTo = pQueue->cmds[i % FLUIDIC_CMD_QUEUE_LEN].pReportTo;
+    
+    if (NULL != pReportTo)
+    {
+      XActivePost(pReportTo, (XEvent_t const*) &(me->flushFailMsg));
+    }
+    else
+    {
+      X_PUBLISH(X_FRAMEWORK_OF(me), me->flushFailMsg);
+    }
+  }
+  
+  XPortMemoryBarrier();                           // Slots were read, hand them back.
+  pQueue->tail = head;
+  me->cmdDispatchPending = false;
+}
+
+
+/**
+  * @brief Adds an event delivered to a state handler to the trace, if it is traced.
+  * @details Not traced:
+  *          -# Entry and exit, which the state machine makes itself.
+  *          -# Piezo events of other channels, which are ignored.
+  *          -# cmdInFlight, as the queue slot which woke the controller is
+  *             traced as the command.
+  *          -# Stats dumps, which change nothing but the histograms.
+  *          Other events from the controller itself are traced as commands.
+  * @param[in] me - The fluid controller
+  * @param[in] pEv - The event.
+  **/
+STATIC void FluidicTraceOnEvent(Fluidic_t *me, const XEvent_t *pEv)
+{
+  eFluidicTraceSource_t eSource = FLUIDIC_TRACE_EVENT;
+  bool isTraced = (NULL != me->pTrace);
+  
+  if (isTraced)
+  {
+    switch (pEv->id)
+    {
+    case X_EV_ENTRY:
+    case X_EV_EXIT:
+    case XMSG_FLUID_STATS_DUMP:
+      isTraced = false;
+      break;
+      
+    case X_EV_TIMER:
+      break;
+      
+    case XMSG_PIEZO_MOVE_COMPLTE:
+    case XMSG_PIEZO_STOPPED:
+      isTraced = (((const PiezoMoveCompltEv_t *)pEv)->chan == me->pPiezo->pParams->chan);
+      break;
+      
+    case XMSG_PEIZO_MOVE_FAIL:
+      isTraced = (((const PiezoMoveFailEv_t *)pEv)->chan == me->pPiezo->pParams->chan);
+      break;
+      
+    default:
+      if (pEv->sender == (void *)me)
+      {
+        eSource = FLUIDIC_TRACE_COMMAND;
+        isTraced = (pEv != &(me->cmdInFlight.msg.super));
+      }
+      break;
+    }
+  }
+  
+  if (isTraced)
+  {
+    FluidicTraceRecord(me, pEv, eSource);
+  }
+}
+
+
+/**
+  * @brief Adds a record of an event to the trace.
+  * @param[in] me - The fluid controller
+  * @param[in] pEv - The event.
+  * @param[in] eSource - Where the event came from.
+  **/
+STATIC void FluidicTraceRecord(Fluidic_t *me, const XEvent_t *pEv, eFluidicTraceSource_t eSource)
+{
+  FluidicTraceRecord_t record;
+  
+  FluidicTraceRecordBegin(me, &record, (uint32_t)pEv->id, eSource);
+  FluidicTraceEncode(me, pEv, &record);
+  
+  (void)FluidicTraceAppend(me->pTrace, FLUIDIC_TIME_NOW_MS(), &record);
+}
+
+
+/**
+  * @brief Adds the part of an event the controller reads to a trace record.
+  * @details Payloads, in order:
+
+Event                           | Payload
+------------------------------- | ---------------------------------
+XMSG_PIEZO_MOVE_COMPLTE         | piezoVoltage (f32).
+XMSG_PIEZO_STOPPED              | piezoVoltage (f32).
+XMSG_PEIZO_MOVE_FAIL            | error (u32).
+XMSG_EC_FLUID_STATUS_CHANGED    | This channel's fluid position (u8).
+XMSG_EC_ERROR                   | errorCode (u32).
+XMSG_FLUID_CHANNEL_MOVE_TO      | eTargetPos (u8), rampSpeedVoltsPerSec (f32), timeout_ms (u32), eOvershootComp (u8), overshootCompProportion (f32), eProfile (u8).
+XMSG_FLUID_LIFT_UP_BLADDER      | rampSpeedVoltsPerSec (f32), timeout_ms (u32).
+XMSG_FLUID_MIX                  | eTargetPos (u8), mixFrequency (f32), mixTime (u32), mixCycles (u32), eMixType (u8), openLoopCompensationFactor (f32), mixDownstrokeProportion (f32).
+XMSG_FLUID_CHANNEL_NEW_PARAMS   | flAVal, flBVal, flCVal (f32).
+XMSG_FLUID_ENABLE_BREACH_DETECT | monitorFluidPosition (u8).
+XMSG_FLUID_WAIT_FOR_CONTACT     | eTargetPos (u8), timeoutMs (u32).
+Move success result             | eRestPosition (u8), completionTimeMs (u32).
+Move fail result                | eTargetPosition (u8).
+Mix complete result             | mixFrequency_Hz (f32).
+Anything else                   | None.
+
+  * @param[in] me - The fluid controller
+  * @param[in] pEv - The event.
+  * @param[in,out] pRecord - Record with an empty payload.
+  **/
+STATIC void FluidicTraceEncode(const Fluidic_t *me, const XEvent_t *pEv, FluidicTraceRecord_t *pRecord)
+{
+  const FluidicMovePositionMsg_t *pMove;
+  const FluidicLiftUpBladderMsg_t *pLift;
+  const FluidicMixMsg_t *pMix;
+  const FluidicUpdateParamsMsg_t *pParamsMsg;
+  const FluidicWaitForFluidAtContactMsg_t *pWait;
+  
+  if (FLUIDIC_TRACE_RESULT == pRecord->eSource)
+  {
+    if (pEv == &(me->moveSuccessMsg.super))
+    {
+      FluidicTracePutU8(pRecord, (uint8_t)me->moveSuccessMsg.eRestPosition);
+      FluidicTracePutU32(pRecord, me->moveSuccessMsg.completionTimeMs);
+    }
+    else if (pEv == &(me->moveFailMsg.super))
+    {
+      FluidicTracePutU8(pRecord, (uint8_t)me->moveFailMsg.eTargetPosition);
+    }
+    else if (pEv == &(me->mixCmpltMsg.super))
+    {
+      FluidicTracePutF32(pRecord, me->mixCmpltMsg.mixFrequency_Hz);
+    }
+    else
+    {
+      // Nothing else is reported.
+    }
+  }
+  else
+  {
+    switch (pEv->id)
+    {
+    case XMSG_PIEZO_MOVE_COMPLTE:
+      FluidicTracePutF32(pRecord, ((const PiezoMoveCompltEv_t *)pEv)->piezoVoltage);
+      break;
+      
+    case XMSG_PIEZO_STOPPED:
+      FluidicTracePutF32(pRecord, ((const PiezoStoppedEv_t *)pEv)->piezoVoltage);
+      break;
+      
+    case XMSG_PEIZO_MOVE_FAIL:
+      FluidicTracePutU32(pRecord, (uint32_t)((const PiezoMoveFailEv_t *)pEv)->error);
+      break;
+      
+    case XMSG_EC_FLUID_STATUS_CHANGED:
+      FluidicTracePutU8(pRecord,
+                        (uint8_t)((const FillDetectStatusChange_t *)pEv)->results.fluidPositions[me->eChannel]);
+      break;
+      
+    case XMSG_EC_ERROR:
+      FluidicTracePutU32(pRecord, (uint32_t)((const EchemErrorMsg_t *)pEv)->errorCode);
+      break;
+      
+    case XMSG_FLUID_CHANNEL_MOVE_TO:
+      pMove = (const FluidicMovePositionMsg_t *)pEv;
+      FluidicTracePutU8(pRecord, (uint8_t)pMove->eTargetPos);
+      FluidicTracePutF32(pRecord, pMove->rampSpeedVoltsPerSec);
+      FluidicTracePutU32(pRecord, pMove->timeout_ms);
+      FluidicTracePutU8(pRecord, (uint8_t)pMove->eOvershootComp);
+      FluidicTracePutF32(pRecord, pMove->overshootCompProportion);
+      FluidicTracePutU8(pRecord, (uint8_t)pMove->eProfile);
+      break;
+      
+    case XMSG_FLUID_LIFT_UP_BLADDER:
+      pLift = (const FluidicLiftUpBladderMsg_t *)pEv;
+      FluidicTracePutF32(pRecord, pLift->rampSpeedVoltsPerSec);
+      FluidicTracePutU32(pRecord, pLift->timeout_ms);
+      break;
+      
+    case XMSG_FLUID_MIX:
+      pMix = (const FluidicMixMsg_t *)pEv;
+      FluidicTracePutU8(pRecord, (uint8_t)pMix->eTargetPos);
+      FluidicTracePutF32(pRecord, pMix->mixFrequency);
+      FluidicTracePutU32(pRecord, pMix->mixTime);
+      FluidicTracePutU32(pRecord, pMix->mixCycles);
+      FluidicTracePutU8(pRecord, (uint8_t)pMix->eMixType);
+      FluidicTracePutF32(pRecord, pMix->openLoopCompensationFactor);
+      FluidicTracePutF32(pRecord, pMix->mixDownstrokeProportion);
+      break;
+      
+    case XMSG_FLUID_CHANNEL_NEW_PARAMS:
+      pParamsMsg = (const FluidicUpdateParamsMsg_t *)pEv;
+      FluidicTracePutF32(pRecord, pParamsMsg->flAVal);
+      FluidicTracePutF32(pRecord, pParamsMsg->flBVal);
+      FluidicTracePutF32(pRecord, pParamsMsg->flCVal);
+      break;
+      
+    case XMSG_FLUID_ENABLE_BREACH_DETECT:
+      FluidicTracePutU8(pRecord, (uint8_t)((const FluidicMonitorBreachMsg_t *)pEv)->monitorFluidPosition);
+      break;
+      
+    case XMSG_FLUID_WAIT_FOR_CONTACT:
+      pWait = (const FluidicWaitForFluidAtContactMsg_t *)pEv;
+      FluidicTracePutU8(pRecord, (uint8_t)pWait->eTargetPos);
+      FluidicTracePutU32(pRecord, pWait->timeoutMs);
+      break;
+      
+    default:
+      break;
+    }
+  }
+}
+
+
+/**
+  * @brief Adds a Piezo command to the trace.
+  * @details The ramp of a FLUIDIC_TRACE_PIEZO_SET is traced as its
+  *          targetVoltage and rampSpeed (f32).
+  * @param[in] me - The fluid controller
+  * @param[in] eOutput - The command.
+  * @param[in] pMoveParams - The ramp. NULL unless eOutput is FLUIDIC_TRACE_PIEZO_SET.
+  **/
+STATIC void FluidicTraceOutput(Fluidic_t *me,
+                               eFluidicTraceOutput_t eOutput,
+                               const peizoMoveParams_t *pMoveParams)
+{
+  FluidicTraceRecord_t record;
+  
+  if (NULL != me->pTrace)
+  {
+    FluidicTraceRecordBegin(me, &record, (uint32_t)eOutput, FLUIDIC_TRACE_OUTPUT);
+    
+    if (NULL != pMoveParams)
+    {
+      FluidicTracePutF32(&record, pMoveParams->targetVoltage);
+      FluidicTracePutF32(&record, pMoveParams->rampSpeed);
+    }
+    
+    (void)FluidicTraceAppend(me->pTrace, FLUIDIC_TIME_NOW_MS(), &record);
+  }
+}
+
+
+#ifdef FLUIDIC_PIEZO_WAVEFORM
+/**
+  * @brief Adds a FLUIDIC_TRACE_PIEZO_WAVEFORM command to the trace.
+  * @details Traced as the shape (u8), samplePeriodUs and totalSamples (u32),
+  *          and the voltage the waveform ends at (f32).
+  * @param[in] me - The fluid controller
+  * @param[in] pWaveform - The waveform.
+  **/
+STATIC void FluidicTraceWaveform(Fluidic_t *me, const FluidicWaveform_t *pWaveform)
+{
+  FluidicTraceRecord_t record;
+  
+  if (NULL != me->pTrace)
+  {
+    FluidicTraceRecordBegin(me, &record, (uint32_t)FLUIDIC_TRACE_PIEZO_WAVEFORM, FLUIDIC_TRACE_OUTPUT);
+    
+    FluidicTracePutU8(&record, (uint8_t)pWaveform->eShape);
+    FluidicTracePutU32(&record, pWaveform->samplePeriodUs);
+    FluidicTracePutU32(&record, pWaveform->totalSamples);
+    FluidicTracePutF32(&record, FluidicWaveformSample(pWaveform, pWaveform->totalSamples - 1u));
+    
+    (void)FluidicTraceAppend(me->pTrace, FLUIDIC_TIME_NOW_MS(), &record);
+  }
+}
+#endif
+
+
+/**
+  * @brief Starts a trace record, with a snapshot of the controller.
+  * @param[in] me - The fluid controller
+  * @param[out] pRecord - The record, with an empty payload.
+  * @param[in] id - Event id, or eFluidicTraceOutput_t.
+  * @param[in] eSource - Where the record came from.
+  **/
+STATIC void FluidicTraceRecordBegin(const Fluidic_t *me,
+                                    FluidicTraceRecord_t *pRecord,
+                                    uint32_t id,
+                                    eFluidicTraceSource_t eSource)
+{
+  pRecord->id = id;
+  pRecord->eSource = eSource;
+  pRecord->snapshot.state = FLUIDIC_TRACE_STATE_UNKNOWN;
+  pRecord->snapshot.eLastKnownPos = (uint8_t)me->eLastKnownPos;
+  pRecord->snapshot.eTargetPos = (uint8_t)me->eTargetPos;
+  pRecord->payloadLen = 0u;
+  
+  for (uint32_t i = 0u; i < (sizeof(s_traceStates) / sizeof(s_traceStates[0])); i++)
+  {
+    if (XFSM_IS_STATE(me, s_traceStates[i]))
+    {
+      pRecord->snapshot.state = (uint8_t)i;
+    }
+  }
+}
+
+
 /**
 * @}
 */
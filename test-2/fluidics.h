@@ -13,6 +13,14 @@
 #include "electrochemical.h"
 #include "piezo.h"
 #include "fluidicsTypes.h"
+#include "fluidicsCal.h"
+#include "fluidicsTelemetry.h"
+#include "fluidicsStats.h"
+#include "fluidicsTrace.h"
+#include "fluidicsWaveform.h"
+#include "xTimerWheel.h"
+#include "xEventPool.h"
+#include "xPort.h"
 
 
 
@@ -22,6 +30,12 @@
 
 #define FLUID_NUM_MIXING_STAGES_PER_CYCLE 2u
 
+/// Strokes held by a mix plan: an opening upstroke and downstroke, then one repeating cycle.
+#define FLUIDIC_MIX_PLAN_MAX_STROKES      4u
+
+/// Strokes of the mix plan which are played once, before the repeating cycle.
+#define FLUIDIC_MIX_PLAN_LEAD_IN_STROKES  2u
+
 // Low speed. 2.5V/s change. This allows move to be completed in 3- 4s
 #define FLUID_SPEED_LOW_DEFAULT_V_PER_S   2.5f
 
@@ -31,6 +45,14 @@
 // Flush speed needs to be faster than slow speed. Used for bead band wash.
 #define FLUID_SPEED_FLUSH_DEFAULT_V_PER_S 10.f
 
+// Fast approach moves ramp at high speed to this far below the expected
+// contact voltage, then finish at the requested speed.
+#define FLUID_APPROACH_WINDOW_DEFAULT_V   5.f
+
+// Predictive stops stop the Piezo this long before the fluid front is expected
+// at the contact. Half an echem sweep, the mean delay in detecting a contact.
+#define FLUID_PREDICTIVE_STOP_LEAD_DEFAULT_MS  (ECHEM_UPDATE_PERIOD_MS / 2u)
+
 // Default Hysterisis multipliers 10% change.
 #define FLUID_HYST_MULTIPLIER_INC_DEFAULT 1.1f
 #define FLUID_HYST_MULTIPLIER_DEC_DEFAULT 0.9f
@@ -51,10 +73,34 @@
 // Default mixing frequency 1Hz.
 #define FLUIDIC_DEFAULT_MIX_FREQ    1.f
 
+// Mix frequency asking the controller to mix as fast as the channel allows.
+// The frequency chosen is reported in the mix complete message.
+#define FLUIDIC_MIX_FREQ_AUTO       0.f
+
+// Proportion of the Piezo ramp limit, and of the contact response limit, an
+// auto-tuned mix runs at.
+#define FLUIDIC_MIX_AUTO_MARGIN     0.8f
+
+// Fastest auto-tuned mix.
+#define FLUIDIC_MIX_AUTO_MAX_FREQ   10.f
+
+// Weight of a faster contact response in the observed response time. Slower
+// responses are taken straight away.
+#define FLUIDIC_CONTACT_RESPONSE_FILTER  0.125f
+
 
 #define FLUIDIC_HYSETRISIS_MAX   10.f
 #define FLUIDIC_HYSETRISIS_MIN   1.f
 
+// Default gains of the PI mix end point controller.
+// The proportional gain moves the expected contact voltage most of the way to
+// each observed contact, the integral gain follows slow drift of the bladders.
+#define FLUID_MIX_PI_KP_DEFAULT             0.7f
+#define FLUID_MIX_PI_KI_DEFAULT             0.1f
+// Hysterisis is held at 2.5x the filtered tracking error, filtered over ~4 strokes.
+#define FLUID_MIX_PI_SPREAD_FILTER_DEFAULT  0.25f
+#define FLUID_MIX_PI_SPREAD_GAIN_DEFAULT    2.5f
+
 
 /// Critical errors which impact Fluidic Objects.
 #define FLUIDIC_CIRITICAL_ERR(errorCode) ((errorCode == ERROR_FLUID_CHANNEL_ECHEM_BUSY || \
@@ -65,9 +111,13 @@
 #define FLUIDIC_MAX_VOLTS_BEFORE_LIFT   50.f
 
 
-/// Tick count of Fluidic objects.
+/// Settling time before the first check of a move. Fluidic timers are
+/// otherwise only armed for the move (or mix) deadline.
 #define FLUIDIC_TIMER_COUNT_MS        (uint32_t) 20
 
+/// Millisecond time source used to measure move and mix durations.
+#define FLUIDIC_TIME_NOW_MS()         XPortTimeNowMs()
+
 ///Maximum error occurrence. Stops the system bouncing between points in the event of a movement failure.
 #define FLUIDIC_MAX_FAIL_COUNT    (uint32_t) 2u
 
@@ -77,6 +127,19 @@
 
 #define FLUID_RETURN_SPEED_REDUCTION_FACTOR 2.f
 
+/// Number of commands which can be queued behind the executing command. Must be a power of two.
+#define FLUIDIC_CMD_QUEUE_LEN         4u
+
+/// Signals of the stats dump and the fluidic group, which the application's
+/// eXEventId list must carry. A build whose list does not yet carry them
+/// defines FLUIDIC_LOCAL_XMSG_BASE as the first free id, and they are
+/// numbered from it.
+#ifdef FLUIDIC_LOCAL_XMSG_BASE
+#define XMSG_FLUID_STATS_DUMP         ((eXEventId)((FLUIDIC_LOCAL_XMSG_BASE) + 0u))
+#define XMSG_FLUID_GROUP_CMD          ((eXEventId)((FLUIDIC_LOCAL_XMSG_BASE) + 1u))
+#define XMSG_FLUID_GROUP_CMPLT        ((eXEventId)((FLUIDIC_LOCAL_XMSG_BASE) + 2u))
+#endif
+
 /// Events which Fluidic objects must subscribe to.
 #define X_SUBSCRIBE_TO_FLUIDIC_EVENTS(me_) \
 		X_SUBSCRIBE(me_, XMSG_FLUID_CHANNEL_MOVE_TO) \
@@ -92,14 +155,8 @@
 		X_SUBSCRIBE(me_, XMSG_PIEZO_STOPPED) \
 		X_SUBSCRIBE(me_, XMSG_DOOR_OPENED) \
 		X_SUBSCRIBE(me_, XMSG_FLUID_MIX_CONTINUE) \
-		X_SUBSCRIBE(me_, XMSG_EC_A1_BLDR_DOWN) \
-		X_SUBSCRIBE(me_, XMSG_EC_A1_BLDR_UP) \
-		X_SUBSCRIBE(me_, XMSG_EC_A3_BLDR_DOWN) \
-		X_SUBSCRIBE(me_, XMSG_EC_A3_BLDR_UP) \
-		X_SUBSCRIBE(me_, XMSG_EC_B2_BLDR_DOWN) \
-		X_SUBSCRIBE(me_, XMSG_EC_B2_BLDR_UP) \
-		X_SUBSCRIBE(me_, XMSG_EC_B4_BLDR_DOWN) \
-		X_SUBSCRIBE(me_, XMSG_EC_B4_BLDR_UP) \
+		X_SUBSCRIBE(me_, (me_)->bladderEvents[FLUIDIC_BLADDER_UP]) \
+		X_SUBSCRIBE(me_, (me_)->bladderEvents[FLUIDIC_BLADDER_DOWN]) \
 		X_SUBSCRIBE_TO_GLOBAL_EVENTS(me)
 
 
@@ -127,16 +184,72 @@ FluidicPositionLimits_t;
 
 
 /**
-  *     @brief Parameters used by a fluidics instance.
+  *     @brief Controllers for the stroke end point of closed loop mixing.
+  *     @details After each contact controlled stroke the controller updates the
+  *              target position's targetVolts (the voltage the contact is
+  *              expected at) and posHysterisis (how far past it the stroke
+  *              ends).
+  **/
+typedef enum
+{
+  FLUID_MIX_CTRL_MULTIPLIER = 0,    ///< targetVolts set to the last contact, hysterisis scaled by hysterisisMultipliersVolts.
+  FLUID_MIX_CTRL_PI,                ///< targetVolts tracks the contact with a PI estimator, hysterisis follows the tracking error.
+  FLUID_MIX_CTRL_COUNT
+}
+eFluidMixController_t;
+
+
+/**
+  *     @brief Bladder states reported by the electrochemistry's bladder detection.
+  **/
+typedef enum
+{
+  FLUIDIC_BLADDER_UP = 0,           ///< The bladder has lifted off the strip.
+  FLUIDIC_BLADDER_DOWN,             ///< The bladder is pressed onto the strip.
+  FLUIDIC_BLADDER_STATE_COUNT
+}
+eFluidicBladderState_t;
+
+
+/**
+  *     @brief Speed profile of a move to a contact.
+  **/
+typedef enum
+{
+  FLUID_MOVE_PROFILE_SINGLE_SPEED = 0,  ///< The whole move at the requested ramp speed.
+  FLUID_MOVE_PROFILE_FAST_APPROACH,     ///< High speed to approachWindowVolts short of the expected contact, then the requested ramp speed.
+  FLUID_MOVE_PROFILE_COUNT
+}
+eFluidMoveProfile_t;
+
+
+/**
+  *     @brief Gains of the PI mix end point controller.
+  **/
+typedef struct FluidicMixPiGains_tag
+{
+  float kp;                         ///< Proportion of the tracking error applied to the expected contact voltage.
+  float ki;                         ///< Proportion of the tracking error added to the drift, per stroke.
+  float spreadFilter;               ///< 0.0 - 1.0, weight of the latest stroke in the filtered tracking error.
+  float spreadGain;                 ///< Hysterisis, as a multiple of the filtered tracking error.
+}
+FluidicMixPiGains_t;
+
+
+/**
+  *     @brief Configuration of a fluidics instance.
+  *     @details Constant, so it can be held in flash. The fields which the
+  *              controller changes at run time are copied into the instance's
+  *              FluidicRunParams_t, and only the copy is changed. Holds nothing
+  *              per channel, so bladders with the same positions share one.
   */
 typedef struct FluidicParams_tag
 {
   FluidicPositionLimits_t        positionLimits[BC_VALID_POS_COUNT];    ///< The piezo voltages which will be used to define each fluid position.
   
-  eElectrochemicalChannel        eChannel;                      ///< Fluid channel which the bladder controls.
   uint32_t                       timeout_ms;                    ///< Timeout whilst waiting for fill detection to occur.
-  float                          mixFrequency_Hz;               ///< The default mixing frequency. This is changed when a new mix command is received.
-  uint32_t                       mixTimeout_ms;                 ///< The default mixing timeout. This is changed when a new mix command is received. 
+  float                          mixFrequency_Hz;               ///< The default mixing frequency, until a mix command is received.
+  uint32_t                       mixTimeout_ms;                 ///< The default mixing timeout, until a mix command is received.
   uint32_t                       targetMixCycles;                     ///< The number of complete cycles which must be completed during the mix operation.
   float                          rampSpeedVoltsPerSec;                    ///< Can be @ref FLUIDIC_SPEED_LOW, @ref FLUIDIC_SPEED_HIGH, or @ref FLUIDIC_SPEED_FLUSH
   uint32_t                       mixTimeoutMax_ms;              ///< Maximum mix timeout which can be used.
@@ -150,11 +263,60 @@ typedef struct FluidicParams_tag
   float                          openLoopCompensationFactor;
   float                          mixDownstrokeProportion;
   
+  float                          approachWindowVolts;         ///< Fast approach moves slow down this far short of the expected contact voltage.
+  uint32_t                       predictiveStopLeadMs;        ///< Forward moves stop this long before the predicted contact. 0 disables predictive stops.
+  
+  eFluidMixController_t          eMixController;              ///< End point controller for closed loop mixing.
+  FluidicMixPiGains_t            mixPiGains;                  ///< Gains used by FLUID_MIX_CTRL_PI.
+  
+  eFluidicWaveformShape_t        eMixWaveform;                ///< Open loop mixes are streamed to the Piezo as this waveform. FLUIDIC_WAVEFORM_NONE, or a build without FLUIDIC_PIEZO_WAVEFORM, plays them a ramp per stroke.
+  
   bool                           monitorBreachAfterMove;      ///< Boolean flag to monitor the contacts for breach after completing the move.
 }
 FluidicParams_t;
 
 
+/**
+  *     @brief Run time state of a position.
+  **/
+typedef struct FluidicPositionState_tag
+{
+  float                          targetVolts;                 ///< The expected voltage for the position. Learned by moves and mixing.
+  float                          posHysterisis;               ///< How far beyond targetVolts moves to the position may run. Adjusted by mixing.
+}
+FluidicPositionState_t;
+
+
+/**
+  *     @brief Per test overlay of a fluidics instance's configuration.
+  *     @details Everything the controller changes at run time. Set from the
+  *              configuration by FluidicInit(). The positions and breach
+  *              monitoring are reset by each homing move, so every test starts
+  *              from the same state. The move and mix parameters are set by
+  *              each command.
+  **/
+typedef struct FluidicRunParams_tag
+{
+  FluidicPositionState_t         positions[BC_VALID_POS_COUNT];
+  
+  uint32_t                       timeout_ms;                  ///< Timeout of the executing move, or wait for fluid.
+  float                          rampSpeedVoltsPerSec;        ///< Ramp speed of the executing move, or mix stroke.
+  eFluidOvershootCompensation_t  eOvershootCompensationType;  ///< Of the executing move.
+  float                          compensationProportion;      ///< Of the executing move.
+  
+  float                          mixFrequency_Hz;             ///< Of the executing mix.
+  uint32_t                       mixTimeout_ms;               ///< Of the executing mix.
+  uint32_t                       targetMixCycles;             ///< Of the executing mix.
+  eFluidicPositions_t            eMixEndPosition;             ///< Position the executing mix returns to.
+  eFluidMixingType_t             eMixType;                    ///< Of the executing mix.
+  float                          openLoopCompensationFactor;  ///< Of the executing mix.
+  float                          mixDownstrokeProportion;     ///< Of the executing mix.
+  
+  bool                           monitorBreachAfterMove;      ///< Monitor the contacts for breach after completing the move.
+}
+FluidicRunParams_t;
+
+
 
 /**
   *     @brief Initialisation parameters for a fluidics instance.
@@ -164,10 +326,16 @@ typedef struct FluidicInitParams_tag
   piezo_t*                      pPiezo;              ///< The piezo object
   Electrochemical_t*            pEchem;               ///< The electrochemical object.
                                                       
-  FluidicParams_t*              pParams;             ///< The initialisation parameters.
+  const FluidicParams_t*        pParams;             ///< The configuration. Not copied, so may be held in flash, and shared between channels.
+  eElectrochemicalChannel       eChannel;            ///< Fluid channel which the bladder controls.
                                                       
   char*                         name;                 ///< The name which will be stored within the XObj base.
   uint8_t                       prio;                 ///< Priority.
+  FluidicCal_t*                 pCal;                 ///< Calibration cache shared by the channels. May be NULL.
+  FluidicStats_t*               pStats;               ///< Latency histograms of this channel. May be NULL.
+  FluidicTrace_t*               pTrace;               ///< Event trace, already given its buffer. Started by the init. May be NULL.
+  XTimerWheel_t*                pTimerWheel;          ///< Timeout service shared by the active objects.
+  XEventPool_t*                 pEventPool;           ///< Events posted by the API. Shared by the active objects. Holds at least FLUIDIC_POOL_EVENT_SIZE bytes.
 }
 FluidicInitParams_t;
 
@@ -184,6 +352,7 @@ typedef struct FluidicMovePositionMsg_tag
   eFluidOvershootCompensation_t   eOvershootComp;
   float                           overshootCompProportion;
   uint32_t                        timeout_ms;
+  eFluidMoveProfile_t             eProfile;               ///< Speed profile of a forward move to a contact.
 }
 FluidicMovePositionMsg_t;
   
@@ -233,6 +402,19 @@ typedef struct FluidicUpdateParamsMsg_tag
 FluidicUpdateParamsMsg_t;
 
 
+/**
+  *     @brief  Message used to dump the latency histograms.
+  */
+typedef struct FluidicStatsMsg_tag
+{
+  XEvent_t                      super;      ///< Base XEvent object
+  FluidicStatsPrintFn_t         pfnPrint;   ///< Writes each line of the dump.
+  void                          *pCtx;      ///< Passed to pfnPrint.
+  bool                          reset;      ///< Empty the histograms once dumped.
+}
+FluidicStatsMsg_t;
+
+
 
 /**
   *     @brief  Message used to indicate that a move was completed
@@ -268,6 +450,7 @@ typedef struct FluidicMixCompleteMsg_tag
   XEvent_t                      super;        ///< Base XEvent object
   eFluidicPositions_t           eRestPosition;///< Position at the end of the fluidic movement.
   eElectrochemicalChannel       eChannel;     ///< Electrochemical channel - Indicates which fluid channel has concluded moving.
+  float                         mixFrequency_Hz; ///< Frequency the mix ran at. Chosen by the controller if FLUIDIC_MIX_FREQ_AUTO was asked for.
 }
 FluidicMixCompleteMsg_t;
 
@@ -316,6 +499,124 @@ typedef struct FluidicWaitForFluidAtContactMsg_tag
 FluidicWaitForFluidAtContactMsg_t;
 
 
+/**
+  *     @brief A move, mix, lift up or wait for contact command waiting for the
+  *            channel to finish its current command.
+  **/
+typedef struct FluidicQueuedCmd_tag
+{
+  union
+  {
+    XEvent_t                    super;     ///< Base XEvent object. The id selects the message.
+    FluidicMovePositionMsg_t    move;      ///< XMSG_FLUID_CHANNEL_MOVE_TO.
+    FluidicLiftUpBladderMsg_t   lift;      ///< XMSG_FLUID_LIFT_UP_BLADDER.
+    FluidicMixMsg_t             mix;       ///< XMSG_FLUID_MIX.
+    FluidicWaitForFluidAtContactMsg_t wait; ///< XMSG_FLUID_WAIT_FOR_CONTACT.
+  }
+  msg;
+  eFluidicPositions_t           eEndPos;   ///< Position the channel rests at once the command completes.
+  XActive_t                     *pReportTo; ///< Receives the result of the command, instead of it being published. May be NULL.
+}
+FluidicQueuedCmd_t;
+
+
+/**
+  *     @brief Messages the fluid controller's API takes from the event pool.
+  *     @details Only for sizing the pool's blocks, see FLUIDIC_POOL_EVENT_SIZE.
+  **/
+typedef union FluidicPoolMsg_tag
+{
+  FluidicUpdateParamsMsg_t      params;    ///< XMSG_FLUID_CHANNEL_NEW_PARAMS.
+  FluidicStatsMsg_t             stats;     ///< XMSG_FLUID_STATS_DUMP.
+  FluidicMonitorBreachMsg_t     breach;    ///< XMSG_FLUID_ENABLE_BREACH_DETECT.
+}
+FluidicPoolMsg_t;
+
+
+/// Smallest event size of a pool given to FluidicInit().
+#define FLUIDIC_POOL_EVENT_SIZE       ((uint32_t)sizeof(FluidicPoolMsg_t))
+
+
+/**
+  *     @brief A single Piezo stroke of a mix.
+  **/
+typedef struct FluidicMixStroke_tag
+{
+  eFluidicMoveDirection_t       eDirection;           ///< Direction of fluid movement during the stroke.
+  float                         startVolts;           ///< Piezo voltage at the start of the stroke.
+  float                         endVolts;             ///< Piezo voltage at the end of the stroke.
+  float                         rampSpeedVoltsPerSec; ///< Ramp rate giving a stroke of half the mix period.
+}
+FluidicMixStroke_t;
+
+
+/**
+  *     @brief Stroke schedule of an open loop mix.
+  *     @details Built once, from the mix message, when the mix starts. Stage n
+  *              plays strokes[n] whilst n is within the lead-in, then the
+  *              remaining strokes repeat until totalStages have been played.
+  *              With a configured eMixWaveform the same strokes are sampled
+  *              into one waveform, and the Piezo plays every stage unaided.
+  **/
+typedef struct FluidicMixPlan_tag
+{
+  FluidicMixStroke_t            strokes[FLUIDIC_MIX_PLAN_MAX_STROKES];
+  uint32_t                      totalStages;          ///< Strokes in the whole mix.
+  bool                          isStreamed;           ///< Strokes are played back to back, without waiting for XMSG_FLUID_MIX_CONTINUE.
+  bool                          isWaveform;           ///< The whole mix is played by the Piezo driver, from waveform.
+  FluidicWaveform_t             waveform;             ///< The strokes, sampled. Only built if isWaveform.
+}
+FluidicMixPlan_t;
+
+
+/**
+  *     @brief State of the PI mix end point controller, for one position.
+  **/
+typedef struct FluidicMixCtrlState_tag
+{
+  float                         driftVolts;           ///< Integral term. Movement of the contact voltage per stroke.
+  float                         spreadVolts;          ///< Filtered magnitude of the tracking error.
+}
+FluidicMixCtrlState_t;
+
+
+/**
+  *     @brief Fluid front velocity estimator of a channel.
+  *     @details Records the Piezo voltage at which forward moves detect each
+  *              contact, and fits the voltage the front travels between
+  *              neighbouring contacts. This predicts where the next contact
+  *              will be detected, so the Piezo can be stopped as the front
+  *              reaches it rather than one detection delay later.
+  *              Cleared by homing.
+  **/
+typedef struct FluidicFrontEstimator_tag
+{
+  float                         detectVolts[BC_VALID_POS_COUNT]; ///< Piezo voltage when the contact was last detected.
+  bool                          isDetected[BC_VALID_POS_COUNT];  ///< The contact has been detected since homing.
+  float                         voltsPerContact;      ///< Fitted Piezo voltage between neighbouring contacts. 0 until two contacts are detected.
+  bool                          isStopPending;        ///< The timer is armed for a predictive stop.
+  bool                          isFrontAwaited;       ///< The Piezo was stopped ahead of the contact, and the front has not yet been detected.
+}
+FluidicFrontEstimator_t;
+
+
+/**
+  *     @brief Bounded command queue of a fluid channel.
+  *     @details Single producer (the API caller) and single consumer (the
+  *              fluid controller). Only the producer writes head, and only
+  *              the consumer writes tail. Both are free running. A memory
+  *              barrier orders each side's slot accesses against the index
+  *              that hands the slots over.
+  **/
+typedef struct FluidicCmdQueue_tag
+{
+  FluidicQueuedCmd_t            cmds[FLUIDIC_CMD_QUEUE_LEN];
+  volatile uint32_t             head;      ///< Count of commands queued.
+  volatile uint32_t             tail;      ///< Count of commands started (or flushed).
+}
+FluidicCmdQueue_t;
+
+
 /**
   *     @brief Status information of a Fluidic Object
   **/
@@ -336,7 +637,9 @@ FluididStatus_t;
 typedef struct Fluidic_tag
 {   
   XActive_t                     super;             ///< Active framework top-level object
-  XTimer_t                      timer;             ///< Fluidic object's timer.
+  XWheelTimer_t                 timer;             ///< Settling checks and deadlines, armed on pTimerWheel.
+  XTimerWheel_t                 *pTimerWheel;      ///< Timeout service shared by the active objects.
+  XEventPool_t                  *pEventPool;       ///< Events posted by the API.
   uint32_t                      evQueueBytes[64];  ///< Data queue for events.
   
 
@@ -347,10 +650,23 @@ typedef struct Fluidic_tag
   eFluidicPositions_t           eLastKnownPos;     ///< Last known position of the fluidics. 
   eFluidicPositions_t           eTargetPos;        ///< Target position for the current movement
     
-  FluidicParams_t               *pParams;          ///< Fluidics parameters
+  const FluidicParams_t         *pParams;          ///< Fluidics configuration
+  eElectrochemicalChannel       eChannel;          ///< Fluid channel which the bladder controls.
+  FluidicRunParams_t            run;               ///< Run time overlay of the configuration.
+  FluidicCal_t                  *pCal;             ///< Learned contact voltages of the strip lot. May be NULL.
+  eXEventId                     bladderEvents[FLUIDIC_BLADDER_STATE_COUNT]; ///< This channel's bladder detection events. The only ones subscribed to.
+  bool                          isContactVoltsKnown[BC_VALID_POS_COUNT]; ///< targetVolts of the position was learned or set, rather than defaulted.
+  eFluidMoveProfile_t           eMoveProfile;      ///< Speed profile of the executing move.
+  bool                          isApproaching;     ///< The fast part of a fast approach move is under way.
     
-  uint32_t                      timeoutTimer;      ///< Timer used when waiting for fill detection to occur. If this exceeds a threshold value the fluidics will cancel the last move request.
-  uint32_t                      mixTimer;
+  uint32_t                      moveStartMs;       ///< Time the current move (or strip check) started. Used for the move timeout and completion time.
+  uint32_t                      mixTimer;          ///< Time spent in the mix movement states, in ms.
+  uint32_t                      mixStageStartMs;   ///< Time the current mix stage started.
+  FluidicMixPlan_t              mixPlan;           ///< Stroke schedule of the executing mix.
+  FluidicMixCtrlState_t         mixCtrl[BC_VALID_POS_COUNT]; ///< End point controller state of each position.
+  FluidicFrontEstimator_t       front;             ///< Fluid front velocity estimator, for predictive stops.
+  float                         contactResponseMs; ///< How late contacts are reported, against where mix strokes expect them. Limits auto-tuned mixes.
+  bool                          deadlineArmed;     ///< The timer is armed for the timeout, rather than the settling check.
   
   FluididStatus_t               status;            ///< Status information of the fluidic channel
   
@@ -359,21 +675,31 @@ typedef struct Fluidic_tag
 
   FluidicMoveSuccessMsg_t       moveSuccessMsg;    ///< Message published when a move has been completed successfully.
   FluidicMoveFailMsg_t          moveFailMsg;       ///< Message published when a move has failed.
+  FluidicMoveFailMsg_t          flushFailMsg;      ///< Message sent for each queued command dropped by a flush. Never changed once initialised, so can be queued many times over.
   FluidicMixCompleteMsg_t       mixCmpltMsg;       ///< Message published when a mix has been completed successfully.
   FluidicErrorMsg_t             errorMsg;          ///< Message published when an error has occurred.
   XEvent_t                      cmdAccepted;       ///< Message to indicate that the object has accepted the command.
   XMsgCmdFail_t                 cmdFail;           ///< Message to indicate that the object command failed.
-  FluidicLiftUpBladderMsg_t     liftUpBlddrMsg;    ///< Message to indicate the lift up of bladders.
-  FluidicWaitForFluidAtContactMsg_t waitForFluidContactMsg;
   
+  FluidicCmdQueue_t             cmdQueue;          ///< Commands accepted whilst the channel is busy.
+  FluidicQueuedCmd_t            cmdInFlight;       ///< Queued command posted to self, once the channel is ready.
+  bool                          cmdDispatchPending; ///< cmdInFlight has been posted, but not yet processed.
+  volatile eFluidicPositions_t  eRestPos;          ///< Where the channel rests once the executing command completes. Only written by the controller, so the API can read it with nothing queued.
+  XActive_t                     *pReportTo;        ///< Receives the result of the executing command. NULL to publish it.
+
+  FluidicTelemetry_t            telemetry;         ///< Records of finished moves and mix strokes, drained by the application.
+  FluidicTelemetryRecord_t      record;            ///< Record of the executing move or mix stroke.
+  bool                          isRecording;       ///< record is open.
+  FluidicStats_t                *pStats;           ///< Latency histograms. May be NULL.
+  uint32_t                      frontChangeMs;     ///< Time of the sweep which found the latest change of this channel's fluid front.
+  bool                          isFrontStopTimed;  ///< A Piezo stop for the fluid front has been issued, and its confirmation is to be timed.
+  FluidicTrace_t                *pTrace;           ///< Event trace. May be NULL.
+
   FluidicMixStageCompleteMsg_t  stageCompelteMsg;
   //Control events. Removes the need for function static events.
-  FluidicMixMsg_t               mixMsg;            ///< Message sent to the object to trigger a mix command.
   FluidicMovePositionMsg_t      moveMsg;           ///< Message sent to the object to trigger a movement.
-  FluidicUpdateParamsMsg_t      paramsMsg;         ///< Message sent to the object to update the parameters.
   XEvent_t                      stopMsg;           ///< Message sent to the object to update the parameters.
   XEvent_t                      errClearMsg;       ///< Message sent to the object to exit the error state..
-  FluidicMonitorBreachMsg_t     monitorPositionMsg;
   
   XEvent_t                      breachDetectedMsg; ///< Message sent to the framework to indicate that a fluid breach has been detected.
   XEvent_t                      fcStartBladderDetectMsg;  ///< Kick off bladder detection.
@@ -394,6 +720,22 @@ eErrorCode FluidicMove(Fluidic_t* me,
                        eFluidOvershootCompensation_t   eOvershootComp,
                        float overshootCompProportion);
 
+eErrorCode FluidicMoveReportTo(Fluidic_t* me, 
+                               XActive_t* pReportTo,
+                               eFluidicPositions_t eTarget, 
+                               float rampSpeedVoltsPerSec,
+                               uint32_t timeout,
+                               eFluidOvershootCompensation_t   eOvershootComp,
+                               float overshootCompProportion,
+                               eFluidMoveProfile_t eProfile);
+
+eErrorCode FluidicMoveCheck(Fluidic_t* me, 
+                            eFluidicPositions_t eTarget, 
+                            float rampSpeedVoltsPerSec,
+                            uint32_t timeout,
+                            eFluidOvershootCompensation_t   eOvershootComp,
+                            float overshootCompProportion);
+
 eErrorCode FluidicLiftUpBladder(Fluidic_t* me,
                                 float rampSpeedVoltsPerSec,
                                 uint32_t timeout_ms);
@@ -407,9 +749,28 @@ eErrorCode FluidicMix(Fluidic_t* me,
                       float openLoopCompensationFactor,
                       float mixDownstrokeProportion);
 
+eErrorCode FluidicMixReportTo(Fluidic_t* me, 
+                              XActive_t* pReportTo,
+                              eFluidicPositions_t eTarget, 
+                              float mixFreq, 
+                              uint32_t mixTimeout, 
+                              uint32_t cycles,
+                              eFluidMixingType_t  eMixType,
+                              float openLoopCompensationFactor,
+                              float mixDownstrokeProportion);
+
+eErrorCode FluidicMixCheck(Fluidic_t* me, 
+                           eFluidicPositions_t eTarget, 
+                           float mixFreq, 
+                           uint32_t mixTimeout, 
+                           uint32_t cycles,
+                           eFluidMixingType_t  eMixType,
+                           float openLoopCompensationFactor,
+                           float mixDownstrokeProportion);
+
 eErrorCode FluidicStop(Fluidic_t *me);
 
-eErrorCode FluidicParamsSet(Fluidic_t* me, FluidicParams_t *pParams);
+eErrorCode FluidicParamsSet(Fluidic_t* me, const FluidicParams_t *pParams);
 eErrorCode FluidicErrorClear(Fluidic_t * me);
 
 eErrorCode FluidicEnableBreachMonitoring(Fluidic_t* me,
@@ -419,6 +780,11 @@ eErrorCode FluidicWaitForFluidAtContact(Fluidic_t * me,
                                         eFluidicPositions_t eTarget,
                                         uint32_t timeoutMs);
 
+eErrorCode FluidicStatsDumpRequest(Fluidic_t * me,
+                                   FluidicStatsPrintFn_t pfnPrint,
+                                   void *pCtx,
+                                   bool reset);
+
 
 #endif
 
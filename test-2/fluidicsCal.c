@@ -0,0 +1,277 @@
+/**
+******************************************************************************
+* @file         fluidicsCal.c
+* @brief        Per strip lot cache of learned contact voltages.
+* @details      Fluid controllers record the Piezo voltage at which each
+*               forward move reached its contact, and seed their target
+*               voltages from the cache when homing. The application selects
+*               the strip lot before the test, and saves the cache after it.
+******************************************************************************
+*/
+
+#include "fluidicsCal.h"
+
+/**
+* @addtogroup FluidicsCal
+*  @{
+*/
+
+STATIC void FluidicCalReset(FluidicCal_t *pCal);
+STATIC uint32_t FluidicCalChecksum(const FluidicCalImage_t *pImage);
+STATIC bool FluidicCalImageIsValid(const FluidicCalImage_t *pImage);
+
+
+/**
+  * @brief Initialises the cache, and loads the stored image.
+  * @details A missing, corrupt or old version image is discarded and the cache
+  *          starts empty. No lot is selected.
+  * @param[in] pCal - The cache.
+  * @param[in] pInitParams - Storage hooks.
+  **/
+void FluidicCalInit(FluidicCal_t *pCal, const FluidicCalInitParams_t *pInitParams)
+{
+  ASSERT_NOT_NULL(pCal);
+  ASSERT_NOT_NULL(pInitParams);
+
+  (void)memset(pCal, 0, sizeof(FluidicCal_t));
+
+  pCal->params = *pInitParams;
+
+  if ((NULL == pCal->params.pfnLoad) ||
+      (OK_STATUS != pCal->params.pfnLoad(&pCal->image, pCal->params.pCtx)) ||
+      (false == FluidicCalImageIsValid(&pCal->image)))
+  {
+    FluidicCalReset(pCal);
+  }
+}
+
+
+/**
+  * @brief Selects the strip lot of the next test.
+  * @details A lot which is not in the cache replaces the least recently used
+  *          lot. FLUIDIC_CAL_LOT_NONE deselects the lot, so nothing is learned.
+  *          Must only be called whilst the fluid channels are idle.
+  * @param[in] pCal - The cache.
+  * @param[in] lotId - The strip lot.
+  * @returns OK_STATUS
+  **/
+eErrorCode FluidicCalSelectLot(FluidicCal_t *pCal, uint32_t lotId)
+{
+  FluidicCalLot_t *pLot = NULL;
+  FluidicCalLot_t *pOldest;
+
+  ASSERT_NOT_NULL(pCal);
+
+  pOldest = &pCal->image.lots[0u];
+
+  if (FLUIDIC_CAL_LOT_NONE != lotId)
+  {
+    for (uint32_t i = 0u; (i < FLUIDIC_CAL_MAX_LOTS) && (NULL == pLot); i++)
+    {
+      if ((0u != pCal->image.lots[i].lastUsed) && (lotId == pCal->image.lots[i].lotId))
+      {
+        pLot = &pCal->image.lots[i];
+      }
+      else if (pCal->image.lots[i].lastUsed < pOldest->lastUsed)
+      {
+        pOldest = &pCal->image.lots[i];
+      }
+      else
+      {
+        // Keep looking.
+      }
+    }
+
+    if (NULL == pLot)
+    {
+      pLot = pOldest;
+      (void)memset(pLot, 0, sizeof(FluidicCalLot_t));
+      pLot->lotId = lotId;
+    }
+
+    pCal->image.selectCount++;
+    pLot->lastUsed = pCal->image.selectCount;
+    pCal->isDirty = true;
+  }
+
+  pCal->pActiveLot = pLot;
+
+  return OK_STATUS;
+}
+
+
+/**
+  * @brief Records the voltage at which a channel reached a contact.
+  * @details Averaged with the voltages of earlier moves, so a single late
+  *          contact detection does not move the learned voltage far.
+  *          Ignored if no lot is selected, or the position is not a contact.
+  * @param[in] pCal - The cache.
+  * @param[in] eChannel - Fluid channel.
+  * @param[in] ePos - Position reached, BC_POS_FLUID_A to BC_POS_FLUID_C.
+  * @param[in] contactVolts - Piezo voltage at the contact.
+  **/
+void FluidicCalRecord(FluidicCal_t *pCal,
+                      eElectrochemicalChannel eChannel,
+                      eFluidicPositions_t ePos,
+                      float contactVolts)
+{
+  FluidicCalLot_t *pLot = pCal->pActiveLot;
+  uint32_t posIndex;
+  uint8_t numSamples;
+
+  if ((NULL != pLot) &&
+      (eChannel < EC_STRIP_CHAN_COUNT) &&
+      (ePos >= BC_POS_FLUID_A) &&
+      (ePos <= BC_POS_FLUID_C))
+  {
+    posIndex = (uint32_t)ePos - (uint32_t)BC_POS_FLUID_A;
+
+    numSamples = pLot->numSamples[eChannel][posIndex];
+
+    if (numSamples < FLUIDIC_CAL_MAX_SAMPLES)
+    {
+      numSamples++;
+      pLot->numSamples[eChannel][posIndex] = numSamples;
+    }
+
+    pLot->contactVolts[eChannel][posIndex] +=
+      (contactVolts - pLot->contactVolts[eChannel][posIndex]) / (float)numSamples;
+
+    pCal->isDirty = true;
+  }
+}
+
+
+/**
+  * @brief Gets the learned contact voltages of a channel.
+  * @details Voltages are only returned once all three contacts have been
+  *          learned for the selected lot, and are in channel order (A < B < C).
+  * @param[in] pCal - The cache. May be NULL.
+  * @param[in] eChannel - Fluid channel.
+  * @param[out] contactVolts - Learned voltages of contacts A, B and C.
+  * @returns True if the voltages were found.
+  **/
+bool FluidicCalLookup(const FluidicCal_t *pCal,
+                      eElectrochemicalChannel eChannel,
+                      float contactVolts[FLUIDIC_CAL_POS_COUNT])
+{
+  const FluidicCalLot_t *pLot = NULL;
+  bool isFound = false;
+
+  if ((NULL != pCal) && (eChannel < EC_STRIP_CHAN_COUNT))
+  {
+    pLot = pCal->pActiveLot;
+  }
+
+  if (NULL != pLot)
+  {
+    isFound = true;
+
+    for (uint32_t i = 0u; i < FLUIDIC_CAL_POS_COUNT; i++)
+    {
+      contactVolts[i] = pLot->contactVolts[eChannel][i];
+
+      if ((0u == pLot->numSamples[eChannel][i]) ||
+          ((i > 0u) && (contactVolts[i] <= contactVolts[i - 1u])))
+      {
+        isFound = false;
+      }
+    }
+  }
+
+  return isFound;
+}
+
+
+/**
+  * @brief Writes the cache to storage, if it has changed.
+  * @param[in] pCal - The cache.
+  * @retval OK_STATUS The image was saved, or had not changed.
+  * @retval ERROR_OBJECT_NOT_READY No storage hook.
+  * @returns Otherwise, the error from the storage hook.
+  **/
+eErrorCode FluidicCalSave(FluidicCal_t *pCal)
+{
+  eErrorCode error = OK_STATUS;
+
+  ASSERT_NOT_NULL(pCal);
+
+  if (NULL == pCal->params.pfnSave)
+  {
+    error = ERROR_OBJECT_NOT_READY;
+  }
+  else if (pCal->isDirty)
+  {
+    pCal->image.checksum = FluidicCalChecksum(&pCal->image);
+
+    error = pCal->params.pfnSave(&pCal->image, pCal->params.pCtx);
+
+    if (OK_STATUS == error)
+    {
+      pCal->isDirty = false;
+    }
+  }
+  else
+  {
+    // Nothing to save.
+  }
+
+  return error;
+}
+
+
+/**
+  * @brief Empties the cache.
+  * @param[in] pCal - The cache.
+  **/
+STATIC void FluidicCalReset(FluidicCal_t *pCal)
+{
+  (void)memset(&pCal->image, 0, sizeof(FluidicCalImage_t));
+
+  pCal->image.magic   = FLUIDIC_CAL_MAGIC;
+  pCal->image.version = FLUIDIC_CAL_VERSION;
+  pCal->pActiveLot    = NULL;
+  pCal->isDirty       = true;
+}
+
+
+/**
+  * @brief Fletcher-32 of the image, excluding the checksum itself.
+  * @param[in] pImage - The image.
+  * @returns The checksum.
+  **/
+STATIC uint32_t FluidicCalChecksum(const FluidicCalImage_t *pImage)
+{
+  const uint8_t *pBytes = (const uint8_t *)pImage;
+  uint32_t sum1 = 0xFFFFu;
+  uint32_t sum2 = 0xFFFFu;
+
+  for (uint32_t i = 0u; i < offsetof(FluidicCalImage_t, checksum); i++)
+  {
+    sum1 = (sum1 + pBytes[i]) % 0xFFFFu;
+    sum2 = (sum2 + sum1) % 0xFFFFu;
+  }
+
+  return (sum2 << 16u) | sum1;
+}
+
+
+/**
+  * @brief Checks a loaded image.
+  * @param[in] pImage - The image.
+  * @returns True if the image is the current version and is not corrupt.
+  **/
+STATIC bool FluidicCalImageIsValid(const FluidicCalImage_t *pImage)
+{
+  return (FLUIDIC_CAL_MAGIC == pImage->magic) &&
+         (FLUIDIC_CAL_VERSION == pImage->version) &&
+         (FluidicCalChecksum(pImage) == pImage->checksum);
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,127 @@
+/**
+ ******************************************************************************
+ * @file   fluidicsCal.h
+ * @brief  Header file for fluidicsCal.c
+ ******************************************************************************
+ */
+
+
+#ifndef FLUIDICS_CAL_H_
+#define FLUIDICS_CAL_H_
+
+#include "poci.h"
+#include "electrochemicalTypes.h"
+#include "fluidicsTypes.h"
+
+
+/**
+ * @defgroup FluidicsCal Fluidic Calibration Cache
+ * @brief Learned contact voltages, kept between tests.
+ * @details The Piezo voltage at which each channel makes contacts A, B and C
+ *          depends on the strip lot. The cache records the voltage learned
+ *          by each forward move, per strip lot, channel and position, and
+ *          the fluid controllers seed their target voltages from it when they
+ *          home at the start of the next test.
+ *          The image is loaded and saved through application hooks, so it
+ *          can be kept in whatever non-volatile storage the instrument has.
+ *  @{
+ */
+
+
+/// Number of strip lots held. The least recently used lot is replaced.
+#define FLUIDIC_CAL_MAX_LOTS           4u
+
+/// Positions held per channel: contacts A, B and C.
+#define FLUIDIC_CAL_POS_COUNT          3u
+
+/// A learned voltage is the mean of up to this many moves, then a moving average.
+#define FLUIDIC_CAL_MAX_SAMPLES        8u
+
+/// Strip lot 0 is reserved to mean "no lot"; nothing is learned or seeded.
+#define FLUIDIC_CAL_LOT_NONE           0u
+
+#define FLUIDIC_CAL_MAGIC              0x464C4341u    ///< "FLCA"
+#define FLUIDIC_CAL_VERSION            1u
+
+
+/**
+  *     @brief Learned contact voltages of one strip lot.
+  **/
+typedef struct FluidicCalLot_tag
+{
+  uint32_t                      lotId;                  ///< Strip lot.
+  uint32_t                      lastUsed;               ///< Selection count when the lot was last selected. 0 if the entry is free.
+  float                         contactVolts[EC_STRIP_CHAN_COUNT][FLUIDIC_CAL_POS_COUNT];  ///< Learned Piezo voltage of contacts A, B and C.
+  uint8_t                       numSamples[EC_STRIP_CHAN_COUNT][FLUIDIC_CAL_POS_COUNT];    ///< Moves averaged into contactVolts. 0 if not learned.
+}
+FluidicCalLot_t;
+
+
+/**
+  *     @brief The stored image of the cache.
+  **/
+typedef struct FluidicCalImage_tag
+{
+  uint32_t                      magic;                  ///< FLUIDIC_CAL_MAGIC
+  uint32_t                      version;                ///< FLUIDIC_CAL_VERSION
+  uint32_t                      selectCount;            ///< Number of lot selections. Orders the lots by use.
+  FluidicCalLot_t               lots[FLUIDIC_CAL_MAX_LOTS];
+  uint32_t                      checksum;               ///< Fletcher-32 of the image up to this field.
+}
+FluidicCalImage_t;
+
+
+/// Reads the stored image. Returns OK_STATUS if an image was read.
+typedef eErrorCode (*FluidicCalLoadFn_t)(FluidicCalImage_t *pImage, void *pCtx);
+
+/// Writes the image to storage. Returns OK_STATUS if it was written.
+typedef eErrorCode (*FluidicCalSaveFn_t)(const FluidicCalImage_t *pImage, void *pCtx);
+
+
+/**
+  *     @brief Cache initialisation parameters.
+  **/
+typedef struct FluidicCalInitParams_tag
+{
+  FluidicCalLoadFn_t            pfnLoad;                ///< Storage read hook. May be NULL, the cache then starts empty.
+  FluidicCalSaveFn_t            pfnSave;                ///< Storage write hook. May be NULL, the cache is then only kept until reset.
+  void                          *pCtx;                  ///< Passed to the hooks.
+}
+FluidicCalInitParams_t;
+
+
+/**
+  *     @brief The calibration cache.
+  *     @details Shared by the fluid controllers. Each controller only writes
+  *              its own channel's voltages. The lot is selected, and the cache
+  *              saved, by the application whilst the channels are idle.
+  **/
+typedef struct FluidicCal_tag
+{
+  FluidicCalInitParams_t        params;
+  FluidicCalImage_t             image;
+  FluidicCalLot_t               *pActiveLot;            ///< Lot of the strip under test. NULL if none selected.
+  volatile bool                 isDirty;                ///< The image has changed since it was loaded or saved.
+}
+FluidicCal_t;
+
+
+/** @} */
+void       FluidicCalInit(FluidicCal_t *pCal, const FluidicCalInitParams_t *pInitParams);
+
+eErrorCode FluidicCalSelectLot(FluidicCal_t *pCal, uint32_t lotId);
+
+void       FluidicCalRecord(FluidicCal_t *pCal,
+                            eElectrochemicalChannel eChannel,
+                            eFluidicPositions_t ePos,
+                            float contactVolts);
+
+bool       FluidicCalLookup(const FluidicCal_t *pCal,
+                            eElectrochemicalChannel eChannel,
+                            float contactVolts[FLUIDIC_CAL_POS_COUNT]);
+
+eErrorCode FluidicCalSave(FluidicCal_t *pCal);
+
+#endif
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,562 @@
+/**
+******************************************************************************
+* @file         fluidicsGroup.c
+* @brief        Coordinated move and mix of several fluid channels.
+* @details      The group object issues a move or mix to every commanded
+*               channel from a single dispatch, collects the per-channel
+*               results and publishes one aggregate completion.
+* @note         Channels in a group command must not be commanded directly
+*               until the group completes. The Fluidic command queue has a
+*               single producer.
+******************************************************************************
+*/
+
+#include "fluidicsGroup.h"
+
+#ifdef FLUIDIC_HOST_SIM
+#include "fluidicsSim.h"
+#endif
+
+/**
+* @addtogroup FluidicsGroup
+*  @{
+*/
+
+STATIC XState FluidicGroupState_Active(FluidicGroup_t *me, XEvent_t const *pEv);
+STATIC void FluidicGroupOnCmd(FluidicGroup_t *me, const FluidicGroupCmdMsg_t *pCmd);
+STATIC void FluidicGroupOnChannelResult(FluidicGroup_t *me, XEvent_t const *pEv);
+STATIC void FluidicGroupOnTimeout(FluidicGroup_t *me);
+STATIC void FluidicGroupChannelDone(FluidicGroup_t *me,
+                                    uint32_t chan,
+                                    eFluidicPositions_t eRestPos,
+                                    bool failed);
+STATIC eErrorCode FluidicGroupCheckTargets(const FluidicGroup_t *me,
+                                           const eFluidicPositions_t eTargets[EC_STRIP_CHAN_COUNT]);
+STATIC bool FluidicGroupClaim(FluidicGroup_t *me);
+
+
+/**
+  * @brief Initialises and starts the group object.
+  * @param[in] me - The group object.
+  * @param[in] pInitParams - Channels in the group, the services they share, name and priority.
+  * @param[in] pXActiveFramework - Framework the group publishes to.
+  **/
+void FluidicGroupInit(FluidicGroup_t *me,
+                      const FluidicGroupInitParams_t *pInitParams,
+                      XActiveFramework_t *pXActiveFramework)
+{
+  ASSERT_NOT_NULL(me);
+  ASSERT_NOT_NULL(pInitParams);
+  ASSERT_NOT_NULL(pInitParams->pEchem);
+  ASSERT_NOT_NULL(pInitParams->pTimerWheel);
+
+  (void)memset(me, 0, sizeof(FluidicGroup_t));
+
+  for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+  {
+    // Channels are indexed, and fill detection enabled, by echem channel.
+    ASSERT((NULL == pInitParams->pChannels[i]) ||
+           ((eElectrochemicalChannel)i == pInitParams->pChannels[i]->eChannel));
+
+    me->pChannels[i] = pInitParams->pChannels[i];
+  }
+
+  me->pEchem = pInitParams->pEchem;
+  me->pTimerWheel = pInitParams->pTimerWheel;
+
+  XActive_ctor(&me->super, (XStateHandler) &FluidicGroupState_Active);
+
+  XTimerWheelTimerInit(&(me->timer), &(me->super), X_EV_TIMER);
+
+  X_EV_INIT(&(me->cmdMsg), XMSG_FLUID_GROUP_CMD, me);
+  X_EV_INIT(&(me->completeMsg), XMSG_FLUID_GROUP_CMPLT, me);
+
+  XActiveStart(pXActiveFramework,
+               (XActive_t*)&(me->super),
+               pInitParams->name,
+               pInitParams->prio,
+               me->evQueueBytes,
+               sizeof(me->evQueueBytes),
+               NULL);
+}
+
+
+/**
+  * @brief API to move several channels at once.
+  * @details The group is claimed, then every commanded channel is checked
+  *          before any is moved, so the command is accepted by all channels
+  *          or none. Can be called from any thread.
+  * @param[in] me - The group object.
+  * @param[in] eTargets - Target of each channel. BC_NONE to leave the channel alone.
+  *                       Homing moves are not grouped.
+  * @param[in] rampSpeedVoltsPerSec - The ramp rate of every channel.
+  * @param[in] timeout_ms - The move timeout of every channel.
+  * @param[in] eOvershootComp - Overshoot compensation mode.
+  * @param[in] overshootCompProportion - Overshoot compensation proportion.
+  * @param[in] eProfile - Speed profile of every channel.
+  * @retval OK_COMMAND_ACCEPTED - XMSG_FLUID_GROUP_CMPLT will be published.
+  * @retval ERROR_OBJECT_NOT_READY - A group command is executing, or a channel queue is full.
+  * @retval ERROR_BAD_ARGS - No channel commanded, a channel is not fitted, or a target is home.
+  * @retval ERROR_FLUID_CHANNEL_INVALID_MOVE - A channel cannot make its move, or the profile is invalid.
+  **/
+eErrorCode FluidicGroupMove(FluidicGroup_t *me,
+                            const eFluidicPositions_t eTargets[EC_STRIP_CHAN_COUNT],
+                            float rampSpeedVoltsPerSec,
+                            uint32_t timeout_ms,
+                            eFluidOvershootCompensation_t eOvershootComp,
+                            float overshootCompProportion,
+                            eFluidMoveProfile_t eProfile)
+{
+  ASSERT_NOT_NULL(me);
+  ASSERT_NOT_NULL(eTargets);
+
+  eErrorCode error = ERROR_OBJECT_NOT_READY;
+  bool isClaimed = FluidicGroupClaim(me);
+
+  if (isClaimed)
+  {
+    error = FluidicGroupCheckTargets(me, eTargets);
+  }
+
+  if ((OK_STATUS == error) && (eProfile >= FLUID_MOVE_PROFILE_COUNT))
+  {
+    error = ERROR_FLUID_CHANNEL_INVALID_MOVE;
+  }
+
+  for (uint32_t i = 0u; (i < (uint32_t)EC_STRIP_CHAN_COUNT) && (OK_STATUS == error); i++)
+  {
+    if (BC_NONE != eTargets[i])
+    {
+      error = FluidicMoveCheck(me->pChannels[i],
+                               eTargets[i],
+                               rampSpeedVoltsPerSec,
+                               timeout_ms,
+                               eOvershootComp,
+                               overshootCompProportion);
+    }
+  }
+
+  if (OK_STATUS == error)
+  {
+    for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+    {
+      me->cmdMsg.eTargets[i] = eTargets[i];
+    }
+    me->cmdMsg.isMix = false;
+    me->cmdMsg.move.rampSpeedVoltsPerSec = rampSpeedVoltsPerSec;
+    me->cmdMsg.move.timeout_ms = timeout_ms;
+    me->cmdMsg.move.eOvershootComp = eOvershootComp;
+    me->cmdMsg.move.overshootCompProportion = overshootCompProportion;
+    me->cmdMsg.move.eProfile = eProfile;
+
+    X_POST(me, me->cmdMsg);
+    error = OK_COMMAND_ACCEPTED;
+  }
+  else if (isClaimed)
+  {
+    me->isBusy = false;
+  }
+
+  return error;
+}
+
+
+/**
+  * @brief API to mix several channels at once.
+  * @details The group is claimed, then every commanded channel is checked
+  *          before any is started, so the command is accepted by all channels
+  *          or none. Can be called from any thread.
+  * @param[in] me - The group object.
+  * @param[in] eTargets - Mix limit of each channel. BC_NONE to leave the channel alone.
+  * @param[in] mixFreq - The frequency of the fluid front movement.
+  * @param[in] mixTimeout - The mixing period in ms.
+  * @param[in] cycles - Number of mixing cycles.
+  * @param[in] eMixType - Open loop, single point or dual point mixing.
+  * @param[in] openLoopCompensationFactor - First stroke compensation (open loop).
+  * @param[in] mixDownstrokeProportion - Proportion of the channel region to mix in.
+  * @returns As FluidicGroupMove().
+  **/
+eErrorCode FluidicGroupMix(FluidicGroup_t *me,
+                           const eFluidicPositions_t eTargets[EC_STRIP_CHAN_COUNT],
+                           float mixFreq,
+                           uint32_t mixTimeout,
+                           uint32_t cycles,
+                           eFluidMixingType_t eMixType,
+                           float openLoopCompensationFactor,
+                           float mixDownstrokeProportion)
+{
+  ASSERT_NOT_NULL(me);
+  ASSERT_NOT_NULL(eTargets);
+
+  eErrorCode error = ERROR_OBJECT_NOT_READY;
+  bool isClaimed = FluidicGroupClaim(me);
+
+  if (isClaimed)
+  {
+    error = FluidicGroupCheckTargets(me, eTargets);
+  }
+
+  for (uint32_t i = 0u; (i < (uint32_t)EC_STRIP_CHAN_COUNT) && (OK_STATUS == error); i++)
+  {
+    if (BC_NONE != eTargets[i])
+    {
+      error = FluidicMixCheck(me->pChannels[i],
+                              eTargets[i],
+                              mixFreq,
+                              mixTimeout,
+                              cycles,
+                              eMixType,
+                              openLoopCompensationFactor,
+                              mixDownstrokeProportion);
+    }
+  }
+
+  if (OK_STATUS == error)
+  {
+    for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+    {
+      me->cmdMsg.eTargets[i] = eTargets[i];
+    }
+    me->cmdMsg.isMix = true;
+    me->cmdMsg.mix.mixFrequency = mixFreq;
+    me->cmdMsg.mix.mixTime = mixTimeout;
+    me->cmdMsg.mix.mixCycles = cycles;
+    me->cmdMsg.mix.eMixType = eMixType;
+    me->cmdMsg.mix.openLoopCompensationFactor = openLoopCompensationFactor;
+    me->cmdMsg.mix.mixDownstrokeProportion = mixDownstrokeProportion;
+
+    X_POST(me, me->cmdMsg);
+    error = OK_COMMAND_ACCEPTED;
+  }
+  else if (isClaimed)
+  {
+    me->isBusy = false;
+  }
+
+  return error;
+}
+
+
+/**
+  * @brief Checks whether a group command is executing.
+  * @param[in] me - The group object.
+  * @returns true from the command being accepted until XMSG_FLUID_GROUP_CMPLT.
+  **/
+bool FluidicGroupIsBusy(const FluidicGroup_t *me)
+{
+  return me->isBusy;
+}
+
+
+/**
+  * @brief The only state of the group object.
+  * @param me The group object.
+  * @param pEv Input events to be handled.
+  * @details Responds to the following events:
+
+Event                     | Actions
+------------------------- | ---------------------------------
+XMSG_FLUID_GROUP_CMD      | Commands every channel of the group command.
+------------------------- |----------------------------------
+XMSG_FMOVE_CMPLT, XMSG_FLUID_MIX_COMPLETE | Records a channel's rest position.
+------------------------- |----------------------------------
+XMSG_FLUID_CHANNEL_MOVE_FAIL, XMSG_FLUID_ERR | Records a channel failure.
+------------------------- |----------------------------------
+X_EV_TIMER                | Group command deadline. Stops and fails the channels yet to report.
+------------------------- |----------------------------------
+default                   | Ignored.
+
+  * @returns The state response.
+  **/
+STATIC XState FluidicGroupState_Active(FluidicGroup_t *me, XEvent_t const *pEv)
+{
+  XState retCode = X_RET_HANDLED;
+
+  if (NULL == pEv)
+  {
+    return X_RET_IGNORED;
+  }
+
+  switch (pEv->id)
+  {
+  case X_EV_ENTRY:
+  case X_EV_EXIT:
+    break;
+
+  case XMSG_FLUID_GROUP_CMD:
+    FluidicGroupOnCmd(me, (const FluidicGroupCmdMsg_t *)pEv);
+    break;
+
+  // Results are posted, not published, by the channels. The move fail
+  // message is constructed with XMSG_FLUID_ERR by the fluid controller.
+  case XMSG_FMOVE_CMPLT:
+  case XMSG_FLUID_MIX_COMPLETE:
+  case XMSG_FLUID_CHANNEL_MOVE_FAIL:
+  case XMSG_FLUID_ERR:
+    FluidicGroupOnChannelResult(me, pEv);
+    break;
+
+  case X_EV_TIMER:
+    FluidicGroupOnTimeout(me);
+    break;
+
+  default:
+    retCode = X_RET_IGNORED;
+    break;
+  }
+
+  return retCode;
+}
+
+
+/**
+  * @brief Starts a group command.
+  * @details Fill detection is enabled on every channel moving to a contact,
+  *          then every channel is commanded, before this returns. The
+  *          channels so start their moves together, on one fill-detect
+  *          session opened at the same sweep, and find fill detection
+  *          already enabled as they reach their moves.
+  * @param[in] me - The group object.
+  * @param[in] pCmd - The group command.
+  **/
+STATIC void FluidicGroupOnCmd(FluidicGroup_t *me, const FluidicGroupCmdMsg_t *pCmd)
+{
+  eErrorCode error;
+  uint32_t timeout_ms = pCmd->isMix ? pCmd->mix.mixTime : pCmd->move.timeout_ms;
+
+  me->startMs = FLUIDIC_TIME_NOW_MS();
+  me->isMix = pCmd->isMix;
+  me->pendingMask = 0u;
+  me->completeMsg.channelMask = 0u;
+  me->completeMsg.failedMask = 0u;
+
+  for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+  {
+    me->eTargets[i] = pCmd->eTargets[i];
+    me->completeMsg.eRestPositions[i] = BC_NONE;
+
+    if (BC_NONE != me->eTargets[i])
+    {
+      me->pendingMask |= (1u << i);
+    }
+  }
+
+  me->completeMsg.channelMask = me->pendingMask;
+
+  XTimerWheelArm(me->pTimerWheel, &(me->timer),
+                 timeout_ms + FLUIDIC_GROUP_TIMEOUT_MARGIN_MS, 0u);
+
+  // The channels monitor every contact on their way to one, as in their
+  // own moves. Moves down run with fill detection off.
+  for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+  {
+    if ((me->eTargets[i] > BC_POS_DOWN) && (me->eTargets[i] < BC_VALID_POS_COUNT))
+    {
+      // A failure is met again, and reported, by the channel's own move.
+      (void)ecSetModeFillDetect(me->pEchem, (eElectrochemicalChannel)i, EC_CHAN_POS_A);
+    }
+  }
+
+  for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+  {
+    if (BC_NONE != me->eTargets[i])
+    {
+      if (pCmd->isMix)
+      {
+        error = FluidicMixReportTo(me->pChannels[i],
+                                   &me->super,
+                                   me->eTargets[i],
+                                   pCmd->mix.mixFrequency,
+                                   pCmd->mix.mixTime,
+                                   pCmd->mix.mixCycles,
+                                   pCmd->mix.eMixType,
+                                   pCmd->mix.openLoopCompensationFactor,
+                                   pCmd->mix.mixDownstrokeProportion);
+      }
+      else
+      {
+        error = FluidicMoveReportTo(me->pChannels[i],
+                                    &me->super,
+                                    me->eTargets[i],
+                                    pCmd->move.rampSpeedVoltsPerSec,
+                                    pCmd->move.timeout_ms,
+                                    pCmd->move.eOvershootComp,
+                                    pCmd->move.overshootCompProportion,
+                                    pCmd->move.eProfile);
+      }
+
+      // Checked by the API, but the channel may have changed since.
+      if (OK_COMMAND_ACCEPTED != error)
+      {
+        ERROR_CHECK(error);
+        FluidicGroupChannelDone(me, i, BC_POS_UNKNOWN, true);
+      }
+    }
+  }
+}
+
+
+/**
+  * @brief Records the result of a channel.
+  * @param[in] me - The group object.
+  * @param[in] pEv - Move complete, mix complete or move fail event from a channel.
+  **/
+STATIC void FluidicGroupOnChannelResult(FluidicGroup_t *me, XEvent_t const *pEv)
+{
+  const FluidicMoveSuccessMsg_t *pMoveMsg;
+  const FluidicMixCompleteMsg_t *pMixMsg;
+  eFluidicPositions_t eRestPos;
+
+  for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+  {
+    if ((NULL != me->pChannels[i]) && (pEv->sender == (void *)me->pChannels[i]))
+    {
+      switch (pEv->id)
+      {
+      case XMSG_FMOVE_CMPLT:
+        pMoveMsg = (const FluidicMoveSuccessMsg_t *)pEv;
+        eRestPos = pMoveMsg->eRestPosition;
+
+        // A mix only completes with XMSG_FLUID_MIX_COMPLETE. A move
+        // complete here means the channel was cancelled or homed.
+        FluidicGroupChannelDone(me, i, eRestPos,
+                                me->isMix || (eRestPos != me->eTargets[i]));
+        break;
+
+      case XMSG_FLUID_MIX_COMPLETE:
+        pMixMsg = (const FluidicMixCompleteMsg_t *)pEv;
+        FluidicGroupChannelDone(me, i, pMixMsg->eRestPosition, false);
+        break;
+
+      default:
+        FluidicGroupChannelDone(me, i, BC_POS_UNKNOWN, true);
+        break;
+      }
+    }
+  }
+}
+
+
+/**
+  * @brief Handles the deadline of a group command.
+  * @details Channels yet to report are stopped, and marked as failed, so the
+  *          group completes. Their results once stopped are ignored. A timer
+  *          cancelled as it expired can still post, so the expiry only counts
+  *          whilst channels are pending and the timer has not been re-armed
+  *          for the next command.
+  * @param[in] me - The group object.
+  **/
+STATIC void FluidicGroupOnTimeout(FluidicGroup_t *me)
+{
+  if ((0u != me->pendingMask) && (false == XTimerWheelIsArmed(&(me->timer))))
+  {
+    for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+    {
+      if (0u != (me->pendingMask & (1u << i)))
+      {
+        (void)FluidicStop(me->pChannels[i]);
+        FluidicGroupChannelDone(me, i, BC_POS_UNKNOWN, true);
+      }
+    }
+  }
+}
+
+
+/**
+  * @brief Marks a channel as finished. Publishes the aggregate completion
+  *        once the last channel has finished.
+  * @param[in] me - The group object.
+  * @param[in] chan - The channel.
+  * @param[in] eRestPos - Where the channel finished.
+  * @param[in] failed - The channel did not complete its command.
+  **/
+STATIC void FluidicGroupChannelDone(FluidicGroup_t *me,
+                                    uint32_t chan,
+                                    eFluidicPositions_t eRestPos,
+                                    bool failed)
+{
+  uint32_t chanBit = (1u << chan);
+
+  // Ignore late results, e.g. the move back after a mix timeout.
+  if (0u != (me->pendingMask & chanBit))
+  {
+    me->pendingMask &= ~chanBit;
+    me->completeMsg.eRestPositions[chan] = eRestPos;
+
+    if (failed)
+    {
+      me->completeMsg.failedMask |= chanBit;
+    }
+
+    if (0u == me->pendingMask)
+    {
+      me->completeMsg.completionTimeMs = FLUIDIC_TIME_NOW_MS() - me->startMs;
+      XTimerWheelCancel(me->pTimerWheel, &(me->timer));
+      me->isBusy = false;
+      X_PUBLISH(X_FRAMEWORK_OF(me), me->completeMsg);
+    }
+  }
+}
+
+
+/**
+  * @brief Checks the group-level validity of a target vector.
+  * @param[in] me - The group object.
+  * @param[in] eTargets - Target of each channel.
+  * @retval OK_STATUS - Each channel can now be checked.
+  * @retval ERROR_BAD_ARGS - Nothing to do, a channel is not fitted, or a target is home.
+  **/
+STATIC eErrorCode FluidicGroupCheckTargets(const FluidicGroup_t *me,
+                                           const eFluidicPositions_t eTargets[EC_STRIP_CHAN_COUNT])
+{
+  eErrorCode error = ERROR_BAD_ARGS;
+
+  for (uint32_t i = 0u; i < (uint32_t)EC_STRIP_CHAN_COUNT; i++)
+  {
+    if (BC_NONE != eTargets[i])
+    {
+      if ((NULL == me->pChannels[i]) || (BC_POS_HOME == eTargets[i]))
+      {
+        error = ERROR_BAD_ARGS;
+        break;
+      }
+      
+      error = OK_STATUS;
+    }
+  }
+
+  return error;
+}
+
+
+/**
+  * @brief Claims the group for a new command.
+  * @details The test and set are made in one critical section, so of two
+  *          threads calling the API together only one gets the group. The
+  *          caller releases it if the command is then refused.
+  * @param[in] me - The group object.
+  * @returns True if the group was free, and is now busy.
+  **/
+STATIC bool FluidicGroupClaim(FluidicGroup_t *me)
+{
+  bool isClaimed = false;
+  uint32_t critical = XPortCriticalEnter();
+
+  if (false == me->isBusy)
+  {
+    me->isBusy = true;
+    isClaimed = true;
+  }
+
+  XPortCriticalExit(critical);
+
+  return isClaimed;
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,137 @@
+/**
+ ******************************************************************************
+ * @file   fluidicsGroup.h
+ * @brief  Header file for fluidicsGroup.c
+ ******************************************************************************
+ */
+
+
+#ifndef FLUIDICS_GROUP_H_
+#define FLUIDICS_GROUP_H_
+
+#include "poci.h"
+#include "fluidics.h"
+
+
+/**
+ * @defgroup FluidicsGroup Fluidic Channel Group
+ * @brief Commands several fluid channels as one.
+ * @details A move or mix is given a target per channel. Every channel is
+ *          commanded in the same dispatch, so all Piezo benders start
+ *          together. The group enables fill detection on every channel
+ *          moving to a contact before commanding any of them, so they share
+ *          one electrochemical fill-detect session from the same sweep,
+ *          rather than each joining it as its own thread gets to the move.
+ *          The channels report their results to the group rather than
+ *          publishing them, and the group publishes a single
+ *          XMSG_FLUID_GROUP_CMPLT once every channel has finished.
+ *
+ *          A group command has a deadline of its longest channel timeout
+ *          plus FLUIDIC_GROUP_TIMEOUT_MARGIN_MS. Channels which have not
+ *          reported by then are stopped and marked as failed, so the group
+ *          always completes.
+ *
+ *          One group command executes at a time. The API claims the group
+ *          atomically, so callers in different threads cannot both start one.
+ *  @{
+ */
+
+
+/// Time allowed past the channel timeout for a channel to report, e.g. the move back after a mix.
+#define FLUIDIC_GROUP_TIMEOUT_MARGIN_MS   5000u
+
+
+/**
+  *     @brief Group initialisation parameters.
+  **/
+typedef struct FluidicGroupInitParams_tag
+{
+  Fluidic_t                     *pChannels[EC_STRIP_CHAN_COUNT];  ///< Fluid controller of each channel, NULL if not fitted.
+  Electrochemical_t             *pEchem;                          ///< Electrochemical object the channels share.
+  XTimerWheel_t                 *pTimerWheel;                     ///< Timeout service shared by the active objects.
+  const char                    *name;                            ///< Name of the group object.
+  uint32_t                      prio;                             ///< Group object thread priority.
+}
+FluidicGroupInitParams_t;
+
+
+/**
+  *     @brief Message sent to the group to start a group command.
+  **/
+typedef struct FluidicGroupCmdMsg_tag
+{
+  XEvent_t                      super;                            ///< Base XEvent object
+  eFluidicPositions_t           eTargets[EC_STRIP_CHAN_COUNT];    ///< Target of each channel. BC_NONE if the channel is not commanded.
+  bool                          isMix;                            ///< Mix, rather than move.
+  FluidicMovePositionMsg_t      move;                             ///< Move parameters. eTargetPos is unused.
+  FluidicMixMsg_t               mix;                              ///< Mix parameters. eTargetPos is unused.
+}
+FluidicGroupCmdMsg_t;
+
+
+/**
+  *     @brief Message published once every channel of a group command has finished.
+  **/
+typedef struct FluidicGroupCompleteMsg_tag
+{
+  XEvent_t                      super;                            ///< Base XEvent object
+  uint32_t                      channelMask;                      ///< Channels which were commanded. Bit n is channel n.
+  uint32_t                      failedMask;                       ///< Channels which failed, or did not finish at their target.
+  eFluidicPositions_t           eRestPositions[EC_STRIP_CHAN_COUNT]; ///< Rest position of each channel. BC_POS_UNKNOWN on failure.
+  uint32_t                      completionTimeMs;                 ///< Time from the group command starting to the last channel finishing.
+}
+FluidicGroupCompleteMsg_t;
+
+
+/**
+  *     @brief The fluidic group object.
+  **/
+typedef struct FluidicGroup_tag
+{
+  XActive_t                     super;                            ///< Base XActive class.
+  uint32_t                      evQueueBytes[128];                ///< Event queue storage.
+
+  Fluidic_t                     *pChannels[EC_STRIP_CHAN_COUNT];  ///< Fluid controller of each channel.
+  Electrochemical_t             *pEchem;                          ///< Electrochemical object the channels share.
+  XTimerWheel_t                 *pTimerWheel;                     ///< Timeout service shared by the active objects.
+  XWheelTimer_t                 timer;                            ///< Deadline of the executing command.
+
+  volatile bool                 isBusy;                           ///< A group command has been accepted and has not yet completed.
+  uint32_t                      pendingMask;                      ///< Channels which have not yet reported.
+  eFluidicPositions_t           eTargets[EC_STRIP_CHAN_COUNT];    ///< Targets of the executing command.
+  bool                          isMix;                            ///< The executing command is a mix.
+  uint32_t                      startMs;                          ///< Time the executing command started.
+
+  FluidicGroupCmdMsg_t          cmdMsg;                           ///< Message sent to self to start a group command.
+  FluidicGroupCompleteMsg_t     completeMsg;                      ///< Message published when a group command completes.
+}
+FluidicGroup_t;
+
+
+/** @} */
+void       FluidicGroupInit(FluidicGroup_t *me,
+                            const FluidicGroupInitParams_t *pInitParams,
+                            XActiveFramework_t *pXActiveFramework);
+
+eErrorCode FluidicGroupMove(FluidicGroup_t *me,
+                            const eFluidicPositions_t eTargets[EC_STRIP_CHAN_COUNT],
+                            float rampSpeedVoltsPerSec,
+                            uint32_t timeout_ms,
+                            eFluidOvershootCompensation_t eOvershootComp,
+                            float overshootCompProportion,
+                            eFluidMoveProfile_t eProfile);
+
+eErrorCode FluidicGroupMix(FluidicGroup_t *me,
+                           const eFluidicPositions_t eTargets[EC_STRIP_CHAN_COUNT],
+                           float mixFreq,
+                           uint32_t mixTimeout,
+                           uint32_t cycles,
+                           eFluidMixingType_t eMixType,
+                           float openLoopCompensationFactor,
+                           float mixDownstrokeProportion);
+
+bool       FluidicGroupIsBusy(const FluidicGroup_t *me);
+
+#endif
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,1607 @@
+/**
+******************************************************************************
+* @file         fluidicsSim.c
+* @brief        Host-side discrete-event simulator for Fluidic objects.
+* @details      Replaces the Piezo driver, the electrochemical fill-detect
+*               interface and the XActive timer service with models that run
+*               against a virtual clock. The simulator advances the clock
+*               directly to the next timer expiry, Piezo ramp end or echem
+*               sweep, then lets the host XActive port dispatch every queued
+*               event before moving on. The shared timer wheel is advanced
+*               with the virtual clock, at a 1 ms tick.
+* @note         Only built for host simulation (FLUIDIC_HOST_SIM). The module
+*               is linked in place of piezo.c, electrochemical.c and the XActive
+*               timer port, so the Fluidic state machine itself is unchanged.
+******************************************************************************
+*/
+
+#include "fluidicsSim.h"
+
+#ifdef FLUIDIC_HOST_SIM
+
+/**
+* @addtogroup FluidicsSim
+*  @{
+*/
+
+/// The single simulator instance. Required as the stand-ins are free functions.
+static FluidicSim_t *s_pSim = NULL;
+
+STATIC FluidicSimChannel_t* FluidicSimFindByPiezo(const piezo_t *pPiezo);
+STATIC FluidicSimChannel_t* FluidicSimFindByChannel(eElectrochemicalChannel eChannel);
+STATIC FluidicSimTimer_t* FluidicSimFindTimer(const XTimer_t *pTimer);
+STATIC float FluidicSimPiezoVolts(const FluidicSimChannel_t *pChan, uint32_t atMs);
+STATIC uint32_t FluidicSimRampEndMs(const FluidicSimChannel_t *pChan);
+STATIC void FluidicSimPiezoHold(FluidicSimChannel_t *pChan, float volts);
+STATIC eEcFluidDetectPosition_t FluidicSimFluidPosition(FluidicSimChannel_t *pChan,
+                                                        float volts);
+STATIC float FluidicSimContactVolts(const FluidicSimChannel_t *pChan, uint32_t contact);
+STATIC float FluidicSimJitterDraw(FluidicSim_t *pSim, float jitterVolts);
+STATIC float FluidicSimNoiseDraw(FluidicSim_t *pSim, float noiseVolts);
+STATIC bool FluidicSimNextEvent(const FluidicSim_t *pSim, uint32_t *pNextMs);
+STATIC bool FluidicSimIsQuiescent(const FluidicSim_t *pSim);
+STATIC bool FluidicSimChannelsAtRest(const FluidicSim_t *pSim);
+STATIC void FluidicSimProcessEvents(FluidicSim_t *pSim);
+STATIC void FluidicSimSweep(FluidicSim_t *pSim);
+STATIC void FluidicSimScanSlot(FluidicSim_t *pSim);
+STATIC void FluidicSimScanContactsInit(FluidicSim_t *pSim);
+STATIC void FluidicSimContactsSample(FluidicSim_t *pSim,
+                                     const FluidicSimChannel_t *pChan,
+                                     uint16_t electrodes);
+STATIC void FluidicSimContactsClassify(FluidicSim_t *pSim);
+STATIC eEcFluidDetectPosition_t FluidicSimWetPosition(const FluidicSim_t *pSim,
+                                                      const FluidicSimChannel_t *pChan,
+                                                      eEcFluidDetectPosition_t eModelPosition);
+STATIC bool FluidicSimMixContinue(FluidicSim_t *pSim);
+STATIC void FluidicSimDispatch(FluidicSim_t *pSim);
+STATIC void FluidicSimReplayEvent(FluidicSim_t *pSim,
+                                  FluidicSimChannel_t *pChan,
+                                  const FluidicTraceRecord_t *pRecord);
+STATIC void FluidicSimReplayCommand(FluidicSim_t *pSim,
+                                    Fluidic_t *pFluidic,
+                                    const FluidicTraceRecord_t *pRecord);
+
+
+/**
+* @defgroup fSimAPI Fluidic Simulator APIs
+* @{
+**/
+
+
+/**
+* @brief  Initialises the simulator and resets virtual time to zero.
+* @param pSim The simulator.
+* @param pParams The simulator configuration.
+* @note Must be called before FluidicSimAddChannel and FluidicInit.
+**/
+void FluidicSimInit(FluidicSim_t *pSim, const FluidicSimParams_t *pParams)
+{
+  ASSERT_NOT_NULL(pSim);
+  ASSERT_NOT_NULL(pParams);
+  ASSERT_NOT_NULL(pParams->pfnRunToCompletion);
+  ASSERT_NOT_NULL(pParams->pEchem);
+
+  (void)memset(pSim, 0, sizeof(FluidicSim_t));
+
+  pSim->params = *pParams;
+  pSim->sweepPeriodMs = pParams->scanScheduled ? EC_SCAN_SLOT_MS : ECHEM_UPDATE_PERIOD_MS;
+  pSim->nextSweepMs = pSim->sweepPeriodMs;
+  pSim->jitterState = FLUIDIC_SIM_JITTER_SEED;
+
+  FluidicSimScanContactsInit(pSim);
+  pParams->pEchem->pContacts = pSim->contacts;
+  (void)ecSetSampleType(pParams->pEchem, SAMPLE_TYPE_FINGER_STICK);
+  EcScanScheduleInit(&pParams->pEchem->scanSchedule, &pParams->pEchem->contactMap);
+
+  XTimerWheelInit(&pSim->timerWheel, 1u, 0u);
+  XEventPoolInit(&pSim->eventPool,
+                 pSim->eventPoolStorage,
+                 (uint32_t)(sizeof(pSim->eventPoolStorage) / sizeof(pSim->eventPoolStorage[0])),
+                 FLUIDIC_POOL_EVENT_SIZE);
+
+  s_pSim = pSim;
+}
+
+
+/**
+* @brief  Attaches a Fluidic object to the simulator.
+* @param pSim The simulator.
+* @param pFluidic The fluid controller.
+* @param pInitParams The fluid controller's initialisation parameters. The Piezo
+*                    and echem objects are simulated.
+* @param pModel The physical model of the channel.
+* @note Must be called before FluidicInit, as the Idle state entry stops the Piezo.
+* @retval OK_STATUS The channel is simulated.
+* @retval ERROR_BAD_ARGS The channel is already simulated, or all channels are in use.
+**/
+eErrorCode FluidicSimAddChannel(FluidicSim_t *pSim,
+                                Fluidic_t *pFluidic,
+                                const FluidicInitParams_t *pInitParams,
+                                const FluidicSimChannelParams_t *pModel)
+{
+  ASSERT_NOT_NULL(pSim);
+  ASSERT_NOT_NULL(pFluidic);
+  ASSERT_NOT_NULL(pInitParams);
+  ASSERT_NOT_NULL(pModel);
+
+  eErrorCode error = ERROR_BAD_ARGS;
+  FluidicSimChannel_t *pChan;
+  uint32_t i;
+
+  if((pSim->numChannels < EC_STRIP_CHAN_COUNT) &&
+     (NULL == FluidicSimFindByChannel(pInitParams->eChannel)))
+  {
+    pChan = &pSim->channels[pSim->numChannels];
+
+    pChan->pFluidic = pFluidic;
+    pChan->pPiezo   = pInitParams->pPiezo;
+    pChan->eChannel = pInitParams->eChannel;
+    pChan->model    = *pModel;
+    pChan->eReportedPosition = FD_DATA_INVALID;
+    pChan->driftStartMs = pSim->nowMs;
+
+    for(i = 0u; i < FLUIDIC_SIM_CONTACT_COUNT; i++)
+    {
+      pChan->jitterOffsetVolts[i] = FluidicSimJitterDraw(pSim, pModel->jitterVolts);
+    }
+
+    FluidicSimPiezoHold(pChan, pChan->pPiezo->currentVoltage);
+
+    X_EV_INIT(&pChan->moveCompleteEv, XMSG_PIEZO_MOVE_COMPLTE, pChan->pPiezo);
+    X_EV_INIT(&pChan->stoppedEv, XMSG_PIEZO_STOPPED, pChan->pPiezo);
+    pChan->moveCompleteEv.chan = pChan->pPiezo->pParams->chan;
+    pChan->stoppedEv.chan = pChan->pPiezo->pParams->chan;
+
+    // All channels share one echem object, and therefore one status change event.
+    X_EV_INIT(&pSim->fdStatusChangeEv, XMSG_EC_FLUID_STATUS_CHANGED, pInitParams->pEchem);
+    X_EV_INIT(&pSim->mixContinueEv, XMSG_FLUID_MIX_CONTINUE, pInitParams->pEchem);
+
+    pSim->numChannels++;
+    error = OK_STATUS;
+  }
+
+  return error;
+}
+
+
+/**
+* @brief  Applies (or removes) sample from a simulated channel.
+* @param pSim The simulator.
+* @param eChannel The fluid channel.
+* @param sampleApplied True if fluid is present in the channel.
+**/
+void FluidicSimSetSampleApplied(FluidicSim_t *pSim,
+                                eElectrochemicalChannel eChannel,
+                                bool sampleApplied)
+{
+  ASSERT_NOT_NULL(pSim);
+
+  FluidicSimChannel_t *pChan = FluidicSimFindByChannel(eChannel);
+
+  if(NULL != pChan)
+  {
+    pChan->model.sampleApplied = sampleApplied;
+  }
+}
+
+
+/**
+* @brief  Makes a simulated channel's contacts noisy.
+* @details Models bladders whose contacts are not made at the same voltage
+*          each time. The jitter of each contact is drawn as the channel is
+*          set, and again each time the contact breaks. The drift runs from now.
+* @param pSim The simulator.
+* @param eChannel The fluid channel.
+* @param jitterVolts Largest jitter either side of a contact voltage. 0 for none.
+* @param driftVoltsPerSec Rate every contact voltage rises at. 0 for none.
+**/
+void FluidicSimSetContactNoise(FluidicSim_t *pSim,
+                               eElectrochemicalChannel eChannel,
+                               float jitterVolts,
+                               float driftVoltsPerSec)
+{
+  ASSERT_NOT_NULL(pSim);
+
+  FluidicSimChannel_t *pChan = FluidicSimFindByChannel(eChannel);
+  uint32_t i;
+
+  if(NULL != pChan)
+  {
+    pChan->model.jitterVolts = jitterVolts;
+    pChan->model.driftVoltsPerSec = driftVoltsPerSec;
+    pChan->driftStartMs = pSim->nowMs;
+
+    for(i = 0u; i < FLUIDIC_SIM_CONTACT_COUNT; i++)
+    {
+      pChan->jitterOffsetVolts[i] = FluidicSimJitterDraw(pSim, jitterVolts);
+    }
+  }
+}
+
+
+/**
+* @brief  Adds noise to every electrode sample of the sweeps.
+* @details Models a noisy echem front end. With pDetectParams, each sweep's
+*          samples go to an EcChangeDetect_t, whose states make the wet mask,
+*          rather than being held between the contact map's thresholds. The
+*          detector starts from the next sweep's samples, and whilst it runs
+*          each sweep samples every channel's electrodes, fill detection on or
+*          off, as the echem's sweep of the strip does. A scheduled scan
+*          samples one electrode a slot, so the detector is not for it.
+* @param pSim The simulator.
+* @param noiseVolts Standard deviation of the noise. 0 for none.
+* @param pDetectParams The detector configuration. NULL for the thresholds.
+**/
+void FluidicSimSetElectrodeNoise(FluidicSim_t *pSim,
+                                 float noiseVolts,
+                                 const EcChangeDetectParams_t *pDetectParams)
+{
+  ASSERT_NOT_NULL(pSim);
+  ASSERT((NULL == pDetectParams) || (false == pSim->params.scanScheduled));
+
+  pSim->electrodeNoiseVolts = noiseVolts;
+  pSim->changeDetectEnabled = (NULL != pDetectParams);
+
+  if(NULL != pDetectParams)
+  {
+    EcChangeDetectInit(&pSim->changeDetect, pDetectParams);
+  }
+}
+
+
+/**
+* @brief  Runs the simulation for a fixed period of virtual time.
+* @param pSim The simulator.
+* @param duration_ms Virtual time to simulate.
+**/
+void FluidicSimRunFor(FluidicSim_t *pSim, uint32_t duration_ms)
+{
+  ASSERT_NOT_NULL(pSim);
+
+  uint32_t endMs = pSim->nowMs + duration_ms;
+  uint32_t nextMs;
+
+  // Let the objects react to anything posted before the run started.
+  FluidicSimDispatch(pSim);
+
+  while(FluidicSimNextEvent(pSim, &nextMs) && (nextMs <= endMs))
+  {
+    pSim->nowMs = nextMs;
+    FluidicSimProcessEvents(pSim);
+  }
+
+  pSim->nowMs = endMs;
+}
+
+
+/**
+* @brief  Runs the simulation until every channel is at rest.
+* @details A channel is at rest when its Piezo is stationary and no timers are
+*          running. When autoMixContinue is set, channels waiting between mix
+*          stages are released, so a complete mix runs to its end.
+* @param pSim The simulator.
+* @param maxDuration_ms Limit on the virtual time to simulate.
+* @returns True if the channels came to rest within the limit.
+**/
+bool FluidicSimRunUntilIdle(FluidicSim_t *pSim, uint32_t maxDuration_ms)
+{
+  ASSERT_NOT_NULL(pSim);
+
+  uint32_t endMs = pSim->nowMs + maxDuration_ms;
+  uint32_t nextMs;
+  bool isIdle = false;
+
+  FluidicSimDispatch(pSim);
+
+  while((false == isIdle) && (pSim->nowMs <= endMs))
+  {
+    // A channel waiting to continue mixing is continued as soon as the
+    // channels are at rest, even if another object, e.g. a group, has a
+    // deadline armed.
+    if(FluidicSimChannelsAtRest(pSim) && FluidicSimMixContinue(pSim))
+    {
+      // The next stage is under way.
+    }
+    else if(FluidicSimIsQuiescent(pSim))
+    {
+      isIdle = true;   // Nothing left to happen.
+    }
+    else if(FluidicSimNextEvent(pSim, &nextMs) && (nextMs <= endMs))
+    {
+      pSim->nowMs = nextMs;
+      FluidicSimProcessEvents(pSim);
+    }
+    else
+    {
+      pSim->nowMs = endMs + 1u;   // Limit reached.
+    }
+  }
+
+  return isIdle;
+}
+
+
+/**
+* @brief  Replays an event trace through a fresh fluid controller, and compares
+*         the trace the replay makes with it.
+* @details Events are delivered at their recorded times, Piezo events also
+*          moving the Piezo model to their voltage. Commands are re-issued
+*          through the Fluidic API, so queued commands and events the
+*          controller posts to itself are made by the controller under test.
+*          Command results and Piezo commands are not injected, they are
+*          made by the replay and compared. Events of one millisecond are queued together before
+*          being delivered, as they are on the instrument, except that the
+*          events before a command are delivered before it is issued.
+* @param pSim The simulator, made with replayOnly set.
+* @param pTrace The trace to replay.
+* @param len Bytes of pTrace.
+* @param pDiff Where the replay's trace first differs from pTrace.
+* @note The channel of the trace must have been added, and the controller
+*       initialised with the same configuration and calibration as the one
+*       which made the trace, and with a trace buffer at least as big.
+*       Results are published, as the objects they were posted to are not
+*       part of the replay.
+* @retval OK_STATUS The trace was replayed, see pDiff.
+* @retval ERROR_BAD_ARGS Not a trace, or no traced controller of its channel is simulated.
+**/
+eErrorCode FluidicSimReplay(FluidicSim_t *pSim,
+                            const uint8_t *pTrace,
+                            uint32_t len,
+                            FluidicTraceDiff_t *pDiff)
+{
+  ASSERT_NOT_NULL(pSim);
+  ASSERT_NOT_NULL(pDiff);
+  ASSERT(pSim->params.replayOnly);
+
+  FluidicTraceReader_t reader;
+  FluidicTraceRecord_t record;
+  FluidicSimChannel_t *pChan = NULL;
+  FluidicTrace_t *pReplayTrace = NULL;
+  eFluidicTraceSource_t eLastSource = FLUIDIC_TRACE_COMMAND;
+  uint32_t startMs = pSim->nowMs;
+  eErrorCode error = FluidicTraceReaderInit(&reader, pTrace, len);
+
+  if(OK_STATUS == error)
+  {
+    pChan = FluidicSimFindByChannel((eElectrochemicalChannel)reader.channel);
+    error = ERROR_BAD_ARGS;
+
+    if((NULL != pChan) && (NULL != pChan->pFluidic->pTrace))
+    {
+      pReplayTrace = pChan->pFluidic->pTrace;
+      error = OK_STATUS;
+    }
+  }
+
+  if(OK_STATUS == error)
+  {
+    FluidicSimDispatch(pSim);
+    pSim->numReplayEvs = 0u;
+
+    while(FluidicTraceReadNext(&reader, &record))
+    {
+      if(((startMs + record.timeMs) != pSim->nowMs) ||
+         (pSim->numReplayEvs >= FLUIDIC_SIM_REPLAY_BATCH) ||
+         ((FLUIDIC_TRACE_COMMAND == record.eSource) && (FLUIDIC_TRACE_EVENT == eLastSource)))
+      {
+        FluidicSimDispatch(pSim);
+        pSim->numReplayEvs = 0u;
+        pSim->nowMs = startMs + record.timeMs;
+      }
+
+      if(FLUIDIC_TRACE_COMMAND == record.eSource)
+      {
+        FluidicSimReplayCommand(pSim, pChan->pFluidic, &record);
+        eLastSource = record.eSource;
+      }
+      else if(FLUIDIC_TRACE_EVENT == record.eSource)
+      {
+        FluidicSimReplayEvent(pSim, pChan, &record);
+        eLastSource = record.eSource;
+      }
+      else
+      {
+        // Results and Piezo commands are made by the replay, and compared.
+      }
+    }
+
+    FluidicSimDispatch(pSim);
+    pSim->numReplayEvs = 0u;
+
+    FluidicTraceCompare(pTrace, len, pReplayTrace->pBuf, pReplayTrace->len, pDiff);
+  }
+
+  return error;
+}
+
+
+/**
+* @brief  Virtual time source.
+* @returns The current virtual time, in ms.
+**/
+uint32_t FluidicSimTimeNowMs(void)
+{
+  uint32_t nowMs = 0u;
+
+  if(NULL != s_pSim)
+  {
+    nowMs = s_pSim->nowMs;
+  }
+
+  return nowMs;
+}
+
+/** @} **/
+
+
+/**
+* @defgroup fSimStandIns Fluidic Simulator Stand-ins
+* @brief Host implementations of the Piezo, echem, XTimer and XActive port interfaces.
+* @{
+**/
+
+
+/**
+* @brief  Starts a Piezo ramp from the current voltage.
+* @returns OK_COMMAND_ACCEPTED, as the Piezo driver does.
+**/
+eErrorCode piezoVoltageSet(piezo_t *pPiezo, peizoMoveParams_t *pMoveParams)
+{
+  ASSERT_NOT_NULL(pMoveParams);
+
+  FluidicSimChannel_t *pChan = FluidicSimFindByPiezo(pPiezo);
+  ASSERT_NOT_NULL(pChan);
+
+  float volts = FluidicSimPiezoVolts(pChan, s_pSim->nowMs);
+
+  pChan->rampStartVolts       = volts;
+  pChan->rampTargetVolts      = pMoveParams->targetVoltage;
+  pChan->rampSpeedVoltsPerSec = pMoveParams->rampSpeed;
+  pChan->rampStartMs          = s_pSim->nowMs;
+  pChan->isMoving             = true;
+  pChan->pWaveform            = NULL;
+
+  return OK_COMMAND_ACCEPTED;
+}
+
+
+/**
+* @brief  Starts playing a waveform from the current voltage.
+* @details Completes, publishing XMSG_PIEZO_MOVE_COMPLTE, once the whole
+*          waveform has been played, as a ramp does.
+* @returns OK_COMMAND_ACCEPTED, as the Piezo driver does.
+**/
+eErrorCode piezoWaveformPlay(piezo_t *pPiezo, const FluidicWaveform_t *pWaveform)
+{
+  ASSERT_NOT_NULL(pWaveform);
+
+  FluidicSimChannel_t *pChan = FluidicSimFindByPiezo(pPiezo);
+  ASSERT_NOT_NULL(pChan);
+
+  pChan->rampStartVolts       = FluidicSimPiezoVolts(pChan, s_pSim->nowMs);
+  pChan->rampTargetVolts      = FluidicWaveformSample(pWaveform, pWaveform->totalSamples - 1u);
+  pChan->rampSpeedVoltsPerSec = 0.f;
+  pChan->rampStartMs          = s_pSim->nowMs;
+  pChan->isMoving             = true;
+  pChan->pWaveform            = pWaveform;
+
+  return OK_COMMAND_ACCEPTED;
+}
+
+
+/**
+* @brief  Stops the Piezo where it is, and publishes XMSG_PIEZO_STOPPED.
+**/
+eErrorCode piezoStop(piezo_t *pPiezo)
+{
+  FluidicSimChannel_t *pChan = FluidicSimFindByPiezo(pPiezo);
+  ASSERT_NOT_NULL(pChan);
+
+  FluidicSimPiezoHold(pChan, FluidicSimPiezoVolts(pChan, s_pSim->nowMs));
+
+  // A replay delivers the traced event instead.
+  if(false == s_pSim->params.replayOnly)
+  {
+    pChan->stoppedEv.piezoVoltage = pPiezo->currentVoltage;
+    X_PUBLISH(s_pSim->params.pFramework, pChan->stoppedEv);
+  }
+
+  return OK_STATUS;
+}
+
+
+/**
+* @brief  Homing is instantaneous. Publishes XMSG_PIEZO_MOVE_COMPLTE.
+**/
+eErrorCode piezoHome(piezo_t *pPiezo)
+{
+  FluidicSimChannel_t *pChan = FluidicSimFindByPiezo(pPiezo);
+  ASSERT_NOT_NULL(pChan);
+
+  FluidicSimPiezoHold(pChan, PIEZO_VOLT_MAX);
+
+  if(false == s_pSim->params.replayOnly)
+  {
+    pChan->moveCompleteEv.piezoVoltage = pPiezo->currentVoltage;
+    X_PUBLISH(s_pSim->params.pFramework, pChan->moveCompleteEv);
+  }
+
+  return OK_STATUS;
+}
+
+
+/**
+* @brief  Returns the Piezo voltage at the current virtual time.
+**/
+float piezoVoltageGet(piezo_t *pPiezo)
+{
+  FluidicSimChannel_t *pChan = FluidicSimFindByPiezo(pPiezo);
+  ASSERT_NOT_NULL(pChan);
+
+  pPiezo->currentVoltage = FluidicSimPiezoVolts(pChan, s_pSim->nowMs);
+
+  return pPiezo->currentVoltage;
+}
+
+
+/**
+* @brief  Enables fill detection. The position is invalid until the next sweep.
+**/
+eErrorCode ecSetModeFillDetect(Electrochemical_t *me,
+                               eElectrochemicalChannel eChan,
+                               eElectrochemicalChannelPos  minimumPosition)
+{
+  FluidicSimChannel_t *pChan = FluidicSimFindByChannel(eChan);
+
+  if((NULL != pChan) && (false == pChan->fillDetectEnabled))
+  {
+    pChan->fillDetectEnabled = true;
+    pChan->eReportedPosition = FD_DATA_INVALID;
+
+    // The CPLD samples every electrode, enabled or not, so the contacts are current.
+    (void)FluidicSimFluidPosition(pChan, FluidicSimPiezoVolts(pChan, s_pSim->nowMs));
+    FluidicSimContactsSample(s_pSim, pChan, me->contactMap.channelMask[eChan]);
+    FluidicSimContactsClassify(s_pSim);
+  }
+
+  return OK_STATUS;
+}
+
+
+/**
+* @brief  Disables fill detection for the channel.
+**/
+eErrorCode ecDisable(Electrochemical_t *me, eElectrochemicalChannel eChan)
+{
+  FluidicSimChannel_t *pChan = FluidicSimFindByChannel(eChan);
+
+  if(NULL != pChan)
+  {
+    pChan->fillDetectEnabled = false;
+    pChan->eReportedPosition = FD_DATA_INVALID;
+  }
+
+  // The channel's electrodes go back to the background of the scan.
+  (void)ecSetScanFocus(me, eChan, EC_CHAN_POS_NONE);
+  (void)ecSetScanWatch(me, eChan, false);
+
+  return OK_STATUS;
+}
+
+
+/**
+* @brief  Changes the sample type, and recompiles the contact map for its thresholds.
+* @note   Applied straight away, where the echem applies it on the update event.
+**/
+eErrorCode ecSetSampleType(Electrochemical_t *me,
+                           ElectrochemicalSampleTypes_t eSampleType)
+{
+  eErrorCode error = ERROR_BAD_ARGS;
+
+  if(eSampleType < SAMPLE_TYPE_COUNT)
+  {
+    me->eSampleType = eSampleType;
+    EcContactMapBuild(&me->contactMap, me->pContacts, EC_SCAN_NUM_ELECTRODES, eSampleType);
+    error = OK_STATUS;
+  }
+
+  return error;
+}
+
+
+/**
+* @brief  Changes one electrode of the contact table, and recompiles the contact map.
+* @note   Applied straight away, where the echem applies it on the update event.
+*         The scan schedule picks the new map up at its next change of focus.
+**/
+eErrorCode EcUpdateContactConfig(Electrochemical_t *me,
+                                 const ElectrochemicalPin_t ePin,
+                                 const ElectrochemicalContact_t contactConfig)
+{
+  eErrorCode error = ERROR_BAD_ARGS;
+
+  if((uint32_t)ePin < EC_SCAN_NUM_ELECTRODES)
+  {
+    me->pContacts[ePin] = contactConfig;
+    EcContactMapBuild(&me->contactMap, me->pContacts, EC_SCAN_NUM_ELECTRODES, me->eSampleType);
+    error = OK_STATUS;
+  }
+
+  return error;
+}
+
+
+/**
+* @brief  Returns the fluid position found by the last sweep.
+**/
+eEcFluidDetectPosition_t ecGetFluidPosition(const Electrochemical_t *me,
+                                            eElectrochemicalChannel eChan)
+{
+  eEcFluidDetectPosition_t ePosition = FD_DATA_INVALID;
+  FluidicSimChannel_t *pChan = FluidicSimFindByChannel(eChan);
+
+  if(NULL != pChan)
+  {
+    ePosition = pChan->eReportedPosition;
+  }
+
+  return ePosition;
+}
+
+
+/**
+* @brief  Creates (or re-creates) a virtual timer.
+**/
+void XTimerCreate(XTimer_t *pTimer,
+                  XActive_t *pOwner,
+                  eXEventId sig,
+                  uint32_t period_ms,
+                  bool start)
+{
+  ASSERT_NOT_NULL(s_pSim);
+
+  FluidicSimTimer_t *pSimTimer = FluidicSimFindTimer(pTimer);
+
+  if(NULL == pSimTimer)
+  {
+    ASSERT(s_pSim->numTimers < FLUIDIC_SIM_MAX_TIMERS);
+
+    pSimTimer = &s_pSim->timers[s_pSim->numTimers];
+    s_pSim->numTimers++;
+  }
+
+  pSimTimer->pTimer    = pTimer;
+  pSimTimer->pOwner    = pOwner;
+  pSimTimer->period_ms = period_ms;
+  pSimTimer->isRunning = false;
+  X_EV_INIT(&pSimTimer->timerEv, sig, pOwner);
+
+  if(start)
+  {
+    XTimerStart(pTimer);
+  }
+}
+
+
+/**
+* @brief  Starts a virtual timer. The first expiry is one period from now.
+**/
+void XTimerStart(XTimer_t *pTimer)
+{
+  FluidicSimTimer_t *pSimTimer = FluidicSimFindTimer(pTimer);
+  ASSERT_NOT_NULL(pSimTimer);
+
+  if(false == pSimTimer->isRunning)
+  {
+    pSimTimer->isRunning = true;
+    pSimTimer->expiryMs  = s_pSim->nowMs + pSimTimer->period_ms;
+  }
+}
+
+
+/**
+* @brief  Stops a virtual timer.
+**/
+void XTimerStop(XTimer_t *pTimer)
+{
+  FluidicSimTimer_t *pSimTimer = FluidicSimFindTimer(pTimer);
+  ASSERT_NOT_NULL(pSimTimer);
+
+  pSimTimer->isRunning = false;
+}
+
+
+/**
+* @brief  Port time source, on the virtual clock.
+**/
+uint32_t XPortTimeNowMs(void)
+{
+  return FluidicSimTimeNowMs();
+}
+
+
+/**
+* @brief  Enters a critical section. The simulator runs on one thread, so
+*         there is nothing to keep out.
+**/
+uint32_t XPortCriticalEnter(void)
+{
+  return 0u;
+}
+
+
+/**
+* @brief  Leaves a critical section.
+**/
+void XPortCriticalExit(uint32_t saved)
+{
+  (void)saved;
+}
+
+
+/**
+* @brief  Orders memory accesses on the host.
+**/
+void XPortMemoryBarrier(void)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/** @} **/
+
+
+/**
+* @defgroup fSimHelpers Fluidic Simulator Helper Functions
+* @{
+**/
+
+
+/**
+* @brief  Finds the simulated channel driven by a Piezo object.
+**/
+STATIC FluidicSimChannel_t* FluidicSimFindByPiezo(const piezo_t *pPiezo)
+{
+  FluidicSimChannel_t *pFound = NULL;
+  uint32_t i;
+
+  ASSERT_NOT_NULL(s_pSim);
+
+  for(i = 0u; (i < s_pSim->numChannels) && (NULL == pFound); i++)
+  {
+    if(s_pSim->channels[i].pPiezo == pPiezo)
+    {
+      pFound = &s_pSim->channels[i];
+    }
+  }
+
+  return pFound;
+}
+
+
+/**
+* @brief  Finds the simulated channel for an electrochemical channel.
+**/
+STATIC FluidicSimChannel_t* FluidicSimFindByChannel(eElectrochemicalChannel eChannel)
+{
+  FluidicSimChannel_t *pFound = NULL;
+  uint32_t i;
+
+  ASSERT_NOT_NULL(s_pSim);
+
+  for(i = 0u; (i < s_pSim->numChannels) && (NULL == pFound); i++)
+  {
+    if(s_pSim->channels[i].eChannel == eChannel)
+    {
+      pFound = &s_pSim->channels[i];
+    }
+  }
+
+  return pFound;
+}
+
+
+/**
+* @brief  Finds the simulated timer for a framework timer.
+**/
+STATIC FluidicSimTimer_t* FluidicSimFindTimer(const XTimer_t *pTimer)
+{
+  FluidicSimTimer_t *pFound = NULL;
+  uint32_t i;
+
+  for(i = 0u; (i < s_pSim->numTimers) && (NULL == pFound); i++)
+  {
+    if(s_pSim->timers[i].pTimer == pTimer)
+    {
+      pFound = &s_pSim->timers[i];
+    }
+  }
+
+  return pFound;
+}
+
+
+/**
+* @brief  Piezo voltage at a given virtual time.
+**/
+STATIC float FluidicSimPiezoVolts(const FluidicSimChannel_t *pChan, uint32_t atMs)
+{
+  float volts = pChan->rampTargetVolts;
+  float travel;
+
+  if(pChan->isMoving && (atMs < FluidicSimRampEndMs(pChan)) && (NULL != pChan->pWaveform))
+  {
+    volts = FluidicWaveformVoltsAt(pChan->pWaveform, (atMs - pChan->rampStartMs) * 1000u);
+  }
+  else if(pChan->isMoving && (atMs < FluidicSimRampEndMs(pChan)))
+  {
+    travel = pChan->rampSpeedVoltsPerSec * (float)(atMs - pChan->rampStartMs) / 1000.f;
+
+    if(pChan->rampTargetVolts >= pChan->rampStartVolts)
+    {
+      volts = pChan->rampStartVolts + travel;
+    }
+    else
+    {
+      volts = pChan->rampStartVolts - travel;
+    }
+  }
+
+  return volts;
+}
+
+
+/**
+* @brief  Virtual time at which the current ramp reaches its target.
+**/
+STATIC uint32_t FluidicSimRampEndMs(const FluidicSimChannel_t *pChan)
+{
+  uint32_t endMs = pChan->rampStartMs;
+
+  if(NULL != pChan->pWaveform)
+  {
+    endMs += (FluidicWaveformDurationUs(pChan->pWaveform) + 999u) / 1000u;
+  }
+  else if(pChan->rampSpeedVoltsPerSec > 0.f)
+  {
+    endMs += (uint32_t)ceilf(fabsf(pChan->rampTargetVolts - pChan->rampStartVolts)
+                             * 1000.f / pChan->rampSpeedVoltsPerSec);
+  }
+
+  return endMs;
+}
+
+
+/**
+* @brief  Holds the Piezo at a fixed voltage.
+**/
+STATIC void FluidicSimPiezoHold(FluidicSimChannel_t *pChan, float volts)
+{
+  pChan->rampStartVolts  = volts;
+  pChan->rampTargetVolts = volts;
+  pChan->rampStartMs     = s_pSim->nowMs;
+  pChan->isMoving        = false;
+  pChan->pWaveform       = NULL;
+
+  pChan->pPiezo->currentVoltage = volts;
+}
+
+
+/**
+* @brief  Physical model of the fluid front.
+* @details The fluid front makes a contact once the Piezo reaches the contact's
+*          voltage, and breaks it once the Piezo falls releaseVolts below it.
+* @returns The position the fill detection would report.
+**/
+STATIC eEcFluidDetectPosition_t FluidicSimFluidPosition(FluidicSimChannel_t *pChan,
+                                                        float volts)
+{
+  static const eEcFluidDetectPosition_t contactPositions[FLUIDIC_SIM_CONTACT_COUNT + 1u] =
+  {
+    FLUID_DETECTED,
+    FLUID_POSITION_A,
+    FLUID_POSITION_B,
+    FLUID_POSITION_C,
+  };
+
+  eEcFluidDetectPosition_t ePosition;
+
+  while((pChan->contactsMade < FLUIDIC_SIM_CONTACT_COUNT) &&
+        (volts >= FluidicSimContactVolts(pChan, pChan->contactsMade)))
+  {
+    pChan->contactsMade++;
+  }
+
+  while((pChan->contactsMade > 0u) &&
+        (volts < (FluidicSimContactVolts(pChan, pChan->contactsMade - 1u) - pChan->model.releaseVolts)))
+  {
+    pChan->contactsMade--;
+    pChan->jitterOffsetVolts[pChan->contactsMade] = FluidicSimJitterDraw(s_pSim, pChan->model.jitterVolts);
+  }
+
+  if(false == pChan->model.stripInserted)
+  {
+    ePosition = NO_STRIP_DETECTED;
+  }
+  else if(false == pChan->model.sampleApplied)
+  {
+    ePosition = NO_FLUID_DETECTED;
+  }
+  else
+  {
+    ePosition = contactPositions[pChan->contactsMade];
+  }
+
+  return ePosition;
+}
+
+
+/**
+* @brief  Voltage at which the fluid front makes a contact, now.
+* @param[in] pChan - The channel.
+* @param[in] contact - The contact, 0 for A.
+* @returns The model's voltage, with its jitter and drift.
+**/
+STATIC float FluidicSimContactVolts(const FluidicSimChannel_t *pChan, uint32_t contact)
+{
+  float driftVolts = pChan->model.driftVoltsPerSec *
+                     (float)(s_pSim->nowMs - pChan->driftStartMs) / 1000.f;
+
+  return pChan->model.contactVolts[contact] + pChan->jitterOffsetVolts[contact] + driftVolts;
+}
+
+
+/**
+* @brief  Draws a contact jitter.
+* @details xorshift32, so the jitter is the same on every host.
+* @param[in] pSim - The simulator.
+* @param[in] jitterVolts - Largest jitter either side of zero.
+* @returns A jitter, uniform over +/- jitterVolts.
+**/
+STATIC float FluidicSimJitterDraw(FluidicSim_t *pSim, float jitterVolts)
+{
+  uint32_t x = pSim->jitterState;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  pSim->jitterState = x;
+
+  return jitterVolts * ((2.f * (float)(x >> 8) / (float)(1u << 24)) - 1.f);
+}
+
+
+/**
+* @brief  Draws the noise of an electrode sample.
+* @details The sum of four uniform draws, close enough to Gaussian.
+* @param pSim The simulator.
+* @param noiseVolts Standard deviation of the noise.
+* @returns The noise, in volts.
+**/
+STATIC float FluidicSimNoiseDraw(FluidicSim_t *pSim, float noiseVolts)
+{
+  float sum = 0.f;
+  uint32_t i;
+
+  for(i = 0u; i < 4u; i++)
+  {
+    sum += FluidicSimJitterDraw(pSim, 1.f);
+  }
+
+  return sum * (noiseVolts / FLUIDIC_SIM_NOISE_DRAW_SD);
+}
+
+
+/**
+* @brief  Finds the virtual time of the next discrete event.
+* @param[in] pSim - The simulator.
+* @param[out] pNextMs - The time of the next event.
+* @returns False if nothing is scheduled.
+**/
+STATIC bool FluidicSimNextEvent(const FluidicSim_t *pSim, uint32_t *pNextMs)
+{
+  bool found = false;
+  bool sweepNeeded = false;
+  uint32_t nextMs = UINT32_MAX;
+  uint32_t wheelMs;
+  uint32_t i;
+
+  for(i = 0u; i < pSim->numTimers; i++)
+  {
+    if(pSim->timers[i].isRunning)
+    {
+      nextMs = (pSim->timers[i].expiryMs < nextMs) ? pSim->timers[i].expiryMs : nextMs;
+      found = true;
+    }
+  }
+
+  if(XTimerWheelNextExpiryMs(&pSim->timerWheel, &wheelMs))
+  {
+    nextMs = (wheelMs < nextMs) ? wheelMs : nextMs;
+    found = true;
+  }
+
+  for(i = 0u; i < pSim->numChannels; i++)
+  {
+    if(pSim->channels[i].isMoving)
+    {
+      uint32_t endMs = FluidicSimRampEndMs(&pSim->channels[i]);
+      nextMs = (endMs < nextMs) ? endMs : nextMs;
+      found = true;
+    }
+
+    sweepNeeded |= pSim->channels[i].fillDetectEnabled;
+  }
+
+  if(sweepNeeded)
+  {
+    nextMs = (pSim->nextSweepMs < nextMs) ? pSim->nextSweepMs : nextMs;
+    found = true;
+  }
+
+  // Events can never be scheduled in the past.
+  *pNextMs = (nextMs < pSim->nowMs) ? pSim->nowMs : nextMs;
+
+  return found;
+}
+
+
+/**
+* @brief  Checks whether anything can still change without outside input.
+* @returns True if no timer is running and every Piezo is stationary.
+**/
+STATIC bool FluidicSimIsQuiescent(const FluidicSim_t *pSim)
+{
+  bool isQuiescent = FluidicSimChannelsAtRest(pSim);
+
+  isQuiescent &= (0u == pSim->timerWheel.numArmed);
+
+  return isQuiescent;
+}
+
+
+/**
+* @brief  Checks whether the channels can still change without outside input.
+* @returns True if no simulator timer or fluid controller timer is running and
+*          every Piezo is stationary. Timers of other objects may be.
+**/
+STATIC bool FluidicSimChannelsAtRest(const FluidicSim_t *pSim)
+{
+  bool isAtRest = true;
+  uint32_t i;
+
+  for(i = 0u; i < pSim->numTimers; i++)
+  {
+    isAtRest &= (false == pSim->timers[i].isRunning);
+  }
+
+  for(i = 0u; i < pSim->numChannels; i++)
+  {
+    isAtRest &= (false == pSim->channels[i].isMoving);
+    isAtRest &= (false == XTimerWheelIsArmed(&(pSim->channels[i].pFluidic->timer)));
+  }
+
+  return isAtRest;
+}
+
+
+/**
+* @brief  Processes every event due at the current virtual time.
+* @details Order matches the target: Piezo completions, echem sweep, then timers.
+**/
+STATIC void FluidicSimProcessEvents(FluidicSim_t *pSim)
+{
+  FluidicSimChannel_t *pChan;
+  FluidicSimTimer_t *pTimer;
+  uint32_t i;
+
+  pSim->numSteps++;
+
+  for(i = 0u; i < pSim->numChannels; i++)
+  {
+    pChan = &pSim->channels[i];
+
+    if(pChan->isMoving && (FluidicSimRampEndMs(pChan) <= pSim->nowMs))
+    {
+      FluidicSimPiezoHold(pChan, pChan->rampTargetVolts);
+
+      pChan->moveCompleteEv.piezoVoltage = pChan->rampTargetVolts;
+      X_PUBLISH(pSim->params.pFramework, pChan->moveCompleteEv);
+    }
+  }
+
+  if(pSim->nowMs >= pSim->nextSweepMs)
+  {
+    if(pSim->params.scanScheduled)
+    {
+      FluidicSimScanSlot(pSim);
+    }
+    else
+    {
+      FluidicSimSweep(pSim);
+    }
+
+    while(pSim->nextSweepMs <= pSim->nowMs)
+    {
+      pSim->nextSweepMs += pSim->sweepPeriodMs;
+    }
+  }
+
+  for(i = 0u; i < pSim->numTimers; i++)
+  {
+    pTimer = &pSim->timers[i];
+
+    if(pTimer->isRunning && (pTimer->expiryMs <= pSim->nowMs))
+    {
+      pTimer->expiryMs += pTimer->period_ms;
+      XActivePost(pTimer->pOwner, (XEvent_t const*) &(pTimer->timerEv));
+    }
+  }
+
+  XTimerWheelAdvance(&pSim->timerWheel, pSim->nowMs);
+
+  FluidicSimDispatch(pSim);
+}
+
+
+/**
+* @brief  Samples every enabled channel, as one CPLD sweep of the contacts.
+* @details Publishes XMSG_EC_FLUID_STATUS_CHANGED if any position changed.
+**/
+STATIC void FluidicSimSweep(FluidicSim_t *pSim)
+{
+  FluidicSimChannel_t *pChan;
+  eEcFluidDetectPosition_t eModelPositions[EC_STRIP_CHAN_COUNT];
+  eEcFluidDetectPosition_t ePosition;
+  eElectrochemicalChannel eChannel;
+  bool hasChanged = false;
+  uint32_t i;
+
+  for(i = 0u; i < pSim->numChannels; i++)
+  {
+    pChan = &pSim->channels[i];
+
+    if(pChan->fillDetectEnabled || pSim->changeDetectEnabled)
+    {
+      eModelPositions[i] = FluidicSimFluidPosition(pChan,
+                                                   FluidicSimPiezoVolts(pChan, pSim->nowMs));
+
+      FluidicSimContactsSample(pSim, pChan,
+                               pSim->params.pEchem->contactMap.channelMask[pChan->eChannel]);
+    }
+  }
+
+  FluidicSimContactsClassify(pSim);
+
+  for(i = 0u; i < pSim->numChannels; i++)
+  {
+    pChan = &pSim->channels[i];
+    eChannel = pChan->eChannel;
+
+    if(pChan->fillDetectEnabled)
+    {
+      ePosition = FluidicSimWetPosition(pSim, pChan, eModelPositions[i]);
+
+      if(ePosition != pChan->eReportedPosition)
+      {
+        pChan->eReportedPosition = ePosition;
+        hasChanged = true;
+      }
+    }
+
+    pSim->fdStatusChangeEv.results.fluidPositions[eChannel] = pChan->eReportedPosition;
+  }
+
+  if(hasChanged)
+  {
+    pSim->fdStatusChangeEv.sweepMs = pSim->nowMs;
+    X_PUBLISH(pSim->params.pFramework, pSim->fdStatusChangeEv);
+  }
+}
+
+
+/**
+* @brief  Samples the one electrode the scan schedule picks for this slot.
+* @details Every channel's contacts are followed by the model, but a contact is
+*          only seen by the fill detection when its electrode is sampled.
+*          Publishes XMSG_EC_FLUID_STATUS_CHANGED if any position changed.
+**/
+STATIC void FluidicSimScanSlot(FluidicSim_t *pSim)
+{
+  FluidicSimChannel_t *pChan;
+  eEcFluidDetectPosition_t eModelPositions[EC_STRIP_CHAN_COUNT];
+  eEcFluidDetectPosition_t ePosition;
+  uint16_t electrode;
+  bool hasChanged = false;
+  uint32_t i;
+
+  electrode = (uint16_t)(1u << ecScanNextElectrode(pSim->params.pEchem));
+
+  for(i = 0u; i < pSim->numChannels; i++)
+  {
+    pChan = &pSim->channels[i];
+
+    eModelPositions[i] = FluidicSimFluidPosition(pChan,
+                                                 FluidicSimPiezoVolts(pChan, pSim->nowMs));
+
+    FluidicSimContactsSample(pSim, pChan, electrode);
+  }
+
+  FluidicSimContactsClassify(pSim);
+
+  for(i = 0u; i < pSim->numChannels; i++)
+  {
+    pChan = &pSim->channels[i];
+    ePosition = FluidicSimWetPosition(pSim, pChan, eModelPositions[i]);
+
+    if(pChan->fillDetectEnabled && (ePosition != pChan->eReportedPosition))
+    {
+      pChan->eReportedPosition = ePosition;
+      hasChanged = true;
+    }
+
+    pSim->fdStatusChangeEv.results.fluidPositions[pChan->eChannel] = pChan->eReportedPosition;
+  }
+
+  if(hasChanged)
+  {
+    pSim->fdStatusChangeEv.sweepMs = pSim->nowMs;
+    X_PUBLISH(pSim->params.pFramework, pSim->fdStatusChangeEv);
+  }
+}
+
+
+/**
+* @brief  Samples a channel's electrodes, from the model.
+* @param[in] pSim - The simulator.
+* @param[in] pChan - The channel.
+* @param[in] electrodes - Electrodes sampled. Only the channel's are changed.
+**/
+STATIC void FluidicSimContactsSample(FluidicSim_t *pSim,
+                                     const FluidicSimChannel_t *pChan,
+                                     uint16_t electrodes)
+{
+  const EcContactMap_t *pMap = &pSim->params.pEchem->contactMap;
+  uint32_t position;
+  uint8_t electrode;
+
+  for(position = 0u; position < FLUIDIC_SIM_CONTACT_COUNT; position++)
+  {
+    electrode = pMap->electrodeAt[pChan->eChannel][position];
+
+    if((EC_CONTACT_MAP_NO_ELECTRODE != electrode) &&
+       (0u != (electrodes & (1u << electrode))))
+    {
+      pSim->electrodeVolts[electrode] = (pChan->contactsMade > position) ?
+                                        FLUIDIC_SIM_ELECTRODE_WET_V : FLUIDIC_SIM_ELECTRODE_DRY_V;
+
+      if(pSim->electrodeNoiseVolts > 0.f)
+      {
+        pSim->electrodeVolts[electrode] += FluidicSimNoiseDraw(pSim, pSim->electrodeNoiseVolts);
+      }
+    }
+  }
+}
+
+
+/**
+* @brief  Classifies the electrode samples against the echem's contact map.
+* @details An electrode between its thresholds keeps the state it had. With
+*          the change detector, its states are the wet mask instead.
+* @param[in] pSim - The simulator.
+**/
+STATIC void FluidicSimContactsClassify(FluidicSim_t *pSim)
+{
+  const EcContactMap_t *pMap = &pSim->params.pEchem->contactMap;
+  uint16_t contactMask;
+  uint16_t noContactMask;
+
+  if(pSim->changeDetectEnabled)
+  {
+    (void)EcChangeDetectUpdate(&pSim->changeDetect, pMap, pSim->electrodeVolts);
+    pSim->wetMask = EcChangeDetectContactMask(&pSim->changeDetect);
+  }
+  else
+  {
+    EcContactMapClassify(pMap,
+                         pSim->electrodeVolts,
+                         &contactMask,
+                         &noContactMask);
+
+    pSim->wetMask = (uint16_t)(contactMask | (pSim->wetMask & (uint16_t)~noContactMask));
+  }
+}
+
+
+/**
+* @brief  Works out a channel's fluid position from the wet mask.
+* @param[in] pSim - The simulator.
+* @param[in] pChan - The channel.
+* @param[in] eModelPosition - Position of the model, which says whether there
+*                             is a strip and sample at all.
+* @returns Without a strip or sample, the model's position. Otherwise the last
+*          of the unbroken run of wet contacts from A.
+**/
+STATIC eEcFluidDetectPosition_t FluidicSimWetPosition(const FluidicSim_t *pSim,
+                                                      const FluidicSimChannel_t *pChan,
+                                                      eEcFluidDetectPosition_t eModelPosition)
+{
+  static const eEcFluidDetectPosition_t contactPositions[FLUIDIC_SIM_CONTACT_COUNT + 1u] =
+  {
+    FLUID_DETECTED,
+    FLUID_POSITION_A,
+    FLUID_POSITION_B,
+    FLUID_POSITION_C,
+  };
+
+  eEcFluidDetectPosition_t ePosition = eModelPosition;
+
+  if(eModelPosition >= FLUID_DETECTED)
+  {
+    ePosition = contactPositions[EcContactMapWetPositions(&pSim->params.pEchem->contactMap,
+                                                          pChan->eChannel,
+                                                          pSim->wetMask)];
+  }
+
+  return ePosition;
+}
+
+
+/**
+* @brief  Builds the simulated strip, and samples every electrode dry.
+* @details Contacts A, B and C of channel 1, then channel 2, and so on. The
+*          last electrodes are the fill and strip detection contacts, and a
+*          spare, which no channel maps to. Every sample type but control
+*          solution has the same thresholds.
+**/
+STATIC void FluidicSimScanContactsInit(FluidicSim_t *pSim)
+{
+  ElectrochemicalContact_t *pContact;
+  uint32_t i;
+  uint32_t sampleType;
+
+  for(i = 0u; i < EC_SCAN_NUM_ELECTRODES; i++)
+  {
+    pContact = &pSim->contacts[i];
+    pContact->positionInChannel = EC_CHAN_POS_NONE;
+
+    if(i < (EC_STRIP_CHAN_COUNT * FLUIDIC_SIM_CONTACT_COUNT))
+    {
+      pContact->mapToChannels[i / FLUIDIC_SIM_CONTACT_COUNT] = true;
+      pContact->positionInChannel = (eElectrochemicalChannelPos)(i % FLUIDIC_SIM_CONTACT_COUNT);
+    }
+
+    for(sampleType = 0u; sampleType < SAMPLE_TYPE_COUNT; sampleType++)
+    {
+      pContact->thresholdVoltsContact[sampleType] = FLUIDIC_SIM_CONTACT_THRESHOLD_V;
+      pContact->thresholdVoltsNoContact[sampleType] = FLUIDIC_SIM_NO_CONTACT_THRESHOLD_V;
+    }
+
+    pContact->thresholdVoltsContact[SAMPLE_TYPE_CONTROL_SOLUTION] = FLUIDIC_SIM_CONTROL_CONTACT_THRESHOLD_V;
+    pContact->thresholdVoltsNoContact[SAMPLE_TYPE_CONTROL_SOLUTION] = FLUIDIC_SIM_CONTROL_NO_CONTACT_THRESHOLD_V;
+
+    pSim->electrodeVolts[i] = FLUIDIC_SIM_ELECTRODE_DRY_V;
+  }
+
+  pSim->contacts[EC_STRIP_CHAN_COUNT * FLUIDIC_SIM_CONTACT_COUNT].isFillDetectPin = true;
+  pSim->contacts[(EC_STRIP_CHAN_COUNT * FLUIDIC_SIM_CONTACT_COUNT) + 1u].isStripDetectPin = true;
+}
+
+
+/**
+* @brief  Releases channels that are waiting between mix stages.
+* @returns True if XMSG_FLUID_MIX_CONTINUE was published.
+**/
+STATIC bool FluidicSimMixContinue(FluidicSim_t *pSim)
+{
+  bool isWaiting = false;
+  FluidicSimChannel_t *pChan;
+  uint32_t i;
+
+  if(pSim->params.autoMixContinue)
+  {
+    for(i = 0u; i < pSim->numChannels; i++)
+    {
+      pChan = &pSim->channels[i];
+
+      if(pChan->pFluidic->status.mixingStagesCompleted != pChan->lastStagesCompleted)
+      {
+        pChan->lastStagesCompleted = pChan->pFluidic->status.mixingStagesCompleted;
+        isWaiting = true;
+      }
+    }
+  }
+
+  if(isWaiting)
+  {
+    X_PUBLISH(pSim->params.pFramework, pSim->mixContinueEv);
+    FluidicSimDispatch(pSim);
+  }
+
+  return isWaiting;
+}
+
+
+/**
+* @brief  Runs the host framework until every event queue is empty.
+**/
+STATIC void FluidicSimDispatch(FluidicSim_t *pSim)
+{
+  pSim->params.pfnRunToCompletion(pSim->params.pFramework);
+}
+
+
+/**
+* @brief  Queues a traced event for the controller.
+* @details Piezo events move the Piezo model to the traced voltage, and fluid
+*          status changes set the position the model reports, so the
+*          controller reads back what it did when the trace was made.
+* @param pSim The simulator.
+* @param pChan The replayed channel.
+* @param pRecord The traced event.
+**/
+STATIC void FluidicSimReplayEvent(FluidicSim_t *pSim,
+                                  FluidicSimChannel_t *pChan,
+                                  const FluidicTraceRecord_t *pRecord)
+{
+  FluidicSimReplayEv_t *pEv = &(pSim->replayEvs[pSim->numReplayEvs]);
+  eXEventId eventId = (eXEventId)pRecord->id;
+  uint32_t pos = 0u;
+
+  pSim->numReplayEvs++;
+
+  switch(eventId)
+  {
+  case XMSG_PIEZO_MOVE_COMPLTE:
+    X_EV_INIT(&(pEv->moveComplete), eventId, pChan->pPiezo);
+    pEv->moveComplete.chan = pChan->pPiezo->pParams->chan;
+    pEv->moveComplete.piezoVoltage = FluidicTraceGetF32(pRecord, &pos);
+    FluidicSimPiezoHold(pChan, pEv->moveComplete.piezoVoltage);
+    break;
+
+  case XMSG_PIEZO_STOPPED:
+    X_EV_INIT(&(pEv->stopped), eventId, pChan->pPiezo);
+    pEv->stopped.chan = pChan->pPiezo->pParams->chan;
+    pEv->stopped.piezoVoltage = FluidicTraceGetF32(pRecord, &pos);
+    FluidicSimPiezoHold(pChan, pEv->stopped.piezoVoltage);
+    break;
+
+  case XMSG_PEIZO_MOVE_FAIL:
+    X_EV_INIT(&(pEv->moveFail), eventId, pChan->pPiezo);
+    pEv->moveFail.chan = pChan->pPiezo->pParams->chan;
+    pEv->moveFail.error = (eErrorCode)FluidicTraceGetU32(pRecord, &pos);
+    break;
+
+  case XMSG_EC_FLUID_STATUS_CHANGED:
+    pEv->fdStatusChange = pSim->fdStatusChangeEv;
+    pChan->eReportedPosition = (eEcFluidDetectPosition_t)FluidicTraceGetU8(pRecord, &pos);
+    pEv->fdStatusChange.results.fluidPositions[pChan->eChannel] = pChan->eReportedPosition;
+    pEv->fdStatusChange.sweepMs = pSim->nowMs;     // Not traced. Delivered at the time it arrived.
+    break;
+
+  case XMSG_EC_ERROR:
+    X_EV_INIT(&(pEv->echemError), eventId, NULL);
+    pEv->echemError.errorCode = (eErrorCode)FluidicTraceGetU32(pRecord, &pos);
+    break;
+
+  default:
+    // Timer, door, halt, cancel, mix continue and bladder detection events
+    // carry nothing the controller reads.
+    X_EV_INIT(&(pEv->plain), eventId, NULL);
+    break;
+  }
+
+  XActivePost(&(pChan->pFluidic->super), &(pEv->plain));
+}
+
+
+/**
+* @brief  Re-issues a traced command through the Fluidic API.
+* @details A command the API refuses is missing from the replay's trace, so
+*          shows up in the comparison. Results are published.
+* @param pSim The simulator.
+* @param pFluidic The replayed controller.
+* @param pRecord The traced command.
+**/
+STATIC void FluidicSimReplayCommand(FluidicSim_t *pSim,
+                                    Fluidic_t *pFluidic,
+                                    const FluidicTraceRecord_t *pRecord)
+{
+  FluidicParams_t params;
+  eFluidicPositions_t eTarget;
+  float rampSpeed;
+  float freq;
+  float proportion;
+  float compensation;
+  uint32_t timeout_ms;
+  uint32_t cycles;
+  uint8_t option;
+  uint32_t pos = 0u;
+
+  switch((eXEventId)pRecord->id)
+  {
+  case XMSG_FLUID_CHANNEL_MOVE_TO:
+    eTarget    = (eFluidicPositions_t)FluidicTraceGetU8(pRecord, &pos);
+    rampSpeed  = FluidicTraceGetF32(pRecord, &pos);
+    timeout_ms = FluidicTraceGetU32(pRecord, &pos);
+    option     = FluidicTraceGetU8(pRecord, &pos);
+    proportion = FluidicTraceGetF32(pRecord, &pos);
+    (void)FluidicMoveReportTo(pFluidic,
+                              NULL,
+                              eTarget,
+                              rampSpeed,
+                              timeout_ms,
+                              (eFluidOvershootCompensation_t)option,
+                              proportion,
+                              (eFluidMoveProfile_t)FluidicTraceGetU8(pRecord, &pos));
+    break;
+
+  case XMSG_FLUID_LIFT_UP_BLADDER:
+    rampSpeed  = FluidicTraceGetF32(pRecord, &pos);
+    timeout_ms = FluidicTraceGetU32(pRecord, &pos);
+    (void)FluidicLiftUpBladder(pFluidic, rampSpeed, timeout_ms);
+    break;
+
+  case XMSG_FLUID_MIX:
+    eTarget      = (eFluidicPositions_t)FluidicTraceGetU8(pRecord, &pos);
+    freq         = FluidicTraceGetF32(pRecord, &pos);
+    timeout_ms   = FluidicTraceGetU32(pRecord, &pos);
+    cycles       = FluidicTraceGetU32(pRecord, &pos);
+    option       = FluidicTraceGetU8(pRecord, &pos);
+    compensation = FluidicTraceGetF32(pRecord, &pos);
+    proportion   = FluidicTraceGetF32(pRecord, &pos);
+    (void)FluidicMixReportTo(pFluidic,
+                             NULL,
+                             eTarget,
+                             freq,
+                             timeout_ms,
+                             cycles,
+                             (eFluidMixingType_t)option,
+                             compensation,
+                             proportion);
+    break;
+
+  case XMSG_FLUID_CHANNEL_CANCEL:
+    (void)FluidicStop(pFluidic);
+    break;
+
+  case XMSG_FLUID_ERR_CLEAR:
+    (void)FluidicErrorClear(pFluidic);
+    break;
+
+  case XMSG_FLUID_CHANNEL_NEW_PARAMS:
+    params = *(pFluidic->pParams);
+    params.positionLimits[BC_POS_FLUID_A].targetVolts = FluidicTraceGetF32(pRecord, &pos);
+    params.positionLimits[BC_POS_FLUID_B].targetVolts = FluidicTraceGetF32(pRecord, &pos);
+    params.positionLimits[BC_POS_FLUID_C].targetVolts = FluidicTraceGetF32(pRecord, &pos);
+    (void)FluidicParamsSet(pFluidic, &params);
+    break;
+
+  case XMSG_FLUID_ENABLE_BREACH_DETECT:
+    (void)FluidicEnableBreachMonitoring(pFluidic, (0u != FluidicTraceGetU8(pRecord, &pos)));
+    break;
+
+  case XMSG_FLUID_WAIT_FOR_CONTACT:
+    eTarget    = (eFluidicPositions_t)FluidicTraceGetU8(pRecord, &pos);
+    timeout_ms = FluidicTraceGetU32(pRecord, &pos);
+    (void)FluidicWaitForFluidAtContact(pFluidic, eTarget, timeout_ms);
+    break;
+
+  default:
+    // Posted by the controller to itself, but not through the API.
+    X_EV_INIT(&(pSim->replayEvs[pSim->numReplayEvs].plain), (eXEventId)pRecord->id, pFluidic);
+    XActivePost(&(pFluidic->super), &(pSim->replayEvs[pSim->numReplayEvs].plain));
+    pSim->numReplayEvs++;
+    break;
+  }
+}
+
+/**
+* @}
+*/
+/**
+* @}
+*/
+
+#endif /* FLUIDIC_HOST_SIM */
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,243 @@
+/**
+ ******************************************************************************
+ * @file   fluidicsSim.h
+ * @brief  Header file for fluidicsSim.c
+ ******************************************************************************
+ */
+
+
+#ifndef FLUIDICS_SIM_H_
+#define FLUIDICS_SIM_H_
+
+#include "fluidics.h"
+#include "ecScanSchedule.h"
+#include "ecChangeDetect.h"
+
+#ifdef FLUIDIC_HOST_SIM
+
+/**
+ * @defgroup FluidicsSim Fluidics Host Simulator
+ * @brief Discrete-event, virtual-time simulation of Fluidic objects on a host.
+ * @details Provides link-time stand-ins for the Piezo interface, the
+ *          electrochemical fill-detect interface, the XActive timer service
+ *          and the xPort primitives.
+ *          Virtual time jumps straight to the next timer expiry, Piezo ramp end
+ *          or echem sweep, so a 60-minute mix is replayed in milliseconds.
+ *          Each sweep reads the contacts as electrode voltages, classified
+ *          against the echem's contact map with EcContactMapClassify(), or
+ *          by an EcChangeDetect_t, see FluidicSimSetElectrodeNoise().
+ *          The host harness links this module in place of piezo.c,
+ *          electrochemical.c, the XActive timer port and xPortThreadX.c.
+ *          A simulator made with replayOnly drives a controller from an
+ *          event trace instead of the models, see FluidicSimReplay().
+ *          fluidicsSimMain.c runs the scenarios, and checks each against its
+ *          expected log in fluidicsSimExpected.
+ *  @{
+ */
+
+
+/// Number of fluid contacts (A, B, C) modelled per channel.
+#define FLUIDIC_SIM_CONTACT_COUNT      3u
+
+/// Maximum number of XTimer_t objects which can be created against the simulator.
+#define FLUIDIC_SIM_MAX_TIMERS         16u
+
+/// Maximum number of trace events a replay queues before delivering them.
+#define FLUIDIC_SIM_REPLAY_BATCH       16u
+
+/// Number of pool events shared by the simulated channels.
+#define FLUIDIC_SIM_EVENT_POOL_LEN     16u
+
+/// Default Piezo voltage at which the fluid front reaches each contact.
+/// All within reach of FLUIDIC_DEFAULT_TARGET_POSITION plus hysterisis.
+#define FLUIDIC_SIM_CONTACT_A_DEFAULT_V   30.f
+#define FLUIDIC_SIM_CONTACT_B_DEFAULT_V   42.f
+#define FLUIDIC_SIM_CONTACT_C_DEFAULT_V   54.f
+
+/// By default the fluid front leaves a contact 2V below the voltage it was made at.
+#define FLUIDIC_SIM_RELEASE_DEFAULT_V     2.f
+
+/// Electrode voltage the echem reads with fluid on the contact, and without.
+#define FLUIDIC_SIM_ELECTRODE_WET_V       0.5f
+#define FLUIDIC_SIM_ELECTRODE_DRY_V       2.5f
+
+/// Thresholds of the simulated contacts, for every other sample type.
+#define FLUIDIC_SIM_CONTACT_THRESHOLD_V     1.f
+#define FLUIDIC_SIM_NO_CONTACT_THRESHOLD_V  2.f
+
+/// Thresholds of the simulated contacts for control solution, under which a
+/// wet electrode reads as no contact.
+#define FLUIDIC_SIM_CONTROL_CONTACT_THRESHOLD_V     0.25f
+#define FLUIDIC_SIM_CONTROL_NO_CONTACT_THRESHOLD_V  0.4f
+
+/// Standard deviation of the sum of four uniform draws on +/-1, for the electrode noise.
+#define FLUIDIC_SIM_NOISE_DRAW_SD         1.1547005f
+
+/// Seed of the contact jitter, so every run of a scenario is the same.
+#define FLUIDIC_SIM_JITTER_SEED           0x2545F491u
+
+
+/**
+  *     @brief Model of a single fluid channel (strip, fluid and Piezo bender).
+  **/
+typedef struct FluidicSimChannelParams_tag
+{
+  float                         contactVolts[FLUIDIC_SIM_CONTACT_COUNT];  ///< Piezo voltage at which the fluid front makes contact A, B and C.
+  float                         releaseVolts;                             ///< The fluid front breaks a contact this many volts below the make voltage.
+  bool                          stripInserted;                            ///< A strip is present in the channel.
+  bool                          sampleApplied;                            ///< Sample has been applied to the strip.
+  float                         jitterVolts;                              ///< Each make of a contact is up to this many volts either side of contactVolts. Drawn again once the contact breaks.
+  float                         driftVoltsPerSec;                         ///< Every contact voltage drifts up at this rate.
+}
+FluidicSimChannelParams_t;
+
+
+/**
+  *     @brief Simulator configuration.
+  **/
+typedef struct FluidicSimParams_tag
+{
+  XActiveFramework_t            *pFramework;                             ///< Framework that the simulated objects publish to.
+  void                          (*pfnRunToCompletion)(XActiveFramework_t *pFramework); ///< Host port hook. Dispatches every queued event before returning.
+  bool                          autoMixContinue;                         ///< Publish XMSG_FLUID_MIX_CONTINUE once every mixing channel has finished its stage.
+  bool                          replayOnly;                              ///< Set for FluidicSimReplay(). The Piezo model publishes nothing, so every event comes from the trace.
+  bool                          scanScheduled;                           ///< Sample one electrode per EC_SCAN_SLOT_MS, as the echem scan schedule orders them, rather than every contact once per ECHEM_UPDATE_PERIOD_MS.
+  Electrochemical_t             *pEchem;                                 ///< Echem object the simulator stands in for. Given the simulated strip's contact table and map.
+}
+FluidicSimParams_t;
+
+
+/**
+  *     @brief Simulated Piezo bender and fill-detect state of one channel.
+  **/
+typedef struct FluidicSimChannel_tag
+{
+  Fluidic_t                     *pFluidic;          ///< The fluid controller under simulation.
+  piezo_t                       *pPiezo;            ///< The simulated Piezo object.
+  eElectrochemicalChannel       eChannel;           ///< Fluid channel of the controller.
+  FluidicSimChannelParams_t     model;              ///< Physical model of the channel.
+
+  float                         rampStartVolts;     ///< Piezo voltage at the start of the current ramp.
+  float                         rampTargetVolts;    ///< Piezo voltage at the end of the current ramp.
+  float                         rampSpeedVoltsPerSec; ///< Ramp rate of the current move.
+  uint32_t                      rampStartMs;        ///< Virtual time the current ramp started.
+  bool                          isMoving;           ///< The Piezo is ramping, or playing pWaveform.
+  const FluidicWaveform_t       *pWaveform;         ///< Waveform being played from rampStartMs. NULL for a ramp.
+
+  bool                          fillDetectEnabled;  ///< Fill detection has been enabled for the channel.
+  uint32_t                      contactsMade;       ///< Number of contacts the fluid front currently touches.
+  eEcFluidDetectPosition_t      eReportedPosition;  ///< Fluid position reported by the last echem sweep.
+  uint32_t                      lastStagesCompleted; ///< Mixing stages at the last mix-continue publication.
+  float                         jitterOffsetVolts[FLUIDIC_SIM_CONTACT_COUNT]; ///< Jitter of each contact until it next breaks.
+  uint32_t                      driftStartMs;       ///< Virtual time the drift started from.
+
+  PiezoMoveCompltEv_t           moveCompleteEv;     ///< Published when a ramp reaches its target.
+  PiezoStoppedEv_t              stoppedEv;          ///< Published when the Piezo is stopped.
+}
+FluidicSimChannel_t;
+
+
+/**
+  *     @brief Simulated XTimer_t.
+  **/
+typedef struct FluidicSimTimer_tag
+{
+  XTimer_t                      *pTimer;            ///< The framework timer being simulated.
+  XActive_t                     *pOwner;            ///< Object that receives the timer event.
+  XEvent_t                      timerEv;            ///< Event posted on expiry.
+  uint32_t                      period_ms;          ///< Timer period.
+  uint32_t                      expiryMs;           ///< Virtual time of the next expiry.
+  bool                          isRunning;          ///< Timer has been started.
+}
+FluidicSimTimer_t;
+
+
+/**
+  *     @brief Storage of an event injected by a replay.
+  **/
+typedef union FluidicSimReplayEv_tag
+{
+  XEvent_t                      plain;
+  PiezoMoveCompltEv_t           moveComplete;
+  PiezoStoppedEv_t              stopped;
+  PiezoMoveFailEv_t             moveFail;
+  FillDetectStatusChange_t      fdStatusChange;
+  EchemErrorMsg_t               echemError;
+}
+FluidicSimReplayEv_t;
+
+
+/**
+  *     @brief The simulator.
+  **/
+typedef struct FluidicSim_tag
+{
+  FluidicSimParams_t            params;
+
+  uint32_t                      nowMs;              ///< Virtual time.
+  uint32_t                      nextSweepMs;        ///< Virtual time of the next echem sweep.
+  uint32_t                      sweepPeriodMs;      ///< Time between echem sweeps, or between electrode samples of a scheduled scan.
+  uint32_t                      numSteps;           ///< Number of discrete events processed.
+  uint32_t                      jitterState;        ///< Random state of the contact jitter.
+
+  FluidicSimChannel_t           channels[EC_STRIP_CHAN_COUNT];
+  uint32_t                      numChannels;
+
+  FluidicSimTimer_t             timers[FLUIDIC_SIM_MAX_TIMERS];
+  uint32_t                      numTimers;
+  XTimerWheel_t                 timerWheel;         ///< Timeout service of the simulated channels. Pass to FluidicInit().
+  XEventPool_t                  eventPool;          ///< Event pool of the simulated channels. Pass to FluidicInit().
+  ElectrochemicalContact_t      contacts[EC_SCAN_NUM_ELECTRODES]; ///< Contact table of the simulated strip, pointed to by the echem. Contacts A, B and C of each channel, in channel order.
+  float                         electrodeVolts[EC_CONTACT_MAP_MAX_ELECTRODES]; ///< Voltage of each electrode when last sampled.
+  uint16_t                      wetMask;            ///< Electrodes in contact, by the echem's contact map, bit per electrode. Held whilst between thresholds.
+  float                         electrodeNoiseVolts; ///< Standard deviation of the noise on each electrode sample.
+  EcChangeDetect_t              changeDetect;       ///< Decides the wet mask in place of the thresholds, when changeDetectEnabled.
+  bool                          changeDetectEnabled;
+  uint64_t                      eventPoolStorage[X_EVENT_POOL_STORAGE_LEN(FLUIDIC_POOL_EVENT_SIZE, FLUIDIC_SIM_EVENT_POOL_LEN)];
+
+  FillDetectStatusChange_t      fdStatusChangeEv;   ///< Published when any channel's fluid position changes.
+  XEvent_t                      mixContinueEv;      ///< Published to release channels waiting between mix stages.
+
+  FluidicSimReplayEv_t          replayEvs[FLUIDIC_SIM_REPLAY_BATCH]; ///< Events injected by a replay, and not yet delivered.
+  uint32_t                      numReplayEvs;
+}
+FluidicSim_t;
+
+
+/** @} */
+void       FluidicSimInit(FluidicSim_t *pSim, const FluidicSimParams_t *pParams);
+
+eErrorCode FluidicSimAddChannel(FluidicSim_t *pSim,
+                                Fluidic_t *pFluidic,
+                                const FluidicInitParams_t *pInitParams,
+                                const FluidicSimChannelParams_t *pModel);
+
+void       FluidicSimSetSampleApplied(FluidicSim_t *pSim,
+                                      eElectrochemicalChannel eChannel,
+                                      bool sampleApplied);
+
+void       FluidicSimSetContactNoise(FluidicSim_t *pSim,
+                                      eElectrochemicalChannel eChannel,
+                                      float jitterVolts,
+                                      float driftVoltsPerSec);
+
+void       FluidicSimSetElectrodeNoise(FluidicSim_t *pSim,
+                                       float noiseVolts,
+                                       const EcChangeDetectParams_t *pDetectParams);
+
+void       FluidicSimRunFor(FluidicSim_t *pSim, uint32_t duration_ms);
+
+bool       FluidicSimRunUntilIdle(FluidicSim_t *pSim, uint32_t maxDuration_ms);
+
+eErrorCode FluidicSimReplay(FluidicSim_t *pSim,
+                            const uint8_t *pTrace,
+                            uint32_t len,
+                            FluidicTraceDiff_t *pDiff);
+
+uint32_t   FluidicSimTimeNowMs(void);
+
+#endif /* FLUIDIC_HOST_SIM */
+
+#endif
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,1807 @@
+/**
+******************************************************************************
+* @file         fluidicsSimMain.c
+* @brief        Host simulator driver. Runs the simulator scenarios, and checks
+*               them against their expected output.
+* @details      Each scenario drives the fluid controllers through the host
+*               simulator and logs what they publish, against virtual time.
+*               The log is deterministic, so the expected log of each scenario,
+*               kept in fluidicsSimExpected/<scenario>.txt, makes it a
+*               regression check:
+*
+*                 fluidicsSim                     Lists the scenarios.
+*                 fluidicsSim <scenario>          Prints the scenario's log.
+*                 fluidicsSim <scenario> <file>   Compares the log with the
+*                                                 file. Exits non-zero at the
+*                                                 first difference.
+*                 fluidicsSim --bench             Times the contact map
+*                                                 classification, vector path
+*                                                 against scalar. Not checked,
+*                                                 as the times vary.
+*
+*               Built for the host with FLUIDIC_HOST_SIM, from the sources of
+*               test-2, and test-3/fluidicsConfig.c, test-4/xTimerWheel.c,
+*               test-4/xEventPool.c, test-6/ecScanSchedule.c,
+*               test-6/ecContactMap.c, test-6/ecChangeDetect.c and
+*               test-6/ecPstatStream.c, with test-2, test-3, test-4 and test-6
+*               on the include path, and linked with the XActive framework's
+*               host port, which provides XHostRunToCompletion().
+* @note         Only built for host simulation (FLUIDIC_HOST_SIM).
+******************************************************************************
+*/
+
+#include "fluidicsSim.h"
+#include "fluidicsConfig.h"
+#include "fluidicsGroup.h"
+#include "fluidicsCal.h"
+#include "ecPstatStream.h"
+
+#ifdef FLUIDIC_HOST_SIM
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+* @addtogroup FluidicsSim
+*  @{
+*/
+
+/// Channels a scenario can use.
+#define FLUIDIC_SIM_MAIN_MAX_CHANNELS     4u
+
+/// Trace bytes kept for each channel, and for the replay.
+#define FLUIDIC_SIM_MAIN_TRACE_BYTES      65536u
+
+/// Longest line of a log.
+#define FLUIDIC_SIM_MAIN_LINE_LEN         512u
+
+/// Virtual time between drains of the telemetry, when counting mix strokes.
+#define FLUIDIC_SIM_MAIN_DRAIN_MS         500u
+
+/// Argument which runs the benchmark rather than a scenario.
+#define FLUIDIC_SIM_MAIN_BENCH_ARG        "--bench"
+
+/// Sweeps classified by the classify scenario, and by each path of the benchmark.
+#define FLUIDIC_SIM_MAIN_CLASSIFY_SWEEPS  4096u
+#define FLUIDIC_SIM_MAIN_BENCH_SWEEPS     4000000u
+
+/// Electrode noise of the change_detect scenario, and how long it holds at B.
+#define FLUIDIC_SIM_MAIN_NOISE_V          0.5f
+#define FLUIDIC_SIM_MAIN_NOISE_HOLD_MS    120000u
+
+/// Results the pstat_stream scenario produces. The slow consumer holds each
+/// block for the first hold whilst the first half is produced, then the second.
+#define FLUIDIC_SIM_MAIN_PSTAT_RESULTS    320u
+#define FLUIDIC_SIM_MAIN_PSTAT_HOLD_1     20u
+#define FLUIDIC_SIM_MAIN_PSTAT_HOLD_2     48u
+
+
+/**
+  *     @brief A scenario.
+  **/
+typedef struct FluidicSimScenario_tag
+{
+  const char                    *name;
+  uint32_t                      numChannels;            ///< Channels made, from EC_STRIP_CHAN_1.
+  bool                          autoMixContinue;        ///< As FluidicSimParams_t.
+  bool                          scanScheduled;          ///< As FluidicSimParams_t.
+  bool                          isTraced;               ///< Give each channel a trace.
+  void                          (*pfnRun)(void);
+}
+FluidicSimScenario_t;
+
+
+/**
+  *     @brief Logs the results published to, or posted to, it.
+  **/
+typedef struct FluidicSimLog_tag
+{
+  XActive_t                     super;                  ///< Base XActive class.
+  uint32_t                      evQueueBytes[256];      ///< Event queue storage.
+}
+FluidicSimLog_t;
+
+
+/// Implemented by the XActive host port. Dispatches every queued event.
+void XHostRunToCompletion(XActiveFramework_t *pFramework);
+
+STATIC XState FluidicSimLogState(FluidicSimLog_t *me, XEvent_t const *pEv);
+STATIC void FluidicSimMainSetUp(const FluidicSimScenario_t *pScenario);
+STATIC void FluidicSimMainPrint(const char *pLine, void *pCtx);
+STATIC int  FluidicSimMainCompare(FILE *pActual, FILE *pExpected);
+STATIC void FluidicSimMainMoveCells(eFluidOvershootCompensation_t eOvershootB);
+STATIC void FluidicSimMainRunCountingStrokes(uint32_t *pReached, uint32_t *pMissed);
+STATIC eErrorCode FluidicSimMainCalLoad(FluidicCalImage_t *pImage, void *pCtx);
+STATIC eErrorCode FluidicSimMainCalSave(const FluidicCalImage_t *pImage, void *pCtx);
+STATIC void FluidicSimMainCalTest(const char *pName, eFluidMoveProfile_t eProfile);
+STATIC void FluidicSimMainVoltsDraw(uint32_t *pState, float *pVolts);
+STATIC void FluidicSimMainBench(void);
+STATIC void FluidicSimScenarioMoveMix(void);
+STATIC void FluidicSimScenarioNoSample(void);
+STATIC void FluidicSimScenarioQueued(void);
+STATIC void FluidicSimScenarioOpenLoopMix(void);
+STATIC void FluidicSimScenarioBladderDetect(void);
+STATIC void FluidicSimScenarioTelemetry(void);
+STATIC void FluidicSimScenarioStats(void);
+STATIC void FluidicSimScenarioWaitAfterMove(void);
+STATIC void FluidicSimScenarioFlushReportTo(void);
+STATIC void FluidicSimScenarioWaveformMix(void);
+STATIC void FluidicSimScenarioGroup(void);
+STATIC void FluidicSimScenarioGroupTimeout(void);
+STATIC void FluidicSimScenarioReplay(void);
+STATIC void FluidicSimScenarioMixFreqAuto(void);
+STATIC void FluidicSimScenarioMixJitter(void);
+STATIC void FluidicSimScenarioCalLot(void);
+STATIC void FluidicSimScenarioFastApproach(void);
+STATIC void FluidicSimScenarioPredictiveStop(void);
+STATIC void FluidicSimScenarioConstConfig(void);
+STATIC void FluidicSimScenarioContactConfig(void);
+STATIC void FluidicSimScenarioBreachScan(void);
+STATIC void FluidicSimScenarioClassify(void);
+STATIC void FluidicSimScenarioChangeDetect(void);
+STATIC void FluidicSimScenarioPstatStream(void);
+STATIC void FluidicSimScenarioSampleType(void);
+
+
+/// Configuration of each channel, before the scenario's copy is made.
+static const FluidicConfig_t * const s_pConfigs[FLUIDIC_SIM_MAIN_MAX_CHANNELS] =
+{
+  &bladder1DefaultConfig,
+  &bladder2DefaultConfig,
+  &bladder3DefaultConfig,
+  &bladder4DefaultConfig,
+};
+
+/// The scenarios. Each has an expected log, fluidicsSimExpected/<name>.txt.
+static const FluidicSimScenario_t s_scenarios[] =
+{
+  //  name                channels  autoMix  scan   traced  run
+  { "move_mix",           2u,       true,    false, false,  FluidicSimScenarioMoveMix         },
+  { "no_sample",          2u,       true,    false, false,  FluidicSimScenarioNoSample        },
+  { "queued",             2u,       true,    false, false,  FluidicSimScenarioQueued          },
+  { "queued_scan",        2u,       true,    true,  false,  FluidicSimScenarioQueued          },
+  { "open_loop_mix",      2u,       true,    false, false,  FluidicSimScenarioOpenLoopMix     },
+  { "bladder_detect",     4u,       true,    false, false,  FluidicSimScenarioBladderDetect   },
+  { "telemetry",          2u,       true,    false, false,  FluidicSimScenarioTelemetry       },
+  { "stats",              2u,       true,    false, false,  FluidicSimScenarioStats           },
+  { "wait_after_move",    2u,       true,    false, false,  FluidicSimScenarioWaitAfterMove   },
+  { "flush_report_to",    2u,       true,    false, false,  FluidicSimScenarioFlushReportTo   },
+  { "waveform_mix",       2u,       true,    false, false,  FluidicSimScenarioWaveformMix     },
+  { "group",              4u,       true,    false, false,  FluidicSimScenarioGroup           },
+  { "group_timeout",      4u,       false,   false, false,  FluidicSimScenarioGroupTimeout    },
+  { "replay",             2u,       true,    false, true,   FluidicSimScenarioReplay          },
+  { "mix_freq_auto",      2u,       true,    false, false,  FluidicSimScenarioMixFreqAuto     },
+  { "mix_jitter",         2u,       true,    false, false,  FluidicSimScenarioMixJitter       },
+  { "cal_lot",            2u,       true,    false, false,  FluidicSimScenarioCalLot          },
+  { "fast_approach",      2u,       true,    false, false,  FluidicSimScenarioFastApproach    },
+  { "predictive_stop",    2u,       true,    false, false,  FluidicSimScenarioPredictiveStop  },
+  { "const_config",       2u,       true,    false, false,  FluidicSimScenarioConstConfig     },
+  { "contact_config",     2u,       true,    true,  false,  FluidicSimScenarioContactConfig   },
+  { "breach_scan",        2u,       true,    true,  false,  FluidicSimScenarioBreachScan      },
+  { "classify",           1u,       true,    false, false,  FluidicSimScenarioClassify        },
+  { "change_detect",      1u,       true,    false, false,  FluidicSimScenarioChangeDetect    },
+  { "pstat_stream",       1u,       true,    false, false,  FluidicSimScenarioPstatStream     },
+  { "sample_type",        1u,       true,    false, false,  FluidicSimScenarioSampleType      },
+};
+
+static FILE                     *s_pOut;
+static FluidicSim_t             s_sim;
+static XActiveFramework_t       s_framework;
+static FluidicSimLog_t          s_log;
+static Electrochemical_t        s_echem;
+static piezoParams_t            s_piezoParams[FLUIDIC_SIM_MAIN_MAX_CHANNELS];
+static piezo_t                  s_piezos[FLUIDIC_SIM_MAIN_MAX_CHANNELS];
+static FluidicParams_t          s_params[FLUIDIC_SIM_MAIN_MAX_CHANNELS];
+static FluidicStats_t           s_stats[FLUIDIC_SIM_MAIN_MAX_CHANNELS];
+static FluidicTrace_t           s_traces[FLUIDIC_SIM_MAIN_MAX_CHANNELS];
+static uint8_t                  s_traceBytes[FLUIDIC_SIM_MAIN_MAX_CHANNELS][FLUIDIC_SIM_MAIN_TRACE_BYTES];
+static Fluidic_t                s_fluidics[FLUIDIC_SIM_MAIN_MAX_CHANNELS];
+static uint32_t                 s_numChannels;
+static FluidicGroup_t           s_group;
+static const EcChangeDetectParams_t s_detectParams =          ///< Change detector of the change_detect and sample_type scenarios.
+{
+  .noiseVolts = FLUIDIC_SIM_MAIN_NOISE_V,
+  .falseTriggerRate = 1e-4f,
+};
+static FluidicCal_t             s_cal;                  ///< Shared by the channels. No lot is selected unless a scenario selects one.
+static FluidicCalImage_t        s_calStore;             ///< Stands in for the instrument's non-volatile storage.
+static bool                     s_isCalStored;
+
+
+/**
+  * @brief Runs a scenario, printing its log or checking it.
+  * @param[in] argc - 1, 2 or 3.
+  * @param[in] argv - The scenario name, then the expected log. Or --bench.
+  * @returns EXIT_SUCCESS if the scenario ran, and matched any expected log,
+  *          or if the scenarios were listed or the benchmark run.
+  **/
+int main(int argc, char *argv[])
+{
+  const FluidicSimScenario_t *pScenario = NULL;
+  FILE *pExpected = NULL;
+  int status = EXIT_FAILURE;
+
+  s_pOut = stdout;
+
+  for (uint32_t i = 0u; (argc > 1) && (i < (sizeof(s_scenarios) / sizeof(s_scenarios[0]))); i++)
+  {
+    if (0 == strcmp(argv[1], s_scenarios[i].name))
+    {
+      pScenario = &s_scenarios[i];
+    }
+  }
+
+  if (argc > 2)
+  {
+    pExpected = fopen(argv[2], "r");
+    s_pOut = tmpfile();
+  }
+
+  if ((2 == argc) && (0 == strcmp(argv[1], FLUIDIC_SIM_MAIN_BENCH_ARG)))
+  {
+    FluidicSimMainBench();
+    status = EXIT_SUCCESS;
+  }
+  else if (NULL == pScenario)
+  {
+    status = (argc > 1) ? EXIT_FAILURE : EXIT_SUCCESS;
+    (void)printf("Scenarios:\n");
+
+    for (uint32_t i = 0u; i < (sizeof(s_scenarios) / sizeof(s_scenarios[0])); i++)
+    {
+      (void)printf("  %s\n", s_scenarios[i].name);
+    }
+  }
+  else if ((NULL == s_pOut) || ((argc > 2) && (NULL == pExpected)))
+  {
+    (void)printf("%s: cannot open %s\n", pScenario->name, argv[2]);
+  }
+  else
+  {
+    FluidicSimMainSetUp(pScenario);
+    pScenario->pfnRun();
+
+    (void)fprintf(s_pOut, "virtual=%u ms steps=%u\n", s_sim.nowMs, s_sim.numSteps);
+
+    status = EXIT_SUCCESS;
+
+    if (NULL != pExpected)
+    {
+      rewind(s_pOut);
+      status = FluidicSimMainCompare(s_pOut, pExpected);
+      (void)printf("%s: %s\n", pScenario->name, (EXIT_SUCCESS == status) ? "PASS" : "FAIL");
+    }
+  }
+
+  return status;
+}
+
+
+/**
+  * @brief The only state of the log.
+  * @param me The log.
+  * @param pEv Input events to be handled.
+  * @returns The state response.
+  **/
+STATIC XState FluidicSimLogState(FluidicSimLog_t *me, XEvent_t const *pEv)
+{
+  XState retCode = X_RET_HANDLED;
+  const FluidicMoveSuccessMsg_t *pMove;
+  const FluidicMoveFailMsg_t *pFail;
+  const FluidicMixCompleteMsg_t *pMix;
+  const FluidicGroupCompleteMsg_t *pGroup;
+
+  (void)me;
+
+  if (NULL == pEv)
+  {
+    return X_RET_IGNORED;
+  }
+
+  switch (pEv->id)
+  {
+  case XMSG_FMOVE_CMPLT:
+    pMove = (const FluidicMoveSuccessMsg_t *)pEv;
+    (void)fprintf(s_pOut, "[%6u] FMOVE_CMPLT ch%u pos%u t=%u pv=%.2f\n",
+                  FluidicSimTimeNowMs(), (unsigned)pMove->eChannel, (unsigned)pMove->eRestPosition,
+                  pMove->completionTimeMs, pMove->piezoVolts);
+    break;
+
+  case XMSG_FLUID_CHANNEL_MOVE_FAIL:
+    pFail = (const FluidicMoveFailMsg_t *)pEv;
+    (void)fprintf(s_pOut, "[%6u] MOVE_FAIL ch%u pos%u\n",
+                  FluidicSimTimeNowMs(), (unsigned)pFail->eChannel, (unsigned)pFail->eTargetPosition);
+    break;
+
+  case XMSG_COMMAND_FAILED:
+    (void)fprintf(s_pOut, "[%6u] CMD_FAILED err=%d\n",
+                  FluidicSimTimeNowMs(), (int)((const XMsgCmdFail_t *)pEv)->eError);
+    break;
+
+  case XMSG_FLUID_MIX_COMPLETE:
+    pMix = (const FluidicMixCompleteMsg_t *)pEv;
+    (void)fprintf(s_pOut, "[%6u] MIX_COMPLETE pos%u f=%.3f\n",
+                  FluidicSimTimeNowMs(), (unsigned)pMix->eRestPosition, pMix->mixFrequency_Hz);
+    break;
+
+  case XMSG_FLUID_GROUP_CMPLT:
+    pGroup = (const FluidicGroupCompleteMsg_t *)pEv;
+    (void)fprintf(s_pOut, "[%6u] GROUP_CMPLT mask=%x fail=%x rest=%u,%u,%u,%u t=%u\n",
+                  FluidicSimTimeNowMs(), pGroup->channelMask, pGroup->failedMask,
+                  (unsigned)pGroup->eRestPositions[0], (unsigned)pGroup->eRestPositions[1],
+                  (unsigned)pGroup->eRestPositions[2], (unsigned)pGroup->eRestPositions[3],
+                  pGroup->completionTimeMs);
+    break;
+
+  default:
+    retCode = X_RET_IGNORED;
+    break;
+  }
+
+  return retCode;
+}
+
+
+/**
+  * @brief Makes the simulator, the log and the scenario's channels.
+  * @details Channel n makes its contacts n volts above the simulator defaults,
+  *          so the channels do not move in step.
+  * @param[in] pScenario - The scenario.
+  **/
+STATIC void FluidicSimMainSetUp(const FluidicSimScenario_t *pScenario)
+{
+  FluidicSimParams_t simParams = { &s_framework, XHostRunToCompletion, pScenario->autoMixContinue, false, pScenario->scanScheduled, &s_echem };
+  FluidicCalInitParams_t calParams = { FluidicSimMainCalLoad, FluidicSimMainCalSave, NULL };
+  FluidicSimChannelParams_t model;
+  FluidicInitParams_t initParams;
+
+  ASSERT(pScenario->numChannels <= FLUIDIC_SIM_MAIN_MAX_CHANNELS);
+
+  FluidicSimInit(&s_sim, &simParams);
+  FluidicCalInit(&s_cal, &calParams);
+
+  XActive_ctor(&s_log.super, (XStateHandler) &FluidicSimLogState);
+  XActiveStart(&s_framework,
+               &s_log.super,
+               "simLog",
+               1u,
+               s_log.evQueueBytes,
+               sizeof(s_log.evQueueBytes),
+               NULL);
+
+  X_SUBSCRIBE(&s_log, XMSG_FMOVE_CMPLT);
+  X_SUBSCRIBE(&s_log, XMSG_FLUID_CHANNEL_MOVE_FAIL);
+  X_SUBSCRIBE(&s_log, XMSG_COMMAND_FAILED);
+  X_SUBSCRIBE(&s_log, XMSG_FLUID_MIX_COMPLETE);
+  X_SUBSCRIBE(&s_log, XMSG_FLUID_GROUP_CMPLT);
+
+  s_numChannels = pScenario->numChannels;
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    s_piezoParams[i].chan = (uint8_t)i;
+    s_piezoParams[i].maxRampRate = PIEZO_RAMP_MAX;
+    s_piezos[i].pParams = &s_piezoParams[i];
+    s_piezos[i].currentVoltage = 0.f;
+
+    s_params[i] = *(s_pConfigs[i]->pParams);     // A copy, so a scenario can change it.
+
+    if (pScenario->isTraced)
+    {
+      FluidicTraceInit(&s_traces[i], s_traceBytes[i], sizeof(s_traceBytes[i]));
+    }
+
+    (void)memset(&initParams, 0, sizeof(initParams));
+    initParams.pPiezo = &s_piezos[i];
+    initParams.pEchem = &s_echem;
+    initParams.pParams = &s_params[i];
+    initParams.eChannel = (eElectrochemicalChannel)i;
+    initParams.name = "fluidic";
+    initParams.prio = 2u;
+    initParams.pCal = &s_cal;
+    initParams.pStats = &s_stats[i];
+    initParams.pTrace = pScenario->isTraced ? &s_traces[i] : NULL;
+    initParams.pTimerWheel = &s_sim.timerWheel;
+    initParams.pEventPool = &s_sim.eventPool;
+
+    (void)memset(&model, 0, sizeof(model));
+    model.contactVolts[0] = FLUIDIC_SIM_CONTACT_A_DEFAULT_V + (float)i;
+    model.contactVolts[1] = FLUIDIC_SIM_CONTACT_B_DEFAULT_V + (float)i;
+    model.contactVolts[2] = FLUIDIC_SIM_CONTACT_C_DEFAULT_V + (float)i;
+    model.releaseVolts = FLUIDIC_SIM_RELEASE_DEFAULT_V;
+    model.stripInserted = true;
+    model.sampleApplied = true;
+
+    (void)FluidicSimAddChannel(&s_sim, &s_fluidics[i], &initParams, &model);
+    FluidicInit(&s_fluidics[i], &initParams, &s_framework);
+  }
+}
+
+
+/**
+  * @brief Writes a histogram dump line to the log.
+  * @param[in] pLine - The line.
+  * @param[in] pCtx - Unused.
+  **/
+STATIC void FluidicSimMainPrint(const char *pLine, void *pCtx)
+{
+  (void)pCtx;
+  (void)fprintf(s_pOut, "%s\n", pLine);
+}
+
+
+/**
+  * @brief Compares a log with its expected log.
+  * @param[in] pActual - The log, rewound.
+  * @param[in] pExpected - The expected log.
+  * @returns EXIT_SUCCESS if they are the same. Otherwise the first difference
+  *          is printed.
+  **/
+STATIC int FluidicSimMainCompare(FILE *pActual, FILE *pExpected)
+{
+  char actual[FLUIDIC_SIM_MAIN_LINE_LEN];
+  char expected[FLUIDIC_SIM_MAIN_LINE_LEN];
+  uint32_t line = 0u;
+  bool hasActual = true;
+  bool hasExpected = true;
+  int status = EXIT_SUCCESS;
+
+  while ((EXIT_SUCCESS == status) && (hasActual || hasExpected))
+  {
+    hasActual = (NULL != fgets(actual, sizeof(actual), pActual));
+    hasExpected = (NULL != fgets(expected, sizeof(expected), pExpected));
+    line++;
+
+    if ((hasActual != hasExpected) ||
+        (hasActual && (0 != strcmp(actual, expected))))
+    {
+      (void)printf("line %u:\n  expected: %s  actual:   %s", line,
+                   hasExpected ? expected : "(end)\n",
+                   hasActual ? actual : "(end)\n");
+      status = EXIT_FAILURE;
+    }
+  }
+
+  return status;
+}
+
+
+/**
+  * @brief Homes every channel, then moves each down and on to A and B.
+  * @param[in] eOvershootB - Overshoot compensation of the move to B.
+  **/
+STATIC void FluidicSimMainMoveCells(eFluidOvershootCompensation_t eOvershootB)
+{
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicMove(&s_fluidics[i], BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicMove(&s_fluidics[i], BC_POS_FLUID_B, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, eOvershootB, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 100000u);
+}
+
+
+/**
+  * @brief Runs until the channels are idle, counting the mix strokes of each
+  *        channel from its telemetry.
+  * @details The telemetry is drained every FLUIDIC_SIM_MAIN_DRAIN_MS, well
+  *          before its ring can fill.
+  * @param[out] pReached - Strokes which made their contact, per channel. Added to.
+  * @param[out] pMissed - Strokes which missed, per channel. Added to.
+  **/
+STATIC void FluidicSimMainRunCountingStrokes(uint32_t *pReached, uint32_t *pMissed)
+{
+  static FluidicTelemetryRecord_t records[FLUIDIC_TELEMETRY_LEN];
+  uint32_t numRecords;
+  bool isIdle = false;
+
+  while (false == isIdle)
+  {
+    isIdle = FluidicSimRunUntilIdle(&s_sim, FLUIDIC_SIM_MAIN_DRAIN_MS);
+
+    for (uint32_t i = 0u; i < s_numChannels; i++)
+    {
+      numRecords = FluidicTelemetryDrain(&s_fluidics[i].telemetry, records, FLUIDIC_TELEMETRY_LEN);
+
+      for (uint32_t k = 0u; k < numRecords; k++)
+      {
+        if ((FLUIDIC_TELEMETRY_MIX_STROKE == records[k].eKind) &&
+            (FLUIDIC_TELEMETRY_REACHED == records[k].eOutcome))
+        {
+          pReached[i]++;
+        }
+        else if ((FLUIDIC_TELEMETRY_MIX_STROKE == records[k].eKind) &&
+                 (FLUIDIC_TELEMETRY_MISSED == records[k].eOutcome))
+        {
+          pMissed[i]++;
+        }
+        else
+        {
+          // Moves, and strokes cut short, are not counted.
+        }
+      }
+    }
+  }
+}
+
+
+/**
+  * @brief Calibration load hook. Reads the image from s_calStore.
+  * @param[out] pImage - The image read.
+  * @param[in] pCtx - Unused.
+  * @returns OK_STATUS if an image has been saved.
+  **/
+STATIC eErrorCode FluidicSimMainCalLoad(FluidicCalImage_t *pImage, void *pCtx)
+{
+  eErrorCode error = ERROR_OBJECT_NOT_READY;
+
+  (void)pCtx;
+
+  if (s_isCalStored)
+  {
+    *pImage = s_calStore;
+    error = OK_STATUS;
+  }
+
+  return error;
+}
+
+
+/**
+  * @brief Calibration save hook. Writes the image to s_calStore.
+  * @param[in] pImage - The image.
+  * @param[in] pCtx - Unused.
+  * @returns OK_STATUS
+  **/
+STATIC eErrorCode FluidicSimMainCalSave(const FluidicCalImage_t *pImage, void *pCtx)
+{
+  (void)pCtx;
+
+  s_calStore = *pImage;
+  s_isCalStored = true;
+
+  return OK_STATUS;
+}
+
+
+/**
+  * @brief One test of the cal_lot scenario. Homes every channel, logs the
+  *        contact voltages each was seeded with, then moves each down and on
+  *        to A, B and C, and logs how long the moves took.
+  * @param[in] pName - Name of the test in the log.
+  * @param[in] eProfile - Speed profile of the moves to the contacts.
+  **/
+STATIC void FluidicSimMainCalTest(const char *pName, eFluidMoveProfile_t eProfile)
+{
+  const Fluidic_t *pFl;
+  uint32_t startMs;
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    pFl = &s_fluidics[i];
+    (void)fprintf(s_pOut, "%s ch%u seeded=%d A=%.2f B=%.2f C=%.2f\n", pName, i,
+                  (int)pFl->isContactVoltsKnown[BC_POS_FLUID_A],
+                  pFl->run.positions[BC_POS_FLUID_A].targetVolts,
+                  pFl->run.positions[BC_POS_FLUID_B].targetVolts,
+                  pFl->run.positions[BC_POS_FLUID_C].targetVolts);
+  }
+
+  startMs = FluidicSimTimeNowMs();
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    for (uint32_t pos = BC_POS_FLUID_A; pos <= BC_POS_FLUID_C; pos++)
+    {
+      (void)FluidicMoveReportTo(&s_fluidics[i], NULL, (eFluidicPositions_t)pos, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u,
+                                FLUID_OVERSHOOT_COMP_NONE, 0.f, eProfile);
+    }
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 200000u);
+
+  (void)fprintf(s_pOut, "%s dt=%u\n", pName, FluidicSimTimeNowMs() - startMs);
+}
+
+
+/**
+  * @brief Draws a sweep of electrode voltages, from 0 to 3V. One lane in
+  *        eight is set exactly on a simulated threshold, to check the
+  *        comparisons are strict in every path.
+  * @param[in,out] pState - State of the draw. Not zero.
+  * @param[out] pVolts - EC_CONTACT_MAP_MAX_ELECTRODES voltages.
+  **/
+STATIC void FluidicSimMainVoltsDraw(uint32_t *pState, float *pVolts)
+{
+  uint32_t x = *pState;
+
+  for (uint32_t i = 0u; i < EC_CONTACT_MAP_MAX_ELECTRODES; i++)
+  {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    if (0u == (x & 0x700u))
+    {
+      pVolts[i] = (0u != (x & 0x800u)) ? FLUIDIC_SIM_CONTACT_THRESHOLD_V : FLUIDIC_SIM_NO_CONTACT_THRESHOLD_V;
+    }
+    else
+    {
+      pVolts[i] = 3.f * (float)(x >> 8) / (float)(1u << 24);
+    }
+  }
+
+  *pState = x;
+}
+
+
+/**
+  * @brief Times EcContactMapClassify(), and EcContactMapClassifyScalar(),
+  *        over the same sweeps, against the simulated strip's contact map.
+  **/
+STATIC void FluidicSimMainBench(void)
+{
+  static float volts[64][EC_CONTACT_MAP_MAX_ELECTRODES];
+
+  const EcContactMap_t *pMap;
+  FluidicSimParams_t simParams = { &s_framework, XHostRunToCompletion, false, false, false, &s_echem };
+  uint32_t state = FLUIDIC_SIM_JITTER_SEED;
+  uint32_t sink = 0u;
+  uint32_t contact32;
+  uint32_t noContact32;
+  uint16_t contact;
+  uint16_t noContact;
+  clock_t start;
+  double vectorNs;
+  double scalarNs;
+
+  FluidicSimInit(&s_sim, &simParams);
+  pMap = &s_echem.contactMap;
+
+  for (uint32_t k = 0u; k < 64u; k++)
+  {
+    FluidicSimMainVoltsDraw(&state, volts[k]);
+  }
+
+  start = clock();
+  for (uint32_t n = 0u; n < FLUIDIC_SIM_MAIN_BENCH_SWEEPS; n++)
+  {
+    EcContactMapClassify(pMap, volts[n & 63u], &contact, &noContact);
+    sink += (uint32_t)contact ^ noContact;
+  }
+  vectorNs = 1e9 * (double)(clock() - start) / (double)CLOCKS_PER_SEC / (double)FLUIDIC_SIM_MAIN_BENCH_SWEEPS;
+
+  start = clock();
+  for (uint32_t n = 0u; n < FLUIDIC_SIM_MAIN_BENCH_SWEEPS; n++)
+  {
+    EcContactMapClassifyScalar(pMap, volts[n & 63u], &contact32, &noContact32);
+    sink -= (contact32 ^ noContact32) & pMap->electrodeMask;
+  }
+  scalarNs = 1e9 * (double)(clock() - start) / (double)CLOCKS_PER_SEC / (double)FLUIDIC_SIM_MAIN_BENCH_SWEEPS;
+
+  (void)printf("classify, %u sweeps of %u electrodes: %.2f ns per sweep, scalar %.2f ns (x%.1f)%s\n",
+               FLUIDIC_SIM_MAIN_BENCH_SWEEPS, EC_CONTACT_MAP_MAX_ELECTRODES, vectorNs, scalarNs,
+               (vectorNs > 0.) ? (scalarNs / vectorNs) : 0.,
+               (0u == sink) ? "" : " MISMATCH");
+}
+
+
+/**
+  * @brief Moves one channel through every position, then mixes it dual point
+  *        and open loop.
+  **/
+STATIC void FluidicSimScenarioMoveMix(void)
+{
+  Fluidic_t *pFl = &s_fluidics[0];
+  eErrorCode e;
+  bool isIdle;
+
+  e = FluidicMove(pFl, BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "home %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicMove(pFl, BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "down %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicMove(pFl, BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "A %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicMove(pFl, BC_POS_FLUID_C, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "C %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicMix(pFl, BC_POS_FLUID_B, 1.f, 3600000u, 100u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+  (void)fprintf(s_pOut, "mix %d\n", (int)e);
+  isIdle = FluidicSimRunUntilIdle(&s_sim, 4000000u);
+  (void)fprintf(s_pOut, "idle=%d\n", (int)isIdle);
+
+  e = FluidicMix(pFl, BC_POS_FLUID_B, 1.f, 3600000u, 10u, FLUID_MIX_OPEN_LOOP, 0.f, 0.5f);
+  (void)fprintf(s_pOut, "mix %d\n", (int)e);
+  isIdle = FluidicSimRunUntilIdle(&s_sim, 4000000u);
+  (void)fprintf(s_pOut, "idle=%d\n", (int)isIdle);
+}
+
+
+/**
+  * @brief A move with no sample on the strip, then a move which times out.
+  **/
+STATIC void FluidicSimScenarioNoSample(void)
+{
+  Fluidic_t *pFl = &s_fluidics[0];
+
+  (void)FluidicMove(pFl, BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  (void)FluidicMove(pFl, BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  FluidicSimSetSampleApplied(&s_sim, EC_STRIP_CHAN_1, false);
+  (void)fprintf(s_pOut, "A nosample %d\n",
+                (int)FluidicMove(pFl, BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f));
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  FluidicSimSetSampleApplied(&s_sim, EC_STRIP_CHAN_1, true);
+  (void)fprintf(s_pOut, "A short timeout %d\n",
+                (int)FluidicMove(pFl, BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 2000u, FLUID_OVERSHOOT_COMP_NONE, 0.f));
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+}
+
+
+/**
+  * @brief Commands queued behind each other, an invalid mix, a full queue,
+  *        and a home which cancels a queued move.
+  **/
+STATIC void FluidicSimScenarioQueued(void)
+{
+  Fluidic_t *pFl = &s_fluidics[0];
+  eErrorCode e;
+  bool isIdle;
+
+  e = FluidicMove(pFl, BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "home %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicMove(pFl, BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "down %d\n", (int)e);
+  e = FluidicMove(pFl, BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "A %d\n", (int)e);
+  e = FluidicMove(pFl, BC_POS_FLUID_C, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "C %d\n", (int)e);
+  e = FluidicMix(pFl, BC_POS_FLUID_B, 1.f, 3600000u, 5u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+  (void)fprintf(s_pOut, "mix %d\n", (int)e);
+  e = FluidicMix(pFl, BC_POS_FLUID_C, 1.f, 3600000u, 5u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+  (void)fprintf(s_pOut, "badmix %d\n", (int)e);
+  e = FluidicMove(pFl, BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "full %d\n", (int)e);
+  isIdle = FluidicSimRunUntilIdle(&s_sim, 4000000u);
+  (void)fprintf(s_pOut, "idle=%d\n", (int)isIdle);
+
+  e = FluidicMove(pFl, BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "A %d\n", (int)e);
+  e = FluidicMove(pFl, BC_POS_FLUID_B, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "B %d\n", (int)e);
+  FluidicSimRunFor(&s_sim, 50u);
+
+  e = FluidicMove(pFl, BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "home %d\n", (int)e);
+  isIdle = FluidicSimRunUntilIdle(&s_sim, 60000u);
+  (void)fprintf(s_pOut, "idle=%d\n", (int)isIdle);
+}
+
+
+/**
+  * @brief A 50 cycle open loop mix on every channel at once.
+  **/
+STATIC void FluidicSimScenarioOpenLoopMix(void)
+{
+  uint32_t startMs;
+  eErrorCode e;
+  bool isIdle;
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicMove(&s_fluidics[i], BC_POS_FLUID_C, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 100000u);
+
+  startMs = FluidicSimTimeNowMs();
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    e = FluidicMix(&s_fluidics[i], BC_POS_FLUID_B, 2.f, 3600000u, 50u, FLUID_MIX_OPEN_LOOP, 0.02f, 0.5f);
+    (void)fprintf(s_pOut, "mix %d\n", (int)e);
+  }
+
+  isIdle = FluidicSimRunUntilIdle(&s_sim, 4000000u);
+  (void)fprintf(s_pOut, "idle=%d dt=%u\n", (int)isIdle, FluidicSimTimeNowMs() - startMs);
+}
+
+
+/**
+  * @brief Moves down, with bladder detection reporting out of step between
+  *        the channels.
+  **/
+STATIC void FluidicSimScenarioBladderDetect(void)
+{
+  static XEvent_t up1;
+  static XEvent_t down2;
+  static XEvent_t down3;
+
+  X_EV_INIT(&up1, XMSG_EC_A1_BLDR_UP, NULL);
+  X_EV_INIT(&down2, XMSG_EC_B2_BLDR_DOWN, NULL);
+  X_EV_INIT(&down3, XMSG_EC_A3_BLDR_DOWN, NULL);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_DOWN, 10.f, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  FluidicSimRunFor(&s_sim, 2000u);
+
+  X_PUBLISH(&s_framework, up1);
+  X_PUBLISH(&s_framework, down2);
+  FluidicSimRunFor(&s_sim, 2000u);
+  X_PUBLISH(&s_framework, down3);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)fprintf(s_pOut, "ch%u down=%.2f\n", i, s_fluidics[i].run.positions[BC_POS_DOWN].targetVolts);
+  }
+}
+
+
+/**
+  * @brief Moves and mixes, then drains the telemetry records of each channel.
+  **/
+STATIC void FluidicSimScenarioTelemetry(void)
+{
+  static FluidicTelemetryRecord_t records[64];
+  const FluidicTelemetryRecord_t *pRec;
+  uint32_t numRecords;
+  eErrorCode e;
+
+  FluidicSimMainMoveCells(FLUID_OVERSHOOT_COMP_CONTACT);
+
+  e = FluidicMix(&s_fluidics[0], BC_POS_FLUID_A, 1.f, 3600000u, 2u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+  (void)fprintf(s_pOut, "mix %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 400000u);
+
+  e = FluidicMix(&s_fluidics[0], BC_POS_FLUID_A, 2.f, 3600000u, 2u, FLUID_MIX_OPEN_LOOP, 0.02f, 0.5f);
+  (void)fprintf(s_pOut, "mix %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 400000u);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    numRecords = FluidicTelemetryDrain(&s_fluidics[i].telemetry, records, 64u);
+    (void)fprintf(s_pOut, "ch%u n=%u dropped=%u\n", i, numRecords, FluidicTelemetryDropped(&s_fluidics[i].telemetry));
+
+    for (uint32_t k = 0u; k < numRecords; k++)
+    {
+      pRec = &records[k];
+      (void)fprintf(s_pOut, " #%u k=%d out=%d err=%d tgt=%d rest=%d fr=%d t=%u..%u (%u) V %.2f->%.2f hy=%.2f rt=%u fc=%u [%u %u %u %u]\n",
+                    pRec->seq, (int)pRec->eKind, (int)pRec->eOutcome, (int)pRec->error,
+                    (int)pRec->eTargetPos, (int)pRec->eRestPos, (int)pRec->eFrontPos,
+                    pRec->startMs, pRec->stopMs, pRec->stopMs - pRec->startMs,
+                    pRec->startVolts, pRec->endVolts, pRec->hysterisisVolts,
+                    (unsigned)pRec->retries, (unsigned)pRec->numFrontChanges,
+                    (unsigned)pRec->frontChangeMs[0], (unsigned)pRec->frontChangeMs[1],
+                    (unsigned)pRec->frontChangeMs[2], (unsigned)pRec->frontChangeMs[3]);
+    }
+
+    (void)fprintf(s_pOut, "again=%u\n", FluidicTelemetryDrain(&s_fluidics[i].telemetry, records, 64u));
+  }
+}
+
+
+/**
+  * @brief Three rounds of moves and mixes, then dumps the latency histograms,
+  *        resetting channel 0's.
+  **/
+STATIC void FluidicSimScenarioStats(void)
+{
+  eErrorCode e;
+
+  for (uint32_t run = 0u; run < 3u; run++)
+  {
+    FluidicSimMainMoveCells(FLUID_OVERSHOOT_COMP_NONE);
+
+    (void)FluidicMix(&s_fluidics[0], BC_POS_FLUID_A, 1.f, 3600000u, 5u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+    (void)FluidicSimRunUntilIdle(&s_sim, 400000u);
+    (void)FluidicMix(&s_fluidics[0], BC_POS_FLUID_A, 2.f, 3600000u, 5u, FLUID_MIX_OPEN_LOOP, 0.02f, 0.5f);
+    (void)FluidicSimRunUntilIdle(&s_sim, 400000u);
+  }
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    e = FluidicStatsDumpRequest(&s_fluidics[i], FluidicSimMainPrint, NULL, (0u == i));
+    (void)fprintf(s_pOut, "dump %d\n", (int)e);
+  }
+  FluidicSimRunFor(&s_sim, 100u);
+
+  (void)FluidicStatsDumpRequest(&s_fluidics[0], FluidicSimMainPrint, NULL, false);
+  FluidicSimRunFor(&s_sim, 100u);
+}
+
+
+/**
+  * @brief A wait for contact requested straight after a queued move, before
+  *        the controller has run. The move completes, and the wait then runs.
+  **/
+STATIC void FluidicSimScenarioWaitAfterMove(void)
+{
+  Fluidic_t *pFl = &s_fluidics[0];
+  eErrorCode e;
+
+  (void)FluidicMove(pFl, BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  (void)FluidicMove(pFl, BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicMove(pFl, BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "A %d\n", (int)e);
+  e = FluidicWaitForFluidAtContact(pFl, BC_POS_FLUID_B, 1000u);
+  (void)fprintf(s_pOut, "wait %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  (void)fprintf(s_pOut, "pending=%d head=%u tail=%u lastpos=%d\n",
+                (int)pFl->cmdDispatchPending, pFl->cmdQueue.head, pFl->cmdQueue.tail, (int)pFl->eLastKnownPos);
+
+  e = FluidicMove(pFl, BC_POS_FLUID_B, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)fprintf(s_pOut, "B %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  (void)fprintf(s_pOut, "pending=%d head=%u tail=%u lastpos=%d\n",
+                (int)pFl->cmdDispatchPending, pFl->cmdQueue.head, pFl->cmdQueue.tail, (int)pFl->eLastKnownPos);
+}
+
+
+/**
+  * @brief Two moves queued to report to the log, flushed by a stop. Each is
+  *        answered with a move fail.
+  **/
+STATIC void FluidicSimScenarioFlushReportTo(void)
+{
+  Fluidic_t *pFl = &s_fluidics[0];
+  eErrorCode e;
+
+  (void)FluidicMove(pFl, BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  (void)FluidicMove(pFl, BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  (void)FluidicMove(pFl, BC_POS_FLUID_A, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  e = FluidicMoveReportTo(pFl, &s_log.super, BC_POS_FLUID_B, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u,
+                          FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "B %d\n", (int)e);
+  e = FluidicMoveReportTo(pFl, &s_log.super, BC_POS_FLUID_C, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u,
+                          FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "C %d\n", (int)e);
+
+  FluidicSimRunFor(&s_sim, 3000u);
+  (void)FluidicStop(pFl);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+}
+
+
+/**
+  * @brief As move_mix, with the open loop mix played as a sine waveform.
+  **/
+STATIC void FluidicSimScenarioWaveformMix(void)
+{
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    s_params[i].eMixWaveform = FLUIDIC_WAVEFORM_SINE;
+  }
+
+  FluidicSimScenarioMoveMix();
+}
+
+
+/**
+  * @brief Group moves and a group mix, a busy group, and a refused home.
+  **/
+STATIC void FluidicSimScenarioGroup(void)
+{
+  static const eFluidicPositions_t downTargets[EC_STRIP_CHAN_COUNT] = { BC_POS_DOWN, BC_POS_DOWN, BC_POS_DOWN, BC_POS_DOWN };
+  static const eFluidicPositions_t moveTargets[EC_STRIP_CHAN_COUNT] = { BC_POS_FLUID_A, BC_POS_FLUID_C, BC_NONE, BC_POS_FLUID_B };
+  static const eFluidicPositions_t mixTargets[EC_STRIP_CHAN_COUNT]  = { BC_NONE, BC_POS_FLUID_B, BC_NONE, BC_POS_FLUID_A };
+  static const eFluidicPositions_t homeTargets[EC_STRIP_CHAN_COUNT] = { BC_POS_FLUID_A, BC_NONE, BC_NONE, BC_POS_HOME };
+
+  FluidicGroupInitParams_t groupParams;
+  eErrorCode e;
+
+  (void)memset(&groupParams, 0, sizeof(groupParams));
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    groupParams.pChannels[i] = &s_fluidics[i];
+  }
+  groupParams.pEchem = &s_echem;
+  groupParams.pTimerWheel = &s_sim.timerWheel;
+  groupParams.name = "fluidicGroup";
+  groupParams.prio = 3u;
+  FluidicGroupInit(&s_group, &groupParams, &s_framework);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicGroupMove(&s_group, downTargets, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u,
+                       FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "group down %d\n", (int)e);
+  e = FluidicGroupMove(&s_group, downTargets, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u,
+                       FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "group busy %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicGroupMove(&s_group, moveTargets, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u,
+                       FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "group move %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicGroupMix(&s_group, mixTargets, 1.f, 3600000u, 5u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+  (void)fprintf(s_pOut, "group mix %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 600000u);
+
+  e = FluidicGroupMove(&s_group, homeTargets, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u,
+                       FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "group home %d\n", (int)e);
+}
+
+
+/**
+  * @brief A group mix whose channels wait between stages for a continue which
+  *        never comes. The group deadline stops them, the group completes, and
+  *        it takes the next command.
+  **/
+STATIC void FluidicSimScenarioGroupTimeout(void)
+{
+  static const eFluidicPositions_t downTargets[EC_STRIP_CHAN_COUNT] = { BC_POS_DOWN, BC_POS_DOWN, BC_POS_DOWN, BC_POS_DOWN };
+  static const eFluidicPositions_t moveTargets[EC_STRIP_CHAN_COUNT] = { BC_POS_FLUID_A, BC_POS_FLUID_C, BC_NONE, BC_POS_FLUID_B };
+  static const eFluidicPositions_t mixTargets[EC_STRIP_CHAN_COUNT] = { BC_NONE, BC_POS_FLUID_B, BC_NONE, BC_POS_FLUID_A };
+
+  FluidicGroupInitParams_t groupParams;
+  eErrorCode e;
+
+  (void)memset(&groupParams, 0, sizeof(groupParams));
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    groupParams.pChannels[i] = &s_fluidics[i];
+  }
+  groupParams.pEchem = &s_echem;
+  groupParams.pTimerWheel = &s_sim.timerWheel;
+  groupParams.name = "fluidicGroup";
+  groupParams.prio = 3u;
+  FluidicGroupInit(&s_group, &groupParams, &s_framework);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicGroupMove(&s_group, downTargets, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u,
+                       FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "group down %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicGroupMove(&s_group, moveTargets, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u,
+                       FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "group move %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  e = FluidicGroupMix(&s_group, mixTargets, 1.f, 10000u, 5u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+  (void)fprintf(s_pOut, "group mix %d busy=%d\n", (int)e, (int)FluidicGroupIsBusy(&s_group));
+  (void)FluidicSimRunUntilIdle(&s_sim, 600000u);
+  (void)fprintf(s_pOut, "busy=%d\n", (int)FluidicGroupIsBusy(&s_group));
+
+  e = FluidicGroupMove(&s_group, moveTargets, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u,
+                       FLUID_OVERSHOOT_COMP_NONE, 0.f, FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "group move %d\n", (int)e);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+}
+
+
+/**
+  * @brief Runs move_mix with channel 0 traced, then replays the trace through
+  *        a fresh controller and reports how the traces compare.
+  **/
+STATIC void FluidicSimScenarioReplay(void)
+{
+  static Fluidic_t replayFluidic;
+  static FluidicTrace_t replayTrace;
+  static uint8_t replayTraceBytes[FLUIDIC_SIM_MAIN_TRACE_BYTES];
+
+  FluidicSimParams_t simParams = { &s_framework, XHostRunToCompletion, false, true, false, &s_echem };
+  FluidicSimChannelParams_t model;
+  FluidicInitParams_t initParams;
+  FluidicTraceDiff_t diff;
+  eErrorCode e;
+
+  FluidicSimScenarioMoveMix();
+
+  (void)fprintf(s_pOut, "trace: %u records %u bytes truncated=%d\n",
+                s_traces[0].numRecords, s_traces[0].len, (int)s_traces[0].isTruncated);
+
+  FluidicSimInit(&s_sim, &simParams);
+  s_piezos[0].currentVoltage = 0.f;
+  FluidicTraceInit(&replayTrace, replayTraceBytes, sizeof(replayTraceBytes));
+
+  (void)memset(&initParams, 0, sizeof(initParams));
+  initParams.pPiezo = &s_piezos[0];
+  initParams.pEchem = &s_echem;
+  initParams.pParams = &s_params[0];
+  initParams.eChannel = EC_STRIP_CHAN_1;
+  initParams.name = "fluidicReplay";
+  initParams.prio = 2u;
+  initParams.pTrace = &replayTrace;
+  initParams.pTimerWheel = &s_sim.timerWheel;
+  initParams.pEventPool = &s_sim.eventPool;
+
+  (void)memset(&model, 0, sizeof(model));   // The replay delivers what the models would.
+
+  (void)FluidicSimAddChannel(&s_sim, &replayFluidic, &initParams, &model);
+  FluidicInit(&replayFluidic, &initParams, &s_framework);
+
+  e = FluidicSimReplay(&s_sim, s_traceBytes[0], s_traces[0].len, &diff);
+  (void)fprintf(s_pOut, "replay err=%d compared=%u mismatches=%u sameLen=%d replayRecords=%u\n",
+                (int)e, diff.numCompared, diff.numMismatches, (int)diff.isLengthSame, replayTrace.numRecords);
+}
+
+
+/**
+  * @brief Mixes channel 0 at the 1 Hz default, and at FLUIDIC_MIX_FREQ_AUTO,
+  *        dual point and open loop, and logs how long each mix took.
+  **/
+STATIC void FluidicSimScenarioMixFreqAuto(void)
+{
+  static const struct
+  {
+    const char          *name;
+    float               mixFrequency_Hz;
+    uint32_t            cycles;
+    eFluidMixingType_t  eMixType;
+  }
+  mixes[] =
+  {
+    { "dual point 1 Hz",  1.f,                    5u,   FLUID_MIX_DUAL_POINT_LOOP },
+    { "dual point auto",  FLUIDIC_MIX_FREQ_AUTO,  5u,   FLUID_MIX_DUAL_POINT_LOOP },
+    { "dual point auto",  FLUIDIC_MIX_FREQ_AUTO,  5u,   FLUID_MIX_DUAL_POINT_LOOP },
+    { "open loop 1 Hz",   1.f,                    20u,  FLUID_MIX_OPEN_LOOP       },
+    { "open loop auto",   FLUIDIC_MIX_FREQ_AUTO,  20u,  FLUID_MIX_OPEN_LOOP       },
+  };
+
+  uint32_t startMs;
+  eErrorCode e;
+
+  FluidicSimMainMoveCells(FLUID_OVERSHOOT_COMP_NONE);
+
+  for (uint32_t i = 0u; i < (sizeof(mixes) / sizeof(mixes[0])); i++)
+  {
+    startMs = FluidicSimTimeNowMs();
+    e = FluidicMix(&s_fluidics[0], BC_POS_FLUID_A, mixes[i].mixFrequency_Hz, 3600000u,
+                   mixes[i].cycles, mixes[i].eMixType, 0.f, 0.5f);
+    (void)FluidicSimRunUntilIdle(&s_sim, 400000u);
+    (void)fprintf(s_pOut, "%s: %d dt=%u response=%.1f ms\n", mixes[i].name, (int)e,
+                  FluidicSimTimeNowMs() - startMs, s_fluidics[0].contactResponseMs);
+  }
+}
+
+
+/**
+  * @brief Three 50 cycle dual point mixes on both channels, with jittering and
+  *        drifting contacts, under the multiplier and then the PI end point
+  *        controller. Logs the strokes each controller missed.
+  **/
+STATIC void FluidicSimScenarioMixJitter(void)
+{
+  static const struct
+  {
+    const char              *name;
+    eFluidMixController_t   eController;
+  }
+  controllers[] =
+  {
+    { "multiplier", FLUID_MIX_CTRL_MULTIPLIER },
+    { "pi",         FLUID_MIX_CTRL_PI         },
+  };
+
+  uint32_t reached[FLUIDIC_SIM_MAIN_MAX_CHANNELS];
+  uint32_t missed[FLUIDIC_SIM_MAIN_MAX_CHANNELS];
+  uint32_t startMs;
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    FluidicSimSetContactNoise(&s_sim, (eElectrochemicalChannel)i, 1.5f, 0.04f);
+  }
+
+  for (uint32_t c = 0u; c < (sizeof(controllers) / sizeof(controllers[0])); c++)
+  {
+    for (uint32_t i = 0u; i < s_numChannels; i++)
+    {
+      s_params[i].eMixController = controllers[c].eController;
+    }
+
+    FluidicSimMainMoveCells(FLUID_OVERSHOOT_COMP_NONE);
+
+    for (uint32_t run = 0u; run < 3u; run++)
+    {
+      (void)memset(reached, 0, sizeof(reached));
+      (void)memset(missed, 0, sizeof(missed));
+      startMs = FluidicSimTimeNowMs();
+
+      for (uint32_t i = 0u; i < s_numChannels; i++)
+      {
+        (void)FluidicMix(&s_fluidics[i], BC_POS_FLUID_A, 1.f, 3600000u, 50u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+      }
+
+      FluidicSimMainRunCountingStrokes(reached, missed);
+
+      for (uint32_t i = 0u; i < s_numChannels; i++)
+      {
+        (void)fprintf(s_pOut, "%s run %u ch%u: reached=%u missed=%u dropped=%u\n",
+                      controllers[c].name, run, i, reached[i], missed[i],
+                      FluidicTelemetryDropped(&s_fluidics[i].telemetry));
+      }
+      (void)fprintf(s_pOut, "%s run %u: dt=%u\n", controllers[c].name, run, FluidicSimTimeNowMs() - startMs);
+    }
+  }
+}
+
+
+/**
+  * @brief Learns the contacts of a strip lot, saves the cache and loads it
+  *        again as at power up. A second test on the lot is seeded with the
+  *        learned voltages, a test on a new lot starts from the defaults,
+  *        and the first lot is still held when it comes back. A corrupt
+  *        stored image is discarded.
+  **/
+STATIC void FluidicSimScenarioCalLot(void)
+{
+  FluidicCalInitParams_t calParams = { FluidicSimMainCalLoad, FluidicSimMainCalSave, NULL };
+
+  (void)fprintf(s_pOut, "select %d\n", (int)FluidicCalSelectLot(&s_cal, 1001u));
+  FluidicSimMainCalTest("lot 1001 first", FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  (void)fprintf(s_pOut, "save %d dirty=%d\n", (int)FluidicCalSave(&s_cal), (int)s_cal.isDirty);
+
+  FluidicCalInit(&s_cal, &calParams);
+  (void)fprintf(s_pOut, "reloaded select=%u lot=%u\n", s_cal.image.selectCount, s_cal.image.lots[0].lotId);
+  (void)FluidicCalSelectLot(&s_cal, 1001u);
+  FluidicSimMainCalTest("lot 1001 second", FLUID_MOVE_PROFILE_SINGLE_SPEED);
+
+  (void)FluidicCalSelectLot(&s_cal, 2002u);
+  FluidicSimMainCalTest("lot 2002 first", FLUID_MOVE_PROFILE_SINGLE_SPEED);
+
+  (void)FluidicCalSelectLot(&s_cal, 1001u);
+  FluidicSimMainCalTest("lot 1001 third", FLUID_MOVE_PROFILE_SINGLE_SPEED);
+
+  (void)FluidicCalSelectLot(&s_cal, FLUIDIC_CAL_LOT_NONE);
+  FluidicSimMainCalTest("no lot", FLUID_MOVE_PROFILE_SINGLE_SPEED);
+
+  (void)fprintf(s_pOut, "save %d\n", (int)FluidicCalSave(&s_cal));
+  s_calStore.lots[0].contactVolts[0][0] += 1.f;
+  FluidicCalInit(&s_cal, &calParams);
+  (void)fprintf(s_pOut, "corrupt reloaded select=%u\n", s_cal.image.selectCount);
+  (void)FluidicCalSelectLot(&s_cal, 1001u);
+  FluidicSimMainCalTest("lot 1001 after corrupt", FLUID_MOVE_PROFILE_SINGLE_SPEED);
+}
+
+
+/**
+  * @brief Learns the contacts of a strip lot, then repeats the test at a
+  *        single speed and with fast approach moves. Fast approach is then
+  *        asked for with no lot selected, so no contact voltage is known,
+  *        and the moves are made at a single speed.
+  **/
+STATIC void FluidicSimScenarioFastApproach(void)
+{
+  (void)FluidicCalSelectLot(&s_cal, 1001u);
+  FluidicSimMainCalTest("learn", FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  FluidicSimMainCalTest("single speed", FLUID_MOVE_PROFILE_SINGLE_SPEED);
+  FluidicSimMainCalTest("fast approach", FLUID_MOVE_PROFILE_FAST_APPROACH);
+
+  (void)FluidicCalSelectLot(&s_cal, FLUIDIC_CAL_LOT_NONE);
+  FluidicSimMainCalTest("fast approach unlearned", FLUID_MOVE_PROFILE_FAST_APPROACH);
+}
+
+
+/**
+  * @brief Moves each channel up through A, B and C, back to A and up to C
+  *        again, at the low and the flush speed, with predictive stops at the
+  *        default lead and then disabled. Logs how far past the modelled
+  *        contact each channel stopped at C, and the retries of moves
+  *        stopped short.
+  **/
+STATIC void FluidicSimScenarioPredictiveStop(void)
+{
+  static const float speeds[] = { FLUID_SPEED_LOW_DEFAULT_V_PER_S, FLUID_SPEED_FLUSH_DEFAULT_V_PER_S };
+  static const uint32_t leads[] = { FLUID_PREDICTIVE_STOP_LEAD_DEFAULT_MS, 0u };
+
+  static FluidicTelemetryRecord_t records[FLUIDIC_TELEMETRY_LEN];
+  const Fluidic_t *pFl;
+  uint32_t numRecords;
+  uint32_t retries;
+
+  for (uint32_t v = 0u; v < (sizeof(speeds) / sizeof(speeds[0])); v++)
+  {
+    for (uint32_t l = 0u; l < (sizeof(leads) / sizeof(leads[0])); l++)
+    {
+      for (uint32_t i = 0u; i < s_numChannels; i++)
+      {
+        s_params[i].predictiveStopLeadMs = leads[l];
+      }
+
+      (void)fprintf(s_pOut, "speed=%.1f V/s lead=%u ms\n", speeds[v], leads[l]);
+      FluidicSimMainMoveCells(FLUID_OVERSHOOT_COMP_NONE);
+
+      for (uint32_t i = 0u; i < s_numChannels; i++)
+      {
+        (void)FluidicTelemetryDrain(&s_fluidics[i].telemetry, records, FLUIDIC_TELEMETRY_LEN);
+        (void)FluidicMove(&s_fluidics[i], BC_POS_FLUID_C, speeds[v], 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+        (void)FluidicMove(&s_fluidics[i], BC_POS_FLUID_A, speeds[v], 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+        (void)FluidicMove(&s_fluidics[i], BC_POS_FLUID_C, speeds[v], 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+      }
+      (void)FluidicSimRunUntilIdle(&s_sim, 200000u);
+
+      for (uint32_t i = 0u; i < s_numChannels; i++)
+      {
+        pFl = &s_fluidics[i];
+        numRecords = FluidicTelemetryDrain(&s_fluidics[i].telemetry, records, FLUIDIC_TELEMETRY_LEN);
+        retries = 0u;
+
+        for (uint32_t k = 0u; k < numRecords; k++)
+        {
+          retries += records[k].retries;
+        }
+
+        (void)fprintf(s_pOut, "  ch%u: C past contact %.2f V, retries=%u\n", i,
+                      pFl->run.positions[BC_POS_FLUID_C].targetVolts - s_sim.channels[i].model.contactVolts[2],
+                      retries);
+      }
+    }
+  }
+}
+
+/**
+  * @brief Mixes, so the controllers adjust the hysterisis of A and B, then
+  *        homes to start the next test. Logs the hysterisis in use against
+  *        the configuration, and checks that neither controller wrote to its
+  *        configuration.
+  **/
+STATIC void FluidicSimScenarioConstConfig(void)
+{
+  const Fluidic_t *pFl;
+
+  FluidicSimMainMoveCells(FLUID_OVERSHOOT_COMP_NONE);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMix(&s_fluidics[i], BC_POS_FLUID_A, 1.f, 3600000u, 10u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 400000u);
+
+  for (uint32_t test = 0u; test < 2u; test++)
+  {
+    for (uint32_t i = 0u; i < s_numChannels; i++)
+    {
+      pFl = &s_fluidics[i];
+      (void)fprintf(s_pOut, "%s ch%u: hyst A=%.2f B=%.2f config A=%.2f B=%.2f unchanged=%d\n",
+                    (0u == test) ? "mixed" : "homed", i,
+                    pFl->run.positions[BC_POS_FLUID_A].posHysterisis,
+                    pFl->run.positions[BC_POS_FLUID_B].posHysterisis,
+                    pFl->pParams->positionLimits[BC_POS_FLUID_A].posHysterisis,
+                    pFl->pParams->positionLimits[BC_POS_FLUID_B].posHysterisis,
+                    (int)(0 == memcmp(pFl->pParams, s_pConfigs[i]->pParams, sizeof(FluidicParams_t))));
+    }
+
+    for (uint32_t i = 0u; i < s_numChannels; i++)
+    {
+      (void)FluidicMove(&s_fluidics[i], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    }
+    (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  }
+}
+
+
+
+/**
+  * @brief Takes contact C of channel 1 off the strip, then moves it to the
+  *        spare electrode, with a move up to C after each change of the
+  *        contact table. Logs the channel's electrodes from the echem's
+  *        contact map, which each change rebuilds.
+  **/
+STATIC void FluidicSimScenarioContactConfig(void)
+{
+  static const uint32_t pins[] = { 2u, EC_SCAN_NUM_ELECTRODES - 1u };
+
+  Fluidic_t *pFl = &s_fluidics[0];
+  ElectrochemicalContact_t contact;
+  eErrorCode e;
+
+  (void)FluidicMove(pFl, BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  (void)FluidicMove(pFl, BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  for (uint32_t k = 0u; k < (sizeof(pins) / sizeof(pins[0])); k++)
+  {
+    contact = s_echem.pContacts[pins[k]];
+    contact.mapToChannels[EC_STRIP_CHAN_1] = (0u != k);
+    contact.positionInChannel = (0u != k) ? EC_CHAN_POS_C : EC_CHAN_POS_NONE;
+
+    e = EcUpdateContactConfig(&s_echem, (ElectrochemicalPin_t)pins[k], contact);
+    (void)fprintf(s_pOut, "pin %u %s %d: electrodes=0x%04x positions=%u\n", pins[k],
+                  (0u != k) ? "mapped to C" : "unmapped", (int)e,
+                  (unsigned)s_echem.contactMap.channelMask[EC_STRIP_CHAN_1],
+                  (unsigned)s_echem.contactMap.numPositions[EC_STRIP_CHAN_1]);
+
+    e = FluidicMove(pFl, BC_POS_FLUID_C, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)fprintf(s_pOut, "C %d\n", (int)e);
+    (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+    (void)FluidicMove(pFl, BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  }
+}
+
+
+/**
+  * @brief Holds channel 1 at B with breach monitoring, while channel 2 mixes
+  *        on a scheduled scan focused on its contacts. Channel 1's contacts
+  *        drift up until B breaks, eight times over. Logs how long after
+  *        each break the controller saw its fluid front move, which the
+  *        breach watch keeps within a sweep of the strip.
+  **/
+STATIC void FluidicSimScenarioBreachScan(void)
+{
+  const Fluidic_t *pFl = &s_fluidics[0];
+  uint32_t breakMs;
+  uint32_t elapsedMs;
+  uint32_t latencyMs;
+  uint32_t maxLatencyMs = 0u;
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  for (uint32_t i = 0u; i < s_numChannels; i++)
+  {
+    (void)FluidicMove(&s_fluidics[i], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  }
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  (void)FluidicMove(&s_fluidics[1], BC_POS_FLUID_C, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+  (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+  (void)fprintf(s_pOut, "mix %d\n", (int)FluidicMix(&s_fluidics[1], BC_POS_FLUID_B, 1.f, 3600000u, 300u, FLUID_MIX_DUAL_POINT_LOOP, 0.f, 0.5f));
+  (void)FluidicEnableBreachMonitoring(&s_fluidics[0], true);
+
+  for (uint32_t trial = 0u; trial < 8u; trial++)
+  {
+    FluidicSimSetContactNoise(&s_sim, EC_STRIP_CHAN_1, 0.f, 0.f);
+    (void)FluidicMove(&s_fluidics[0], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicMove(&s_fluidics[0], BC_POS_FLUID_B, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    FluidicSimRunFor(&s_sim, 30000u);
+
+    // Drift at a different rate each time, so each break falls at a
+    // different point of the scan.
+    FluidicSimSetContactNoise(&s_sim, EC_STRIP_CHAN_1, 0.f, 0.5f + (0.13f * (float)trial));
+    breakMs = 0u;
+    elapsedMs = 0u;
+
+    while (((0u == breakMs) || (pFl->frontChangeMs < breakMs)) && (elapsedMs < 30000u))
+    {
+      FluidicSimRunFor(&s_sim, EC_SCAN_SLOT_MS);
+      elapsedMs += EC_SCAN_SLOT_MS;
+
+      if ((0u == breakMs) && (s_sim.channels[0].contactsMade < 2u))
+      {
+        breakMs = s_sim.nowMs;
+      }
+    }
+
+    latencyMs = pFl->frontChangeMs - breakMs;
+    maxLatencyMs = (latencyMs > maxLatencyMs) ? latencyMs : maxLatencyMs;
+    (void)fprintf(s_pOut, "B broke at %u ms, seen after %u ms\n", breakMs, latencyMs);
+  }
+
+  (void)fprintf(s_pOut, "max %u ms, sweep %u ms\n", maxLatencyMs, ECHEM_UPDATE_PERIOD_MS);
+  (void)FluidicSimRunUntilIdle(&s_sim, 4000000u);
+}
+
+
+/**
+  * @brief Classifies sweeps of drawn electrode voltages against the simulated
+  *        strip's contact map, by EcContactMapClassify() and by
+  *        EcContactMapClassifyScalar(). Logs how many agree, and a checksum
+  *        of the masks, which are the same whichever path the build takes.
+  **/
+STATIC void FluidicSimScenarioClassify(void)
+{
+  const EcContactMap_t *pMap = &s_echem.contactMap;
+  float volts[EC_CONTACT_MAP_MAX_ELECTRODES];
+  uint32_t state = FLUIDIC_SIM_JITTER_SEED;
+  uint32_t numAgree = 0u;
+  uint32_t checksum = 0u;
+  uint32_t contact32;
+  uint32_t noContact32;
+  uint16_t contact;
+  uint16_t noContact;
+
+  for (uint32_t n = 0u; n < FLUIDIC_SIM_MAIN_CLASSIFY_SWEEPS; n++)
+  {
+    FluidicSimMainVoltsDraw(&state, volts);
+    EcContactMapClassify(pMap, volts, &contact, &noContact);
+    EcContactMapClassifyScalar(pMap, volts, &contact32, &noContact32);
+
+    if ((contact == (contact32 & pMap->electrodeMask)) &&
+        (noContact == (noContact32 & pMap->electrodeMask)))
+    {
+      numAgree++;
+    }
+
+    checksum = (checksum * 31u) + ((uint32_t)contact << 16) + noContact;
+
+    if (n < 4u)
+    {
+      (void)fprintf(s_pOut, "sweep %u: contact=0x%04x no contact=0x%04x\n", n, contact, noContact);
+    }
+  }
+
+  (void)fprintf(s_pOut, "agree %u/%u checksum=0x%08x\n", numAgree, FLUIDIC_SIM_MAIN_CLASSIFY_SWEEPS, checksum);
+}
+
+
+/**
+  * @brief Moves a channel to B with noisy electrodes, first classified by the
+  *        contact map's thresholds and then by the CUSUM change detector.
+  *        Each way, logs how often the fluid front moved while held at B,
+  *        then lets B drift until it breaks, four times over, and logs how
+  *        long after each break the breach was seen.
+  **/
+STATIC void FluidicSimScenarioChangeDetect(void)
+{
+  const Fluidic_t *pFl = &s_fluidics[0];
+  uint32_t frontChangeMs;
+  uint32_t numFrontChanges;
+  uint32_t breakMs;
+  uint32_t elapsedMs;
+
+  for (uint32_t useDetect = 0u; useDetect < 2u; useDetect++)
+  {
+    (void)fprintf(s_pOut, "%s\n", (0u != useDetect) ? "change detect" : "thresholds");
+    FluidicSimSetContactNoise(&s_sim, EC_STRIP_CHAN_1, 0.f, 0.f);
+    FluidicSimSetElectrodeNoise(&s_sim, FLUIDIC_SIM_MAIN_NOISE_V,
+                                (0u != useDetect) ? &s_detectParams : NULL);
+
+    (void)FluidicMove(&s_fluidics[0], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+    (void)FluidicEnableBreachMonitoring(&s_fluidics[0], true);
+    (void)FluidicMove(&s_fluidics[0], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicMove(&s_fluidics[0], BC_POS_FLUID_B, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    FluidicSimRunFor(&s_sim, 30000u);
+
+    frontChangeMs = pFl->frontChangeMs;
+    numFrontChanges = 0u;
+
+    for (elapsedMs = 0u; elapsedMs < FLUIDIC_SIM_MAIN_NOISE_HOLD_MS; elapsedMs += ECHEM_UPDATE_PERIOD_MS)
+    {
+      FluidicSimRunFor(&s_sim, ECHEM_UPDATE_PERIOD_MS);
+
+      if (pFl->frontChangeMs != frontChangeMs)
+      {
+        frontChangeMs = pFl->frontChangeMs;
+        numFrontChanges++;
+      }
+    }
+
+    (void)fprintf(s_pOut, "held at B for %u ms, front moved %u times\n",
+                  FLUIDIC_SIM_MAIN_NOISE_HOLD_MS, numFrontChanges);
+
+    for (uint32_t trial = 0u; trial < 4u; trial++)
+    {
+      FluidicSimSetContactNoise(&s_sim, EC_STRIP_CHAN_1, 0.f, 0.f);
+      (void)FluidicMove(&s_fluidics[0], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+      (void)FluidicMove(&s_fluidics[0], BC_POS_FLUID_B, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+      FluidicSimRunFor(&s_sim, 30000u);
+
+      FluidicSimSetContactNoise(&s_sim, EC_STRIP_CHAN_1, 0.f, 0.5f + (0.13f * (float)trial));
+      breakMs = 0u;
+      elapsedMs = 0u;
+
+      while (((0u == breakMs) || (pFl->frontChangeMs < breakMs)) && (elapsedMs < 30000u))
+      {
+        FluidicSimRunFor(&s_sim, ECHEM_UPDATE_PERIOD_MS);
+        elapsedMs += ECHEM_UPDATE_PERIOD_MS;
+
+        if ((0u == breakMs) && (s_sim.channels[0].contactsMade < 2u))
+        {
+          breakMs = s_sim.nowMs;
+        }
+      }
+
+      (void)fprintf(s_pOut, "B broke at %u ms, seen after %u ms\n", breakMs, pFl->frontChangeMs - breakMs);
+    }
+
+    (void)FluidicEnableBreachMonitoring(&s_fluidics[0], false);
+    FluidicSimSetContactNoise(&s_sim, EC_STRIP_CHAN_1, 0.f, 0.f);
+    (void)FluidicMove(&s_fluidics[0], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  }
+
+  FluidicSimSetElectrodeNoise(&s_sim, 0.f, NULL);
+}
+
+
+/**
+  * @brief Streams potentiostat results to two consumers. One releases each
+  *        block as it is published, the other a number of results later.
+  *        Logs each block published and each release of the slow consumer,
+  *        and where the producer started and stopped dropping. Whilst the
+  *        slow consumer holds a block for less than a block of results
+  *        nothing is dropped. Once it holds one for longer, the producer gets
+  *        back round to it and drops until it is released.
+  **/
+STATIC void FluidicSimScenarioPstatStream(void)
+{
+  EcPstatStream_t stream;
+  const EcPstatStreamBlock_t *pHeld[EC_PSTAT_STREAM_NUM_BLOCKS] = { NULL };
+  uint32_t releaseAt[EC_PSTAT_STREAM_NUM_BLOCKS] = { 0u };
+  EcPotentiostatResults_t results;
+  EcPstatStreamBlock_t *pBlock;
+  uint32_t hold;
+  uint32_t numDropped = 0u;
+  uint32_t slot;
+  bool isDropping = false;
+
+  (void)memset(&results, 0, sizeof(results));
+  EcPstatStreamInit(&stream, 2u);
+
+  for (uint32_t n = 0u; n < FLUIDIC_SIM_MAIN_PSTAT_RESULTS; n++)
+  {
+    for (slot = 0u; slot < EC_PSTAT_STREAM_NUM_BLOCKS; slot++)
+    {
+      if ((NULL != pHeld[slot]) && (n >= releaseAt[slot]))
+      {
+        (void)fprintf(s_pOut, "result %3u: slow released seq %u\n", n, pHeld[slot]->seq);
+        EcPstatStreamRelease(&stream, pHeld[slot]);
+        pHeld[slot] = NULL;
+      }
+    }
+
+    pBlock = EcPstatStreamAdd(&stream, &results);
+
+    if ((stream.numDropped != numDropped) && (false == isDropping))
+    {
+      (void)fprintf(s_pOut, "result %3u: dropping, block still held\n", n);
+    }
+    else if ((stream.numDropped == numDropped) && isDropping)
+    {
+      (void)fprintf(s_pOut, "result %3u: filling again\n", n);
+    }
+    else
+    {
+      // No change.
+    }
+
+    isDropping = (stream.numDropped != numDropped);
+    numDropped = stream.numDropped;
+
+    if (NULL != pBlock)
+    {
+      hold = (n < (FLUIDIC_SIM_MAIN_PSTAT_RESULTS / 2u)) ? FLUIDIC_SIM_MAIN_PSTAT_HOLD_1 : FLUIDIC_SIM_MAIN_PSTAT_HOLD_2;
+      (void)fprintf(s_pOut, "result %3u: published seq %u, %u results, slow holds %u\n",
+                    n, pBlock->seq, pBlock->numSamples, hold);
+
+      // The fast consumer.
+      EcPstatStreamRelease(&stream, pBlock);
+
+      slot = (uint32_t)(pBlock - stream.blocks);
+      pHeld[slot] = pBlock;
+      releaseAt[slot] = n + hold;
+    }
+  }
+
+  pBlock = EcPstatStreamFlush(&stream);
+
+  if (NULL != pBlock)
+  {
+    (void)fprintf(s_pOut, "flushed seq %u, %u results\n", pBlock->seq, pBlock->numSamples);
+    EcPstatStreamRelease(&stream, pBlock);
+    EcPstatStreamRelease(&stream, pBlock);
+  }
+  else
+  {
+    (void)fprintf(s_pOut, "flush held back, block still read\n");
+  }
+
+  (void)fprintf(s_pOut, "published %u dropped %u\n", stream.numPublished, stream.numDropped);
+}
+
+
+/**
+  * @brief Holds a channel at B with breach monitoring, and switches the
+  *        sample type to control solution, whose thresholds read the wet
+  *        electrodes as no contact. First classified by the thresholds, then
+  *        by the change detector. Logs how long after the switch the
+  *        controller saw its fluid front move: the contact map is rebuilt at
+  *        once, and the detector takes as many sweeps as the marginal
+  *        readings need.
+  **/
+STATIC void FluidicSimScenarioSampleType(void)
+{
+  const Fluidic_t *pFl = &s_fluidics[0];
+  eErrorCode error;
+  uint32_t switchMs;
+  uint32_t elapsedMs;
+
+  for (uint32_t useDetect = 0u; useDetect < 2u; useDetect++)
+  {
+    (void)fprintf(s_pOut, "%s\n", (0u != useDetect) ? "change detect" : "thresholds");
+    FluidicSimSetElectrodeNoise(&s_sim, 0.f, (0u != useDetect) ? &s_detectParams : NULL);
+
+    (void)FluidicMove(&s_fluidics[0], BC_POS_HOME, 0.f, 0u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+
+    (void)FluidicEnableBreachMonitoring(&s_fluidics[0], true);
+    (void)FluidicMove(&s_fluidics[0], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicMove(&s_fluidics[0], BC_POS_FLUID_B, FLUID_SPEED_LOW_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    FluidicSimRunFor(&s_sim, 30000u);
+
+    switchMs = s_sim.nowMs;
+    error = ecSetSampleType(&s_echem, SAMPLE_TYPE_CONTROL_SOLUTION);
+    (void)fprintf(s_pOut, "control solution %d: thresholds %.2f/%.2f V\n", (int)error,
+                  s_echem.contactMap.contactVolts[0], s_echem.contactMap.noContactVolts[0]);
+
+    for (elapsedMs = 0u; (pFl->frontChangeMs < switchMs) && (elapsedMs < 30000u); elapsedMs += ECHEM_UPDATE_PERIOD_MS)
+    {
+      FluidicSimRunFor(&s_sim, ECHEM_UPDATE_PERIOD_MS);
+    }
+
+    (void)fprintf(s_pOut, "front moved after %u ms\n", pFl->frontChangeMs - switchMs);
+
+    (void)ecSetSampleType(&s_echem, SAMPLE_TYPE_FINGER_STICK);
+    (void)FluidicEnableBreachMonitoring(&s_fluidics[0], false);
+    (void)FluidicMove(&s_fluidics[0], BC_POS_DOWN, FLUID_SPEED_HIGH_DEFAULT_V_PER_S, 30000u, FLUID_OVERSHOOT_COMP_NONE, 0.f);
+    (void)FluidicSimRunUntilIdle(&s_sim, 60000u);
+  }
+
+  FluidicSimSetElectrodeNoise(&s_sim, 0.f, NULL);
+}
+
+/**
+* @}
+*/
+
+#endif
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,250 @@
+/**
+******************************************************************************
+* @file         fluidicsStats.c
+* @brief        Latency histograms of a fluid channel.
+* @details      The fluid controller adds each move, mix stroke and fluid
+*               front reaction to its histograms. A dump writes one line per
+*               histogram, listing only the buckets which have samples, as
+*               "<lowest value of bucket>:<count>".
+******************************************************************************
+*/
+
+#include "fluidicsStats.h"
+
+/**
+* @addtogroup FluidicsStats
+*  @{
+*/
+
+STATIC uint32_t FluidicHistogramBucket(uint32_t value);
+STATIC void FluidicHistogramReset(FluidicHistogram_t *pHist);
+STATIC void FluidicHistogramPrint(FluidicStats_t *pStats,
+                                  const FluidicHistogram_t *pHist,
+                                  eElectrochemicalChannel eChannel,
+                                  const char *pName,
+                                  FluidicStatsPrintFn_t pfnPrint,
+                                  void *pCtx);
+
+
+/// Dump names of the move histograms, by target position.
+static const char * const s_moveNames[BC_VALID_POS_COUNT] =
+{
+  "MOVE_HOME_MS",
+  "MOVE_DOWN_MS",
+  "MOVE_A_MS",
+  "MOVE_B_MS",
+  "MOVE_C_MS",
+};
+
+
+/**
+  * @brief Adds a sample to a histogram.
+  * @param[in] pHist - The histogram.
+  * @param[in] value - The sample.
+  **/
+void FluidicHistogramAdd(FluidicHistogram_t *pHist, uint32_t value)
+{
+  pHist->counts[FluidicHistogramBucket(value)]++;
+
+  if ((0u == pHist->numSamples) || (value < pHist->minValue))
+  {
+    pHist->minValue = value;
+  }
+
+  if (value > pHist->maxValue)
+  {
+    pHist->maxValue = value;
+  }
+
+  pHist->numSamples++;
+  pHist->sumValues += value;
+}
+
+
+/**
+  * @brief Gets the lowest value counted by a bucket.
+  * @param[in] bucket - Bucket index, less than FLUIDIC_HIST_BUCKETS.
+  * @returns The value.
+  **/
+uint32_t FluidicHistogramBucketLow(uint32_t bucket)
+{
+  uint32_t octave = bucket >> FLUIDIC_HIST_SUB_BUCKET_BITS;
+  uint32_t sub = bucket & (FLUIDIC_HIST_SUB_BUCKETS - 1u);
+  uint32_t low;
+
+  if (0u == octave)
+  {
+    low = bucket;
+  }
+  else
+  {
+    low = (FLUIDIC_HIST_SUB_BUCKETS + sub) << (octave - 1u);
+  }
+
+  return low;
+}
+
+
+/**
+  * @brief Empties every histogram of a channel.
+  * @param[in] pStats - The channel's histograms.
+  **/
+void FluidicStatsReset(FluidicStats_t *pStats)
+{
+  ASSERT_NOT_NULL(pStats);
+
+  for (uint32_t i = 0u; i < BC_VALID_POS_COUNT; i++)
+  {
+    FluidicHistogramReset(&(pStats->moveMs[i]));
+  }
+
+  FluidicHistogramReset(&(pStats->strokePct));
+  FluidicHistogramReset(&(pStats->frontStopMs));
+}
+
+
+/**
+  * @brief Writes every histogram of a channel, one line each.
+  * @details Line format:
+  *          "FLSTATS CH:<channel> <name> N:<samples> MIN:<min> MEAN:<mean> MAX:<max> <low>:<count> ..."
+  * @param[in] pStats - The channel's histograms.
+  * @param[in] eChannel - Fluid channel, for the line prefix.
+  * @param[in] pfnPrint - Writes each line.
+  * @param[in] pCtx - Passed to pfnPrint.
+  **/
+void FluidicStatsDump(FluidicStats_t *pStats,
+                      eElectrochemicalChannel eChannel,
+                      FluidicStatsPrintFn_t pfnPrint,
+                      void *pCtx)
+{
+  ASSERT_NOT_NULL(pStats);
+  ASSERT_NOT_NULL(pfnPrint);
+
+  for (uint32_t i = 0u; i < BC_VALID_POS_COUNT; i++)
+  {
+    FluidicHistogramPrint(pStats, &(pStats->moveMs[i]), eChannel, s_moveNames[i], pfnPrint, pCtx);
+  }
+
+  FluidicHistogramPrint(pStats, &(pStats->strokePct), eChannel, "MIX_STROKE_PCT", pfnPrint, pCtx);
+  FluidicHistogramPrint(pStats, &(pStats->frontStopMs), eChannel, "FRONT_STOP_MS", pfnPrint, pCtx);
+}
+
+
+/**
+  * @brief Finds the bucket which counts a value.
+  * @details Values below FLUIDIC_HIST_SUB_BUCKETS have a bucket each. Above
+  *          that, each power of two is split into FLUIDIC_HIST_SUB_BUCKETS
+  *          equal buckets.
+  * @param[in] value - The sample.
+  * @returns The bucket index.
+  **/
+STATIC uint32_t FluidicHistogramBucket(uint32_t value)
+{
+  uint32_t bucket;
+  uint32_t msb = 0u;
+
+  if (value < FLUIDIC_HIST_SUB_BUCKETS)
+  {
+    bucket = value;
+  }
+  else
+  {
+    while ((value >> msb) > 1u)
+    {
+      msb++;
+    }
+
+    bucket = ((msb - FLUIDIC_HIST_SUB_BUCKET_BITS + 1u) << FLUIDIC_HIST_SUB_BUCKET_BITS) +
+             ((value >> (msb - FLUIDIC_HIST_SUB_BUCKET_BITS)) - FLUIDIC_HIST_SUB_BUCKETS);
+  }
+
+  if (bucket >= FLUIDIC_HIST_BUCKETS)
+  {
+    bucket = FLUIDIC_HIST_BUCKETS - 1u;
+  }
+
+  return bucket;
+}
+
+
+/**
+  * @brief Empties a histogram.
+  * @param[in] pHist - The histogram.
+  **/
+STATIC void FluidicHistogramReset(FluidicHistogram_t *pHist)
+{
+  (void)memset(pHist, 0, sizeof(FluidicHistogram_t));
+}
+
+
+/**
+  * @brief Writes one histogram as a dump line.
+  * @param[in] pStats - Holds the line buffer.
+  * @param[in] pHist - The histogram.
+  * @param[in] eChannel - Fluid channel.
+  * @param[in] pName - Name of the histogram.
+  * @param[in] pfnPrint - Writes the line.
+  * @param[in] pCtx - Passed to pfnPrint.
+  **/
+STATIC void FluidicHistogramPrint(FluidicStats_t *pStats,
+                                  const FluidicHistogram_t *pHist,
+                                  eElectrochemicalChannel eChannel,
+                                  const char *pName,
+                                  FluidicStatsPrintFn_t pfnPrint,
+                                  void *pCtx)
+{
+  char *pLine = pStats->line;
+  uint32_t len;
+  int written;
+  uint32_t mean = 0u;
+
+  if (pHist->numSamples > 0u)
+  {
+    mean = (uint32_t)(pHist->sumValues / pHist->numSamples);
+  }
+
+  written = snprintf(pLine,
+                     FLUIDIC_STATS_LINE_LEN,
+                     "FLSTATS CH:%u %s N:%lu MIN:%lu MEAN:%lu MAX:%lu",
+                     (unsigned int)eChannel,
+                     pName,
+                     (unsigned long)pHist->numSamples,
+                     (unsigned long)pHist->minValue,
+                     (unsigned long)mean,
+                     (unsigned long)pHist->maxValue);
+
+  len = (written > 0) ? (uint32_t)written : 0u;
+
+  for (uint32_t i = 0u; (i < FLUIDIC_HIST_BUCKETS) && (len < FLUIDIC_STATS_LINE_LEN); i++)
+  {
+    if (pHist->counts[i] > 0u)
+    {
+      written = snprintf(&pLine[len],
+                         FLUIDIC_STATS_LINE_LEN - len,
+                         " %lu:%lu",
+                         (unsigned long)FluidicHistogramBucketLow(i),
+                         (unsigned long)pHist->counts[i]);
+
+      // Leave off a bucket which does not fit whole.
+      if ((written > 0) && ((len + (uint32_t)written) < FLUIDIC_STATS_LINE_LEN))
+      {
+        len += (uint32_t)written;
+      }
+      else
+      {
+        pLine[len] = '\0';
+        len = FLUIDIC_STATS_LINE_LEN;
+      }
+    }
+  }
+
+  pfnPrint(pLine, pCtx);
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ * @file   fluidicsStats.h
+ * @brief  Header file for fluidicsStats.c
+ ******************************************************************************
+ */
+
+
+#ifndef FLUIDICS_STATS_H_
+#define FLUIDICS_STATS_H_
+
+#include "poci.h"
+#include "electrochemical.h"
+#include "fluidicsTypes.h"
+
+
+/**
+ * @defgroup FluidicsStats Fluidic Latency Histograms
+ * @brief Where the time of a fluid move goes.
+ * @details Fixed-bucket, log-linear histograms of a fluid channel's move
+ *          durations per target position, mix stroke durations against the
+ *          stroke time asked for, and the time from an echem status change
+ *          arriving to the Piezo stop being issued for it. Together they show
+ *          whether a slow test is down to the Piezo, the echem sampling
+ *          period or the state machine.
+ *          Each bucket spans a quarter of a power of two, so the resolution
+ *          is 25% or better at every scale. Values below 4 are exact.
+ *  @{
+ */
+
+
+/// Buckets per power of two, as bits.
+#define FLUIDIC_HIST_SUB_BUCKET_BITS      2u
+
+/// Buckets per power of two.
+#define FLUIDIC_HIST_SUB_BUCKETS          (1u << FLUIDIC_HIST_SUB_BUCKET_BITS)
+
+/// Buckets per histogram. Covers 0 to 131071, larger values go in the last bucket.
+#define FLUIDIC_HIST_BUCKETS              64u
+
+/// Longest line written by a dump. Buckets which do not fit are left off the line.
+#define FLUIDIC_STATS_LINE_LEN            200u
+
+
+/**
+  *     @brief A log-linear histogram.
+  **/
+typedef struct FluidicHistogram_tag
+{
+  uint32_t                      counts[FLUIDIC_HIST_BUCKETS];
+  uint32_t                      numSamples;
+  uint32_t                      minValue;               ///< Only valid if numSamples > 0.
+  uint32_t                      maxValue;
+  uint64_t                      sumValues;
+}
+FluidicHistogram_t;
+
+
+/**
+  *     @brief Histograms of one fluid channel.
+  **/
+typedef struct FluidicStats_tag
+{
+  FluidicHistogram_t            moveMs[BC_VALID_POS_COUNT];  ///< Duration of moves which reached their target, by target, in ms.
+  FluidicHistogram_t            strokePct;              ///< Mix stroke duration, as a percentage of the stroke time set by mixFrequency_Hz.
+  FluidicHistogram_t            frontStopMs;            ///< Sweep finding a fluid front change, to the Piezo confirming the stop for it, in ms.
+  char                          line[FLUIDIC_STATS_LINE_LEN]; ///< Dump line buffer.
+}
+FluidicStats_t;
+
+
+/// Writes one line of a dump. Called from the fluid controller's thread.
+typedef void (*FluidicStatsPrintFn_t)(const char *pLine, void *pCtx);
+
+
+/** @} */
+void       FluidicHistogramAdd(FluidicHistogram_t *pHist, uint32_t value);
+
+uint32_t   FluidicHistogramBucketLow(uint32_t bucket);
+
+void       FluidicStatsReset(FluidicStats_t *pStats);
+
+void       FluidicStatsDump(FluidicStats_t *pStats,
+                            eElectrochemicalChannel eChannel,
+                            FluidicStatsPrintFn_t pfnPrint,
+                            void *pCtx);
+
+#endif
+
+/********************************** End Of File ******************************/
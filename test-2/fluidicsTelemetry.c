@@ -0,0 +1,125 @@
+/**
+******************************************************************************
+* @file         fluidicsTelemetry.c
+* @brief        Per channel ring of fluid move and mix stroke records.
+* @details      The fluid controller pushes a record as each move or mix
+*               stroke finishes. The application drains them in bulk, to
+*               profile protocol timing without logging every move.
+******************************************************************************
+*/
+
+#include "fluidicsTelemetry.h"
+
+/**
+* @addtogroup FluidicsTelemetry
+*  @{
+*/
+
+
+// The ring indices are free running, so the slot of an index must not jump
+// when the index wraps.
+_Static_assert((FLUIDIC_TELEMETRY_LEN & (FLUIDIC_TELEMETRY_LEN - 1u)) == 0u,
+               "FLUIDIC_TELEMETRY_LEN must be a power of two");
+
+
+/**
+  * @brief Empties the ring.
+  * @details Called by the fluid controller's init, before anything can drain it.
+  * @param[in] pTlm - The ring.
+  **/
+void FluidicTelemetryInit(FluidicTelemetry_t *pTlm)
+{
+  ASSERT_NOT_NULL(pTlm);
+
+  (void)memset(pTlm, 0, sizeof(FluidicTelemetry_t));
+}
+
+
+/**
+  * @brief Adds a record to the ring. Fluid controller thread only.
+  * @details The record is numbered, so the reader can see where records
+  *          were dropped.
+  * @param[in] pTlm - The ring.
+  * @param[in] pRecord - The finished record. Its seq is ignored.
+  * @returns false if the ring was full and the record was dropped.
+  **/
+bool FluidicTelemetryPush(FluidicTelemetry_t *pTlm, const FluidicTelemetryRecord_t *pRecord)
+{
+  uint32_t head = pTlm->head;
+  FluidicTelemetryRecord_t *pSlot;
+  bool isAdded = false;
+
+  if ((head - pTlm->tail) < FLUIDIC_TELEMETRY_LEN)
+  {
+    pSlot = &(pTlm->records[head % FLUIDIC_TELEMETRY_LEN]);
+    *pSlot = *pRecord;
+    pSlot->seq = pTlm->nextSeq;
+    XPortMemoryBarrier();                         // Slot is complete, hand it over.
+    pTlm->head = head + 1u;
+    isAdded = true;
+  }
+  else
+  {
+    pTlm->dropped++;
+  }
+
+  pTlm->nextSeq++;
+
+  return isAdded;
+}
+
+
+/**
+  * @brief Copies the oldest records out of the ring, and frees their slots.
+  * @details May be called from any one thread other than the fluid
+  *          controller's, whilst the controller is running.
+  * @param[in] pTlm - The ring.
+  * @param[out] pRecords - Receives the records, oldest first.
+  * @param[in] maxRecords - Size of pRecords.
+  * @returns The number of records copied.
+  **/
+uint32_t FluidicTelemetryDrain(FluidicTelemetry_t *pTlm,
+                               FluidicTelemetryRecord_t *pRecords,
+                               uint32_t maxRecords)
+{
+  uint32_t tail = pTlm->tail;
+  uint32_t count = pTlm->head - tail;
+
+  ASSERT_NOT_NULL(pRecords);
+
+  XPortMemoryBarrier();                           // See the slots as the producer left them.
+
+  if (count > maxRecords)
+  {
+    count = maxRecords;
+  }
+
+  for (uint32_t i = 0u; i < count; i++)
+  {
+    pRecords[i] = pTlm->records[(tail + i) % FLUIDIC_TELEMETRY_LEN];
+  }
+
+  XPortMemoryBarrier();                           // Copied out, hand the slots back.
+  pTlm->tail = tail + count;
+
+  return count;
+}
+
+
+/**
+  * @brief Gets the number of records lost to a full ring.
+  * @param[in] pTlm - The ring.
+  * @returns The count, since init. Free running.
+  **/
+uint32_t FluidicTelemetryDropped(const FluidicTelemetry_t *pTlm)
+{
+  return pTlm->dropped;
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
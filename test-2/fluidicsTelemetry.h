@@ -0,0 +1,118 @@
+/**
+ ******************************************************************************
+ * @file   fluidicsTelemetry.h
+ * @brief  Header file for fluidicsTelemetry.c
+ ******************************************************************************
+ */
+
+
+#ifndef FLUIDICS_TELEMETRY_H_
+#define FLUIDICS_TELEMETRY_H_
+
+#include "poci.h"
+#include "electrochemical.h"
+#include "fluidicsTypes.h"
+#include "xPort.h"
+
+
+/**
+ * @defgroup FluidicsTelemetry Fluidic Move Telemetry
+ * @brief Timing records of each fluid move and mix stroke.
+ * @details Each fluid controller writes a record when a move or mix stroke
+ *          finishes, into a fixed-size ring of its own. The application
+ *          drains the records in bulk, from any one thread, without
+ *          stopping the controller. If the ring is full the newest record
+ *          is dropped and counted, so a slow reader never sees a record
+ *          change under it.
+ *  @{
+ */
+
+
+/// Records held per channel. Must be a power of two.
+#define FLUIDIC_TELEMETRY_LEN             16u
+
+/// Fluid front changes timed per record. Later changes are only counted.
+#define FLUIDIC_TELEMETRY_MAX_FRONT_CHANGES  4u
+
+
+/**
+  *     @brief What a record describes.
+  **/
+typedef enum
+{
+  FLUIDIC_TELEMETRY_MOVE = 0,           ///< A move, from the command starting to the result being reported.
+  FLUIDIC_TELEMETRY_MIX_STROKE,         ///< One stroke of a mix.
+}
+eFluidicTelemetryKind_t;
+
+
+/**
+  *     @brief How a move or mix stroke finished.
+  **/
+typedef enum
+{
+  FLUIDIC_TELEMETRY_REACHED = 0,        ///< Reached the target.
+  FLUIDIC_TELEMETRY_MISSED,             ///< Mix stroke finished without making its contact.
+  FLUIDIC_TELEMETRY_FAILED,             ///< Failed. The record holds the error.
+  FLUIDIC_TELEMETRY_CANCELLED,          ///< Cancelled, halted, or replaced by a homing move.
+}
+eFluidicTelemetryOutcome_t;
+
+
+/**
+  *     @brief Telemetry of one move or mix stroke.
+  **/
+typedef struct FluidicTelemetryRecord_tag
+{
+  uint32_t                      seq;                    ///< Record number of the channel. A gap means records were dropped.
+  eFluidicTelemetryKind_t       eKind;
+  eFluidicTelemetryOutcome_t    eOutcome;
+  eErrorCode                    error;                  ///< Error of a failed move, otherwise OK_STATUS.
+  eFluidicPositions_t           eTargetPos;
+  eFluidicPositions_t           eRestPos;               ///< Last known position when the record finished.
+  eEcFluidDetectPosition_t      eFrontPos;              ///< Fluid front position when the record finished.
+  uint32_t                      startMs;                ///< FLUIDIC_TIME_NOW_MS() at the start.
+  uint32_t                      stopMs;                 ///< FLUIDIC_TIME_NOW_MS() at the finish.
+  float                         startVolts;             ///< Piezo voltage at the start.
+  float                         endVolts;               ///< Piezo voltage at the finish.
+  float                         hysterisisVolts;        ///< Hysterisis of the target position at the start.
+  uint16_t                      frontChangeMs[FLUIDIC_TELEMETRY_MAX_FRONT_CHANGES]; ///< Time of each fluid front change, from the start. Saturates at 0xFFFF.
+  uint8_t                       numFrontChanges;        ///< Fluid front changes seen. Saturates at 0xFF.
+  uint8_t                       retries;                ///< Times the Piezo move was restarted, by a predictive stop resuming or by breaking and remaking the contact.
+}
+FluidicTelemetryRecord_t;
+
+
+/**
+  *     @brief Telemetry ring of a fluid channel.
+  *     @details Single producer (the fluid controller) and single consumer
+  *              (the drain caller). Only the producer writes head and dropped,
+  *              and only the consumer writes tail. Both are free running. A
+  *              memory barrier orders each side's slot accesses against the
+  *              index that hands the slots over.
+  **/
+typedef struct FluidicTelemetry_tag
+{
+  FluidicTelemetryRecord_t      records[FLUIDIC_TELEMETRY_LEN];
+  volatile uint32_t             head;                   ///< Count of records written.
+  volatile uint32_t             tail;                   ///< Count of records drained.
+  volatile uint32_t             dropped;                ///< Count of records lost to a full ring.
+  uint32_t                      nextSeq;                ///< seq of the next record, written or dropped.
+}
+FluidicTelemetry_t;
+
+
+/** @} */
+void       FluidicTelemetryInit(FluidicTelemetry_t *pTlm);
+
+bool       FluidicTelemetryPush(FluidicTelemetry_t *pTlm, const FluidicTelemetryRecord_t *pRecord);
+
+uint32_t   FluidicTelemetryDrain(FluidicTelemetry_t *pTlm,
+                                 FluidicTelemetryRecord_t *pRecords,
+                                 uint32_t maxRecords);
+
+uint32_t   FluidicTelemetryDropped(const FluidicTelemetry_t *pTlm);
+
+#endif
+
+/********************************** End Of File ******************************/
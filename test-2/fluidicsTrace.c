@@ -0,0 +1,440 @@
+/**
+******************************************************************************
+* @file         fluidicsTrace.c
+* @brief        Binary trace of the events delivered to a fluid controller.
+* @details      Encodes and decodes trace records, and compares two traces.
+*               The fluid controller picks the records and their payloads,
+*               this module only packs them. Integers are little endian and
+*               floats are written as their IEEE-754 bits, so a trace taken on
+*               the instrument reads the same on a host.
+******************************************************************************
+*/
+
+#include "fluidicsTrace.h"
+
+/**
+* @addtogroup FluidicsTrace
+*  @{
+*/
+
+STATIC uint32_t FluidicTracePutVarint(uint8_t *pOut, uint32_t value);
+STATIC bool FluidicTraceGetVarint(FluidicTraceReader_t *pReader, uint32_t *pValue);
+STATIC bool FluidicTraceRecordsMatch(const FluidicTraceRecord_t *pA,
+                                     const FluidicTraceRecord_t *pB);
+
+
+/**
+  * @brief Gives a trace its buffer. Nothing is recorded until it is started.
+  * @param[in] pTrace - The trace.
+  * @param[in] pBuf - Receives the trace.
+  * @param[in] size - Bytes of pBuf.
+  **/
+void FluidicTraceInit(FluidicTrace_t *pTrace, uint8_t *pBuf, uint32_t size)
+{
+  ASSERT_NOT_NULL(pTrace);
+  ASSERT_NOT_NULL(pBuf);
+
+  (void)memset(pTrace, 0, sizeof(FluidicTrace_t));
+
+  pTrace->pBuf = pBuf;
+  pTrace->size = size;
+  pTrace->isTruncated = true;                   // Not started.
+}
+
+
+/**
+  * @brief Empties the trace and writes its header. Fluid controller thread only.
+  * @param[in] pTrace - The trace.
+  * @param[in] channel - Fluid channel of the controller.
+  * @param[in] nowMs - Time of the trace start. Record times are from here.
+  **/
+void FluidicTraceStart(FluidicTrace_t *pTrace, uint8_t channel, uint32_t nowMs)
+{
+  uint8_t *pBuf = pTrace->pBuf;
+
+  pTrace->len = 0u;
+  pTrace->numRecords = 0u;
+  pTrace->startMs = nowMs;
+  pTrace->lastMs = nowMs;
+  pTrace->isTruncated = (pTrace->size < FLUIDIC_TRACE_HEADER_LEN);
+
+  if (false == pTrace->isTruncated)
+  {
+    pBuf[0] = (uint8_t)(FLUIDIC_TRACE_MAGIC);
+    pBuf[1] = (uint8_t)(FLUIDIC_TRACE_MAGIC >> 8);
+    pBuf[2] = (uint8_t)(FLUIDIC_TRACE_MAGIC >> 16);
+    pBuf[3] = (uint8_t)(FLUIDIC_TRACE_MAGIC >> 24);
+    pBuf[4] = (uint8_t)FLUIDIC_TRACE_VERSION;
+    pBuf[5] = channel;
+    pBuf[6] = 0u;
+    pBuf[7] = 0u;
+
+    pTrace->len = FLUIDIC_TRACE_HEADER_LEN;
+  }
+}
+
+
+/**
+  * @brief Appends a record. Fluid controller thread only.
+  * @details The record is encoded in full before len moves past it, so a
+  *          reader copying out [0, len) never sees half a record.
+  * @param[in] pTrace - The trace.
+  * @param[in] nowMs - Time of the record. Its timeMs is ignored.
+  * @param[in] pRecord - The record.
+  * @returns false if the trace is full, or was never started.
+  **/
+bool FluidicTraceAppend(FluidicTrace_t *pTrace,
+                        uint32_t nowMs,
+                        const FluidicTraceRecord_t *pRecord)
+{
+  uint8_t encoded[FLUIDIC_TRACE_MAX_RECORD_LEN];
+  uint32_t n;
+  bool isAdded = false;
+
+  if (false == pTrace->isTruncated)
+  {
+    n  = FluidicTracePutVarint(&encoded[0], nowMs - pTrace->lastMs);
+    n += FluidicTracePutVarint(&encoded[n], pRecord->id);
+    encoded[n++] = (uint8_t)(((uint32_t)pRecord->eSource << 6) | pRecord->payloadLen);
+    encoded[n++] = pRecord->snapshot.state;
+    encoded[n++] = pRecord->snapshot.eLastKnownPos;
+    encoded[n++] = pRecord->snapshot.eTargetPos;
+    (void)memcpy(&encoded[n], pRecord->payload, pRecord->payloadLen);
+    n += pRecord->payloadLen;
+
+    if ((pTrace->size - pTrace->len) >= n)
+    {
+      (void)memcpy(&(pTrace->pBuf[pTrace->len]), encoded, n);
+      pTrace->len = pTrace->len + n;
+      pTrace->numRecords++;
+      pTrace->lastMs = nowMs;
+      isAdded = true;
+    }
+    else
+    {
+      pTrace->isTruncated = true;
+    }
+  }
+
+  return isAdded;
+}
+
+
+/**
+  * @brief Adds a byte to the payload of a record.
+  * @param[in] pRecord - The record.
+  * @param[in] value - The byte.
+  **/
+void FluidicTracePutU8(FluidicTraceRecord_t *pRecord, uint8_t value)
+{
+  ASSERT(pRecord->payloadLen < FLUIDIC_TRACE_MAX_PAYLOAD);
+
+  pRecord->payload[pRecord->payloadLen] = value;
+  pRecord->payloadLen++;
+}
+
+
+/**
+  * @brief Adds a 32 bit value to the payload of a record, little endian.
+  * @param[in] pRecord - The record.
+  * @param[in] value - The value.
+  **/
+void FluidicTracePutU32(FluidicTraceRecord_t *pRecord, uint32_t value)
+{
+  for (uint32_t i = 0u; i < 4u; i++)
+  {
+    FluidicTracePutU8(pRecord, (uint8_t)(value >> (8u * i)));
+  }
+}
+
+
+/**
+  * @brief Adds a float to the payload of a record, as its IEEE-754 bits.
+  * @param[in] pRecord - The record.
+  * @param[in] value - The value.
+  **/
+void FluidicTracePutF32(FluidicTraceRecord_t *pRecord, float value)
+{
+  uint32_t bits;
+
+  (void)memcpy(&bits, &value, sizeof(bits));
+  FluidicTracePutU32(pRecord, bits);
+}
+
+
+/**
+  * @brief Reads a byte of the payload of a record.
+  * @param[in] pRecord - The record.
+  * @param[in,out] pPos - Payload offset. Moved past the byte.
+  * @returns The byte, or 0 past the end of the payload.
+  **/
+uint8_t FluidicTraceGetU8(const FluidicTraceRecord_t *pRecord, uint32_t *pPos)
+{
+  uint8_t value = 0u;
+
+  if (*pPos < pRecord->payloadLen)
+  {
+    value = pRecord->payload[*pPos];
+  }
+
+  (*pPos)++;
+
+  return value;
+}
+
+
+/**
+  * @brief Reads a 32 bit value of the payload of a record.
+  * @param[in] pRecord - The record.
+  * @param[in,out] pPos - Payload offset. Moved past the value.
+  * @returns The value.
+  **/
+uint32_t FluidicTraceGetU32(const FluidicTraceRecord_t *pRecord, uint32_t *pPos)
+{
+  uint32_t value = 0u;
+
+  for (uint32_t i = 0u; i < 4u; i++)
+  {
+    value |= (uint32_t)FluidicTraceGetU8(pRecord, pPos) << (8u * i);
+  }
+
+  return value;
+}
+
+
+/**
+  * @brief Reads a float of the payload of a record.
+  * @param[in] pRecord - The record.
+  * @param[in,out] pPos - Payload offset. Moved past the value.
+  * @returns The value.
+  **/
+float FluidicTraceGetF32(const FluidicTraceRecord_t *pRecord, uint32_t *pPos)
+{
+  uint32_t bits = FluidicTraceGetU32(pRecord, pPos);
+  float value;
+
+  (void)memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
+
+
+/**
+  * @brief Checks the header of a trace, and readies it to be read.
+  * @param[out] pReader - The reader.
+  * @param[in] pBuf - The trace.
+  * @param[in] len - Bytes of the trace.
+  * @retval OK_STATUS The trace can be read.
+  * @retval ERROR_BAD_ARGS Not a trace, or a trace of another version.
+  **/
+eErrorCode FluidicTraceReaderInit(FluidicTraceReader_t *pReader,
+                                  const uint8_t *pBuf,
+                                  uint32_t len)
+{
+  eErrorCode error = ERROR_BAD_ARGS;
+  uint32_t magic;
+
+  ASSERT_NOT_NULL(pReader);
+  ASSERT_NOT_NULL(pBuf);
+
+  (void)memset(pReader, 0, sizeof(FluidicTraceReader_t));
+
+  if (len >= FLUIDIC_TRACE_HEADER_LEN)
+  {
+    magic = (uint32_t)pBuf[0] |
+            ((uint32_t)pBuf[1] << 8) |
+            ((uint32_t)pBuf[2] << 16) |
+            ((uint32_t)pBuf[3] << 24);
+
+    if ((FLUIDIC_TRACE_MAGIC == magic) && (FLUIDIC_TRACE_VERSION == pBuf[4]))
+    {
+      pReader->pBuf = pBuf;
+      pReader->len = len;
+      pReader->pos = FLUIDIC_TRACE_HEADER_LEN;
+      pReader->channel = pBuf[5];
+      error = OK_STATUS;
+    }
+  }
+
+  return error;
+}
+
+
+/**
+  * @brief Reads the next record of a trace.
+  * @param[in] pReader - The reader.
+  * @param[out] pRecord - The record.
+  * @returns false at the end of the trace, or at a record cut short.
+  **/
+bool FluidicTraceReadNext(FluidicTraceReader_t *pReader, FluidicTraceRecord_t *pRecord)
+{
+  uint32_t deltaMs = 0u;
+  uint32_t id = 0u;
+  uint32_t flags;
+  bool isRead = false;
+
+  if ((NULL != pReader->pBuf) &&
+      FluidicTraceGetVarint(pReader, &deltaMs) &&
+      FluidicTraceGetVarint(pReader, &id) &&
+      ((pReader->len - pReader->pos) >= 4u))
+  {
+    flags = pReader->pBuf[pReader->pos];
+
+    pRecord->timeMs = pReader->timeMs + deltaMs;
+    pRecord->id = id;
+    pRecord->eSource = (eFluidicTraceSource_t)(flags >> 6);
+    pRecord->payloadLen = (uint8_t)(flags & 0x3Fu);
+    pRecord->snapshot.state = pReader->pBuf[pReader->pos + 1u];
+    pRecord->snapshot.eLastKnownPos = pReader->pBuf[pReader->pos + 2u];
+    pRecord->snapshot.eTargetPos = pReader->pBuf[pReader->pos + 3u];
+    pReader->pos += 4u;
+
+    if ((pRecord->payloadLen <= FLUIDIC_TRACE_MAX_PAYLOAD) &&
+        ((pReader->len - pReader->pos) >= pRecord->payloadLen))
+    {
+      (void)memcpy(pRecord->payload, &(pReader->pBuf[pReader->pos]), pRecord->payloadLen);
+      pReader->pos += pRecord->payloadLen;
+      pReader->timeMs = pRecord->timeMs;
+      isRead = true;
+    }
+  }
+
+  if (false == isRead)
+  {
+    pReader->pos = pReader->len;                  // Nothing after a bad record can be trusted.
+  }
+
+  return isRead;
+}
+
+
+/**
+  * @brief Compares two traces, record by record.
+  * @details Records match if their time, id, source, snapshot and payload
+  *          are all the same.
+  * @param[in] pExpected - The reference trace, e.g. taken on the instrument.
+  * @param[in] expectedLen - Bytes of pExpected.
+  * @param[in] pActual - The trace to check, e.g. taken by a replay.
+  * @param[in] actualLen - Bytes of pActual.
+  * @param[out] pDiff - Where the traces differ. A trace with a bad header has no records.
+  **/
+void FluidicTraceCompare(const uint8_t *pExpected,
+                         uint32_t expectedLen,
+                         const uint8_t *pActual,
+                         uint32_t actualLen,
+                         FluidicTraceDiff_t *pDiff)
+{
+  FluidicTraceReader_t expected;
+  FluidicTraceReader_t actual;
+  FluidicTraceRecord_t expectedRecord;
+  FluidicTraceRecord_t actualRecord;
+  bool hasExpected;
+  bool hasActual;
+
+  ASSERT_NOT_NULL(pDiff);
+
+  (void)memset(pDiff, 0, sizeof(FluidicTraceDiff_t));
+  (void)FluidicTraceReaderInit(&expected, pExpected, expectedLen);
+  (void)FluidicTraceReaderInit(&actual, pActual, actualLen);
+
+  hasExpected = FluidicTraceReadNext(&expected, &expectedRecord);
+  hasActual = FluidicTraceReadNext(&actual, &actualRecord);
+
+  while (hasExpected && hasActual)
+  {
+    if (false == FluidicTraceRecordsMatch(&expectedRecord, &actualRecord))
+    {
+      if (0u == pDiff->numMismatches)
+      {
+        pDiff->firstMismatch = pDiff->numCompared;
+        pDiff->expected = expectedRecord;
+        pDiff->actual = actualRecord;
+      }
+
+      pDiff->numMismatches++;
+    }
+
+    pDiff->numCompared++;
+
+    hasExpected = FluidicTraceReadNext(&expected, &expectedRecord);
+    hasActual = FluidicTraceReadNext(&actual, &actualRecord);
+  }
+
+  pDiff->isLengthSame = (hasExpected == hasActual);
+}
+
+
+/**
+  * @brief Writes a varint: 7 bits per byte, least significant first, top bit set on all but the last.
+  * @param[out] pOut - Receives up to 5 bytes.
+  * @param[in] value - The value.
+  * @returns Bytes written.
+  **/
+STATIC uint32_t FluidicTracePutVarint(uint8_t *pOut, uint32_t value)
+{
+  uint32_t n = 0u;
+
+  while (value >= 0x80u)
+  {
+    pOut[n++] = (uint8_t)(value | 0x80u);
+    value >>= 7;
+  }
+
+  pOut[n++] = (uint8_t)value;
+
+  return n;
+}
+
+
+/**
+  * @brief Reads a varint.
+  * @param[in] pReader - The reader.
+  * @param[out] pValue - The value.
+  * @returns false if the trace ends within the varint, or it is too long.
+  **/
+STATIC bool FluidicTraceGetVarint(FluidicTraceReader_t *pReader, uint32_t *pValue)
+{
+  uint32_t value = 0u;
+  uint32_t shift = 0u;
+  uint8_t byte = 0x80u;
+
+  while (((byte & 0x80u) != 0u) && (pReader->pos < pReader->len) && (shift < 35u))
+  {
+    byte = pReader->pBuf[pReader->pos];
+    pReader->pos++;
+    value |= (uint32_t)(byte & 0x7Fu) << shift;
+    shift += 7u;
+  }
+
+  *pValue = value;
+
+  return ((byte & 0x80u) == 0u);
+}
+
+
+/**
+  * @brief Checks whether two records are the same.
+  * @param[in] pA - A record.
+  * @param[in] pB - The other record.
+  * @returns true if they match.
+  **/
+STATIC bool FluidicTraceRecordsMatch(const FluidicTraceRecord_t *pA,
+                                     const FluidicTraceRecord_t *pB)
+{
+  return (pA->timeMs == pB->timeMs) &&
+         (pA->id == pB->id) &&
+         (pA->eSource == pB->eSource) &&
+         (pA->snapshot.state == pB->snapshot.state) &&
+         (pA->snapshot.eLastKnownPos == pB->snapshot.eLastKnownPos) &&
+         (pA->snapshot.eTargetPos == pB->snapshot.eTargetPos) &&
+         (pA->payloadLen == pB->payloadLen) &&
+         (0 == memcmp(pA->payload, pB->payload, pA->payloadLen));
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,199 @@
+/**
+ ******************************************************************************
+ * @file   fluidicsTrace.h
+ * @brief  Header file for fluidicsTrace.c
+ ******************************************************************************
+ */
+
+
+#ifndef FLUIDICS_TRACE_H_
+#define FLUIDICS_TRACE_H_
+
+#include "poci.h"
+
+
+/**
+ * @defgroup FluidicsTrace Fluidic Event Trace
+ * @brief Compact binary trace of the events delivered to a fluid controller.
+ * @details A fluid controller given a trace buffer appends a record for each
+ *          event its state handlers receive, each command it is given, each
+ *          command result it sends and each Piezo command it makes. Each
+ *          record holds the time, the event id, a snapshot of the controller
+ *          taken before the event was handled, and only the part of the
+ *          event payload the controller reads. A trace taken on an
+ *          instrument can be replayed through the host simulator, which
+ *          re-records the replay, so any change to fluidics.c which alters a
+ *          transition or result shows up as the first record at which the
+ *          two traces differ.
+ *
+ *          The buffer starts with a FLUIDIC_TRACE_HEADER_LEN byte header:
+ *          magic (4 bytes, little endian), version, channel and two reserved
+ *          bytes. Each record is then:
+ *
+ *          Field           | Encoding
+ *          --------------- | ---------------------------------
+ *          Time            | Varint, ms since the previous record (or the trace start).
+ *          Event id        | Varint.
+ *          Source, length  | One byte. eFluidicTraceSource_t in the top two bits, payload length below.
+ *          Snapshot        | Three bytes. State, last known position and target position.
+ *          Payload         | Little endian fields, listed per event at FluidicTraceEncode() in fluidics.c.
+ *
+ *          Recording stops at the first record which does not fit, so a
+ *          trace is always a whole number of records.
+ *  @{
+ */
+
+
+/// "FLTR", little endian.
+#define FLUIDIC_TRACE_MAGIC               0x52544C46u
+
+/// Format version. Changes whenever a payload changes.
+#define FLUIDIC_TRACE_VERSION             2u
+
+/// Bytes of the trace header.
+#define FLUIDIC_TRACE_HEADER_LEN          8u
+
+/// Longest payload of a record.
+#define FLUIDIC_TRACE_MAX_PAYLOAD         24u
+
+/// Longest encoded record: two 5 byte varints, the source byte, snapshot and payload.
+#define FLUIDIC_TRACE_MAX_RECORD_LEN      (5u + 5u + 1u + 3u + FLUIDIC_TRACE_MAX_PAYLOAD)
+
+/// Snapshot state of a controller in a state the trace does not know.
+#define FLUIDIC_TRACE_STATE_UNKNOWN       0xFFu
+
+
+/**
+  *     @brief Where a record came from.
+  **/
+typedef enum
+{
+  FLUIDIC_TRACE_EVENT = 0,              ///< Event from another object, or the controller's timer.
+  FLUIDIC_TRACE_COMMAND,                ///< Command posted by the controller's API.
+  FLUIDIC_TRACE_RESULT,                 ///< Command result sent by the controller.
+  FLUIDIC_TRACE_OUTPUT,                 ///< Piezo command made by the controller. The id is an eFluidicTraceOutput_t.
+}
+eFluidicTraceSource_t;
+
+
+/**
+  *     @brief Piezo commands, as the id of a FLUIDIC_TRACE_OUTPUT record.
+  **/
+typedef enum
+{
+  FLUIDIC_TRACE_PIEZO_SET = 0,          ///< Ramp to a voltage.
+  FLUIDIC_TRACE_PIEZO_STOP,
+  FLUIDIC_TRACE_PIEZO_HOME,
+  FLUIDIC_TRACE_PIEZO_WAVEFORM,         ///< Play a mix waveform.
+}
+eFluidicTraceOutput_t;
+
+
+/**
+  *     @brief Controller state when a record was made.
+  **/
+typedef struct FluidicTraceSnapshot_tag
+{
+  uint8_t                       state;                  ///< Index of the state handler, or FLUIDIC_TRACE_STATE_UNKNOWN.
+  uint8_t                       eLastKnownPos;
+  uint8_t                       eTargetPos;
+}
+FluidicTraceSnapshot_t;
+
+
+/**
+  *     @brief One decoded record.
+  **/
+typedef struct FluidicTraceRecord_tag
+{
+  uint32_t                      timeMs;                 ///< Time from the trace start.
+  uint32_t                      id;                     ///< eXEventId of the event, or eFluidicTraceOutput_t of an output.
+  eFluidicTraceSource_t         eSource;
+  FluidicTraceSnapshot_t        snapshot;               ///< Taken before the event was handled.
+  uint8_t                       payloadLen;
+  uint8_t                       payload[FLUIDIC_TRACE_MAX_PAYLOAD];
+}
+FluidicTraceRecord_t;
+
+
+/**
+  *     @brief A trace being recorded. Written by the fluid controller only.
+  **/
+typedef struct FluidicTrace_tag
+{
+  uint8_t                       *pBuf;
+  uint32_t                      size;                   ///< Bytes of pBuf.
+  volatile uint32_t             len;                    ///< Bytes written. Only ever covers whole records.
+  uint32_t                      numRecords;
+  uint32_t                      startMs;                ///< Time of the trace start.
+  uint32_t                      lastMs;                 ///< Time of the latest record.
+  bool                          isTruncated;            ///< A record did not fit. Nothing more is recorded.
+}
+FluidicTrace_t;
+
+
+/**
+  *     @brief Reads the records of a trace, in order.
+  **/
+typedef struct FluidicTraceReader_tag
+{
+  const uint8_t                 *pBuf;
+  uint32_t                      len;
+  uint32_t                      pos;                    ///< Offset of the next record.
+  uint32_t                      timeMs;                 ///< Time of the latest record read.
+  uint8_t                       channel;                ///< Channel from the header.
+}
+FluidicTraceReader_t;
+
+
+/**
+  *     @brief Where two traces first differ.
+  **/
+typedef struct FluidicTraceDiff_tag
+{
+  uint32_t                      numCompared;            ///< Records found in both traces, and compared.
+  uint32_t                      numMismatches;          ///< Compared records which differ.
+  bool                          isLengthSame;           ///< Both traces hold the same number of records.
+  uint32_t                      firstMismatch;          ///< Record index of the first difference. Only valid if numMismatches > 0.
+  FluidicTraceRecord_t          expected;               ///< The first differing record, of each trace.
+  FluidicTraceRecord_t          actual;
+}
+FluidicTraceDiff_t;
+
+
+/** @} */
+void       FluidicTraceInit(FluidicTrace_t *pTrace, uint8_t *pBuf, uint32_t size);
+
+void       FluidicTraceStart(FluidicTrace_t *pTrace, uint8_t channel, uint32_t nowMs);
+
+bool       FluidicTraceAppend(FluidicTrace_t *pTrace,
+                              uint32_t nowMs,
+                              const FluidicTraceRecord_t *pRecord);
+
+void       FluidicTracePutU8(FluidicTraceRecord_t *pRecord, uint8_t value);
+
+void       FluidicTracePutU32(FluidicTraceRecord_t *pRecord, uint32_t value);
+
+void       FluidicTracePutF32(FluidicTraceRecord_t *pRecord, float value);
+
+uint8_t    FluidicTraceGetU8(const FluidicTraceRecord_t *pRecord, uint32_t *pPos);
+
+uint32_t   FluidicTraceGetU32(const FluidicTraceRecord_t *pRecord, uint32_t *pPos);
+
+float      FluidicTraceGetF32(const FluidicTraceRecord_t *pRecord, uint32_t *pPos);
+
+eErrorCode FluidicTraceReaderInit(FluidicTraceReader_t *pReader,
+                                  const uint8_t *pBuf,
+                                  uint32_t len);
+
+bool       FluidicTraceReadNext(FluidicTraceReader_t *pReader, FluidicTraceRecord_t *pRecord);
+
+void       FluidicTraceCompare(const uint8_t *pExpected,
+                               uint32_t expectedLen,
+                               const uint8_t *pActual,
+                               uint32_t actualLen,
+                               FluidicTraceDiff_t *pDiff);
+
+#endif
+
+/********************************** End Of File ******************************/
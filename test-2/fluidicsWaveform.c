@@ -0,0 +1,192 @@
+/**
+******************************************************************************
+* @file         fluidicsWaveform.c
+* @brief        Sampled Piezo waveform of an open loop mix.
+* @details      Builds the lead-in strokes and repeating cycle of a mix into a
+*               buffer the Piezo driver plays out by itself, and reads the
+*               voltage back at any point of the playback.
+******************************************************************************
+*/
+
+#include "fluidicsWaveform.h"
+
+/**
+* @addtogroup FluidicsWaveform
+*  @{
+*/
+
+#define FLUIDIC_WAVEFORM_PI            3.14159265f
+
+
+/**
+  * @brief Initialises an empty waveform.
+  * @param[in] pWaveform - The waveform.
+  * @param[in] eShape - Shape of the strokes.
+  * @param[in] frequency_Hz - Mix frequency. Each stroke is half a period.
+  **/
+void FluidicWaveformInit(FluidicWaveform_t *pWaveform,
+                         eFluidicWaveformShape_t eShape,
+                         float frequency_Hz)
+{
+  float periodUs;
+
+  ASSERT_NOT_NULL(pWaveform);
+  ASSERT((FLUIDIC_WAVEFORM_NONE < eShape) && (FLUIDIC_WAVEFORM_COUNT > eShape));
+  ASSERT(frequency_Hz > 0.f);
+
+  (void)memset(pWaveform, 0, sizeof(FluidicWaveform_t));
+
+  pWaveform->eShape = eShape;
+
+  periodUs = 1000000.f / (2.f * frequency_Hz * (float)FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE);
+  pWaveform->samplePeriodUs = (uint32_t)(periodUs + 0.5f);
+
+  // The driver cannot play faster than one sample per us.
+  if (0u == pWaveform->samplePeriodUs)
+  {
+    pWaveform->samplePeriodUs = 1u;
+  }
+}
+
+
+/**
+  * @brief Appends a stroke.
+  * @param[in] pWaveform - The waveform.
+  * @param[in] startVolts - Piezo voltage at the start of the stroke.
+  * @param[in] endVolts - Piezo voltage at the end of the stroke.
+  * @returns False if the buffer is full, and nothing was added.
+  **/
+bool FluidicWaveformAddStroke(FluidicWaveform_t *pWaveform, float startVolts, float endVolts)
+{
+  bool isAdded = false;
+  float *pSample;
+  float fraction;
+
+  ASSERT_NOT_NULL(pWaveform);
+
+  if ((pWaveform->numSamples + FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE) <= FLUIDIC_WAVEFORM_MAX_SAMPLES)
+  {
+    pSample = &pWaveform->samplesVolts[pWaveform->numSamples];
+
+    for (uint32_t i = 1u; i <= FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE; i++)
+    {
+      fraction = (float)i / (float)FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE;
+
+      if (FLUIDIC_WAVEFORM_SINE == pWaveform->eShape)
+      {
+        fraction = (1.f - cosf(FLUIDIC_WAVEFORM_PI * fraction)) / 2.f;
+      }
+
+      *pSample = startVolts + ((endVolts - startVolts) * fraction);
+      pSample++;
+    }
+
+    pWaveform->numSamples += FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE;
+    isAdded = true;
+  }
+
+  return isAdded;
+}
+
+
+/**
+  * @brief Sets how the strokes are repeated.
+  * @param[in] pWaveform - The waveform, with its strokes added.
+  * @param[in] loopStroke - Stroke played after the last one.
+  * @param[in] totalStrokes - Strokes played before playback stops.
+  **/
+void FluidicWaveformRepeat(FluidicWaveform_t *pWaveform, uint32_t loopStroke, uint32_t totalStrokes)
+{
+  ASSERT_NOT_NULL(pWaveform);
+
+  pWaveform->loopStart    = loopStroke * FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE;
+  pWaveform->totalSamples = totalStrokes * FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE;
+
+  ASSERT(pWaveform->loopStart < pWaveform->numSamples);
+}
+
+
+/**
+  * @brief Gets the voltage of a sample of the playback.
+  * @param[in] pWaveform - The waveform.
+  * @param[in] played - Zero based sample of the playback. Can be beyond the buffer.
+  * @returns The voltage.
+  **/
+float FluidicWaveformSample(const FluidicWaveform_t *pWaveform, uint32_t played)
+{
+  uint32_t index = played;
+
+  ASSERT_NOT_NULL(pWaveform);
+  ASSERT(pWaveform->loopStart < pWaveform->numSamples);
+
+  if (index >= pWaveform->numSamples)
+  {
+    index = pWaveform->loopStart +
+      ((index - pWaveform->loopStart) % (pWaveform->numSamples - pWaveform->loopStart));
+  }
+
+  return pWaveform->samplesVolts[index];
+}
+
+
+/**
+  * @brief Gets the Piezo voltage at a time into the playback.
+  * @param[in] pWaveform - The waveform.
+  * @param[in] elapsedUs - Time since playback started.
+  * @returns The voltage. The last sample once playback has ended.
+  **/
+float FluidicWaveformVoltsAt(const FluidicWaveform_t *pWaveform, uint32_t elapsedUs)
+{
+  uint32_t played;
+
+  ASSERT_NOT_NULL(pWaveform);
+  ASSERT(pWaveform->totalSamples > 0u);
+
+  played = elapsedUs / pWaveform->samplePeriodUs;
+
+  if (played >= pWaveform->totalSamples)
+  {
+    played = pWaveform->totalSamples - 1u;
+  }
+
+  return FluidicWaveformSample(pWaveform, played);
+}
+
+
+/**
+  * @brief Gets the length of the playback.
+  * @param[in] pWaveform - The waveform.
+  * @returns Time from the start of playback until the last sample is reached.
+  **/
+uint32_t FluidicWaveformDurationUs(const FluidicWaveform_t *pWaveform)
+{
+  ASSERT_NOT_NULL(pWaveform);
+
+  return pWaveform->totalSamples * pWaveform->samplePeriodUs;
+}
+
+
+/**
+  * @brief Gets the peak ramp rate of a shape, relative to a triangle.
+  * @param[in] eShape - The shape.
+  * @returns The factor to apply to a stroke's mean ramp rate.
+  **/
+float FluidicWaveformPeakRateFactor(eFluidicWaveformShape_t eShape)
+{
+  float factor = 1.f;
+
+  if (FLUIDIC_WAVEFORM_SINE == eShape)
+  {
+    factor = FLUIDIC_WAVEFORM_PI / 2.f;
+  }
+
+  return factor;
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * @file   fluidicsWaveform.h
+ * @brief  Header file for fluidicsWaveform.c
+ ******************************************************************************
+ */
+
+
+#ifndef FLUIDICS_WAVEFORM_H_
+#define FLUIDICS_WAVEFORM_H_
+
+#include "poci.h"
+#include "piezo.h"
+
+/// The host simulator's Piezo plays waveforms.
+#if defined(FLUIDIC_HOST_SIM) && !defined(FLUIDIC_PIEZO_WAVEFORM)
+#define FLUIDIC_PIEZO_WAVEFORM
+#endif
+
+
+/**
+ * @defgroup FluidicsWaveform Fluidic Mix Waveform
+ * @brief Piezo voltage waveform of a whole open loop mix.
+ * @details An open loop mix is fully known before it starts, so rather than
+ *          one Piezo ramp per stroke it can be handed to the Piezo driver as
+ *          a sampled waveform, which the driver plays out from its own timer.
+ *          The fluid controller then only hears from the Piezo once, when the
+ *          whole mix has been played.
+ *
+ *          The buffer holds FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE samples per
+ *          stroke, each stroke being half of the mix period. The driver plays
+ *          the buffer from the start, then repeats it from loopStart until
+ *          totalSamples samples have been played. So a mix is stored as its
+ *          lead-in strokes and one repeating cycle, however many cycles it
+ *          has.
+ *
+ *          Each sample is held for samplePeriodUs. A stroke's samples finish
+ *          at its end voltage, the stroke's start being the previous stroke's
+ *          end.
+ *
+ *          Define FLUIDIC_PIEZO_WAVEFORM in builds whose Piezo driver
+ *          provides piezoWaveformPlay(). Without it eMixWaveform is ignored,
+ *          and open loop mixes are played one ramp per stroke.
+ *  @{
+ */
+
+
+/// Samples per stroke.
+#define FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE  16u
+
+/// Strokes held by a waveform buffer.
+#define FLUIDIC_WAVEFORM_MAX_STROKES         4u
+
+/// Samples held by a waveform buffer.
+#define FLUIDIC_WAVEFORM_MAX_SAMPLES         (FLUIDIC_WAVEFORM_SAMPLES_PER_STROKE * FLUIDIC_WAVEFORM_MAX_STROKES)
+
+
+/**
+  *     @brief Shape of each stroke.
+  **/
+typedef enum
+{
+  FLUIDIC_WAVEFORM_NONE = 0,            ///< No waveform. The mix is played one ramp per stroke.
+  FLUIDIC_WAVEFORM_TRIANGLE,            ///< Constant ramp rate, as the ramp per stroke.
+  FLUIDIC_WAVEFORM_SINE,                ///< Half a cosine per stroke. Gentler turns, but a peak rate pi/2 times the triangle's.
+  FLUIDIC_WAVEFORM_COUNT
+}
+eFluidicWaveformShape_t;
+
+
+/**
+  *     @brief A waveform, as played by piezoWaveformPlay().
+  **/
+typedef struct FluidicWaveform_tag
+{
+  float                         samplesVolts[FLUIDIC_WAVEFORM_MAX_SAMPLES];
+  uint32_t                      numSamples;             ///< Samples in samplesVolts.
+  uint32_t                      loopStart;              ///< Sample played after the last one.
+  uint32_t                      totalSamples;           ///< Samples played before playback stops.
+  uint32_t                      samplePeriodUs;
+  eFluidicWaveformShape_t       eShape;
+}
+FluidicWaveform_t;
+
+
+/** @} */
+void       FluidicWaveformInit(FluidicWaveform_t *pWaveform,
+                               eFluidicWaveformShape_t eShape,
+                               float frequency_Hz);
+
+bool       FluidicWaveformAddStroke(FluidicWaveform_t *pWaveform, float startVolts, float endVolts);
+
+void       FluidicWaveformRepeat(FluidicWaveform_t *pWaveform, uint32_t loopStroke, uint32_t totalStrokes);
+
+float      FluidicWaveformSample(const FluidicWaveform_t *pWaveform, uint32_t played);
+
+float      FluidicWaveformVoltsAt(const FluidicWaveform_t *pWaveform, uint32_t elapsedUs);
+
+uint32_t   FluidicWaveformDurationUs(const FluidicWaveform_t *pWaveform);
+
+float      FluidicWaveformPeakRateFactor(eFluidicWaveformShape_t eShape);
+
+
+/**
+  *     @brief Plays a waveform out on the Piezo. Provided by the Piezo driver.
+  *     @details Playback starts from the current voltage. XMSG_PIEZO_MOVE_COMPLTE
+  *              is published once totalSamples have been played, with the
+  *              Piezo holding the last of them. piezoVoltageSet(), piezoStop()
+  *              and piezoHome() end playback early. The waveform is read as it
+  *              plays, so must not change until playback ends.
+  *     @param[in] pPiezo - The Piezo.
+  *     @param[in] pWaveform - The waveform.
+  *     @retval OK_COMMAND_ACCEPTED
+  **/
+#ifdef FLUIDIC_PIEZO_WAVEFORM
+eErrorCode piezoWaveformPlay(piezo_t *pPiezo, const FluidicWaveform_t *pWaveform);
+#endif
+
+#endif
+
+/********************************** End Of File ******************************/
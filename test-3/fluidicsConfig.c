@@ -2,7 +2,7 @@
  ******************************************************************************
  * @file        fluidicsConfig.c
  * @author      TMW
- * @brief       Fluidics - Configuration settings.      
+ * @brief       Fluidics - Configuration settings.
  ******************************************************************************
  */
 
@@ -19,206 +19,73 @@
 */
 
 
-
 /**
-  *     @brief Configuration for Bladder 1.
-  *     @note All distances are based on experimentation with drivers.
+  *     @brief Parameters of a position set.
+  *     @details Only the positions differ between sets.
   */
-FluidicParams_t bladder1DefaultParams = 
-{
-   .positionLimits[BC_POS_HOME].targetVolts                       = PIEZO_VOLT_MAX,
-   .positionLimits[BC_POS_HOME].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE,
-   
-   .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_FWD]     = FD_DATA_INVALID,
-   .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_REV]     = FD_DATA_INVALID,
-    
-   .positionLimits[BC_POS_DOWN].targetVolts                       = PIEZO_MIN_VOLTAGE,
-   .positionLimits[BC_POS_DOWN].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE,
-   
-   .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_FWD]     = NO_FLUID_DETECTED,
-   .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_REV]     = FLUID_DETECTED,
-   
-   .positionLimits[BC_POS_FLUID_A].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_A].posHysterisis                      = FLUIDIC_POS_A_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_A,
-   .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_REV]  = FLUID_DETECTED,
-   
-   .positionLimits[BC_POS_FLUID_B].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_B].posHysterisis                      = FLUIDIC_DEFAULT_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_B,
-   .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_A,
-   
-   .positionLimits[BC_POS_FLUID_C].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_C].posHysterisis                      = FLUIDIC_DEFAULT_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_C,
-   .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_B,   
-  
-   .hysterisisMultipliersVolts[FLUID_HYST_INC]                             = FLUID_HYST_MULTIPLIER_INC_DEFAULT,
-   .hysterisisMultipliersVolts[FLUID_HYST_DEC]                             = FLUID_HYST_MULTIPLIER_DEC_DEFAULT,
-    
-  .eChannel                                                           = EC_STRIP_CHAN_1,
-                                      
-  .timeout_ms                                                         = FLUIDIC_DEFAULT_TIMEOUT_30S,
-  .mixFrequency_Hz                                                    = FLUIDIC_DEFAULT_MIX_FREQ,
-  .rampSpeedVoltsPerSec                                               = FLUID_SPEED_LOW_DEFAULT_V_PER_S,
-  .mixTimeoutMax_ms                                                   = FLUIDIC_MAX_MIX_TIMEOUT_DEFAULT_MS,
-  .eMixEndPosition                                                    = BC_POS_UNKNOWN,
-  .returnSpeedRedcutionFactor                                        = FLUID_RETURN_SPEED_REDUCTION_FACTOR,
+#define FLUIDIC_POSITIONS_PARAMS(positions_) \
+const FluidicParams_t fluidicParams##positions_ = \
+{ \
+  .positionLimits[BC_POS_HOME].targetVolts                           = PIEZO_VOLT_MAX, \
+  .positionLimits[BC_POS_HOME].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE, \
+  .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_FWD]     = FD_DATA_INVALID, \
+  .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_REV]     = FD_DATA_INVALID, \
+  \
+  .positionLimits[BC_POS_DOWN].targetVolts                           = PIEZO_MIN_VOLTAGE, \
+  .positionLimits[BC_POS_DOWN].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE, \
+  .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_FWD]     = NO_FLUID_DETECTED, \
+  .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_REV]     = FLUID_DETECTED, \
+  \
+  .positionLimits[BC_POS_FLUID_A].targetVolts                        = FLUIDIC_POSITIONS_##positions_##_A_V, \
+  .positionLimits[BC_POS_FLUID_A].posHysterisis                      = FLUIDIC_POSITIONS_##positions_##_A_HYST_V, \
+  .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_A, \
+  .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_REV]  = FLUID_DETECTED, \
+  \
+  .positionLimits[BC_POS_FLUID_B].targetVolts                        = FLUIDIC_POSITIONS_##positions_##_B_V, \
+  .positionLimits[BC_POS_FLUID_B].posHysterisis                      = FLUIDIC_POSITIONS_##positions_##_B_HYST_V, \
+  .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_B, \
+  .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_A, \
+  \
+  .positionLimits[BC_POS_FLUID_C].targetVolts                        = FLUIDIC_POSITIONS_##positions_##_C_V, \
+  .positionLimits[BC_POS_FLUID_C].posHysterisis                      = FLUIDIC_POSITIONS_##positions_##_C_HYST_V, \
+  .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_C, \
+  .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_B, \
+  \
+  .hysterisisMultipliersVolts[FLUID_HYST_INC]                        = FLUID_HYST_MULTIPLIER_INC_DEFAULT, \
+  .hysterisisMultipliersVolts[FLUID_HYST_DEC]                        = FLUID_HYST_MULTIPLIER_DEC_DEFAULT, \
+  \
+  .approachWindowVolts                                               = FLUID_APPROACH_WINDOW_DEFAULT_V, \
+  .predictiveStopLeadMs                                              = FLUID_PREDICTIVE_STOP_LEAD_DEFAULT_MS, \
+  \
+  .eMixController                                                    = FLUID_MIX_CTRL_PI, \
+  .mixPiGains.kp                                                     = FLUID_MIX_PI_KP_DEFAULT, \
+  .mixPiGains.ki                                                     = FLUID_MIX_PI_KI_DEFAULT, \
+  .mixPiGains.spreadFilter                                           = FLUID_MIX_PI_SPREAD_FILTER_DEFAULT, \
+  .mixPiGains.spreadGain                                             = FLUID_MIX_PI_SPREAD_GAIN_DEFAULT, \
+  \
+  .timeout_ms                                                        = FLUIDIC_DEFAULT_TIMEOUT_30S, \
+  .mixFrequency_Hz                                                   = FLUIDIC_DEFAULT_MIX_FREQ, \
+  .rampSpeedVoltsPerSec                                              = FLUID_SPEED_LOW_DEFAULT_V_PER_S, \
+  .mixTimeoutMax_ms                                                  = FLUIDIC_MAX_MIX_TIMEOUT_DEFAULT_MS, \
+  .eMixEndPosition                                                   = BC_POS_UNKNOWN, \
+  .returnSpeedRedcutionFactor                                        = FLUID_RETURN_SPEED_REDUCTION_FACTOR, \
 };
 
 
 /**
-  *     @brief Configuration for Bladder 2.
-  *     @note All distances are based on experimentation with drivers.
+  *     @brief Configuration of a bladder.
   */
-FluidicParams_t bladder2DefaultParams = 
-{
-   .positionLimits[BC_POS_HOME].targetVolts                       = PIEZO_VOLT_MAX,
-   .positionLimits[BC_POS_HOME].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE,
-   
-   .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_FWD]     = FD_DATA_INVALID,
-   .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_REV]     = FD_DATA_INVALID,
-    
-   .positionLimits[BC_POS_DOWN].targetVolts                       = PIEZO_MIN_VOLTAGE,
-   .positionLimits[BC_POS_DOWN].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE,
-   
-   .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_FWD]     = NO_FLUID_DETECTED,
-   .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_REV]     = FLUID_DETECTED,
-   
-   .positionLimits[BC_POS_FLUID_A].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_A].posHysterisis                      = FLUIDIC_POS_A_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_A,
-   .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_REV]  = FLUID_DETECTED,
-   
-   .positionLimits[BC_POS_FLUID_B].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_B].posHysterisis                      = FLUIDIC_DEFAULT_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_B,
-   .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_A,
-   
-   .positionLimits[BC_POS_FLUID_C].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_C].posHysterisis                      = FLUIDIC_DEFAULT_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_C,
-   .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_B,
-  
-   .hysterisisMultipliersVolts[FLUID_HYST_INC]                             = FLUID_HYST_MULTIPLIER_INC_DEFAULT,
-   .hysterisisMultipliersVolts[FLUID_HYST_DEC]                             = FLUID_HYST_MULTIPLIER_DEC_DEFAULT,
-
-  .eChannel                                                           = EC_STRIP_CHAN_2,
-                                      
-  .timeout_ms                                                         = FLUIDIC_DEFAULT_TIMEOUT_30S,
-  .mixFrequency_Hz                                                    = FLUIDIC_DEFAULT_MIX_FREQ,
-  .rampSpeedVoltsPerSec                                                          = FLUID_SPEED_LOW_DEFAULT_V_PER_S,
-  .mixTimeoutMax_ms                                                   = FLUIDIC_MAX_MIX_TIMEOUT_DEFAULT_MS,
-  .eMixEndPosition                                                    = BC_POS_UNKNOWN,
-  .returnSpeedRedcutionFactor                                        = FLUID_RETURN_SPEED_REDUCTION_FACTOR,
+#define FLUIDIC_CONFIG_CHANNEL(name_, eChannel_, positions_) \
+const FluidicConfig_t name_ = \
+{ \
+  .pParams  = &fluidicParams##positions_, \
+  .eChannel = eChannel_, \
 };
 
 
-/**
-  *     @brief Configuration for Bladder 1.
-  *     @note All distances are based on experimentation with drivers.
-  */
-FluidicParams_t bladder3DefaultParams = 
-{
-   .positionLimits[BC_POS_HOME].targetVolts                       = PIEZO_VOLT_MAX,
-   .positionLimits[BC_POS_HOME].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE,
-   
-   .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_FWD]     = FD_DATA_INVALID,
-   .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_REV]     = FD_DATA_INVALID,
-    
-   .positionLimits[BC_POS_DOWN].targetVolts                       = PIEZO_MIN_VOLTAGE,
-   .positionLimits[BC_POS_DOWN].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE,
-   
-   .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_FWD]     = NO_FLUID_DETECTED,
-   .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_REV]     = FLUID_DETECTED,
-   
-   .positionLimits[BC_POS_FLUID_A].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_A].posHysterisis                      = FLUIDIC_POS_A_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_A,
-   .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_REV]  = FLUID_DETECTED,
-   
-   .positionLimits[BC_POS_FLUID_B].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_B].posHysterisis                      = FLUIDIC_DEFAULT_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_B,
-   .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_A,
-   
-   .positionLimits[BC_POS_FLUID_C].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_C].posHysterisis                      = FLUIDIC_DEFAULT_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_C,
-   .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_B,   
-  
-   .hysterisisMultipliersVolts[FLUID_HYST_INC]                             = FLUID_HYST_MULTIPLIER_INC_DEFAULT,
-   .hysterisisMultipliersVolts[FLUID_HYST_DEC]                             = FLUID_HYST_MULTIPLIER_DEC_DEFAULT,
-  
-  .eChannel                                                           = EC_STRIP_CHAN_3,
-                                    
-  .timeout_ms                                                         = FLUIDIC_DEFAULT_TIMEOUT_30S,
-  .mixFrequency_Hz                                                    = FLUIDIC_DEFAULT_MIX_FREQ,
-  .rampSpeedVoltsPerSec                                                          = FLUID_SPEED_LOW_DEFAULT_V_PER_S,
-  .mixTimeoutMax_ms                                                   = FLUIDIC_MAX_MIX_TIMEOUT_DEFAULT_MS,
-  .eMixEndPosition                                                    = BC_POS_UNKNOWN,
-  .returnSpeedRedcutionFactor                                        = FLUID_RETURN_SPEED_REDUCTION_FACTOR,
-};
-
-
-/**
-  *     @brief Configuration for Bladder 4.
-  *     @note All distances are based on experimentation with drivers.
-  */
-FluidicParams_t bladder4DefaultParams = 
-{
-   .positionLimits[BC_POS_HOME].targetVolts                       = PIEZO_VOLT_MAX,
-   .positionLimits[BC_POS_HOME].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE,
-   
-   .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_FWD]     = FD_DATA_INVALID,
-   .positionLimits[BC_POS_HOME].echemRequirements[FLUID_MOVE_REV]     = FD_DATA_INVALID,
-    
-   .positionLimits[BC_POS_DOWN].targetVolts                       = PIEZO_MIN_VOLTAGE,
-   .positionLimits[BC_POS_DOWN].posHysterisis                         = FLUIDIC_HYSTERISIS_NONE,
-   
-   .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_FWD]     = NO_FLUID_DETECTED,
-   .positionLimits[BC_POS_DOWN].echemRequirements[FLUID_MOVE_REV]     = FLUID_DETECTED,
-   
-   .positionLimits[BC_POS_FLUID_A].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_A].posHysterisis                      = FLUIDIC_POS_A_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_A,
-   .positionLimits[BC_POS_FLUID_A].echemRequirements[FLUID_MOVE_REV]  = FLUID_DETECTED,
-   
-   .positionLimits[BC_POS_FLUID_B].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_B].posHysterisis                      = FLUIDIC_DEFAULT_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_B,
-   .positionLimits[BC_POS_FLUID_B].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_A,
-   
-   .positionLimits[BC_POS_FLUID_C].targetVolts                    = FLUIDIC_DEFAULT_TARGET_POSITION,
-   .positionLimits[BC_POS_FLUID_C].posHysterisis                      = FLUIDIC_DEFAULT_HYSTERISIS_V,
-   
-   .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_FWD]  = FLUID_POSITION_C,
-   .positionLimits[BC_POS_FLUID_C].echemRequirements[FLUID_MOVE_REV]  = FLUID_POSITION_B,  
-  
-   .hysterisisMultipliersVolts[FLUID_HYST_INC]                             = FLUID_HYST_MULTIPLIER_INC_DEFAULT,
-   .hysterisisMultipliersVolts[FLUID_HYST_DEC]                             = FLUID_HYST_MULTIPLIER_DEC_DEFAULT,
-  
-   .eChannel                                                          = EC_STRIP_CHAN_4,
-                                      
-   .timeout_ms                                                        = FLUIDIC_DEFAULT_TIMEOUT_30S,
-   .mixFrequency_Hz                                                   = FLUIDIC_DEFAULT_MIX_FREQ,
-   .rampSpeedVoltsPerSec                                                         = FLUID_SPEED_LOW_DEFAULT_V_PER_S,
-   .mixTimeoutMax_ms                                                  = FLUIDIC_MAX_MIX_TIMEOUT_DEFAULT_MS,
-   .eMixEndPosition                                                   = BC_POS_UNKNOWN,
-   .returnSpeedRedcutionFactor                                        = FLUID_RETURN_SPEED_REDUCTION_FACTOR,
-};
+FLUIDIC_POSITIONS_TABLE(FLUIDIC_POSITIONS_PARAMS)
 
+FLUIDIC_CONFIG_TABLE(FLUIDIC_CONFIG_CHANNEL)
 
 
 /**
@@ -226,4 +93,3 @@ FluidicParams_t bladder4DefaultParams =
   */
 
 /********************************** End Of File ******************************/
-
@@ -2,11 +2,11 @@
  ******************************************************************************
  * @file        fluidicsConfig.h
  * @author      TMW
- * @brief      Fluidics - Configuration settings.      
+ * @brief      Fluidics - Configuration settings.
  ******************************************************************************
  */
 
-  
+
 #ifndef FLUIDICS_CONFIG_H_
 #define FLUIDICS_CONFIG_H_
 
@@ -18,14 +18,69 @@
  *      @defgroup fluidicsConfig Fluidics
  *      @{
  *      @brief      Contains startup configuation settings for bladder controllers.
- *      @details    Each bladder controller contains a default parameters structure.
+ *      @details    Each bladder controller has a default configuration: its
+ *                  channel and a parameters structure. The structures are
+ *                  constant, the controllers copy the values they change at
+ *                  run time.
+ *
+ *                  One parameters structure is generated per position set of
+ *                  FLUIDIC_POSITIONS_TABLE, from its FLUIDIC_POSITIONS_<set>_*
+ *                  values. Everything else is common to every set. Bladders
+ *                  using the same set share its structure, so it is held in
+ *                  flash once. FLUIDIC_CONFIG_TABLE then gives each bladder its
+ *                  channel and set. A strip variant is added as a new set, and
+ *                  a bladder as a new row. FluidicInit() checks the positions.
 */
 
 
-extern FluidicParams_t bladder1DefaultParams;
-extern FluidicParams_t bladder2DefaultParams;
-extern FluidicParams_t bladder3DefaultParams;
-extern FluidicParams_t bladder4DefaultParams;
+// Standard strip. The contact voltages are learned, so start every contact
+// high enough to be passed, but low enough not to lift the bladder.
+#define FLUIDIC_POSITIONS_STD_A_V         FLUIDIC_DEFAULT_TARGET_POSITION
+#define FLUIDIC_POSITIONS_STD_B_V         FLUIDIC_DEFAULT_TARGET_POSITION
+#define FLUIDIC_POSITIONS_STD_C_V         FLUIDIC_DEFAULT_TARGET_POSITION
+#define FLUIDIC_POSITIONS_STD_A_HYST_V    FLUIDIC_POS_A_HYSTERISIS_V
+#define FLUIDIC_POSITIONS_STD_B_HYST_V    FLUIDIC_DEFAULT_HYSTERISIS_V
+#define FLUIDIC_POSITIONS_STD_C_HYST_V    FLUIDIC_DEFAULT_HYSTERISIS_V
+
+
+/**
+  *     @brief The position sets.
+  *     @details Column: name of the set. Its parameters are fluidicParams<set>.
+  */
+#define FLUIDIC_POSITIONS_TABLE(X_) \
+  X_(STD)
+
+
+/**
+  *     @brief The bladders.
+  *     @details Columns: name of the configuration, echem channel, position set.
+  *     @note All distances are based on experimentation with drivers.
+  */
+#define FLUIDIC_CONFIG_TABLE(X_) \
+  X_(bladder1DefaultConfig,   EC_STRIP_CHAN_1,   STD) \
+  X_(bladder2DefaultConfig,   EC_STRIP_CHAN_2,   STD) \
+  X_(bladder3DefaultConfig,   EC_STRIP_CHAN_3,   STD) \
+  X_(bladder4DefaultConfig,   EC_STRIP_CHAN_4,   STD)
+
+
+/**
+  *     @brief Default configuration of a bladder. Its fields are the
+  *            FluidicInitParams_t fields of the same names.
+  */
+typedef struct FluidicConfig_tag
+{
+  const FluidicParams_t         *pParams;             ///< Shared by the bladders with the same position set.
+  eElectrochemicalChannel       eChannel;             ///< Fluid channel which the bladder controls.
+}
+FluidicConfig_t;
+
+
+#define FLUIDIC_POSITIONS_EXTERN(positions_)                  extern const FluidicParams_t fluidicParams##positions_;
+#define FLUIDIC_CONFIG_EXTERN(name_, eChannel_, positions_)   extern const FluidicConfig_t name_;
+
+FLUIDIC_POSITIONS_TABLE(FLUIDIC_POSITIONS_EXTERN)
+
+FLUIDIC_CONFIG_TABLE(FLUIDIC_CONFIG_EXTERN)
 
 /**
   *     @}
@@ -35,7 +90,7 @@ extern FluidicParams_t bladder4DefaultParams;
 /** @}*/
 
 /** @}*/
- 
+
 #endif
 
 
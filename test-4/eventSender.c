@@ -64,6 +64,7 @@ STATIC void EventSenderOnRealTimeInrClotResult(XEvent_t const * pEvent);
 
 STATIC void EventSenderProcessCommandFailedEvent(EventSender_t * pEventSender,
                                                  XEvent_t const * pEvent);
+STATIC void EventSenderFluidicStatsPrint(const char *pLine, void *pCtx);
 
 
 /**
@@ -343,6 +344,43 @@ STATIC void EventNotifyScheduler(XEvent_t const* pEvent)
 
 
 
+/**
+* @brief  Console command. Dumps the latency histograms of a fluid channel.
+* @details The channel prints the dump from its own thread, and each line is
+*          published to the console as an XMSG_FLUID_STATS_DUMP event.
+* @param pFluidic The fluid channel.
+* @param reset Empty the histograms once dumped.
+* @returns The result of FluidicStatsDumpRequest().
+*/
+eErrorCode EventSenderFluidicStatsDump(Fluidic_t* pFluidic, bool reset)
+{
+  ASSERT_NOT_NULL(pFluidic);
+  
+  return FluidicStatsDumpRequest(pFluidic,
+                                 EventSenderFluidicStatsPrint,
+                                 NULL,
+                                 reset);
+}
+
+
+
+/**
+* @brief  Publishes a line of a fluid channel's histogram dump to the Console.
+* @param pLine The line.
+* @param pCtx Unused.
+*/
+STATIC void EventSenderFluidicStatsPrint(const char *pLine, void *pCtx)
+{
+  (void)pCtx;
+  
+  Console_PublishEvent("INS",
+                       (uint32_t)XMSG_FLUID_STATS_DUMP,
+                       XMsgIdLookup(XMSG_FLUID_STATS_DUMP),
+                       pLine);
+}
+
+
+
 /**
 * @brief  Helper to send an event to the Console  .
 *
@@ -21,6 +21,7 @@
 
 #include "poci.h"
 #include "xActive.h"
+#include "fluidics.h"
  
 
 
@@ -58,6 +59,8 @@ void EventSenderInit(EventSender_t* me,
                      const EventSenderParams_t* pParams,
                      XActiveFramework_t* pXActiveFramework);
 
+eErrorCode EventSenderFluidicStatsDump(Fluidic_t* pFluidic, bool reset);
+
 
 /**
   * @}
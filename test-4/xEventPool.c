@@ -0,0 +1,219 @@
+/**
+******************************************************************************
+* @file         xEventPool.c
+* @brief        Fixed-block pool of reference counted events.
+* @details      Free blocks form a singly linked list through their headers,
+*               so taking and returning a block is O(1).
+******************************************************************************
+*/
+
+#include "xEventPool.h"
+
+/**
+* @addtogroup xEventPool
+*  @{
+*/
+
+STATIC XEventPoolHdr_t* XEventPoolHdr(const XEventPool_t *pPool, const XEvent_t *pEv);
+
+
+/**
+  * @brief Initialises a pool, with every block free.
+  * @param[in] pPool - The pool.
+  * @param[in] pStorage - Blocks of the pool. Sized with X_EVENT_POOL_STORAGE_LEN().
+  * @param[in] storageLen - Length of pStorage.
+  * @param[in] eventSize - Bytes of the largest event the pool holds.
+  **/
+void XEventPoolInit(XEventPool_t *pPool,
+                    uint64_t *pStorage,
+                    uint32_t storageLen,
+                    uint32_t eventSize)
+{
+  XEventPoolHdr_t *pHdr;
+
+  ASSERT_NOT_NULL(pPool);
+  ASSERT_NOT_NULL(pStorage);
+  ASSERT(eventSize >= sizeof(XEvent_t));
+
+  (void)memset(pPool, 0, sizeof(XEventPool_t));
+
+  pPool->pStorage = (uint8_t*)pStorage;
+  pPool->eventSize = eventSize;
+  pPool->blockSize = X_EVENT_POOL_BLOCK_SIZE(eventSize);
+  pPool->numBlocks = (storageLen * 8u) / pPool->blockSize;
+
+  ASSERT(pPool->numBlocks > 0u);
+
+  // Free list in storage order.
+  for (uint32_t i = pPool->numBlocks; i > 0u; i--)
+  {
+    pHdr = (XEventPoolHdr_t*)&(pPool->pStorage[(i - 1u) * pPool->blockSize]);
+    pHdr->refCount = 0u;
+    pHdr->pNextFree = pPool->pFree;
+    pPool->pFree = pHdr;
+  }
+
+  pPool->numFree = pPool->numBlocks;
+  pPool->minFree = pPool->numBlocks;
+}
+
+
+/**
+  * @brief Takes an event from a pool, holding one reference.
+  * @param[in] pPool - The pool.
+  * @param[in] eventSize - Bytes of the event. No more than the pool's eventSize.
+  * @param[in] id - Event id.
+  * @param[in] pSender - Sender of the event.
+  * @returns The event, with its payload zeroed, or NULL if the pool is empty.
+  **/
+XEvent_t* XEventPoolNew(XEventPool_t *pPool, uint32_t eventSize, eXEventId id, void *pSender)
+{
+  XEventPoolHdr_t *pHdr;
+  XEvent_t *pEv = NULL;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(pPool);
+  ASSERT(eventSize <= pPool->eventSize);
+
+  critical = XPortCriticalEnter();
+
+  pHdr = pPool->pFree;
+
+  if (NULL != pHdr)
+  {
+    pPool->pFree = pHdr->pNextFree;
+    pPool->numFree--;
+
+    if (pPool->numFree < pPool->minFree)
+    {
+      pPool->minFree = pPool->numFree;
+    }
+
+    pHdr->pNextFree = NULL;
+    pHdr->refCount = 1u;
+  }
+  else
+  {
+    pPool->numFailed++;
+  }
+
+  XPortCriticalExit(critical);
+
+  if (NULL != pHdr)
+  {
+    pEv = (XEvent_t*)&(((uint8_t*)pHdr)[X_EVENT_POOL_HDR_SIZE]);
+
+    (void)memset(pEv, 0, eventSize);
+    X_EV_INIT(pEv, id, pSender);
+  }
+
+  return pEv;
+}
+
+
+/**
+  * @brief Adds a reference to an event, for one more receiver.
+  * @param[in] pPool - The pool.
+  * @param[in] pEv - The event. Must be from the pool, and hold a reference.
+  **/
+void XEventPoolRetain(XEventPool_t *pPool, const XEvent_t *pEv)
+{
+  XEventPoolHdr_t *pHdr;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(pPool);
+
+  pHdr = XEventPoolHdr(pPool, pEv);
+
+  ASSERT_NOT_NULL(pHdr);
+
+  critical = XPortCriticalEnter();
+
+  ASSERT(pHdr->refCount > 0u);
+  pHdr->refCount++;
+
+  XPortCriticalExit(critical);
+}
+
+
+/**
+  * @brief Drops a reference to an event, returning it to the pool with the last.
+  * @param[in] pPool - The pool.
+  * @param[in] pEv - The event. Nothing is done if it is not from the pool.
+  **/
+void XEventPoolRelease(XEventPool_t *pPool, const XEvent_t *pEv)
+{
+  XEventPoolHdr_t *pHdr;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(pPool);
+
+  pHdr = XEventPoolHdr(pPool, pEv);
+
+  if (NULL != pHdr)
+  {
+    critical = XPortCriticalEnter();
+
+    ASSERT(pHdr->refCount > 0u);
+    pHdr->refCount--;
+
+    if (0u == pHdr->refCount)
+    {
+      pHdr->pNextFree = pPool->pFree;
+      pPool->pFree = pHdr;
+      pPool->numFree++;
+    }
+
+    XPortCriticalExit(critical);
+  }
+}
+
+
+/**
+  * @brief Checks whether an event is from a pool.
+  * @param[in] pPool - The pool.
+  * @param[in] pEv - The event.
+  * @returns True if pEv is the event of one of the pool's blocks.
+  **/
+bool XEventPoolOwns(const XEventPool_t *pPool, const XEvent_t *pEv)
+{
+  ASSERT_NOT_NULL(pPool);
+
+  return (NULL != XEventPoolHdr(pPool, pEv));
+}
+
+
+/**
+  * @brief Finds the header of a pool event.
+  * @param[in] pPool - The pool.
+  * @param[in] pEv - The event.
+  * @returns The header, or NULL if pEv is not the event of a pool block.
+  **/
+STATIC XEventPoolHdr_t* XEventPoolHdr(const XEventPool_t *pPool, const XEvent_t *pEv)
+{
+  XEventPoolHdr_t *pHdr = NULL;
+  uintptr_t addr = (uintptr_t)pEv;
+  uintptr_t first = (uintptr_t)pPool->pStorage + X_EVENT_POOL_HDR_SIZE;
+  uintptr_t offset;
+
+  if (addr >= first)
+  {
+    offset = addr - first;
+
+    if ((offset < ((uintptr_t)pPool->numBlocks * pPool->blockSize)) &&
+        (0u == (offset % pPool->blockSize)))
+    {
+      pHdr = (XEventPoolHdr_t*)(addr - X_EVENT_POOL_HDR_SIZE);
+    }
+  }
+
+  return pHdr;
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
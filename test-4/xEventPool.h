@@ -0,0 +1,95 @@
+/**
+ ******************************************************************************
+ * @file   xEventPool.h
+ * @brief  Header file for xEventPool.c
+ ******************************************************************************
+ */
+
+
+#ifndef X_EVENT_POOL_H_
+#define X_EVENT_POOL_H_
+
+#include "poci.h"
+
+#ifndef XACTIVE_H_
+#include "xActive.h"
+#endif
+#include "xPort.h"
+
+
+/**
+ * @defgroup xEventPool Event Pool
+ * @brief Fixed-block, reference counted events.
+ * @details An event with a payload, taken from a pool for each post, cannot
+ *          be overwritten by a later post whilst it is still queued, so an
+ *          API can be called again before its previous event is handled.
+ *
+ *          A new event holds one reference, which passes to the receiver
+ *          along with the post. An event posted or published to several
+ *          receivers is retained once per extra receiver. Each receiver
+ *          releases its reference once it has handled the event, and the
+ *          block returns to the pool with the last release. Releasing an
+ *          event which is not from the pool does nothing, so a receiver can
+ *          release every event it handles.
+ *
+ *          Blocks are all one size, set by the largest event the pool holds.
+ *          The pool can be shared between threads.
+ *  @{
+ */
+
+
+/**
+  *     @brief Header of a pool block, ahead of the event.
+  **/
+typedef struct XEventPoolHdr_tag
+{
+  struct XEventPoolHdr_tag      *pNextFree;             ///< Next free block. Only valid whilst the block is free.
+  uint32_t                      refCount;               ///< 0 whilst the block is free.
+}
+XEventPoolHdr_t;
+
+
+/// Bytes of a block header, keeping the event 8 byte aligned.
+#define X_EVENT_POOL_HDR_SIZE             ((sizeof(XEventPoolHdr_t) + 7u) & ~7u)
+
+/// Bytes of a block holding events of up to eventSize_ bytes.
+#define X_EVENT_POOL_BLOCK_SIZE(eventSize_)   (X_EVENT_POOL_HDR_SIZE + (((eventSize_) + 7u) & ~7u))
+
+/// Length of a uint64_t array holding numEvents_ events of up to eventSize_ bytes.
+#define X_EVENT_POOL_STORAGE_LEN(eventSize_, numEvents_)  ((X_EVENT_POOL_BLOCK_SIZE(eventSize_) / 8u) * (numEvents_))
+
+
+/**
+  *     @brief A pool of events.
+  **/
+typedef struct XEventPool_tag
+{
+  uint8_t                       *pStorage;
+  uint32_t                      eventSize;              ///< Largest event a block holds.
+  uint32_t                      blockSize;
+  uint32_t                      numBlocks;
+  XEventPoolHdr_t               *pFree;                 ///< Free blocks, most recently released first.
+  uint32_t                      numFree;
+  uint32_t                      minFree;                ///< Lowest numFree has been. Sizes the pool.
+  uint32_t                      numFailed;              ///< Events refused as the pool was empty.
+}
+XEventPool_t;
+
+
+/** @} */
+void       XEventPoolInit(XEventPool_t *pPool,
+                          uint64_t *pStorage,
+                          uint32_t storageLen,
+                          uint32_t eventSize);
+
+XEvent_t*  XEventPoolNew(XEventPool_t *pPool, uint32_t eventSize, eXEventId id, void *pSender);
+
+void       XEventPoolRetain(XEventPool_t *pPool, const XEvent_t *pEv);
+
+void       XEventPoolRelease(XEventPool_t *pPool, const XEvent_t *pEv);
+
+bool       XEventPoolOwns(const XEventPool_t *pPool, const XEvent_t *pEv);
+
+#endif
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,41 @@
+/**
+ ******************************************************************************
+ * @file   xPort.h
+ * @brief  OS primitives of the XActive port.
+ ******************************************************************************
+ */
+
+
+#ifndef X_PORT_H_
+#define X_PORT_H_
+
+#include "poci.h"
+
+
+/**
+ * @defgroup xPort XActive Port
+ * @brief The few OS primitives the framework and application layers use.
+ * @details Code above the port calls these rather than the RTOS, so it builds
+ *          unchanged against any port. xPortThreadX.c implements them on
+ *          ThreadX. The host simulator implements them on its virtual clock.
+ *
+ *          A critical section keeps out every other thread and interrupt. It
+ *          is entered with XPortCriticalEnter(), which returns the state to
+ *          hand back to XPortCriticalExit(), so sections can nest. Keep them
+ *          short: interrupts are held off for their whole length.
+ *  @{
+ */
+
+
+/** @} */
+uint32_t   XPortTimeNowMs(void);
+
+uint32_t   XPortCriticalEnter(void);
+
+void       XPortCriticalExit(uint32_t saved);
+
+void       XPortMemoryBarrier(void);
+
+#endif
+
+/********************************** End Of File ******************************/
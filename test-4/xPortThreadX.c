@@ -0,0 +1,62 @@
+/**
+******************************************************************************
+* @file         xPortThreadX.c
+* @brief        XActive port primitives on ThreadX.
+* @details      The only file above the drivers which calls ThreadX directly.
+******************************************************************************
+*/
+
+#include "xPort.h"
+
+/**
+* @addtogroup xPort
+*  @{
+*/
+
+
+/**
+  * @brief Gets the time since start up.
+  * @returns Milliseconds. Wraps after 2^32 ms, so compare times by difference.
+  **/
+uint32_t XPortTimeNowMs(void)
+{
+  return (uint32_t)(((uint64_t)tx_time_get() * 1000u) / TX_TIMER_TICKS_PER_SECOND);
+}
+
+
+/**
+  * @brief Enters a critical section.
+  * @returns Interrupt state before entry, for XPortCriticalExit().
+  **/
+uint32_t XPortCriticalEnter(void)
+{
+  return (uint32_t)tx_interrupt_control(TX_INT_DISABLE);
+}
+
+
+/**
+  * @brief Leaves a critical section.
+  * @param[in] saved - What the matching XPortCriticalEnter() returned.
+  **/
+void XPortCriticalExit(uint32_t saved)
+{
+  (void)tx_interrupt_control((UINT)saved);
+}
+
+
+/**
+  * @brief Orders memory accesses: every access before the barrier is seen
+  *        by other threads and interrupts before any access after it.
+  **/
+void XPortMemoryBarrier(void)
+{
+  __DMB();
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
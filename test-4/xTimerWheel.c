@@ -0,0 +1,481 @@
+/**
+******************************************************************************
+* @file         xTimerWheel.c
+* @brief        Hierarchical timer wheel, shared by the active objects.
+* @details      Each slot is an intrusive, doubly linked list of the timers
+*               due in it, so a timer is armed or cancelled without searching.
+*               The wheel lock only covers list changes; expiry events are
+*               posted with it released.
+******************************************************************************
+*/
+
+#include "xTimerWheel.h"
+
+/**
+* @addtogroup xTimerWheel
+*  @{
+*/
+
+/// Mask of a slot index.
+#define X_TIMER_WHEEL_SLOT_MASK           (X_TIMER_WHEEL_SLOTS - 1u)
+
+_Static_assert(X_TIMER_WHEEL_SLOTS == 64u, "occupied has a bit per slot");
+
+STATIC uint32_t XTimerWheelTicks(const XTimerWheel_t *pWheel, uint32_t ms);
+STATIC void XTimerWheelInsert(XTimerWheel_t *pWheel, XWheelTimer_t *pTimer);
+STATIC void XTimerWheelLink(XWheelTimer_t **ppHead, XWheelTimer_t *pTimer);
+STATIC void XTimerWheelUnlink(XWheelTimer_t *pTimer);
+STATIC void XTimerWheelRemove(XTimerWheel_t *pWheel, XWheelTimer_t *pTimer);
+STATIC uint32_t XTimerWheelFirstSlot(uint64_t occupied, uint32_t fromSlot);
+STATIC void XTimerWheelCascade(XTimerWheel_t *pWheel);
+STATIC void XTimerWheelExpire(XTimerWheel_t *pWheel, uint32_t targetTick);
+
+
+/**
+  * @brief Initialises a wheel, with no timers armed.
+  * @param[in] pWheel - The wheel.
+  * @param[in] tickMs - Period of the tick which advances the wheel.
+  * @param[in] nowMs - The time now.
+  **/
+void XTimerWheelInit(XTimerWheel_t *pWheel, uint32_t tickMs, uint32_t nowMs)
+{
+  ASSERT_NOT_NULL(pWheel);
+  ASSERT(tickMs > 0u);
+
+  (void)memset(pWheel, 0, sizeof(XTimerWheel_t));
+
+  pWheel->tickMs = tickMs;
+  pWheel->nowMs = nowMs;
+}
+
+
+/**
+  * @brief Initialises a timer, not armed.
+  * @param[in] pTimer - The timer.
+  * @param[in] pOwner - Object the timer posts to.
+  * @param[in] id - Id of the event posted on expiry.
+  **/
+void XTimerWheelTimerInit(XWheelTimer_t *pTimer, XActive_t *pOwner, eXEventId id)
+{
+  ASSERT_NOT_NULL(pTimer);
+  ASSERT_NOT_NULL(pOwner);
+
+  (void)memset(pTimer, 0, sizeof(XWheelTimer_t));
+
+  pTimer->pOwner = pOwner;
+  X_EV_INIT(&(pTimer->ev), id, pOwner);
+}
+
+
+/**
+  * @brief Arms a timer, first cancelling it if it is armed.
+  * @details Times are rounded up to whole ticks, and counted from the latest
+  *          tick, so a timer can expire up to a tick early, as any tick based
+  *          timer can.
+  * @param[in] pWheel - The wheel.
+  * @param[in] pTimer - The timer.
+  * @param[in] delayMs - Time to the first expiry. At least one tick.
+  * @param[in] periodMs - Time between later expiries, or 0 for a one-shot timer.
+  **/
+void XTimerWheelArm(XTimerWheel_t *pWheel,
+                    XWheelTimer_t *pTimer,
+                    uint32_t delayMs,
+                    uint32_t periodMs)
+{
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(pWheel);
+  ASSERT_NOT_NULL(pTimer);
+
+  critical = XPortCriticalEnter();
+
+  if (NULL != pTimer->ppPrev)
+  {
+    XTimerWheelRemove(pWheel, pTimer);
+    pWheel->numArmed--;
+  }
+
+  pTimer->expiryTick = pWheel->nowTick + XTimerWheelTicks(pWheel, delayMs);
+  pTimer->periodTicks = (periodMs > 0u) ? XTimerWheelTicks(pWheel, periodMs) : 0u;
+
+  XTimerWheelInsert(pWheel, pTimer);
+  pWheel->numArmed++;
+
+  XPortCriticalExit(critical);
+}
+
+
+/**
+  * @brief Cancels a timer. Does nothing if it is not armed.
+  * @param[in] pWheel - The wheel.
+  * @param[in] pTimer - The timer.
+  **/
+void XTimerWheelCancel(XTimerWheel_t *pWheel, XWheelTimer_t *pTimer)
+{
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(pWheel);
+  ASSERT_NOT_NULL(pTimer);
+
+  critical = XPortCriticalEnter();
+
+  if (NULL != pTimer->ppPrev)
+  {
+    XTimerWheelRemove(pWheel, pTimer);
+    pWheel->numArmed--;
+  }
+
+  XPortCriticalExit(critical);
+}
+
+
+/**
+  * @brief Checks whether a timer is armed.
+  * @param[in] pTimer - The timer.
+  * @returns True until a one-shot timer expires or any timer is cancelled.
+  **/
+bool XTimerWheelIsArmed(const XWheelTimer_t *pTimer)
+{
+  ASSERT_NOT_NULL(pTimer);
+
+  return (NULL != pTimer->ppPrev);
+}
+
+
+/**
+  * @brief Moves the wheel on to a time, posting every timer due by then.
+  * @details Called from the tick which drives the wheel. A late tick is
+  *          caught up on, every tick in turn, and counted in the statistics.
+  * @param[in] pWheel - The wheel.
+  * @param[in] nowMs - The time now.
+  **/
+void XTimerWheelAdvance(XTimerWheel_t *pWheel, uint32_t nowMs)
+{
+  uint32_t targetTick;
+  XWheelTimer_t **ppSlot;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(pWheel);
+
+  targetTick = pWheel->nowTick + ((nowMs - pWheel->nowMs) / pWheel->tickMs);
+
+  while (pWheel->nowTick != targetTick)
+  {
+    critical = XPortCriticalEnter();
+
+    pWheel->nowTick++;
+    pWheel->nowMs += pWheel->tickMs;
+
+    XTimerWheelCascade(pWheel);
+
+    // Take the slot's timers off the wheel, so re-armed timers go back in it.
+    ppSlot = &(pWheel->slots[0][pWheel->nowTick & X_TIMER_WHEEL_SLOT_MASK]);
+    pWheel->pExpiring = *ppSlot;
+    *ppSlot = NULL;
+    pWheel->occupied[0] &= ~((uint64_t)1u << (pWheel->nowTick & X_TIMER_WHEEL_SLOT_MASK));
+
+    if (NULL != pWheel->pExpiring)
+    {
+      pWheel->pExpiring->ppPrev = &(pWheel->pExpiring);
+    }
+
+    XPortCriticalExit(critical);
+
+    XTimerWheelExpire(pWheel, targetTick);
+  }
+}
+
+
+/**
+  * @brief Finds the time of the earliest expiry.
+  * @details A level's slots are reached in turn, from the one after the
+  *          current slot, so its earliest timers are in the first occupied
+  *          slot from there. Only that slot of each level is visited.
+  * @param[in] pWheel - The wheel.
+  * @param[out] pExpiryMs - Time of the earliest expiry.
+  * @returns False if no timer is armed.
+  **/
+bool XTimerWheelNextExpiryMs(const XTimerWheel_t *pWheel, uint32_t *pExpiryMs)
+{
+  bool found = false;
+  uint32_t nextTicks = UINT32_MAX;
+  const XWheelTimer_t *pTimer;
+  uint32_t shift;
+  uint32_t slot;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(pWheel);
+  ASSERT_NOT_NULL(pExpiryMs);
+
+  critical = XPortCriticalEnter();
+
+  for (uint32_t level = 0u; level < X_TIMER_WHEEL_LEVELS; level++)
+  {
+    if (0u != pWheel->occupied[level])
+    {
+      shift = X_TIMER_WHEEL_SLOT_BITS * level;
+      slot = XTimerWheelFirstSlot(pWheel->occupied[level],
+                                  ((pWheel->nowTick >> shift) + 1u) & X_TIMER_WHEEL_SLOT_MASK);
+
+      for (pTimer = pWheel->slots[level][slot]; NULL != pTimer; pTimer = pTimer->pNext)
+      {
+        if ((pTimer->expiryTick - pWheel->nowTick) < nextTicks)
+        {
+          nextTicks = pTimer->expiryTick - pWheel->nowTick;
+        }
+      }
+
+      found = true;
+    }
+  }
+
+  *pExpiryMs = pWheel->nowMs + (nextTicks * pWheel->tickMs);
+
+  XPortCriticalExit(critical);
+
+  return found;
+}
+
+
+/**
+  * @brief Converts a time to whole ticks, rounding up.
+  * @param[in] pWheel - The wheel.
+  * @param[in] ms - The time.
+  * @returns Ticks, at least one.
+  **/
+STATIC uint32_t XTimerWheelTicks(const XTimerWheel_t *pWheel, uint32_t ms)
+{
+  uint32_t ticks = (ms / pWheel->tickMs) + (((ms % pWheel->tickMs) > 0u) ? 1u : 0u);
+
+  return (ticks > 0u) ? ticks : 1u;
+}
+
+
+/**
+  * @brief Puts a timer in the slot for its expiry. Called with the wheel locked.
+  * @details A timer goes in the lowest level which reaches its expiry,
+  *          indexed by the bits of the expiry at that level.
+  * @param[in] pWheel - The wheel.
+  * @param[in] pTimer - The timer, not in a slot.
+  **/
+STATIC void XTimerWheelInsert(XTimerWheel_t *pWheel, XWheelTimer_t *pTimer)
+{
+  uint32_t deltaTicks = pTimer->expiryTick - pWheel->nowTick;
+  uint32_t slotTick = pTimer->expiryTick;
+  uint32_t level = 0u;
+  uint32_t slot;
+
+  if (deltaTicks >= X_TIMER_WHEEL_SPAN_TICKS)
+  {
+    deltaTicks = X_TIMER_WHEEL_SPAN_TICKS - 1u;
+    slotTick = pWheel->nowTick + deltaTicks;
+  }
+
+  while (deltaTicks >= (1u << (X_TIMER_WHEEL_SLOT_BITS * (level + 1u))))
+  {
+    level++;
+  }
+
+  slot = (slotTick >> (X_TIMER_WHEEL_SLOT_BITS * level)) & X_TIMER_WHEEL_SLOT_MASK;
+
+  XTimerWheelLink(&(pWheel->slots[level][slot]), pTimer);
+  pTimer->slotIndex = (level * X_TIMER_WHEEL_SLOTS) + slot;
+  pWheel->occupied[level] |= ((uint64_t)1u << slot);
+}
+
+
+/**
+  * @brief Adds a timer to the head of a list.
+  * @param[in] ppHead - The list.
+  * @param[in] pTimer - The timer, not in a list.
+  **/
+STATIC void XTimerWheelLink(XWheelTimer_t **ppHead, XWheelTimer_t *pTimer)
+{
+  pTimer->pNext = *ppHead;
+  pTimer->ppPrev = ppHead;
+
+  if (NULL != pTimer->pNext)
+  {
+    pTimer->pNext->ppPrev = &(pTimer->pNext);
+  }
+
+  *ppHead = pTimer;
+}
+
+
+/**
+  * @brief Takes a timer out of its list.
+  * @param[in] pTimer - The timer, in a list.
+  **/
+STATIC void XTimerWheelUnlink(XWheelTimer_t *pTimer)
+{
+  *(pTimer->ppPrev) = pTimer->pNext;
+
+  if (NULL != pTimer->pNext)
+  {
+    pTimer->pNext->ppPrev = pTimer->ppPrev;
+  }
+
+  pTimer->pNext = NULL;
+  pTimer->ppPrev = NULL;
+}
+
+
+/**
+  * @brief Takes an armed timer out of the wheel. Called with the wheel locked.
+  * @details The timer may be in a slot or waiting to expire. Either way the
+  *          slot it was last put in is marked free if it is now empty. A slot
+  *          taken for expiry is already empty, so that is always correct.
+  * @param[in] pWheel - The wheel.
+  * @param[in] pTimer - The timer, armed.
+  **/
+STATIC void XTimerWheelRemove(XTimerWheel_t *pWheel, XWheelTimer_t *pTimer)
+{
+  uint32_t level = pTimer->slotIndex / X_TIMER_WHEEL_SLOTS;
+  uint32_t slot = pTimer->slotIndex % X_TIMER_WHEEL_SLOTS;
+
+  XTimerWheelUnlink(pTimer);
+
+  if (NULL == pWheel->slots[level][slot])
+  {
+    pWheel->occupied[level] &= ~((uint64_t)1u << slot);
+  }
+}
+
+
+/**
+  * @brief Finds the first occupied slot of a level, searching on from a slot
+  *        and wrapping round.
+  * @param[in] occupied - The level's occupied slots. At least one.
+  * @param[in] fromSlot - Slot to search from.
+  * @returns The slot.
+  **/
+STATIC uint32_t XTimerWheelFirstSlot(uint64_t occupied, uint32_t fromSlot)
+{
+  uint64_t bits = occupied >> fromSlot;
+  uint32_t offset = 0u;
+
+  if (fromSlot > 0u)
+  {
+    bits |= occupied << (X_TIMER_WHEEL_SLOTS - fromSlot);
+  }
+
+  // Lowest set bit, by halving.
+  for (uint32_t width = X_TIMER_WHEEL_SLOTS / 2u; width > 0u; width /= 2u)
+  {
+    if (0u == (bits & (((uint64_t)1u << width) - 1u)))
+    {
+      bits >>= width;
+      offset += width;
+    }
+  }
+
+  return (fromSlot + offset) & X_TIMER_WHEEL_SLOT_MASK;
+}
+
+
+/**
+  * @brief Moves the timers of the slots the wheel has reached down a level.
+  *        Called with the wheel locked, after the tick has moved on.
+  * @details A level is reached when every level below it has wrapped. Its
+  *          timers are all due within one lap of the level below, so they are
+  *          put back in a lower level.
+  * @param[in] pWheel - The wheel.
+  **/
+STATIC void XTimerWheelCascade(XTimerWheel_t *pWheel)
+{
+  XWheelTimer_t *pList;
+  XWheelTimer_t *pTimer;
+  uint32_t shift;
+
+  for (uint32_t level = 1u; level < X_TIMER_WHEEL_LEVELS; level++)
+  {
+    shift = X_TIMER_WHEEL_SLOT_BITS * level;
+
+    if (0u != (pWheel->nowTick & ((1u << shift) - 1u)))
+    {
+      break;
+    }
+
+    pList = pWheel->slots[level][(pWheel->nowTick >> shift) & X_TIMER_WHEEL_SLOT_MASK];
+    pWheel->slots[level][(pWheel->nowTick >> shift) & X_TIMER_WHEEL_SLOT_MASK] = NULL;
+    pWheel->occupied[level] &= ~((uint64_t)1u << ((pWheel->nowTick >> shift) & X_TIMER_WHEEL_SLOT_MASK));
+
+    while (NULL != pList)
+    {
+      pTimer = pList;
+      pList = pList->pNext;
+
+      XTimerWheelInsert(pWheel, pTimer);
+    }
+  }
+}
+
+
+/**
+  * @brief Posts each timer of the current tick to its owner.
+  * @details One timer is taken at a time, with the wheel locked, so a timer
+  *          can be cancelled or re-armed by another thread meanwhile.
+  *          Periodic timers are re-armed from their expiry, so do not drift.
+  * @param[in] pWheel - The wheel.
+  * @param[in] targetTick - Tick the wheel is being advanced to.
+  **/
+STATIC void XTimerWheelExpire(XTimerWheel_t *pWheel, uint32_t targetTick)
+{
+  XWheelTimer_t *pTimer;
+  uint32_t lateMs;
+  uint32_t critical;
+
+  do
+  {
+    critical = XPortCriticalEnter();
+
+    pTimer = pWheel->pExpiring;
+
+    if (NULL != pTimer)
+    {
+      XTimerWheelRemove(pWheel, pTimer);
+
+      if (pTimer->periodTicks > 0u)
+      {
+        pTimer->expiryTick += pTimer->periodTicks;
+        XTimerWheelInsert(pWheel, pTimer);
+      }
+      else
+      {
+        pWheel->numArmed--;
+      }
+
+      lateMs = (targetTick - pWheel->nowTick) * pWheel->tickMs;
+
+      pWheel->stats.numExpired++;
+      pWheel->stats.sumLateMs += lateMs;
+
+      if (lateMs > 0u)
+      {
+        pWheel->stats.numLate++;
+      }
+
+      if (lateMs > pWheel->stats.maxLateMs)
+      {
+        pWheel->stats.maxLateMs = lateMs;
+      }
+    }
+
+    XPortCriticalExit(critical);
+
+    if (NULL != pTimer)
+    {
+      XActivePost(pTimer->pOwner, &(pTimer->ev));
+    }
+  }
+  while (NULL != pTimer);
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
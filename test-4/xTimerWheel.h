@@ -0,0 +1,131 @@
+/**
+ ******************************************************************************
+ * @file   xTimerWheel.h
+ * @brief  Header file for xTimerWheel.c
+ ******************************************************************************
+ */
+
+
+#ifndef X_TIMER_WHEEL_H_
+#define X_TIMER_WHEEL_H_
+
+#include "poci.h"
+
+#ifndef XACTIVE_H_
+#include "xActive.h"
+#endif
+#include "xPort.h"
+
+
+/**
+ * @defgroup xTimerWheel Timer Wheel
+ * @brief Timeout service shared by the active objects.
+ * @details One hierarchical timer wheel holds every one-shot and periodic
+ *          deadline of the active objects using it. Arming and cancelling a
+ *          timer are O(1); on expiry the wheel posts the timer's event straight
+ *          to its owner, so no object needs a periodic tick of its own to count
+ *          time.
+ *
+ *          The wheel has X_TIMER_WHEEL_LEVELS levels of X_TIMER_WHEEL_SLOTS
+ *          slots. Level 0 has a slot per tick. Each higher level has a slot
+ *          per lap of the level below, whose timers are moved down a level as
+ *          the wheel reaches that slot. Timers further out than the wheel
+ *          spans wait in the last slot of the top level, and are moved again.
+ *
+ *          The wheel is driven from one periodic tick, e.g. a ThreadX timer,
+ *          by XTimerWheelAdvance(). Timers can be armed and cancelled from any
+ *          thread. Owners are posted to outside of the wheel lock, so, as with
+ *          XTimer_t, a timer cancelled as it expires can still deliver its
+ *          event once.
+ *
+ *          Every expiry is checked against the time the wheel was advanced to,
+ *          so the statistics show how late events are posted when the tick
+ *          is held off.
+ *
+ *          Each level keeps a bit per slot holding timers, so the earliest
+ *          expiry is found from the first occupied slot of each level rather
+ *          than by visiting every slot.
+ *  @{
+ */
+
+
+/// Slots per level, as bits. 6, so a level's occupied slots fit a uint64_t.
+#define X_TIMER_WHEEL_SLOT_BITS           6u
+
+/// Slots per level.
+#define X_TIMER_WHEEL_SLOTS               (1u << X_TIMER_WHEEL_SLOT_BITS)
+
+/// Levels of the wheel.
+#define X_TIMER_WHEEL_LEVELS              4u
+
+/// Ticks spanned by the wheel. 2^24, so over 4 hours at a 1 ms tick.
+#define X_TIMER_WHEEL_SPAN_TICKS          (1u << (X_TIMER_WHEEL_SLOT_BITS * X_TIMER_WHEEL_LEVELS))
+
+
+/**
+  *     @brief A timer, armed on a wheel. Owned by the object it posts to.
+  **/
+typedef struct XWheelTimer_tag
+{
+  struct XWheelTimer_tag        *pNext;                 ///< Next timer of the slot.
+  struct XWheelTimer_tag        **ppPrev;               ///< Link which points at this timer. NULL when not armed.
+  uint32_t                      expiryTick;
+  uint32_t                      periodTicks;            ///< 0 for a one-shot timer.
+  uint32_t                      slotIndex;              ///< Level * X_TIMER_WHEEL_SLOTS + slot, of the slot it was last put in.
+  XActive_t                     *pOwner;
+  XEvent_t                      ev;                     ///< Posted to pOwner on expiry.
+}
+XWheelTimer_t;
+
+
+/**
+  *     @brief How late expiry events have been posted.
+  **/
+typedef struct XTimerWheelStats_tag
+{
+  uint32_t                      numExpired;
+  uint32_t                      numLate;                ///< Expiries posted a tick or more after they were due.
+  uint32_t                      maxLateMs;
+  uint64_t                      sumLateMs;
+}
+XTimerWheelStats_t;
+
+
+/**
+  *     @brief The timer wheel.
+  **/
+typedef struct XTimerWheel_tag
+{
+  XWheelTimer_t                 *slots[X_TIMER_WHEEL_LEVELS][X_TIMER_WHEEL_SLOTS];
+  uint64_t                      occupied[X_TIMER_WHEEL_LEVELS]; ///< Bit per slot, set whilst the slot has timers.
+  XWheelTimer_t                 *pExpiring;             ///< Timers of the current tick, not yet posted.
+  uint32_t                      tickMs;
+  uint32_t                      nowTick;
+  uint32_t                      nowMs;                  ///< Time of nowTick.
+  uint32_t                      numArmed;
+  XTimerWheelStats_t            stats;
+}
+XTimerWheel_t;
+
+
+/** @} */
+void       XTimerWheelInit(XTimerWheel_t *pWheel, uint32_t tickMs, uint32_t nowMs);
+
+void       XTimerWheelTimerInit(XWheelTimer_t *pTimer, XActive_t *pOwner, eXEventId id);
+
+void       XTimerWheelArm(XTimerWheel_t *pWheel,
+                          XWheelTimer_t *pTimer,
+                          uint32_t delayMs,
+                          uint32_t periodMs);
+
+void       XTimerWheelCancel(XTimerWheel_t *pWheel, XWheelTimer_t *pTimer);
+
+bool       XTimerWheelIsArmed(const XWheelTimer_t *pTimer);
+
+void       XTimerWheelAdvance(XTimerWheel_t *pWheel, uint32_t nowMs);
+
+bool       XTimerWheelNextExpiryMs(const XTimerWheel_t *pWheel, uint32_t *pExpiryMs);
+
+#endif
+
+/********************************** End Of File ******************************/
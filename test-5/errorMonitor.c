@@ -69,6 +69,7 @@ void ErrorMonitorInit(ErrorMonitor_t* pMe,
 {
   ASSERT_NOT_NULL(pMe);
   ASSERT_NOT_NULL(pParams);
+  ASSERT_NOT_NULL(pParams->pTimerWheel);
 
   pMe->pParams = pParams;
 
@@ -76,11 +77,8 @@ void ErrorMonitorInit(ErrorMonitor_t* pMe,
 
   pMe->tickIntervalMs = ERROR_MONITOR_TIMER_TICK;
 
-  XTimerCreate(&(pMe->timer),
-               &(pMe->super),
-               X_EV_TIMER,
-               pMe->tickIntervalMs,
-               X_TIMER_NO_START);
+  XTimerWheelTimerInit(&(pMe->tiltTimer), &(pMe->super), X_EV_TIMER);
+  XTimerWheelTimerInit(&(pMe->ambientTimer), &(pMe->super), XMSG_ERROR_MONITOR_AMBIENT_TICK);
 
   XActiveStart(pXActiveFramework,
 							 (XActive_t*)&(pMe->super),
@@ -119,7 +117,10 @@ STATIC XState ErrorMonitorState_Initial(ErrorMonitor_t* pMe, XEvent_t const* pEv
 {
   XState result;
 
-  XTimerStart(&(pMe->timer));
+  XTimerWheelArm(pMe->pParams->pTimerWheel,
+                 &(pMe->tiltTimer),
+                 pMe->tickIntervalMs,
+                 pMe->tickIntervalMs);
   
   result = X_TRAN(pMe, &ErrorMonitorState_Idle);
   
@@ -153,7 +154,6 @@ STATIC XState ErrorMonitorState_Idle(ErrorMonitor_t* pMe, XEvent_t const* pEv)
         pMe->expectedSampleState = ERRMON_EXPECT_SAMPLE_STATE_IGNORED;
         pMe->expectedStripState = ERRMON_EXPECT_STRIP_STATE_IGNORED;
         pMe->expectedMaxTiltAngle = INSTRUMENT_MAX_TILT_ANGLE;
-        pMe->alternateTimeEventFlag = true;
         pMe->currentTiltStatus = ERROR_ERRMON_INSTRUMENT_IS_LEVEL;
         result = X_RET_HANDLED;
         break;
@@ -327,46 +327,60 @@ STATIC XState ErrorMonitorState_TestRunning(ErrorMonitor_t* pMe, XEvent_t const*
         error = ERROR_ERRMON_SAMPLE_DETECTED;
       }
 
+      /* Tilt angle and ambient temperature take turns, one per tick. */
+      XTimerWheelArm(pMe->pParams->pTimerWheel,
+                     &(pMe->tiltTimer),
+                     pMe->tickIntervalMs,
+                     2u * pMe->tickIntervalMs);
+      XTimerWheelArm(pMe->pParams->pTimerWheel,
+                     &(pMe->ambientTimer),
+                     2u * pMe->tickIntervalMs,
+                     2u * pMe->tickIntervalMs);
+
     	result = X_RET_HANDLED;
       break;
 
+    case X_EV_EXIT:
+      XTimerWheelCancel(pMe->pParams->pTimerWheel, &(pMe->ambientTimer));
+      XTimerWheelArm(pMe->pParams->pTimerWheel,
+                     &(pMe->tiltTimer),
+                     pMe->tickIntervalMs,
+                     pMe->tickIntervalMs);
+      result = X_RET_HANDLED;
+      break;
+
     case X_EV_TIMER:
-      if (pMe->alternateTimeEventFlag)
+      /* Check tilt angle. */
+      drvError = DrvLIS2DH_GetTiltAngles(&pitch,
+                                         &roll,
+                                         ERROR_MONITOR_ACCELEROMETER_SAMPLES);
+      if (OK_STATUS == drvError)
       {
-        /* Check tilt angle. */
-        drvError = DrvLIS2DH_GetTiltAngles(&pitch,
-                                           &roll,
-                                           ERROR_MONITOR_ACCELEROMETER_SAMPLES);
-        if (OK_STATUS == drvError)
-        {
-          error = ErrorMonitorActOnTiltAngle(pMe, &pitch, &roll);
-        }
-        else if (ERROR_ACCELEROMETER_VIBRATION_DETECTED == drvError)
-        {
-          /* Ignore vibrations. This is not required based on specifications.*/
-        }
-        else
-        {
-          error = ERROR_ERRMON_ACCELEROMETER_NOT_READING;
-        }
-
-        pMe->alternateTimeEventFlag = false;
+        error = ErrorMonitorActOnTiltAngle(pMe, &pitch, &roll);
+      }
+      else if (ERROR_ACCELEROMETER_VIBRATION_DETECTED == drvError)
+      {
+        /* Ignore vibrations. This is not required based on specifications.*/
       }
       else
       {
-        /* Check ambient temperature. */
-        drvError = DrvEMC2105_GetExternalTemperature(&ambientTemp);
+        error = ERROR_ERRMON_ACCELEROMETER_NOT_READING;
+      }
 
-        if (OK_STATUS == drvError)
-        {
-          error = ErrorMonitorActOnAmbientTempRead(pMe, &ambientTemp);
-        }
-        else
-        {
-          error = ERROR_ERRMON_AMBIENT_TEMP_NOT_READING;
-        }
+      result = X_RET_HANDLED;
+    break;
+
+    case XMSG_ERROR_MONITOR_AMBIENT_TICK:
+      /* Check ambient temperature. */
+      drvError = DrvEMC2105_GetExternalTemperature(&ambientTemp);
 
-        pMe->alternateTimeEventFlag = true;
+      if (OK_STATUS == drvError)
+      {
+        error = ErrorMonitorActOnAmbientTempRead(pMe, &ambientTemp);
+      }
+      else
+      {
+        error = ERROR_ERRMON_AMBIENT_TEMP_NOT_READING;
       }
 
       result = X_RET_HANDLED;
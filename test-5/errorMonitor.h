@@ -22,6 +22,15 @@
 #include "xActive.h"
 #endif
 
+#include "xTimerWheel.h"
+
+/// Ambient poll timer signal, which the application's eXEventId list must
+/// carry. A build whose list does not yet carry it defines
+/// ERROR_MONITOR_LOCAL_XMSG_BASE as a free id.
+#ifdef ERROR_MONITOR_LOCAL_XMSG_BASE
+#define XMSG_ERROR_MONITOR_AMBIENT_TICK   ((eXEventId)(ERROR_MONITOR_LOCAL_XMSG_BASE))
+#endif
+
 
 /* Type Definitions ---------------------------------------------------------*/
 
@@ -52,6 +61,7 @@ eErrMonExpectedStates;
 typedef struct ErrorMonitorParams_tag
 {
   uint8_t priority;
+  XTimerWheel_t* pTimerWheel; ///< Timeout service shared by the active objects.
 }ErrorMonitorParams_t;
 
 /**
@@ -88,7 +98,8 @@ typedef struct ErrMonPreTestStatus_tag
 typedef struct ErrorMonitor_tag
 {
   XActive_t super;
-  XTimer_t timer;
+  XWheelTimer_t tiltTimer;    ///< Tilt angle check. Posts X_EV_TIMER.
+  XWheelTimer_t ambientTimer; ///< Ambient temperature check, during a test.
   uint32_t evQueueBytes[32];
   uint32_t tickIntervalMs;
 
@@ -107,7 +118,6 @@ typedef struct ErrorMonitor_tag
 
   uint32_t expectedAmbientTemp;
   float expectedMaxTiltAngle;
-  bool alternateTimeEventFlag;
 
   eErrorCode newTiltStatus;
   eErrorCode currentTiltStatus;
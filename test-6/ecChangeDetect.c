@@ -0,0 +1,157 @@
+/**
+******************************************************************************
+* @file         ecChangeDetect.c
+* @brief        Electrode change detection.
+* @details      One sided CUSUM per electrode, in whichever direction would
+*               change its state, against the contact map's threshold for the
+*               state it would change to.
+******************************************************************************
+*/
+
+#include "ecChangeDetect.h"
+
+/**
+* @addtogroup ecChangeDetect
+*  @{
+*/
+
+
+/**
+  * @brief Initialises a detector, with every electrode state unknown.
+  * @param[in] pDetect - The detector.
+  * @param[in] pParams - The configuration.
+  **/
+void EcChangeDetectInit(EcChangeDetect_t *pDetect,
+                        const EcChangeDetectParams_t *pParams)
+{
+  ASSERT_NOT_NULL(pDetect);
+  ASSERT_NOT_NULL(pParams);
+  ASSERT(pParams->noiseVolts > 0.f);
+  ASSERT((pParams->falseTriggerRate > 0.f) && (pParams->falseTriggerRate < 1.f));
+
+  (void)memset(pDetect, 0, sizeof(EcChangeDetect_t));
+
+  pDetect->params = *pParams;
+  pDetect->invVariance = 1.f / (pParams->noiseVolts * pParams->noiseVolts);
+  pDetect->triggerLevel = logf(1.f / pParams->falseTriggerRate);
+}
+
+
+/**
+  * @brief Forgets every electrode state, as when the strip is removed.
+  * @param[in] pDetect - The detector.
+  * @note The next update takes each state from its sample.
+  **/
+void EcChangeDetectReset(EcChangeDetect_t *pDetect)
+{
+  ASSERT_NOT_NULL(pDetect);
+
+  (void)memset(pDetect->evidence, 0, sizeof(pDetect->evidence));
+  pDetect->contactMask = 0u;
+  pDetect->isPrimed = false;
+}
+
+
+/**
+  * @brief Adds a sweep of the strip.
+  * @param[in] pDetect - The detector.
+  * @param[in] pMap - Contact map, with the thresholds of the sample type.
+  * @param[in] pVolts - Voltage of each electrode, EC_CONTACT_MAP_MAX_ELECTRODES
+  *                     long. Lanes past the contact table are ignored.
+  * @returns Electrodes that changed state. Every electrode for the first sweep
+  *          after a reset, as its state becomes known.
+  **/
+uint16_t EcChangeDetectUpdate(EcChangeDetect_t *pDetect,
+                              const EcContactMap_t *pMap,
+                              const float *pVolts)
+{
+  uint16_t changed = 0u;
+  uint16_t bit;
+  float midVolts;
+  float gain;
+  float llr;
+
+  ASSERT_NOT_NULL(pDetect);
+  ASSERT_NOT_NULL(pMap);
+  ASSERT_NOT_NULL(pVolts);
+
+  for (uint32_t i = 0u; i < EC_CONTACT_MAP_MAX_ELECTRODES; i++)
+  {
+    bit = (uint16_t)(1u << i);
+
+    if (false == pDetect->isPrimed)
+    {
+      // No state to leave yet, so the nearer threshold decides.
+      midVolts = 0.5f * (pMap->contactVolts[i] + pMap->noContactVolts[i]);
+
+      if (pVolts[i] < midVolts)
+      {
+        pDetect->contactMask |= bit;
+      }
+    }
+    else
+    {
+      // Evidence for leaving the current state, measured against the
+      // threshold of the state it would change to. Readings between the
+      // thresholds count against a change either way.
+      gain = (pMap->noContactVolts[i] - pMap->contactVolts[i]) * pDetect->invVariance;
+
+      if (0u != (pDetect->contactMask & bit))
+      {
+        llr = gain * (pVolts[i] - pMap->noContactVolts[i]);
+      }
+      else
+      {
+        llr = gain * (pMap->contactVolts[i] - pVolts[i]);
+      }
+
+      pDetect->evidence[i] += llr;
+
+      if (pDetect->evidence[i] < 0.f)
+      {
+        pDetect->evidence[i] = 0.f;
+      }
+      else if (pDetect->evidence[i] >= pDetect->triggerLevel)
+      {
+        pDetect->evidence[i] = 0.f;
+        pDetect->contactMask ^= bit;
+        changed |= bit;
+      }
+      else
+      {
+        // Not enough evidence yet.
+      }
+    }
+  }
+
+  if (false == pDetect->isPrimed)
+  {
+    pDetect->isPrimed = true;
+    changed = pMap->electrodeMask;
+  }
+
+  pDetect->contactMask &= pMap->electrodeMask;
+
+  return (uint16_t)(changed & pMap->electrodeMask);
+}
+
+
+/**
+  * @brief Gets the electrode states.
+  * @param[in] pDetect - The detector.
+  * @returns Electrodes in contact, bit per electrode.
+  **/
+uint16_t EcChangeDetectContactMask(const EcChangeDetect_t *pDetect)
+{
+  ASSERT_NOT_NULL(pDetect);
+
+  return pDetect->contactMask;
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
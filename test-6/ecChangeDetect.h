@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * @file   ecChangeDetect.h
+ * @brief  Header file for ecChangeDetect.c
+ ******************************************************************************
+ */
+
+
+#ifndef EC_CHANGE_DETECT_H_
+#define EC_CHANGE_DETECT_H_
+
+#include "poci.h"
+#include "ecContactMap.h"
+
+
+/**
+ * @defgroup ecChangeDetect Electrode Change Detection
+ * @brief Decides when an electrode has made or broken contact.
+ * @details Rather than waiting for ECHEM_NUM_SAMPLES_TO_REGISTER_CHANGE
+ *          matching sweeps, each electrode runs a CUSUM test for the
+ *          sample type in use. An electrode in contact collects the evidence
+ *          of readings above its no contact threshold, and one out of contact
+ *          the evidence of readings below its contact threshold, each scaled
+ *          for noise of noiseVolts. Readings between the thresholds count
+ *          against a change either way, so the hysteresis of the thresholds
+ *          is kept. The sum never falls below zero, and the change is
+ *          reported once it reaches ln(1 / falseTriggerRate).
+ *
+ *          A step well past the other threshold is reported on the first
+ *          sample. Noisy or marginal readings take as many samples as the
+ *          evidence needs. An electrode whose readings centre on its current
+ *          state's threshold, or further from the other one, triggers no more
+ *          than about once every 1 / falseTriggerRate samples. Nearer the
+ *          other threshold that no longer holds: one centred on it drifts to
+ *          a false change in about (ln(1 / falseTriggerRate) * noiseVolts /
+ *          (noContactVolts - contactVolts))^2 samples.
+ *
+ *          The thresholds are read from the contact map on every update, so a
+ *          sample type change applies from the next sweep with the evidence
+ *          kept. Only a strip removal calls for EcChangeDetectReset().
+ *  @{
+ */
+
+
+/**
+  *     @brief Detector configuration.
+  **/
+typedef struct EcChangeDetectParams_tag
+{
+  float         noiseVolts;             ///< Standard deviation of an electrode sample.
+  float         falseTriggerRate;       ///< Chance per sample of reporting a change that did not happen.
+}
+EcChangeDetectParams_t;
+
+
+/**
+  *     @brief Detector of every electrode of the strip.
+  **/
+typedef struct EcChangeDetect_tag
+{
+  EcChangeDetectParams_t  params;
+  float                   invVariance;                                  ///< 1 / noiseVolts^2
+  float                   triggerLevel;                                 ///< ln(1 / falseTriggerRate)
+  float                   evidence[EC_CONTACT_MAP_MAX_ELECTRODES];      ///< Log likelihood of a change, per electrode.
+  uint16_t                contactMask;                                  ///< Electrodes in contact, bit per electrode.
+  bool                    isPrimed;                                     ///< The electrode states are known.
+}
+EcChangeDetect_t;
+
+
+/** @} */
+void       EcChangeDetectInit(EcChangeDetect_t *pDetect,
+                              const EcChangeDetectParams_t *pParams);
+
+void       EcChangeDetectReset(EcChangeDetect_t *pDetect);
+
+uint16_t   EcChangeDetectUpdate(EcChangeDetect_t *pDetect,
+                                const EcContactMap_t *pMap,
+                                const float *pVolts);
+
+uint16_t   EcChangeDetectContactMask(const EcChangeDetect_t *pDetect);
+
+#endif
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,270 @@
+/**
+******************************************************************************
+* @file         ecContactMap.c
+* @brief        Electrode contact map.
+* @details      Compiles the contact table into per-channel electrode orders
+*               and masks, so that classifying a sample is per channel rather
+*               than per electrode and channel, and into threshold vectors, so
+*               that a whole sweep is classified in one pass.
+******************************************************************************
+*/
+
+#include "ecContactMap.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/**
+* @addtogroup ecContactMap
+*  @{
+*/
+
+
+/**
+  * @brief Compiles a contact table.
+  * @param[in] pMap - The map.
+  * @param[in] pContacts - Contact table, one per electrode.
+  * @param[in] numContacts - Length of pContacts.
+  * @param[in] eSampleType - Sample type whose thresholds are used.
+  * @note Call again whenever the table, or the sample type, changes.
+  **/
+void EcContactMapBuild(EcContactMap_t *pMap,
+                       const ElectrochemicalContact_t *pContacts,
+                       uint32_t numContacts,
+                       ElectrochemicalSampleTypes_t eSampleType)
+{
+  const ElectrochemicalContact_t *pContact;
+  uint16_t bit;
+  uint8_t numPositions;
+
+  ASSERT_NOT_NULL(pMap);
+  ASSERT_NOT_NULL(pContacts);
+  ASSERT(numContacts <= EC_CONTACT_MAP_MAX_ELECTRODES);
+  ASSERT(eSampleType < SAMPLE_TYPE_COUNT);
+
+  (void)memset(pMap, 0, sizeof(EcContactMap_t));
+  (void)memset(pMap->electrodeAt, EC_CONTACT_MAP_NO_ELECTRODE, sizeof(pMap->electrodeAt));
+
+  for (uint32_t i = 0u; i < numContacts; i++)
+  {
+    pContact = &pContacts[i];
+    bit = (uint16_t)(1u << i);
+
+    pMap->electrodeMask |= bit;
+    pMap->contactVolts[i] = pContact->thresholdVoltsContact[eSampleType];
+    pMap->noContactVolts[i] = pContact->thresholdVoltsNoContact[eSampleType];
+
+    if (pContact->isFillDetectPin)
+    {
+      pMap->fillDetectMask |= bit;
+    }
+
+    if (pContact->isStripDetectPin)
+    {
+      pMap->stripDetectMask |= bit;
+    }
+
+    if (pContact->positionInChannel < EC_CHAN_POS_COUNT)
+    {
+      for (uint32_t chan = 0u; chan < EC_STRIP_CHAN_COUNT; chan++)
+      {
+        if (pContact->mapToChannels[chan])
+        {
+          // An electrode is one position of a channel, and a position one electrode.
+          ASSERT(EC_CONTACT_MAP_NO_ELECTRODE == pMap->electrodeAt[chan][pContact->positionInChannel]);
+
+          pMap->channelMask[chan] |= bit;
+          pMap->electrodeAt[chan][pContact->positionInChannel] = (uint8_t)i;
+        }
+      }
+    }
+  }
+
+  for (uint32_t chan = 0u; chan < EC_STRIP_CHAN_COUNT; chan++)
+  {
+    numPositions = 0u;
+
+    while ((numPositions < EC_CHAN_POS_COUNT) &&
+           (EC_CONTACT_MAP_NO_ELECTRODE != pMap->electrodeAt[chan][numPositions]))
+    {
+      numPositions++;
+    }
+
+    pMap->numPositions[chan] = numPositions;
+  }
+}
+
+
+/**
+  * @brief Classifies a sweep of the strip.
+  * @details Four lanes at a time with NEON or SSE, when the compiler targets
+  *          either, and otherwise as EcContactMapClassifyScalar(). Every path
+  *          gives the same masks.
+  * @param[in] pMap - The map.
+  * @param[in] pVolts - Voltage of each electrode, EC_CONTACT_MAP_MAX_ELECTRODES
+  *                     long. Lanes past the contact table are ignored.
+  * @param[out] pContactMask - Electrodes in contact, bit per electrode.
+  * @param[out] pNoContactMask - Electrodes out of contact, bit per electrode.
+  *                              Those in neither mask are between thresholds.
+  **/
+void EcContactMapClassify(const EcContactMap_t *pMap,
+                          const float *pVolts,
+                          uint16_t *pContactMask,
+                          uint16_t *pNoContactMask)
+{
+#if defined(__ARM_NEON)
+  static const uint32_t laneBits[4] = { 1u, 2u, 4u, 8u };
+  uint32x4_t bits;
+  uint32x4_t contactLanes;
+  uint32x4_t noContactLanes;
+  uint32x2_t sums;
+  float32x4_t volts;
+#elif defined(__SSE__)
+  __m128 volts;
+#endif
+  uint32_t contactMask = 0u;
+  uint32_t noContactMask = 0u;
+
+  ASSERT_NOT_NULL(pMap);
+  ASSERT_NOT_NULL(pVolts);
+  ASSERT_NOT_NULL(pContactMask);
+  ASSERT_NOT_NULL(pNoContactMask);
+
+#if defined(__ARM_NEON)
+  bits = vld1q_u32(laneBits);
+
+  for (uint32_t i = 0u; i < EC_CONTACT_MAP_MAX_ELECTRODES; i += 4u)
+  {
+    volts = vld1q_f32(&pVolts[i]);
+    contactLanes = vandq_u32(vcltq_f32(volts, vld1q_f32(&pMap->contactVolts[i])), bits);
+    noContactLanes = vandq_u32(vcgtq_f32(volts, vld1q_f32(&pMap->noContactVolts[i])), bits);
+
+    // Each lane holds its own bit, so summing the lanes packs them.
+    sums = vpadd_u32(vadd_u32(vget_low_u32(contactLanes), vget_high_u32(contactLanes)),
+                     vadd_u32(vget_low_u32(noContactLanes), vget_high_u32(noContactLanes)));
+
+    contactMask   |= vget_lane_u32(sums, 0) << i;
+    noContactMask |= vget_lane_u32(sums, 1) << i;
+  }
+#elif defined(__SSE__)
+  for (uint32_t i = 0u; i < EC_CONTACT_MAP_MAX_ELECTRODES; i += 4u)
+  {
+    volts = _mm_loadu_ps(&pVolts[i]);
+    contactMask   |= (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(volts, _mm_loadu_ps(&pMap->contactVolts[i]))) << i;
+    noContactMask |= (uint32_t)_mm_movemask_ps(_mm_cmpgt_ps(volts, _mm_loadu_ps(&pMap->noContactVolts[i]))) << i;
+  }
+#else
+  EcContactMapClassifyScalar(pMap, pVolts, &contactMask, &noContactMask);
+#endif
+
+  // Lanes past the table compare against zeroed thresholds, so drop them.
+  *pContactMask = (uint16_t)(contactMask & pMap->electrodeMask);
+  *pNoContactMask = (uint16_t)(noContactMask & pMap->electrodeMask);
+}
+
+
+/**
+  * @brief Classifies a sweep of the strip a lane at a time.
+  * @details The path of targets with no vector unit, and the reference the
+  *          vector paths of EcContactMapClassify() are checked against.
+  * @param[in] pMap - The map.
+  * @param[in] pVolts - Voltage of each electrode, EC_CONTACT_MAP_MAX_ELECTRODES
+  *                     long.
+  * @param[out] pContactMask - Lanes below the contact threshold. Not masked to
+  *                            the contact table.
+  * @param[out] pNoContactMask - Lanes above the no contact threshold. Not
+  *                              masked to the contact table.
+  **/
+void EcContactMapClassifyScalar(const EcContactMap_t *pMap,
+                                const float *pVolts,
+                                uint32_t *pContactMask,
+                                uint32_t *pNoContactMask)
+{
+  uint32_t contactMask = 0u;
+  uint32_t noContactMask = 0u;
+
+  ASSERT_NOT_NULL(pMap);
+  ASSERT_NOT_NULL(pVolts);
+  ASSERT_NOT_NULL(pContactMask);
+  ASSERT_NOT_NULL(pNoContactMask);
+
+  for (uint32_t i = 0u; i < EC_CONTACT_MAP_MAX_ELECTRODES; i++)
+  {
+    contactMask   |= (uint32_t)(pVolts[i] < pMap->contactVolts[i]) << i;
+    noContactMask |= (uint32_t)(pVolts[i] > pMap->noContactVolts[i]) << i;
+  }
+
+  *pContactMask = contactMask;
+  *pNoContactMask = noContactMask;
+}
+
+
+/**
+  * @brief Gets the electrode at a position of a channel.
+  * @param[in] pMap - The map.
+  * @param[in] eChan - The channel.
+  * @param[in] ePos - The position. EC_CHAN_POS_NONE for none.
+  * @returns Mask of the electrode. Zero if the channel has none there.
+  **/
+uint16_t EcContactMapPositionMask(const EcContactMap_t *pMap,
+                                  eElectrochemicalChannel eChan,
+                                  eElectrochemicalChannelPos ePos)
+{
+  uint16_t mask = 0u;
+  uint8_t electrode;
+
+  ASSERT_NOT_NULL(pMap);
+  ASSERT(eChan < EC_STRIP_CHAN_COUNT);
+
+  if (ePos < EC_CHAN_POS_COUNT)
+  {
+    electrode = pMap->electrodeAt[eChan][ePos];
+
+    if (EC_CONTACT_MAP_NO_ELECTRODE != electrode)
+    {
+      mask = (uint16_t)(1u << electrode);
+    }
+  }
+
+  return mask;
+}
+
+
+/**
+  * @brief Finds how far the fluid has reached along a channel.
+  * @param[in] pMap - The map.
+  * @param[in] eChan - The channel.
+  * @param[in] wetMask - Sample of the strip, bit per electrode in contact.
+  * @returns Positions from A that are all wet. Zero if A is dry.
+  **/
+uint32_t EcContactMapWetPositions(const EcContactMap_t *pMap,
+                                  eElectrochemicalChannel eChan,
+                                  uint16_t wetMask)
+{
+  const uint8_t *pElectrode;
+  uint32_t numWet = 0u;
+
+  ASSERT_NOT_NULL(pMap);
+  ASSERT(eChan < EC_STRIP_CHAN_COUNT);
+
+  pElectrode = pMap->electrodeAt[eChan];
+
+  while ((numWet < pMap->numPositions[eChan]) &&
+         (0u != (wetMask & (1u << pElectrode[numWet]))))
+  {
+    numWet++;
+  }
+
+  return numWet;
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
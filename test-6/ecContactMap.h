@@ -0,0 +1,94 @@
+/**
+ ******************************************************************************
+ * @file   ecContactMap.h
+ * @brief  Header file for ecContactMap.c
+ ******************************************************************************
+ */
+
+
+#ifndef EC_CONTACT_MAP_H_
+#define EC_CONTACT_MAP_H_
+
+#include "poci.h"
+#include "electrochemicalTypes.h"
+
+
+/**
+ * @defgroup ecContactMap Electrode Contact Map
+ * @brief The contact table, compiled into bitmasks for per-sample lookups.
+ * @details The contact table says, per electrode, which channels it maps to
+ *          and which position it is in them. Classifying a sample from it
+ *          means walking every electrode for every channel. The map turns it
+ *          around once, when the table is set or changed: per channel, the
+ *          electrodes in position order, and bitmasks over the electrodes.
+ *
+ *          A sample is then a wet mask, bit per electrode, and a channel's
+ *          fluid front is found by following its positions through the mask
+ *          until the first dry one.
+ *
+ *          The thresholds of the sample type in use are held as one vector per
+ *          threshold, a lane per electrode, so a whole sweep is classified by
+ *          one fixed length loop, with no test per channel or position. Where
+ *          the compiler targets NEON (__ARM_NEON) or SSE (__SSE__) the loop
+ *          takes four lanes at a time. Otherwise, as on the Cortex-M parts,
+ *          it takes one, as EcContactMapClassifyScalar() does.
+ *
+ *          Electrochemical_t holds the map of its contact table, contactMap.
+ *          It is rebuilt with each sample type and contact config update, as
+ *          the host simulator's ecSetSampleType() and EcUpdateContactConfig()
+ *          do. The scan schedule reads it on each change of focus.
+ *  @{
+ */
+
+
+/// Electrodes a map can hold, one bit each in a mask.
+#define EC_CONTACT_MAP_MAX_ELECTRODES   16u
+
+/// Marks a position with no electrode in a channel.
+#define EC_CONTACT_MAP_NO_ELECTRODE     0xFFu
+
+
+/**
+  *     @brief The compiled contact table.
+  **/
+typedef struct EcContactMap_tag
+{
+  uint16_t        electrodeMask;                                            ///< Electrodes of the contact table.
+  uint16_t        channelMask[EC_STRIP_CHAN_COUNT];                         ///< Electrodes mapped to each channel.
+  uint8_t         electrodeAt[EC_STRIP_CHAN_COUNT][EC_CHAN_POS_COUNT];      ///< Electrode at each position of each channel, or EC_CONTACT_MAP_NO_ELECTRODE.
+  uint8_t         numPositions[EC_STRIP_CHAN_COUNT];                        ///< Positions from A with an electrode, with no gap.
+  uint16_t        fillDetectMask;                                           ///< Fill detection electrodes.
+  uint16_t        stripDetectMask;                                          ///< Strip detection electrodes.
+  float           contactVolts[EC_CONTACT_MAP_MAX_ELECTRODES];              ///< In contact below this, for the sample type.
+  float           noContactVolts[EC_CONTACT_MAP_MAX_ELECTRODES];            ///< Out of contact above this, for the sample type.
+}
+EcContactMap_t;
+
+
+/** @} */
+void       EcContactMapBuild(EcContactMap_t *pMap,
+                             const ElectrochemicalContact_t *pContacts,
+                             uint32_t numContacts,
+                             ElectrochemicalSampleTypes_t eSampleType);
+
+void       EcContactMapClassify(const EcContactMap_t *pMap,
+                                const float *pVolts,
+                                uint16_t *pContactMask,
+                                uint16_t *pNoContactMask);
+
+void       EcContactMapClassifyScalar(const EcContactMap_t *pMap,
+                                      const float *pVolts,
+                                      uint32_t *pContactMask,
+                                      uint32_t *pNoContactMask);
+
+uint16_t   EcContactMapPositionMask(const EcContactMap_t *pMap,
+                                    eElectrochemicalChannel eChan,
+                                    eElectrochemicalChannelPos ePos);
+
+uint32_t   EcContactMapWetPositions(const EcContactMap_t *pMap,
+                                    eElectrochemicalChannel eChan,
+                                    uint16_t wetMask);
+
+#endif
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,176 @@
+/**
+******************************************************************************
+* @file         ecPstatStream.c
+* @brief        Potentiostat block stream.
+* @details      Two blocks, filled in turn. A block is emptied by its last
+*               release, so a block with no references is always ready to fill.
+******************************************************************************
+*/
+
+#include "ecPstatStream.h"
+
+/**
+* @addtogroup ecPstatStream
+*  @{
+*/
+
+STATIC void EcPstatStreamPublish(EcPstatStream_t *pStream, EcPstatStreamBlock_t *pBlock);
+
+
+/**
+  * @brief Initialises a stream, with both blocks empty.
+  * @param[in] pStream - The stream.
+  * @param[in] numConsumers - Receivers of each published block, each of which
+  *                           releases it once.
+  **/
+void EcPstatStreamInit(EcPstatStream_t *pStream, uint32_t numConsumers)
+{
+  ASSERT_NOT_NULL(pStream);
+  ASSERT(numConsumers > 0u);
+
+  (void)memset(pStream, 0, sizeof(EcPstatStream_t));
+
+  pStream->numConsumers = numConsumers;
+}
+
+
+/**
+  * @brief Adds a result to the block being filled.
+  * @param[in] pStream - The stream.
+  * @param[in] pResults - The result.
+  * @returns The block, if the result filled it, to publish. It holds a reference
+  *          per consumer. NULL otherwise, including when the result was dropped.
+  **/
+EcPstatStreamBlock_t* EcPstatStreamAdd(EcPstatStream_t *pStream,
+                                       const EcPotentiostatResults_t *pResults)
+{
+  EcPstatStreamBlock_t *pBlock;
+  EcPstatStreamBlock_t *pFull = NULL;
+
+  ASSERT_NOT_NULL(pStream);
+  ASSERT_NOT_NULL(pResults);
+
+  pBlock = &(pStream->blocks[pStream->fillIndex]);
+
+  if (0u != pBlock->refCount)
+  {
+    // Still being read. Keep what the consumers see intact.
+    pStream->numDropped++;
+  }
+  else
+  {
+    pBlock->samples[pBlock->numSamples] = *pResults;
+    pBlock->numSamples++;
+
+    if (EC_PSTAT_STREAM_BLOCK_SAMPLES == pBlock->numSamples)
+    {
+      EcPstatStreamPublish(pStream, pBlock);
+      pFull = pBlock;
+    }
+  }
+
+  return pFull;
+}
+
+
+/**
+  * @brief Ends the block being filled early, as when the measurement stops.
+  * @param[in] pStream - The stream.
+  * @returns The block, to publish, holding a reference per consumer. NULL if
+  *          it is empty.
+  **/
+EcPstatStreamBlock_t* EcPstatStreamFlush(EcPstatStream_t *pStream)
+{
+  EcPstatStreamBlock_t *pBlock;
+  EcPstatStreamBlock_t *pPartial = NULL;
+
+  ASSERT_NOT_NULL(pStream);
+
+  pBlock = &(pStream->blocks[pStream->fillIndex]);
+
+  if ((0u == pBlock->refCount) && (pBlock->numSamples > 0u))
+  {
+    EcPstatStreamPublish(pStream, pBlock);
+    pPartial = pBlock;
+  }
+
+  return pPartial;
+}
+
+
+/**
+  * @brief Drops a consumer's reference to a block, emptying it with the last.
+  * @param[in] pStream - The stream.
+  * @param[in] pBlock - The block. Must be from the stream, and published.
+  **/
+void EcPstatStreamRelease(EcPstatStream_t *pStream,
+                          const EcPstatStreamBlock_t *pBlock)
+{
+  EcPstatStreamBlock_t *pHeld;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(pStream);
+  ASSERT(EcPstatStreamOwns(pStream, pBlock));
+
+  pHeld = &(pStream->blocks[pBlock - pStream->blocks]);
+
+  critical = XPortCriticalEnter();
+
+  ASSERT(pHeld->refCount > 0u);
+  pHeld->refCount--;
+
+  if (0u == pHeld->refCount)
+  {
+    pHeld->numSamples = 0u;
+  }
+
+  XPortCriticalExit(critical);
+}
+
+
+/**
+  * @brief Checks whether a block is from a stream.
+  * @param[in] pStream - The stream.
+  * @param[in] pBlock - The block.
+  * @returns True if pBlock is one of the stream's blocks.
+  **/
+bool EcPstatStreamOwns(const EcPstatStream_t *pStream,
+                       const EcPstatStreamBlock_t *pBlock)
+{
+  bool isOwned = false;
+
+  ASSERT_NOT_NULL(pStream);
+
+  for (uint32_t i = 0u; i < EC_PSTAT_STREAM_NUM_BLOCKS; i++)
+  {
+    if (pBlock == &(pStream->blocks[i]))
+    {
+      isOwned = true;
+    }
+  }
+
+  return isOwned;
+}
+
+
+/**
+  * @brief Hands a block to the consumers, and moves filling on to the next.
+  * @param[in] pStream - The stream.
+  * @param[in] pBlock - The block being filled.
+  **/
+STATIC void EcPstatStreamPublish(EcPstatStream_t *pStream, EcPstatStreamBlock_t *pBlock)
+{
+  pBlock->seq = pStream->numPublished;
+  pBlock->refCount = pStream->numConsumers;
+
+  pStream->numPublished++;
+  pStream->fillIndex = (pStream->fillIndex + 1u) % EC_PSTAT_STREAM_NUM_BLOCKS;
+}
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
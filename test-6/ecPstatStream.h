@@ -0,0 +1,94 @@
+/**
+ ******************************************************************************
+ * @file   ecPstatStream.h
+ * @brief  Header file for ecPstatStream.c
+ ******************************************************************************
+ */
+
+
+#ifndef EC_PSTAT_STREAM_H_
+#define EC_PSTAT_STREAM_H_
+
+#include "poci.h"
+#include "ecPotentiostat.h"
+#include "xPort.h"
+
+
+/**
+ * @defgroup ecPstatStream Potentiostat Block Stream
+ * @brief Potentiostat results, published a block at a time.
+ * @details Publishing each potentiostat result as its own event costs one
+ *          event per sample, through the queues of the echem object and of
+ *          every consumer. A stream instead fills blocks of
+ *          EC_PSTAT_STREAM_BLOCK_SAMPLES results. A full block is published
+ *          in place, as a handle to the block and its count, and the next
+ *          samples go to the other block whilst the consumers read it.
+ *
+ *          A published block holds one reference per consumer. Each consumer
+ *          releases the block once it has read it, and the block can be
+ *          filled again with the last release. If the potentiostat gets back
+ *          round to a block that is still held, its samples are dropped and
+ *          counted until the block is released, rather than written over
+ *          what a consumer is reading.
+ *
+ *          Blocks are filled by one thread, and can be released from any.
+ *
+ *          numConsumers is fixed at EcPstatStreamInit(), so every subscriber
+ *          to the block event must release each block exactly once, whether
+ *          or not it reads it. One that never releases leaves the producer
+ *          dropping from its second block on.
+ *  @{
+ */
+
+
+/// Results per block.
+#define EC_PSTAT_STREAM_BLOCK_SAMPLES   32u
+
+/// Blocks of a stream. One filling whilst the other is read.
+#define EC_PSTAT_STREAM_NUM_BLOCKS      2u
+
+
+/**
+  *     @brief A block of results.
+  **/
+typedef struct EcPstatStreamBlock_tag
+{
+  EcPotentiostatResults_t       samples[EC_PSTAT_STREAM_BLOCK_SAMPLES];
+  uint32_t                      numSamples;             ///< Results in samples.
+  uint32_t                      seq;                    ///< Blocks published before this one.
+  uint32_t                      refCount;               ///< 0 whilst the block is not published.
+}
+EcPstatStreamBlock_t;
+
+
+/**
+  *     @brief A stream.
+  **/
+typedef struct EcPstatStream_tag
+{
+  EcPstatStreamBlock_t          blocks[EC_PSTAT_STREAM_NUM_BLOCKS];
+  uint32_t                      fillIndex;              ///< Block being filled.
+  uint32_t                      numConsumers;           ///< References a published block holds.
+  uint32_t                      numPublished;
+  uint32_t                      numDropped;             ///< Results dropped as the block to fill was still held.
+}
+EcPstatStream_t;
+
+
+/** @} */
+void       EcPstatStreamInit(EcPstatStream_t *pStream, uint32_t numConsumers);
+
+EcPstatStreamBlock_t*  EcPstatStreamAdd(EcPstatStream_t *pStream,
+                                        const EcPotentiostatResults_t *pResults);
+
+EcPstatStreamBlock_t*  EcPstatStreamFlush(EcPstatStream_t *pStream);
+
+void       EcPstatStreamRelease(EcPstatStream_t *pStream,
+                                const EcPstatStreamBlock_t *pBlock);
+
+bool       EcPstatStreamOwns(const EcPstatStream_t *pStream,
+                             const EcPstatStreamBlock_t *pBlock);
+
+#endif
+
+/********************************** End Of File ******************************/
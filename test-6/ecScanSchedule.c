@@ -0,0 +1,292 @@
+/**
+******************************************************************************
+* @file         ecScanSchedule.c
+* @brief        Electrode scan schedule of the fill detection.
+* @details      Earliest deadline first over the strip's electrodes, with the
+*               deadline of each electrode set by whether a moving channel is
+*               waiting on it, or a holding channel watching it.
+******************************************************************************
+*/
+
+#include "ecScanSchedule.h"
+#include "electrochemical.h"
+#include "xPort.h"
+
+/**
+* @addtogroup ecScanSchedule
+*  @{
+*/
+
+STATIC void EcScanScheduleFocusMaskUpdate(EcScanSchedule_t *pSchedule);
+
+
+/**
+  * @brief Initialises a schedule, with no channel focused.
+  * @param[in] pSchedule - The schedule.
+  * @param[in] pMap - Contact map of the strip. Read on each change of focus,
+  *                   so a rebuild of it applies from then.
+  **/
+void EcScanScheduleInit(EcScanSchedule_t *pSchedule,
+                        const EcContactMap_t *pMap)
+{
+  ASSERT_NOT_NULL(pSchedule);
+  ASSERT_NOT_NULL(pMap);
+
+  (void)memset(pSchedule, 0, sizeof(EcScanSchedule_t));
+
+  pSchedule->pMap = pMap;
+
+  for (uint32_t i = 0u; i < EC_STRIP_CHAN_COUNT; i++)
+  {
+    pSchedule->focus[i] = EC_CHAN_POS_NONE;
+  }
+
+  // Sweep in electrode order, as the CPLD did.
+  for (uint32_t i = 0u; i < EC_SCAN_NUM_ELECTRODES; i++)
+  {
+    pSchedule->dueSlot[i] = i;
+  }
+}
+
+
+/**
+  * @brief Sets the position a channel is waiting on.
+  * @param[in] pSchedule - The schedule.
+  * @param[in] eChan - The channel.
+  * @param[in] ePos - The position, or EC_CHAN_POS_NONE once the channel stops.
+  * @note Newly focused electrodes are due straight away.
+  **/
+void EcScanScheduleFocus(EcScanSchedule_t *pSchedule,
+                         eElectrochemicalChannel eChan,
+                         eElectrochemicalChannelPos ePos)
+{
+  ASSERT_NOT_NULL(pSchedule);
+  ASSERT(eChan < EC_STRIP_CHAN_COUNT);
+  ASSERT((ePos < EC_CHAN_POS_COUNT) || (EC_CHAN_POS_NONE == ePos));
+
+  if (ePos != pSchedule->focus[eChan])
+  {
+    pSchedule->focus[eChan] = ePos;
+    EcScanScheduleFocusMaskUpdate(pSchedule);
+  }
+}
+
+
+/**
+  * @brief Holds a channel's electrodes at the sweep rate, or releases them.
+  * @param[in] pSchedule - The schedule.
+  * @param[in] eChan - The channel.
+  * @param[in] isWatched - True whilst the channel monitors its fluid front.
+  * @note Newly watched electrodes are due straight away.
+  **/
+void EcScanScheduleWatch(EcScanSchedule_t *pSchedule,
+                         eElectrochemicalChannel eChan,
+                         bool isWatched)
+{
+  ASSERT_NOT_NULL(pSchedule);
+  ASSERT(eChan < EC_STRIP_CHAN_COUNT);
+
+  if (isWatched != pSchedule->isWatched[eChan])
+  {
+    pSchedule->isWatched[eChan] = isWatched;
+    EcScanScheduleFocusMaskUpdate(pSchedule);
+  }
+}
+
+
+/**
+  * @brief Takes the electrode to sample in the next slot.
+  * @param[in] pSchedule - The schedule.
+  * @returns Index of the electrode in the contact table.
+  **/
+uint32_t EcScanScheduleNext(EcScanSchedule_t *pSchedule)
+{
+  uint32_t electrode = 0u;
+  uint32_t period;
+  int32_t lateness;
+  int32_t maxLateness = INT32_MIN;
+  bool isFocused;
+  bool isChosenFocused = false;
+
+  ASSERT_NOT_NULL(pSchedule);
+
+  for (uint32_t i = 0u; i < EC_SCAN_NUM_ELECTRODES; i++)
+  {
+    lateness = (int32_t)(pSchedule->slot - pSchedule->dueSlot[i]);
+    isFocused = EcScanScheduleIsFocused(pSchedule, i);
+
+    if ((lateness > maxLateness) ||
+        ((lateness == maxLateness) && isFocused && (false == isChosenFocused)))
+    {
+      electrode = i;
+      maxLateness = lateness;
+      isChosenFocused = isFocused;
+    }
+  }
+
+  if (isChosenFocused)
+  {
+    period = EC_SCAN_FOCUS_PERIOD_SLOTS;
+  }
+  else if ((0u != pSchedule->focusMask) &&
+           (0u == (pSchedule->watchMask & (1u << electrode))))
+  {
+    period = EC_SCAN_BACKGROUND_PERIOD_SLOTS;
+  }
+  else
+  {
+    period = EC_SCAN_SWEEP_SLOTS;
+  }
+
+  pSchedule->dueSlot[electrode] = pSchedule->slot + period;
+  pSchedule->slot++;
+
+  return electrode;
+}
+
+
+/**
+  * @brief Checks whether a channel is waiting on an electrode.
+  * @param[in] pSchedule - The schedule.
+  * @param[in] electrode - Index of the electrode in the contact table.
+  * @returns True if the electrode is sampled at the focus rate.
+  **/
+bool EcScanScheduleIsFocused(const EcScanSchedule_t *pSchedule, uint32_t electrode)
+{
+  ASSERT_NOT_NULL(pSchedule);
+  ASSERT(electrode < EC_SCAN_NUM_ELECTRODES);
+
+  return (0u != (pSchedule->focusMask & (1u << electrode)));
+}
+
+
+/**
+  * @brief Works out which electrodes are focused and watched, from the
+  *        channel focuses and watches.
+  * @param[in] pSchedule - The schedule.
+  **/
+STATIC void EcScanScheduleFocusMaskUpdate(EcScanSchedule_t *pSchedule)
+{
+  uint16_t focusMask = 0u;
+  uint16_t watchMask = 0u;
+  uint16_t newlyDue;
+
+  for (uint32_t chan = 0u; chan < EC_STRIP_CHAN_COUNT; chan++)
+  {
+    focusMask |= EcContactMapPositionMask(pSchedule->pMap,
+                                          (eElectrochemicalChannel)chan,
+                                          pSchedule->focus[chan]);
+
+    if (pSchedule->isWatched[chan])
+    {
+      watchMask |= pSchedule->pMap->channelMask[chan];
+    }
+  }
+
+  watchMask &= (uint16_t)~focusMask;
+  newlyDue = (uint16_t)((focusMask & ~pSchedule->focusMask) |
+                        (watchMask & ~pSchedule->watchMask));
+
+  for (uint32_t i = 0u; i < EC_SCAN_NUM_ELECTRODES; i++)
+  {
+    if (0u != (newlyDue & (1u << i)))
+    {
+      pSchedule->dueSlot[i] = pSchedule->slot;
+    }
+  }
+
+  pSchedule->focusMask = focusMask;
+  pSchedule->watchMask = watchMask;
+}
+
+
+#ifdef EC_SCAN_SCHEDULE
+/**
+  * @brief Sets the position a channel waits on, in the echem's schedule.
+  * @param[in] me - The echem object.
+  * @param[in] eChan - The channel.
+  * @param[in] ePos - The position, or EC_CHAN_POS_NONE for none.
+  * @retval OK_STATUS The focus is set.
+  * @retval ERROR_BAD_ARGS The channel or position is not of the strip.
+  **/
+eErrorCode ecSetScanFocus(Electrochemical_t *me,
+                          eElectrochemicalChannel eChan,
+                          eElectrochemicalChannelPos ePos)
+{
+  eErrorCode error = ERROR_BAD_ARGS;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(me);
+
+  if ((eChan < EC_STRIP_CHAN_COUNT) &&
+      ((ePos < EC_CHAN_POS_COUNT) || (EC_CHAN_POS_NONE == ePos)))
+  {
+    critical = XPortCriticalEnter();
+    EcScanScheduleFocus(&me->scanSchedule, eChan, ePos);
+    XPortCriticalExit(critical);
+
+    error = OK_STATUS;
+  }
+
+  return error;
+}
+
+
+/**
+  * @brief Holds a channel's electrodes at the sweep rate in the echem's
+  *        schedule, or releases them.
+  * @param[in] me - The echem object.
+  * @param[in] eChan - The channel.
+  * @param[in] isWatched - True whilst the channel monitors its fluid front.
+  * @retval OK_STATUS The watch is set.
+  * @retval ERROR_BAD_ARGS The channel is not of the strip.
+  **/
+eErrorCode ecSetScanWatch(Electrochemical_t *me,
+                          eElectrochemicalChannel eChan,
+                          bool isWatched)
+{
+  eErrorCode error = ERROR_BAD_ARGS;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(me);
+
+  if (eChan < EC_STRIP_CHAN_COUNT)
+  {
+    critical = XPortCriticalEnter();
+    EcScanScheduleWatch(&me->scanSchedule, eChan, isWatched);
+    XPortCriticalExit(critical);
+
+    error = OK_STATUS;
+  }
+
+  return error;
+}
+
+
+/**
+  * @brief Takes the electrode to sample in the next slot of the echem's schedule.
+  * @param[in] me - The echem object.
+  * @returns Index of the electrode in the contact table.
+  **/
+uint32_t ecScanNextElectrode(Electrochemical_t *me)
+{
+  uint32_t electrode;
+  uint32_t critical;
+
+  ASSERT_NOT_NULL(me);
+
+  critical = XPortCriticalEnter();
+  electrode = EcScanScheduleNext(&me->scanSchedule);
+  XPortCriticalExit(critical);
+
+  return electrode;
+}
+#endif
+
+
+/**
+* @}
+*/
+
+
+/********************************** End Of File ******************************/
@@ -0,0 +1,100 @@
+/**
+ ******************************************************************************
+ * @file   ecScanSchedule.h
+ * @brief  Header file for ecScanSchedule.c
+ ******************************************************************************
+ */
+
+
+#ifndef EC_SCAN_SCHEDULE_H_
+#define EC_SCAN_SCHEDULE_H_
+
+#include "poci.h"
+#include "electrochemicalTypes.h"
+#include "ecContactMap.h"
+
+
+/**
+ * @defgroup ecScanSchedule Electrode Scan Schedule
+ * @brief Chooses which strip electrode the CPLD samples in each 5ms slot.
+ * @details A full sweep of the strip takes ECHEM_UPDATE_PERIOD_MS, so a moving
+ *          channel can wait that long to see the contact it is moving to.
+ *          A channel's focus is the position in the channel whose contact it
+ *          is waiting on. Electrodes at a focus, by the contact map, are
+ *          sampled every EC_SCAN_FOCUS_PERIOD_SLOTS. Every other electrode is
+ *          sampled every EC_SCAN_BACKGROUND_PERIOD_SLOTS while any focus is
+ *          set, and every EC_SCAN_SWEEP_SLOTS otherwise, as the plain sweep did.
+ *          A watched channel, one holding its fluid front for breach
+ *          monitoring, keeps all of its electrodes at EC_SCAN_SWEEP_SLOTS
+ *          whatever the other channels focus on.
+ *
+ *          Each slot goes to the electrode most overdue, focused electrodes
+ *          first on a tie. When more channels are focused than the slots
+ *          allow, every electrode slips by the same share rather than any
+ *          being starved.
+ *
+ *          The schedule follows the contact map it was given, so a rebuilt
+ *          map, after a sample type or contact config update, applies from
+ *          the next change of focus or watch.
+ *
+ *          With EC_SCAN_SCHEDULE defined, the echem owns a schedule, and this
+ *          module also provides the echem methods over it. Fluid controllers
+ *          call ecSetScanFocus() and ecSetScanWatch() from their own threads,
+ *          and the echem takes each slot's electrode with
+ *          ecScanNextElectrode(), so all three hold a critical section.
+ *  @{
+ */
+
+
+/// Time the CPLD takes to sample one electrode.
+#define EC_SCAN_SLOT_MS                    5u
+
+/// Electrodes of a 15-contact strip.
+#define EC_SCAN_NUM_ELECTRODES             15u
+
+/// Slots of a full sweep of the strip. Matches ECHEM_UPDATE_PERIOD_MS.
+#define EC_SCAN_SWEEP_SLOTS                16u
+
+/// Slots between samples of a focused electrode. One per 20ms read of the CPLD.
+#define EC_SCAN_FOCUS_PERIOD_SLOTS         4u
+
+/// Slots between samples of the other electrodes while any channel is focused.
+/// Watched electrodes stay at EC_SCAN_SWEEP_SLOTS.
+#define EC_SCAN_BACKGROUND_PERIOD_SLOTS    32u
+
+
+/**
+  *     @brief The schedule.
+  **/
+typedef struct EcScanSchedule_tag
+{
+  const EcContactMap_t            *pMap;                                  ///< Contact map of the strip.
+  eElectrochemicalChannelPos      focus[EC_STRIP_CHAN_COUNT];             ///< Position each channel waits on. EC_CHAN_POS_NONE if none.
+  uint16_t                        focusMask;                              ///< Electrodes mapped to a focus, bit per electrode.
+  bool                            isWatched[EC_STRIP_CHAN_COUNT];         ///< Channel is held at the sweep rate.
+  uint16_t                        watchMask;                              ///< Electrodes of watched channels, and not focused, bit per electrode.
+  uint32_t                        dueSlot[EC_SCAN_NUM_ELECTRODES];        ///< Slot each electrode is next due in.
+  uint32_t                        slot;                                   ///< Slots scheduled so far.
+}
+EcScanSchedule_t;
+
+
+/** @} */
+void       EcScanScheduleInit(EcScanSchedule_t *pSchedule,
+                              const EcContactMap_t *pMap);
+
+void       EcScanScheduleFocus(EcScanSchedule_t *pSchedule,
+                               eElectrochemicalChannel eChan,
+                               eElectrochemicalChannelPos ePos);
+
+void       EcScanScheduleWatch(EcScanSchedule_t *pSchedule,
+                               eElectrochemicalChannel eChan,
+                               bool isWatched);
+
+uint32_t   EcScanScheduleNext(EcScanSchedule_t *pSchedule);
+
+bool       EcScanScheduleIsFocused(const EcScanSchedule_t *pSchedule, uint32_t electrode);
+
+#endif
+
+/********************************** End Of File ******************************/
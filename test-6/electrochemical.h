@@ -25,6 +25,8 @@
 #include "ecFluidDetect.h"
 #include "ecPotentiostat.h"
 #include "ecPinMapping.h"
+#include "ecContactMap.h"
+#include "ecScanSchedule.h"
 
 
 #define DEFAULT_PSTAT_A_REF_VOLTS (SD_ADC_REF_VOLTAGE)
@@ -51,8 +53,20 @@ X_SUBSCRIBE(me_, XMSG_FLUID_STOP_BLDDR_DETECT) \
 X_SUBSCRIBE(me_, XMSG_FLUID_MONITOR_STOP_BLDDR_DETECT) \
 X_SUBSCRIBE_TO_GLOBAL_EVENTS(me_)
 
+/// Defined by builds whose echem runs the ecScanSchedule electrode scan. The
+/// host simulator's echem always does. A target build opts in by defining it,
+/// with ecScanSchedule.c linked, once its echem initialises scanSchedule over
+/// contactMap and has the CPLD sample ecScanNextElectrode() in each slot.
+/// Fluid controllers then focus the scan with ecSetScanFocus() and
+/// ecSetScanWatch().
+#if defined(FLUIDIC_HOST_SIM) && !defined(EC_SCAN_SCHEDULE)
+#define EC_SCAN_SCHEDULE
+#endif
+
 // 5ms per electrode, 15 pins to sample. Therefore 75ms update period in CPLD.
 // Can only sample on 20ms intervals.
+// With EC_SCAN_SCHEDULE, a channel's focused contact is sampled every 20ms,
+// see ecSetScanFocus().
 #define ECHEM_UPDATE_PERIOD_MS 80u
 
 #define BLADDER_DOWN_LOW_END	  (1.7f) ///< in Volts, based on 2.5V ref and 1.5V Bias voltage
@@ -170,11 +184,15 @@ EcDisableMsg_t;
   *@brief    Event used to indicate that the fluid detect status has changed.
   *@details  This is used to indicate that any channel has been updated.
   *           The initial fill, and strip status, are published separately.
+  *           sweepMs is set as the sweep is taken, so consumers can time
+  *           their reaction from the measurement rather than from handling
+  *           the event.
   **/
 typedef struct FillDetectStatusChange_tag
 {
     XEvent_t                    super;                                          ///< Base event class
     EcFluidDetectResults_t              results;                                ///< Fill detect results.
+    uint32_t                            sweepMs;                                ///< XPortTimeNowMs() of the sweep which found the change.
 }
 FillDetectStatusChange_t;
 
@@ -276,6 +294,10 @@ typedef struct Electrochemical_tag
   FillDetectState_t                     fillDetectState;                        ///< The current fill detection state.
   
   ElectrochemicalSampleTypes_t          eSampleType;                            ///< The sample type being used for the current measurement types.
+  EcContactMap_t                        contactMap;                             ///< pContacts compiled for eSampleType. Rebuilt by the sample type and contact config updates.
+#ifdef EC_SCAN_SCHEDULE
+  EcScanSchedule_t                      scanSchedule;                           ///< Order the CPLD samples the electrodes in, over contactMap.
+#endif
   
   ElectrochemicalBladderDownStatus_t    bladderDownStatuses[EC_STRIP_CHAN_COUNT];
   float                                 bladderDownLastVolts[EC_STRIP_CHAN_COUNT];
@@ -370,6 +392,18 @@ eErrorCode EcWaitForFillDetect(Electrochemical_t *me);
 
 eErrorCode ecDisable(Electrochemical_t *me, eElectrochemicalChannel eChan);
 
+#ifdef EC_SCAN_SCHEDULE
+eErrorCode ecSetScanFocus(Electrochemical_t *me,
+                          eElectrochemicalChannel eChan,
+                          eElectrochemicalChannelPos ePos);
+
+eErrorCode ecSetScanWatch(Electrochemical_t *me,
+                          eElectrochemicalChannel eChan,
+                          bool isWatched);
+
+uint32_t   ecScanNextElectrode(Electrochemical_t *me);
+#endif
+
 eErrorCode ecSetModePotentiostat(Electrochemical_t *me,
                                  eElectrochemicalChannel eChan,
                                  EcPotentiostatParams_t *pParams);